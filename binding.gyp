@@ -7,6 +7,7 @@
       'SODIUM_STATIC=1',
       'DEV_MODE=0',
       'CONFIGURED=1',
+      'NAPI_VERSION=8',
     ],
     'sources': [
       "deps/pomelo-udp-native/include/pomelo/statistic/statistic-allocator.h",
@@ -246,11 +247,17 @@
       "deps/pomelo-udp-native/deps/libsodium/src/libsodium/sodium/core.c",
       "deps/pomelo-udp-native/deps/libsodium/src/libsodium/sodium/runtime.c",
       "deps/pomelo-udp-native/deps/libsodium/src/libsodium/sodium/utils.c",
+      "src/bitstream.c",
+      "src/bitstream.h",
       "src/channel.c",
       "src/channel.h",
       "src/context.c",
       "src/context.h",
       "src/error.h",
+      "src/group.c",
+      "src/group.h",
+      "src/handle.c",
+      "src/handle.h",
       "src/message.c",
       "src/message.h",
       "src/module.c",
@@ -259,6 +266,10 @@
       "src/platform.h",
       "src/plugin.c",
       "src/plugin.h",
+      "src/pool.c",
+      "src/pool.h",
+      "src/schema.c",
+      "src/schema.h",
       "src/session.c",
       "src/session.h",
       "src/socket.c",
@@ -372,6 +383,8 @@
       "deps/pomelo-udp-native/src/utils/mutex.h",
       "deps/pomelo-udp-native/src/utils/pool.c",
       "deps/pomelo-udp-native/src/utils/pool.h",
+      "src/platforms/platform-napi/address.c",
+      "src/platforms/platform-napi/address.h",
       "src/platforms/platform-napi/platform-napi.c",
       "src/platforms/platform-napi/platform-napi.h",
       "src/platforms/platform-napi/threadsafe.c",
@@ -384,6 +397,8 @@
       "src/platforms/platform-napi/udp.h",
       "src/platforms/platform-napi/worker.c",
       "src/platforms/platform-napi/worker.h",
+      "src/platforms/platform-napi/worker-pool.c",
+      "src/platforms/platform-napi/worker-pool.h",
       "src/platform.h",
     ],
     'include_dirs': [
@@ -411,5 +426,55 @@
         ],
       }]
     ]
-  }]
+  }],
+  # recvmmsg/sendmmsg are Linux-only
+  'conditions': [
+    ['OS=="linux"', {
+      'targets': [{
+        'target_name': 'pomelo-udp-node-platform-mmsg',
+        'defines': [
+          'V8_DEPRECATION_WARNINGS=1',
+          '_CRT_INTERNAL_NONSTDC_NAMES=1',
+        ],
+        'sources': [
+          "deps/pomelo-udp-native/src/base/allocator.c",
+          "deps/pomelo-udp-native/src/base/address.c",
+          "deps/pomelo-udp-native/src/base/extra.h",
+          "deps/pomelo-udp-native/src/platform/uv/executor.c",
+          "deps/pomelo-udp-native/src/platform/uv/executor.h",
+          "deps/pomelo-udp-native/src/platform/uv/platform-uv.c",
+          "deps/pomelo-udp-native/src/platform/uv/platform-uv.h",
+          "deps/pomelo-udp-native/src/platform/uv/time.c",
+          "deps/pomelo-udp-native/src/platform/uv/timer.c",
+          "deps/pomelo-udp-native/src/platform/uv/timer.h",
+          "deps/pomelo-udp-native/src/platform/uv/udp.c",
+          "deps/pomelo-udp-native/src/platform/uv/udp.h",
+          "deps/pomelo-udp-native/src/platform/uv/worker.c",
+          "deps/pomelo-udp-native/src/platform/uv/worker.h",
+          "deps/pomelo-udp-native/src/platform/platform.h",
+          "deps/pomelo-udp-native/src/utils/atomic.c",
+          "deps/pomelo-udp-native/src/utils/atomic.h",
+          "deps/pomelo-udp-native/src/utils/list.c",
+          "deps/pomelo-udp-native/src/utils/list.h",
+          "deps/pomelo-udp-native/src/utils/mutex.c",
+          "deps/pomelo-udp-native/src/utils/mutex.h",
+          "deps/pomelo-udp-native/src/utils/pool.c",
+          "deps/pomelo-udp-native/src/utils/pool.h",
+          "src/platforms/platform-mmsg/platform-mmsg.c",
+          "src/platforms/platform-mmsg/platform-mmsg.h",
+          "src/platforms/platform-mmsg/udp.c",
+          "src/platforms/platform-mmsg/udp.h",
+          "src/platform.h",
+        ],
+        'include_dirs': [
+          "<(module_root_dir)/deps/pomelo-udp-native/include",
+          "<(module_root_dir)/deps/pomelo-udp-native/src",
+          "<(module_root_dir)/src",
+        ],
+        'dependencies': [],
+        'cflags!': ['-fno-exceptions'],
+        'cflags_cc!': ['-fno-exceptions'],
+      }]
+    }]
+  ]
 }
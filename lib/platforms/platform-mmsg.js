@@ -0,0 +1,51 @@
+import bindings from "bindings";
+
+/**
+ * Node.js platform using libuv for timers and workers, and recvmmsg/sendmmsg
+ * for UDP sockets.
+ *
+ * Note: This implementation is only available on Linux.
+ *
+ * POMELO_MMSG_GSO=1 coalesces same-sized datagrams to the same target with
+ * UDP_SEGMENT, POMELO_MMSG_GRO=1 enables UDP_GRO on sockets. Both fall back
+ * to plain datagrams if the kernel does not support them.
+ * POMELO_MMSG_REUSEPORT=1 sets SO_REUSEPORT on server sockets, which is used
+ * by the sharded socket (see lib/shard.js).
+ */
+
+/**
+ * @type {Object | null}
+ */
+let platform = null;
+
+/**
+ * @returns {Object} The platform
+ */
+export function initPlatformMMSG() {
+    if (platform) {
+        return platform;
+    }
+
+    if (process.platform !== "linux") {
+        throw new Error('Platform mmsg is only available on Linux');
+    }
+
+    const initializer = bindings({
+        bindings: "pomelo-udp-node-platform-mmsg",
+        module_root: process.env.POMELO_MODULE_ROOT
+    });
+    if (!initializer || typeof initializer !== 'function') {
+        throw new Error('Failed to initialize native platform module');
+    }
+
+    platform = initializer({
+        gso: process.env.POMELO_MMSG_GSO === "1",
+        gro: process.env.POMELO_MMSG_GRO === "1",
+        reusePort: process.env.POMELO_MMSG_REUSEPORT === "1"
+    });
+    if (!platform) {
+        throw new Error('Failed to initialize native platform module');
+    }
+
+    return platform;
+};
@@ -1,4 +1,5 @@
 import { hrtime } from 'node:process';
+import { availableParallelism } from 'node:os';
 import dgram from 'node:dgram';
 import bindings from "bindings";
 
@@ -17,6 +18,90 @@ const SERVER_SOCKET_RCVBUF_SIZE = 4 * 1024 * 1024;
 const SOCKET_MODE_SERVER = 0;
 const SOCKET_MODE_CLIENT = 1;
 
+const RECV_QUEUE_INITIAL_CAPACITY = 64;
+
+
+/**
+ * Whether received datagrams are queued and delivered to native once per
+ * setImmediate. Set POMELO_NAPI_RECV_BATCH=0 to deliver them one by one.
+ */
+let recvBatching = process.env.POMELO_NAPI_RECV_BATCH !== '0';
+
+
+/**
+ * Enable or disable batched receiving for sockets created afterwards
+ * @param {boolean} enabled Whether batching is enabled
+ */
+export function setRecvBatching(enabled) {
+    recvBatching = enabled;
+}
+
+
+/**
+ * Mirror of the native address cache. Addresses are exchanged with the
+ * native side as integer handles, the host and port strings only cross the
+ * boundary once per handle.
+ */
+class AddressCache {
+    constructor() {
+        /** Number of clears, handles of older generations are invalid */
+        this.generation = 0;
+
+        /** @type {Map<string, Map<number, number>>} host -> port -> handle */
+        this.handles = new Map();
+
+        /** @type {string[]} */
+        this.hosts = [];
+
+        /** @type {number[]} */
+        this.ports = [];
+    }
+
+
+    /**
+     * Find the handle of an address
+     * @param {string} host The host
+     * @param {number} port The port
+     * @returns {number | undefined} The handle
+     */
+    find(host, port) {
+        const ports = this.handles.get(host);
+        return ports && ports.get(port);
+    }
+
+
+    /**
+     * Set the address of a handle
+     * @param {number} handle The handle
+     * @param {string} host The host
+     * @param {number} port The port
+     */
+    set(handle, host, port) {
+        let ports = this.handles.get(host);
+        if (!ports) {
+            ports = new Map();
+            this.handles.set(host, ports);
+        }
+        ports.set(port, handle);
+        this.hosts[handle] = host;
+        this.ports[handle] = port;
+    }
+
+
+    /**
+     * Remove all addresses
+     */
+    clear() {
+        this.generation++;
+        this.handles.clear();
+        this.hosts.length = 0;
+        this.ports.length = 0;
+    }
+};
+
+
+const addressCache = new AddressCache();
+
 
 /**
  * UDP socket class
@@ -27,13 +112,131 @@ class UDPSocket {
      * @param {number} port The port
      * @param {Function} recvCallback The receive callback
      * @param {Function} sendCallback The send callback
+     * @param {Function} recvBatchCallback The batched receive callback
      */
-    constructor(host, port, recvCallback, sendCallback) {
+    constructor(host, port, recvCallback, sendCallback, recvBatchCallback) {
         this.host = host;
         this.port = port;
         this.recvCallback = recvCallback;
         this.sendCallback = sendCallback;
+        this.recvBatchCallback = recvBatchCallback;
         this.running = false;
+
+        // The receive queue
+        this.recvBatching = recvBatching;
+        this.recvCount = 0;
+        this.recvScheduled = false;
+        this.recvGeneration = addressCache.generation;
+        this.recvBuffers = [];
+        this.recvHosts = [];
+        this.recvHandles = new Int32Array(RECV_QUEUE_INITIAL_CAPACITY);
+        this.recvPorts = new Int32Array(RECV_QUEUE_INITIAL_CAPACITY);
+        this.flushRecv = this.flushRecv.bind(this);
+    }
+
+
+    /**
+     * Deliver a datagram to native immediately
+     * @param {Buffer} message The datagram
+     * @param {string} address The remote host
+     * @param {number} port The remote port
+     */
+    deliver(message, address, port) {
+        const handle = addressCache.find(address, port);
+        if (handle !== undefined) {
+            this.recvCallback(this, message, handle);
+            return;
+        }
+
+        // The native side interns the address and returns its handle
+        const newHandle = this.recvCallback(this, message, -1, address, port);
+        if (newHandle >= 0) {
+            addressCache.set(newHandle, address, port);
+        }
+    }
+
+
+    /**
+     * Queue a datagram, the queue is flushed on next setImmediate
+     * @param {Buffer} message The datagram
+     * @param {string} address The remote host
+     * @param {number} port The remote port
+     */
+    enqueue(message, address, port) {
+        this.invalidateQueuedHandles();
+
+        const index = this.recvCount++;
+        if (index === this.recvHandles.length) {
+            const handles = new Int32Array(index * 2);
+            const ports = new Int32Array(index * 2);
+            handles.set(this.recvHandles);
+            ports.set(this.recvPorts);
+            this.recvHandles = handles;
+            this.recvPorts = ports;
+        }
+
+        const handle = addressCache.find(address, port);
+        this.recvBuffers[index] = message;
+        this.recvHosts[index] = address;
+        this.recvPorts[index] = port;
+        this.recvHandles[index] = (handle === undefined) ? -1 : handle;
+
+        if (!this.recvScheduled) {
+            this.recvScheduled = true;
+            setImmediate(this.flushRecv);
+        }
+    }
+
+
+    /**
+     * Forget the queued handles if the address cache has been cleared
+     */
+    invalidateQueuedHandles() {
+        if (this.recvGeneration === addressCache.generation) {
+            return;
+        }
+        this.recvGeneration = addressCache.generation;
+        this.recvHandles.fill(-1, 0, this.recvCount);
+    }
+
+
+    /**
+     * Deliver all queued datagrams to native in one call
+     */
+    flushRecv() {
+        this.recvScheduled = false;
+        const count = this.recvCount;
+        if (count === 0) {
+            return;
+        }
+        this.recvCount = 0;
+
+        if (this.running) {
+            this.invalidateQueuedHandles();
+            const handles = this.recvHandles;
+            this.recvBatchCallback(
+                this,
+                this.recvBuffers,
+                handles,
+                this.recvHosts,
+                this.recvPorts,
+                count
+            );
+
+            // Cache the handles interned by native
+            const hosts = this.recvHosts;
+            const ports = this.recvPorts;
+            for (let i = 0; i < count; i++) {
+                const handle = handles[i];
+                if (handle >= 0 && addressCache.hosts[handle] === undefined) {
+                    addressCache.set(handle, hosts[i], ports[i]);
+                }
+            }
+        }
+
+        // Release the datagrams
+        this.recvBuffers.fill(null, 0, count);
+        this.recvHosts.fill(null, 0, count);
     }
 
 
@@ -60,7 +263,11 @@ class UDPSocket {
         });
 
         this.socket.on('message', (message, remote) => {
-            this.recvCallback(this, message, remote.address, remote.port);
+            if (this.recvBatching) {
+                this.enqueue(message, remote.address, remote.port);
+            } else {
+                this.deliver(message, remote.address, remote.port);
+            }
         });
 
         return this.socket;
@@ -118,33 +325,43 @@ class UDPSocket {
 
 
     /**
-     * Send a message to the socket
-     * @param {Buffer[]} messages The messages to send
-     * @param {string} host The host
-     * @param {number} port The port
-     * @param {Object} callbackData The callback native data
-     * @param {Object} callbackFunc The callback native function
-     * @return {boolean} True if the message is sent, false otherwise
+     * Send a batch of datagrams to the socket
+     * @param {Buffer} data The packed payloads
+     * @param {Int32Array} offsets The payload i is [offsets[i], offsets[i+1])
+     * @param {Int32Array} handles The address handles, -1 for connected sockets
+     * @param {Object} batch The native batch, passed back to the callback
+     * @return {boolean} True if the datagrams are sent, false otherwise
      */
-    send(messages, host, port, callbackData, callbackFunc) {
+    sendBatch(data, offsets, handles, batch) {
         if (!this.socket) {
             return false;
         }
 
-        if (this.mode === SOCKET_MODE_SERVER) {
-            this.socket.send(messages, port, host, (error) => {
-                if (!this.running) {
-                    return;
-                }
-                this.sendCallback(callbackFunc, callbackData, error ? -1 : 0);
-            });
-        } else {
-            this.socket.send(messages, (error) => {
-                if (!this.running) {
-                    return;
-                }
-                this.sendCallback(callbackFunc, callbackData, error ? -1 : 0);
-            });
+        const count = handles.length;
+        let pending = count;
+        let statuses = null;
+        const onSent = (index, error) => {
+            if (error) {
+                statuses = statuses || new Int32Array(count);
+                statuses[index] = -1;
+            }
+            if (--pending === 0 && this.running) {
+                this.sendCallback(batch, statuses);
+            }
+        };
+
+        for (let i = 0; i < count; i++) {
+            const message = data.subarray(offsets[i], offsets[i + 1]);
+            if (this.mode === SOCKET_MODE_SERVER) {
+                const handle = handles[i];
+                const host = addressCache.hosts[handle];
+                const port = addressCache.ports[handle];
+                this.socket.send(message, port, host, (error) => {
+                    onSent(i, error);
+                });
+            } else {
+                this.socket.send(message, (error) => onSent(i, error));
+            }
         }
 
         return true;
@@ -152,55 +369,6 @@ class UDPSocket {
 };
 
 
-/**
- * Timer class
- */
-class Timer {
-    /**
-     * 
-     * @param {Function} callback The entry function
-     * @param {number} timeoutMS The timeout in milliseconds
-     * @param {number} repeatMS The repeat in milliseconds
-     */
-    constructor(callback, timeoutMS, repeatMS) {
-        this.callback = callback;
-        this.timeoutMS = timeoutMS;
-        this.repeatMS = repeatMS;
-        this.timeout = null;
-        this.interval = null;
-    }
-
-    /**
-     * Start the timer
-     */
-    start() {
-        this.stop();
-        this.timeout = setTimeout(() => {
-            this.callback(this);
-            if (this.repeatMS > 0) {
-                this.interval = setInterval(() => {
-                    this.callback(this);
-                }, this.repeatMS);
-            }
-        }, this.timeoutMS);
-    }
-
-    /**
-     * Stop the timer
-     */
-    stop() {
-        if (this.timeout !== null) {
-            clearTimeout(this.timeout);
-            this.timeout = null;
-        }
-        if (this.interval !== null) {
-            clearInterval(this.interval);
-            this.interval = null;
-        }
-    }
-};
-
-
 /**
  * Platform for N-API
  */
@@ -234,10 +402,15 @@ options.now = () => BigInt(Date.now());
  * @param {number} port The port
  * @param {Function} recvCallback The receive callback
  * @param {Function} sendCallback The send callback
+ * @param {Function} recvBatchCallback The batched receive callback
  * @returns {UDPSocket | null} The UDP socket object
  */
-options.udpCreate = (host, port, recvCallback, sendCallback) => {
-    return new UDPSocket(host, port, recvCallback, sendCallback);
+options.udpCreate = (
+    host, port, recvCallback, sendCallback, recvBatchCallback
+) => {
+    return new UDPSocket(
+        host, port, recvCallback, sendCallback, recvBatchCallback
+    );
 };
 
 
@@ -272,54 +445,79 @@ options.udpStop = (socket) => {
 
 
 /**
- * Send a message to the UDP socket
+ * Send the queued datagrams of a UDP socket, called once per flush
  * @param {UDPSocket} socket The UDP socket object
- * @param {Buffer[]} messages The messages to send
- * @param {string} host The host
- * @param {number} port The port
- * @param {Object} callbackData The callback native data
- * @param {Object} callbackFunc The callback native function
- * @returns {boolean} True if the message is sent, false otherwise
+ * @param {Buffer} data The packed payloads
+ * @param {Int32Array} offsets The payload offsets, one more than datagrams
+ * @param {Int32Array} handles The address handles, -1 for connected sockets
+ * @param {Array | undefined} newAddresses The [handle, host, port] triples
+ * of handles which are new to the address cache
+ * @param {Object} batch The native batch
+ * @returns {boolean} True if the datagrams are sent, false otherwise
  */
-options.udpSend = (
-    socket, messages, host, port, callbackData, callbackFunc
+options.udpSendBatch = (
+    socket, data, offsets, handles, newAddresses, batch
 ) => {
-    return socket.send(messages, host, port, callbackData, callbackFunc);
+    if (newAddresses !== undefined) {
+        for (let i = 0; i < newAddresses.length; i += 3) {
+            addressCache.set(
+                newAddresses[i], newAddresses[i + 1], newAddresses[i + 2]
+            );
+        }
+    }
+    return socket.sendBatch(data, offsets, handles, batch);
 }
 
 
+/**
+ * Clear the address handles, called when the native cache has been reset
+ */
+options.udpAddressReset = () => {
+    addressCache.clear();
+};
+
+
 /* -------------------------------------------------------------------------- */
 /*                            Platform Timer APIs                              */
 /* -------------------------------------------------------------------------- */
 
 /**
- * Create a timer
- * @param {Function} callback The callback function
- * @param {number} timeoutMS The timeout in milliseconds
- * @param {number} repeatMS The repeat in milliseconds
- * @returns {Timer} The timer object
+ * The timeout which drives the native timer wheel
+ * @type {NodeJS.Timeout | null}
  */
-options.timerCreate = (callback, timeoutMS, repeatMS) => {
-    return new Timer(callback, timeoutMS, repeatMS);
-};
+let wheelTimeout = null;
 
 
 /**
- * Start a timer
- * @param {Timer} timer The timer object
+ * Arm the timeout of native timer wheel, replacing the armed one. All native
+ * timers share this timeout, it is armed for the nearest expiry.
+ * @param {Function} callback The wheel tick callback
+ * @param {number} timeoutMS The timeout in milliseconds
  */
-options.timerStart = (timer) => {
-    timer.start();
+options.timerSchedule = (callback, timeoutMS) => {
+    if (wheelTimeout !== null) {
+        clearTimeout(wheelTimeout);
+    }
+    wheelTimeout = setTimeout(() => {
+        wheelTimeout = null;
+        callback();
+    }, timeoutMS);
 };
 
 
+/* -------------------------------------------------------------------------- */
+/*                            Platform Worker APIs                            */
+/* -------------------------------------------------------------------------- */
+
 /**
- * Stop a timer
- * @param {Timer} timer The timer object
+ * Number of threads of the native worker pool, which runs the worker tasks
+ * (token decryption) away from the shared libuv threadpool. Set
+ * POMELO_NAPI_WORKER_THREADS to override it, 0 queues the worker tasks as
+ * napi_async_work on the libuv threadpool.
  */
-options.timerStop = (timer) => {
-    timer.stop();
-};
+options.workerThreads = process.env.POMELO_NAPI_WORKER_THREADS !== undefined
+    ? (parseInt(process.env.POMELO_NAPI_WORKER_THREADS) || 0)
+    : Math.min(4, availableParallelism());
 
 
 /* -------------------------------------------------------------------------- */
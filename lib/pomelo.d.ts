@@ -16,10 +16,144 @@ export enum ConnectResult {
     TIMED_OUT
 }
 
+/**
+ * Field type of a message schema
+ */
+export type FieldType =
+    "uint8" | "uint16" | "uint32" | "uint64" |
+    "int8" | "int16" | "int32" | "int64" |
+    "float32" | "float64";
+
+
+/**
+ * Compiled message schema, created by `Message.compileSchema`
+ */
+export interface MessageSchema {
+    readonly __brand: "MessageSchema";
+}
+
+
 /**
  * Message
  */
 export class Message {
+    /**
+     * Acquire a new message from the pool. Release it with release() once it
+     * is not needed anymore, otherwise its payload is only returned to the
+     * pool when the message is garbage-collected.
+     */
+    static acquire(): Message;
+
+    /**
+     * Allocate a message handle. Handles are plain integers which index a
+     * native table, they have no JS object and no finalizer, so they must be
+     * freed with `Message.free()`. A handle can be sent in place of a message.
+     * Handles are integers up to 2^52, compare them with `===` only.
+     * @returns The message handle
+     */
+    static alloc(): number;
+
+    /**
+     * Free a message handle. The handle is stale afterwards, using it throws.
+     * Messages which are being sent are kept until they are delivered.
+     * @param handle The message handle
+     */
+    static free(handle: number): void;
+
+    /**
+     * Get the size of a message handle
+     * @param handle The message handle
+     */
+    static hsize(handle: number): number;
+
+    /**
+     * Reset a message handle
+     * @param handle The message handle
+     */
+    static hreset(handle: number): void;
+
+    /** Write an uint8 value to a message handle */
+    static wu8(handle: number, value: number | bigint): void;
+
+    /** Write an uint16 value to a message handle */
+    static wu16(handle: number, value: number | bigint): void;
+
+    /** Write an uint32 value to a message handle */
+    static wu32(handle: number, value: number | bigint): void;
+
+    /** Write an uint64 value to a message handle */
+    static wu64(handle: number, value: number | bigint): void;
+
+    /** Write an int8 value to a message handle */
+    static wi8(handle: number, value: number | bigint): void;
+
+    /** Write an int16 value to a message handle */
+    static wi16(handle: number, value: number | bigint): void;
+
+    /** Write an int32 value to a message handle */
+    static wi32(handle: number, value: number | bigint): void;
+
+    /** Write an int64 value to a message handle */
+    static wi64(handle: number, value: number | bigint): void;
+
+    /** Write a float32 value to a message handle */
+    static wf32(handle: number, value: number): void;
+
+    /** Write a float64 value to a message handle */
+    static wf64(handle: number, value: number): void;
+
+    /** Read an uint8 value from a message handle */
+    static ru8(handle: number): number;
+
+    /** Read an uint16 value from a message handle */
+    static ru16(handle: number): number;
+
+    /** Read an uint32 value from a message handle */
+    static ru32(handle: number): number;
+
+    /** Read an uint64 value from a message handle */
+    static ru64(handle: number): bigint;
+
+    /** Read an int8 value from a message handle */
+    static ri8(handle: number): number;
+
+    /** Read an int16 value from a message handle */
+    static ri16(handle: number): number;
+
+    /** Read an int32 value from a message handle */
+    static ri32(handle: number): number;
+
+    /** Read an int64 value from a message handle */
+    static ri64(handle: number): bigint;
+
+    /** Read a float32 value from a message handle */
+    static rf32(handle: number): number;
+
+    /** Read a float64 value from a message handle */
+    static rf64(handle: number): number;
+
+    /**
+     * Compile a record schema for writeStruct and readStruct
+     * @param fields The field types of a record, in order
+     */
+    static compileSchema(fields: FieldType[]): MessageSchema;
+
+    /**
+     * Release the native message and its payload to the pool. Messages which
+     * are being sent are kept until they are delivered. Any further use of
+     * this message, including a second release(), throws.
+     */
+    release(): void;
+
+    /**
+     * Keep a received message valid after its receive callback has returned,
+     * when received messages are released automatically
+     * (POMELO_MESSAGE_AUTO_RELEASE=1). The retained message is released by
+     * release() or by the garbage collector.
+     * @returns This message
+     */
+    retain(): Message;
+
     /**
      * Get the size of message
      */
@@ -91,6 +225,92 @@ export class Message {
      */
     writeFloat64(value: number | bigint): void;
 
+    /**
+     * Read `length` bytes like read(), but into a scratch buffer shared by
+     * all messages instead of a new ArrayBuffer. The bytes are consumed, so
+     * call `readView(message.size())` once to get the whole payload. The view
+     * is only valid until the next call of readView(), writable(),
+     * readString(), writeString(), readStringLatin1() or writeStringLatin1()
+     * on any message: the scratch is then detached and the view becomes
+     * empty. Copy the data if it needs to outlive that.
+     * @param length Number of bytes to read
+     */
+    readView(length: number): Uint8Array;
+
+    /**
+     * Get a writable view of `length` bytes which will be appended to this
+     * message. The view is written to the message by commit(), by the next
+     * write to this message or automatically when the message is sent. It
+     * shares the same scratch buffer as readView(). When another message uses
+     * the scratch, the pending bytes are written to this message right away
+     * and the view becomes empty, so fill it before touching other messages.
+     * @param length Number of bytes to write
+     */
+    writable(length: number): Uint8Array;
+
+    /**
+     * Write the pending writable view to the message
+     */
+    commit(): void;
+
+    /**
+     * Write records to buffer in one call. The values are laid out as
+     * consecutive records, so their number must be a multiple of the number
+     * of schema fields. A Float64Array is read directly without conversion of
+     * JS values, 64-bit fields in it are limited to the double precision.
+     * Values which do not fit their field, like NaN, infinities or numbers
+     * out of the integer range, throw before any record is written.
+     * Fractions of integer fields are truncated toward zero.
+     * @param schema The compiled schema
+     * @param values Values of one or more records
+     * @returns The number of written records
+     */
+    writeStruct(
+        schema: MessageSchema,
+        values: (number | bigint)[] | Float64Array
+    ): number;
+
+    /**
+     * Read records from buffer in one call. 64-bit fields are read as bigint
+     * when the output is an array.
+     * @param schema The compiled schema
+     * @param out The output values, a new array is created if it is omitted
+     * @param count The number of records to read, default is 1
+     * @returns The output values
+     */
+    readStruct<T extends (number | bigint)[] | Float64Array>(
+        schema: MessageSchema,
+        out?: T,
+        count?: number
+    ): T;
+
+    /**
+     * Write a UTF-8 string, prefixed by its byte length as a varint. The
+     * string is encoded straight into the message, without an intermediate
+     * Uint8Array.
+     * @param value String to write
+     */
+    writeString(value: string): void;
+
+    /**
+     * Read a string written by writeString()
+     * @returns Retrieved value from buffer
+     */
+    readString(): string;
+
+    /**
+     * Write a Latin-1 string, prefixed by its length as a varint. Each
+     * character takes one byte, characters above U+00FF are not preserved.
+     * @param value String to write
+     */
+    writeStringLatin1(value: string): void;
+
+    /**
+     * Read a string written by writeStringLatin1()
+     * @returns Retrieved value from buffer
+     */
+    readStringLatin1(): string;
+
     /**
      * Read the message with specific length
      * @param length Length to read
@@ -156,6 +376,88 @@ export class Message {
      * @returns Retrieved value from buffer
      */
     readFloat64(): number;
+
+    /**
+     * Write the low bits of an unsigned value. Bits are packed LSB first and
+     * the last partial byte is padded with zeros by alignBits(), by any
+     * byte-aligned write or when the message is sent. size() does not count
+     * the pending bits.
+     * @param value Value to write
+     * @param bits Number of bits, from 1 to 32
+     */
+    writeBits(value: number, bits: number): void;
+
+    /**
+     * Read an unsigned value of bits
+     * @param bits Number of bits, from 1 to 32
+     * @returns Retrieved value from buffer
+     */
+    readBits(bits: number): number;
+
+    /**
+     * Write a zigzag encoded varint through the bit writer. Small magnitudes
+     * take one byte, 64-bit values take up to 10 bytes.
+     * @param value Value to write
+     */
+    writeVarint(value: number | bigint): void;
+
+    /**
+     * Read a zigzag encoded varint. The value is a bigint, so that 64-bit
+     * values round-trip without precision loss.
+     * @returns Retrieved value from buffer
+     */
+    readVarint(): bigint;
+
+    /**
+     * Write a value quantized in the range [min, max]. Out of range values are
+     * clamped.
+     * @param value Value to write
+     * @param min The lower bound of range
+     * @param max The upper bound of range, greater than min
+     * @param bits Number of bits, from 1 to 32
+     */
+    writeQuantized(value: number, min: number, max: number, bits: number): void;
+
+    /**
+     * Read a value quantized in the range [min, max]
+     * @param min The lower bound of range
+     * @param max The upper bound of range, greater than min
+     * @param bits Number of bits, from 1 to 32
+     * @returns Retrieved value from buffer
+     */
+    readQuantized(min: number, max: number, bits: number): number;
+
+    /**
+     * Write a unit quaternion with the smallest-three compression: the index
+     * of the largest component takes 2 bits and each of the other components
+     * takes `bits` bits.
+     * @param x The x component
+     * @param y The y component
+     * @param z The z component
+     * @param w The w component
+     * @param bits Number of bits of each component, from 1 to 32
+     */
+    writeQuaternion(
+        x: number, y: number, z: number, w: number, bits: number
+    ): void;
+
+    /**
+     * Read a unit quaternion written by writeQuaternion(). Its sign may be
+     * flipped, which is the same rotation.
+     * @param bits Number of bits of each component, from 1 to 32
+     * @param out The array of [x, y, z, w] to fill, a new one by default
+     * @returns The quaternion
+     */
+    readQuaternion(bits: number, out?: Float64Array): Float64Array;
+
+    /**
+     * Align the bit writer and the bit reader to the next byte. The pending
+     * bits of writer are padded with zeros, the remaining bits of reader are
+     * dropped. Every byte-aligned accessor (write*, read*, writeStruct,
+     * readStruct, readView, writable, writeString, readString) aligns first
+     * the same way, so this is only needed between bit fields.
+     */
+    alignBits(): void;
 }
 
 
@@ -186,11 +488,18 @@ export interface Channel {
 
     /**
      * Send message by specific channel
-     * @param message The message to send
+     * @param message The message or message handle to send
      * @returns Returns a promise which will resolve to a number value
      * indicating the number of sent messages.
      */
-    send(message: Message): Promise<number>;
+    send(message: Message | number): Promise<number>;
+
+    /**
+     * Send message by specific channel without creating a result promise.
+     * The results are aggregated in `statistic().binding`.
+     * @param message The message or message handle to send
+     */
+    sendFast(message: Message | number): void;
 }
 
 
@@ -216,11 +525,19 @@ export interface Session {
     /**
      * Send message to the peer connected by this session
      * @param channelIndex The channel to send
-     * @param message The message to send
+     * @param message The message or message handle to send
      * @returns Returns a promise which will resolve to a number value
      * indicating the number of sent messages.
      */
-    send(channelIndex: number, message: Message): Promise<number>;
+    send(channelIndex: number, message: Message | number): Promise<number>;
+
+    /**
+     * Send message to the peer without creating a result promise.
+     * The results are aggregated in `statistic().binding`.
+     * @param channelIndex The channel to send
+     * @param message The message or message handle to send
+     */
+    sendFast(channelIndex: number, message: Message | number): void;
 
     /**
      * Set mode for specific channel of a session
@@ -251,6 +568,50 @@ export interface Session {
 }
 
 
+/**
+ * A native set of sessions which can be passed to `Socket.send` as the
+ * recipients. Disconnected sessions are removed from their groups
+ * automatically.
+ */
+export class SessionGroup {
+    /**
+     * Create new empty group
+     */
+    constructor();
+
+    /**
+     * The number of sessions in this group
+     */
+    readonly size: number;
+
+    /**
+     * Add a session to this group
+     * @param session The session
+     * @returns Returns false if the session is already in this group or it
+     * has been disconnected
+     */
+    add(session: Session): boolean;
+
+    /**
+     * Remove a session from this group
+     * @param session The session
+     * @returns Returns false if the session is not in this group
+     */
+    remove(session: Session): boolean;
+
+    /**
+     * Check if a session is in this group
+     * @param session The session
+     */
+    has(session: Session): boolean;
+
+    /**
+     * Remove all sessions from this group
+     */
+    clear(): void;
+}
+
+
 /**
  * The socket listener
  */
@@ -269,11 +630,49 @@ export interface SocketListener {
 
     /**
      * This callback is called when a message has been arrived to this peer.
-     * The message WILL BE INVALID after this callback.
+     * The message WILL BE INVALID after this callback. With
+     * POMELO_MESSAGE_AUTO_RELEASE=1, it is released and its object is reused
+     * for later messages as soon as the callback returns, call
+     * `message.retain()` to keep it.
      * @param session The sender
      * @param message The incoming message
      */
-    onReceived(session: Session, message: Message): void;
+    onReceived?(session: Session, message: Message): void;
+
+    /**
+     * Batched version of onReceived. When this callback is provided, incoming
+     * messages are collected natively and delivered once per event loop tick.
+     * The arrays are reused between calls, only the first `count` elements
+     * are valid and they are cleared once the callback returns, so copy them
+     * to keep them. onReceived is optional in this mode. The messages follow the
+     * same release rules as in onReceived.
+     * @param sessions The senders
+     * @param messages The incoming messages
+     * @param count The number of valid elements in both arrays
+     */
+    onReceivedBatch?(
+        sessions: Session[],
+        messages: Message[],
+        count: number
+    ): void;
+
+    /**
+     * Receive ring callback, called at most once per event loop tick when the
+     * socket has a receive ring (see `Socket.setReceiveRing`). Records between
+     * `begin` and `end` are valid only during this callback.
+     *
+     * Each record is 8-byte aligned and starts with a 16-byte little-endian
+     * header: `[sessionID: int64][length: uint32][reserved: uint32]`, followed
+     * by `length` bytes of payload. When fewer than 16 bytes remain before the
+     * end of the ring, or the length is 0xFFFFFFFF, reading wraps to offset 0.
+     * onReceived is optional in this mode, messages which arrive before a
+     * ring is attached are dropped and counted in `dropped`.
+     * @param begin Offset of the first record
+     * @param end The write cursor, offset after the last record
+     * @param dropped The number of messages dropped because the ring was full
+     * or not attached
+     */
+    onReceivedRing?(begin: number, end: number, dropped: number): void;
 }
 
 
@@ -486,33 +885,116 @@ export interface Statistic {
      */
     binding: {
         /**
-         * The number of binding messages
+         * The number of sendFast() requests
          */
-        messages: number;
+        sendFastRequests: number;
+
+        /**
+         * The number of completed sendFast() requests
+         */
+        sendFastResults: number;
+
+        /**
+         * The number of messages sent by sendFast() requests
+         */
+        sendFastSent: number;
+
+        /**
+         * The number of completed sendFast() requests which sent nothing
+         */
+        sendFastFailures: number;
+
+        /**
+         * The number of messages whose native message has not been released
+         */
+        messagesOutstanding: number;
+
+        /**
+         * The number of messages released by release()
+         */
+        messagesReleased: number;
+
+        /**
+         * The number of messages released by the garbage collector
+         */
+        messagesCollected: number;
 
         /**
-         * The number of binding sockets
+         * The number of received messages released when their callback
+         * returned
          */
-        sockets: number;
+        messagesAutoReleased: number;
 
         /**
-         * The number of binding sessions
+         * The number of received messages kept by retain()
          */
-        sessions: number;
+        messagesRetained: number;
 
         /**
-         * The size of message pool
+         * The number of received messages which could not be queued for
+         * onReceivedBatch
          */
-        messagePoolSize: number;
+        messagesDropped: number;
 
         /**
-         * The size of channels array pool
+         * The number of live message handles
          */
-        channelsArrayPoolSize: number;
+        messageHandles: number;
+
+        /**
+         * The binding object pools
+         */
+        pools: {
+            socket: PoolStatistic;
+            message: PoolStatistic;
+            session: PoolStatistic;
+            channel: PoolStatistic;
+        }
     }
 }
 
 
+/**
+ * The statistic of a binding object pool
+ */
+export interface PoolStatistic {
+    /**
+     * The number of acquired objects
+     */
+    acquired: number;
+
+    /**
+     * The number of released objects
+     */
+    released: number;
+
+    /**
+     * The number of objects in use
+     */
+    inUse: number;
+
+    /**
+     * The highest number of objects in use
+     */
+    peakInUse: number;
+
+    /**
+     * The number of pooled objects which are ready to be acquired
+     */
+    available: number;
+
+    /**
+     * The number of acquisitions which had to allocate a new object
+     */
+    misses: number;
+
+    /**
+     * The number of released objects which were freed instead of being pooled
+     */
+    freed: number;
+}
+
+
 /**
  * The socket.
  * Passing listener of socket is not so convinient
@@ -563,21 +1045,251 @@ export class Socket {
     /**
      * Send a message to multiple recipients.
      * @param channelIndex The sending channel index
-     * @param message The message
-     * @param recipients List of recipients
+     * @param message The message or message handle
+     * @param recipients List or group of recipients
      * @returns Returns a promise which will resolve to the number of sent
      * messages
      */
     send(
         channelIndex: number,
-        message: Message,
-        recipients: Session[]
+        message: Message | number,
+        recipients: Session[] | SessionGroup
     ): Promise<number>;
 
+    /**
+     * Send a message to multiple recipients without creating a result
+     * promise. The results are aggregated in `statistic().binding`.
+     * @param channelIndex The sending channel index
+     * @param message The message or message handle
+     * @param recipients List or group of recipients
+     */
+    sendFast(
+        channelIndex: number,
+        message: Message | number,
+        recipients: Session[] | SessionGroup
+    ): void;
+
+    /**
+     * Send a message to the sessions with specific IDs without creating
+     * `Session` objects or a result promise. Unknown IDs are skipped. The
+     * results are aggregated in `statistic().binding`.
+     * @param channelIndex The sending channel index
+     * @param message The message or message handle
+     * @param sessionIds The IDs of recipients
+     * @param count The number of IDs to use, defaults to the array length
+     * @returns The number of resolved recipients
+     */
+    multicast(
+        channelIndex: number,
+        message: Message | number,
+        sessionIds: BigInt64Array,
+        count?: number
+    ): number;
+
     /**
      * Get synchronized socket time
      */
     time(): bigint;
+
+    /**
+     * Set the receive ring. Incoming payloads are copied into the returned
+     * buffer instead of creating Message objects, and the listener is
+     * notified through `onReceivedRing`. The buffer is native memory, it
+     * stays valid even if it is transferred or detached, but a detached
+     * buffer no longer shows new records.
+     * @param capacity Capacity of ring in bytes, 0 to disable the ring
+     * @returns The ring buffer, or null if the ring has been disabled
+     */
+    setReceiveRing(capacity: number): ArrayBuffer | null;
+}
+
+
+/**
+ * A session of a threaded socket. It lives on the main thread and proxies the
+ * session of a socket thread.
+ */
+export class ThreadedSession {
+    /**
+     * The session ID
+     */
+    readonly id: bigint;
+
+    /**
+     * Index of the socket thread (shard) which owns this session
+     */
+    readonly shardIndex: number;
+
+    /**
+     * Custom data
+     */
+    data?: any;
+
+    /**
+     * Send a payload to this session. The payload is copied into the send ring
+     * of the socket thread.
+     *
+     * Unlike `Session.send`, this takes raw bytes instead of a `Message`, a
+     * message belongs to the thread which created it. The send is fire and
+     * forget: no delivery count is reported back, and the payload is dropped
+     * if the session has gone by the time the socket thread sends it.
+     * @param channelIndex The channel index
+     * @param data The payload
+     */
+    send(channelIndex: number, data: Uint8Array): void;
+
+    /**
+     * Disconnect this session
+     */
+    disconnect(): void;
+}
+
+
+/**
+ * The listener of threaded socket
+ */
+export interface ThreadedSocketListener {
+    /**
+     * Peer connected callback
+     * @param session Created session
+     */
+    onConnected(session: ThreadedSession): void;
+
+    /**
+     * Peer disconnected callback
+     * @param session The session
+     */
+    onDisconnected(session: ThreadedSession): void;
+
+    /**
+     * Incoming payload callback. The data is only valid during this callback.
+     * @param session The sender
+     * @param data The payload
+     */
+    onReceived(session: ThreadedSession, data: Uint8Array): void;
+}
+
+
+/**
+ * Options of threaded socket
+ */
+export interface ThreadedSocketOptions {
+    /**
+     * Platform of socket thread, defaults to the platform selected by
+     * POMELO_PLATFORM
+     */
+    platform?: "mmsg" | "uv" | "napi";
+
+    /**
+     * Capacity in bytes of each ring between the threads, defaults to 1MB
+     */
+    ringCapacity?: number;
+}
+
+
+/**
+ * Socket running on a worker thread. The native socket, its loop, crypto and
+ * packet processing stay on the socket thread, events and sends cross the
+ * threads through lock-free rings. Only the listener callbacks run on the
+ * main thread.
+ *
+ * This is the public API of threaded and sharded sockets, and it is
+ * intentionally narrower than `Socket`: payloads are raw bytes, sends are
+ * fire and forget, and there are no `Message`, `Channel`, `SessionGroup`,
+ * send results or multicast. Those objects belong to the thread which
+ * created them and cannot cross to the socket thread. Use `Socket` when they
+ * are needed.
+ */
+export class ThreadedSocket {
+    /**
+     * Create new threaded socket
+     * @param channelModes The channel modes
+     * @param options The options
+     */
+    constructor(channelModes: ChannelMode[], options?: ThreadedSocketOptions);
+
+    /**
+     * Set the listener
+     * @param listener The listener
+     */
+    setListener(listener: ThreadedSocketListener): void;
+
+    /**
+     * Start the socket as a server
+     * @param privateKey The private key
+     * @param protocolID The protocol ID
+     * @param maxClients The maximum number of clients
+     * @param address The bind address
+     * @returns Returns a promise which will resolve when the socket is
+     * listening
+     */
+    listen(
+        privateKey: Uint8Array,
+        protocolID: number | bigint,
+        maxClients: number,
+        address: string
+    ): Promise<void>;
+
+    /**
+     * Start the socket as a client
+     * @param connectToken The connect token
+     * @returns Returns a promise which will resolve with the connect result
+     */
+    connect(connectToken: Uint8Array | string): Promise<ConnectResult>;
+
+    /**
+     * Stop the socket thread(s)
+     * @returns Returns a promise which will resolve when the thread(s) have
+     * exited
+     */
+    stop(): Promise<void>;
+}
+
+
+/**
+ * Options of sharded socket
+ */
+export interface ShardedSocketOptions extends ThreadedSocketOptions {
+    /**
+     * Number of shards, defaults to the available parallelism
+     */
+    shards?: number;
+
+    /**
+     * Platform of shards, defaults to "mmsg". Only the mmsg platform (Linux)
+     * binds with SO_REUSEPORT, so other platforms support a single shard.
+     */
+    platform?: "mmsg" | "uv" | "napi";
+}
+
+
+/**
+ * Server socket sharded over socket threads. Each shard runs a native socket
+ * bound to the same address with SO_REUSEPORT on its own thread and loop, the
+ * kernel pins every peer to a shard. A sharded socket cannot connect.
+ */
+export class ShardedSocket extends ThreadedSocket {
+    /**
+     * Create new sharded socket
+     * @param channelModes The channel modes
+     * @param options The options
+     */
+    constructor(channelModes: ChannelMode[], options?: ShardedSocketOptions);
+
+    /**
+     * Start all shards
+     * @param privateKey The private key
+     * @param protocolID The protocol ID
+     * @param maxClients The maximum number of clients of each shard
+     * @param address The bind address
+     * @returns Returns a promise which will resolve when all shards are
+     * listening
+     */
+    listen(
+        privateKey: Uint8Array,
+        protocolID: number | bigint,
+        maxClients: number,
+        address: string
+    ): Promise<void>;
 }
 
 
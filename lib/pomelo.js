@@ -1,13 +1,24 @@
 import bindings from "bindings";
 import { initPlatformNAPI } from "./platforms/platform-napi.js";
 import { initPlatformUV } from "./platforms/platform-uv.js";
+import { initPlatformMMSG } from "./platforms/platform-mmsg.js";
 
 
 /**
- * Create the platform
+ * Create the platform. POMELO_PLATFORM ("uv", "napi" or "mmsg") overrides
+ * the default platform of the runtime.
  * @returns {any} The platform
  */
 function createPlatform() {
+    switch (process.env.POMELO_PLATFORM) {
+        case "uv":
+            return initPlatformUV();
+        case "napi":
+            return initPlatformNAPI();
+        case "mmsg":
+            return initPlatformMMSG();
+    }
+
     if (process.versions.bun) {
         // We use the napi bindings for bun
         return initPlatformNAPI();
@@ -22,6 +33,10 @@ const DEFAULT_POOL_SOCKET_MAX = 10;
 const DEFAULT_POOL_MESSAGE_MAX = 1000;
 const DEFAULT_POOL_SESSION_MAX = 50;
 const DEFAULT_POOL_CHANNEL_MAX = 200;
+const DEFAULT_POOL_MESSAGE_PREWARM = 0;
+const DEFAULT_POOL_SESSION_PREWARM = 0;
+const DEFAULT_POOL_CHANNEL_PREWARM = 0;
+const DEFAULT_MESSAGE_AUTO_RELEASE = 0;
 
 
 /**
@@ -59,6 +74,32 @@ const pomelo = initializer({
         DEFAULT_POOL_CHANNEL_MAX
     ),
 
+    // Preallocated elements, they are kept when the pools shrink. The message
+    // prewarm also creates the recycled wrappers of received messages (up to
+    // 64) when messageAutoRelease is enabled; sessions and channels prewarm
+    // their native structs only.
+    poolMessagePrewarm: envOrDefault(
+        process.env.POMELO_POOL_MESSAGE_PREWARM,
+        DEFAULT_POOL_MESSAGE_PREWARM
+    ),
+
+    poolSessionPrewarm: envOrDefault(
+        process.env.POMELO_POOL_SESSION_PREWARM,
+        DEFAULT_POOL_SESSION_PREWARM
+    ),
+
+    poolChannelPrewarm: envOrDefault(
+        process.env.POMELO_POOL_CHANNEL_PREWARM,
+        DEFAULT_POOL_CHANNEL_PREWARM
+    ),
+
+    // Received messages are released when onReceived returns, unless they
+    // are retained with message.retain()
+    messageAutoRelease: envOrDefault(
+        process.env.POMELO_MESSAGE_AUTO_RELEASE,
+        DEFAULT_MESSAGE_AUTO_RELEASE
+    ),
+
     /**
      * Error handler
      * @param {Error} error 
@@ -74,9 +115,12 @@ export const ChannelMode = pomelo.ChannelMode;
 export const ConnectResult = pomelo.ConnectResult;
 export const Message = pomelo.Message;
 export const Socket = pomelo.Socket;
+export const SessionGroup = pomelo.SessionGroup;
 export const Plugin = pomelo.Plugin;
 export const Token = pomelo.Token;
 export const statistic = pomelo.statistic;
+export { ThreadedSocket, ThreadedSession } from "./threaded.js";
+export { ShardedSocket } from "./shard.js";
 
 
 /**
@@ -0,0 +1,66 @@
+import { availableParallelism } from "node:os";
+import { ThreadedSocket } from "./threaded.js";
+
+/**
+ * Sharded server socket.
+ *
+ * Each shard is a socket thread of a threaded socket (see threaded.js) with
+ * its own libuv loop, platform and native socket. All shards are bound to the
+ * same address with SO_REUSEPORT, so that the protocol pipeline (crypto,
+ * parsing, resending) of each shard runs on its own core. The kernel pins
+ * every peer to a shard by its 4-tuple hash.
+ */
+
+
+/**
+ * Server socket sharded over socket threads
+ */
+export class ShardedSocket extends ThreadedSocket {
+    /**
+     * @param {number[]} channelModes The channel modes
+     * @param {{
+     *  shards?: number, platform?: string, ringCapacity?: number
+     * }} [options] Number of shards (default: available parallelism), the
+     * platform (default: "mmsg", the only platform which sets SO_REUSEPORT)
+     * and the capacity of each ring in bytes
+     */
+    constructor(channelModes, options = {}) {
+        super(channelModes, {
+            ...options,
+            platform: options.platform || "mmsg"
+        });
+        this.shardCount = options.shards || availableParallelism();
+    }
+
+    /**
+     * Start all shards
+     * @param {Uint8Array} privateKey The private key
+     * @param {number | bigint} protocolID The protocol ID
+     * @param {number} maxClients The maximum number of clients per shard
+     * @param {string} address The bind address
+     * @returns {Promise<void>} Resolves when all shards are listening
+     */
+    listen(privateKey, protocolID, maxClients, address) {
+        if (this.shardCount > 1 && this.platform !== "mmsg") {
+            return Promise.reject(
+                new Error("Sharding requires the mmsg platform")
+            );
+        }
+
+        return this.listenThreads(
+            this.shardCount,
+            true,
+            privateKey,
+            protocolID,
+            maxClients,
+            address
+        );
+    }
+
+    /**
+     * A sharded socket cannot be a client
+     */
+    connect() {
+        return Promise.reject(new Error("Sharded socket cannot connect"));
+    }
+};
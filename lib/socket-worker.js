@@ -0,0 +1,119 @@
+// Socket thread of a threaded socket (see lib/threaded.js)
+import { parentPort, workerData } from "node:worker_threads";
+import { SPSCRing, SPSCProducer, SPSCConsumer, SPSC_WAKE } from "./spsc.js";
+import {
+    THREAD_EVENT_CONNECTED,
+    THREAD_EVENT_DISCONNECTED,
+    THREAD_EVENT_RECEIVED
+} from "./threaded.js";
+
+// The environment of a worker is its own copy, the platform is selected before
+// the binding is loaded.
+if (workerData.platform) {
+    process.env.POMELO_PLATFORM = workerData.platform;
+}
+if (workerData.reusePort) {
+    process.env.POMELO_MMSG_REUSEPORT = "1";
+}
+const { Socket, Message } = await import("./pomelo.js");
+
+
+/**
+ * @type {Map<bigint, Object>}
+ */
+const sessions = new Map();
+const events = new SPSCProducer(
+    new SPSCRing(workerData.events), parentPort
+);
+const sends = new SPSCConsumer(
+    new SPSCRing(workerData.sends),
+    (channelIndex, id, payload) => {
+        const session = sessions.get(id);
+        if (!session) {
+            return;
+        }
+
+        // The sending keeps its own reference of the native message, so the
+        // message goes back to the pool right after the send
+        const message = Message.acquire();
+        try {
+            message.write(payload);
+            session.sendFast(channelIndex, message);
+        } finally {
+            message.release();
+        }
+    }
+);
+
+
+const socket = new Socket(workerData.channelModes);
+socket.setListener({
+    onConnected(session) {
+        sessions.set(session.id, session);
+        events.push(THREAD_EVENT_CONNECTED, session.id);
+    },
+
+    onDisconnected(session) {
+        sessions.delete(session.id);
+        events.push(THREAD_EVENT_DISCONNECTED, session.id);
+    },
+
+    onReceived(session, message) {
+        const payload = message.readView(message.size());
+        events.push(THREAD_EVENT_RECEIVED, session.id, payload);
+    }
+});
+
+
+/**
+ * Post the result of a command
+ * @param {number} id The request ID of command
+ * @param {Promise<any>} promise The command promise
+ */
+function reply(id, promise) {
+    promise.then(
+        (value) => parentPort.postMessage({ type: "result", id, value }),
+        (error) => parentPort.postMessage({
+            type: "error",
+            id,
+            message: String(error && error.message || error)
+        })
+    );
+}
+
+
+parentPort.on("message", (command) => {
+    switch (command.type) {
+        case SPSC_WAKE:
+            sends.wake();
+            break;
+
+        case "listen":
+            reply(command.id, socket.listen(
+                command.privateKey,
+                command.protocolID,
+                command.maxClients,
+                command.address
+            ));
+            break;
+
+        case "connect":
+            reply(command.id, socket.connect(command.connectToken));
+            break;
+
+        case "disconnect": {
+            const session = sessions.get(command.id);
+            if (session) {
+                session.disconnect();
+            }
+            break;
+        }
+
+        case "stop":
+            sends.wake();
+            socket.stop();
+            events.flushOverflow();
+            parentPort.close();
+            break;
+    }
+});
@@ -0,0 +1,262 @@
+/**
+ * Lock-free single-producer single-consumer ring over a SharedArrayBuffer,
+ * used to pass socket events and sends between a socket thread and the main
+ * thread.
+ *
+ * Layout: a 16-byte header `[head: int32][tail: int32][pending: int32][_]`
+ * followed by the records. The consumer owns `head`, the producer owns
+ * `tail`. Each record is 8-byte aligned and starts with a 16-byte header
+ * `[length: uint32][tag: uint32][id: int64]`, followed by `length` bytes of
+ * payload. A length of 0xFFFFFFFF means that the reading wraps to offset 0.
+ *
+ * `pending` is set by the producer when it wakes the consumer up, so that at
+ * most one wake message is in flight.
+ */
+
+const HEADER_BYTES = 16;
+const HEAD = 0;
+const TAIL = 1;
+const PENDING = 2;
+
+const RECORD_HEADER_BYTES = 16;
+const RECORD_WRAP = 0xFFFFFFFF;
+
+export const SPSC_WAKE = "wake";
+
+
+/**
+ * @param {number} value
+ * @returns {number} The value aligned to 8 bytes
+ */
+function align8(value) {
+    return (value + 7) & ~7;
+}
+
+
+export class SPSCRing {
+    /**
+     * @param {SharedArrayBuffer} buffer The shared buffer
+     */
+    constructor(buffer) {
+        this.buffer = buffer;
+        this.header = new Int32Array(buffer, 0, HEADER_BYTES / 4);
+        this.capacity = buffer.byteLength - HEADER_BYTES;
+        this.data = new Uint8Array(buffer, HEADER_BYTES);
+        this.view = new DataView(buffer, HEADER_BYTES);
+    }
+
+    /**
+     * Create a ring
+     * @param {number} capacity Capacity in bytes
+     * @returns {SPSCRing} The ring
+     */
+    static create(capacity) {
+        return new SPSCRing(
+            new SharedArrayBuffer(HEADER_BYTES + align8(capacity))
+        );
+    }
+
+    /**
+     * Append a record. Only called by the producer.
+     * @param {number} tag The tag
+     * @param {bigint} id The ID
+     * @param {Uint8Array} [payload] The payload, it is copied
+     * @returns {boolean} False if the ring is full
+     */
+    tryPush(tag, id, payload) {
+        const length = payload ? payload.length : 0;
+        const size = align8(RECORD_HEADER_BYTES + length);
+        const capacity = this.capacity;
+
+        const head = Atomics.load(this.header, HEAD);
+        let tail = this.header[TAIL];
+        const used = (tail - head + capacity) % capacity;
+
+        // One slot is kept free to distinguish a full ring from an empty one
+        let required = size;
+        const contiguous = capacity - tail;
+        if (contiguous < size) {
+            required += contiguous;
+        }
+        if (used + required > capacity - 8) {
+            return false;
+        }
+
+        if (contiguous < size) {
+            this.view.setUint32(tail, RECORD_WRAP, true);
+            tail = 0;
+        }
+
+        this.view.setUint32(tail, length, true);
+        this.view.setUint32(tail + 4, tag, true);
+        this.view.setBigInt64(tail + 8, id, true);
+        if (length > 0) {
+            this.data.set(payload, tail + RECORD_HEADER_BYTES);
+        }
+
+        tail += size;
+        if (tail === capacity) {
+            tail = 0;
+        }
+
+        // Publish the record
+        Atomics.store(this.header, TAIL, tail);
+        return true;
+    }
+
+    /**
+     * Consume all published records. Only called by the consumer.
+     * @param {(tag: number, id: bigint, payload: Uint8Array) => void} callback
+     * The record callback, the payload is only valid during the call
+     * @returns {number} Number of consumed records
+     */
+    drain(callback) {
+        const capacity = this.capacity;
+        const tail = Atomics.load(this.header, TAIL);
+        let head = this.header[HEAD];
+        let count = 0;
+
+        while (head !== tail) {
+            const length = this.view.getUint32(head, true);
+            if (length === RECORD_WRAP) {
+                head = 0;
+                continue;
+            }
+
+            const tag = this.view.getUint32(head + 4, true);
+            const id = this.view.getBigInt64(head + 8, true);
+            const begin = head + RECORD_HEADER_BYTES;
+            callback(tag, id, this.data.subarray(begin, begin + length));
+            count++;
+
+            head += align8(RECORD_HEADER_BYTES + length);
+            if (head === capacity) {
+                head = 0;
+            }
+        }
+
+        // Release the space
+        Atomics.store(this.header, HEAD, head);
+        return count;
+    }
+
+    /**
+     * Mark the consumer as woken up. Only called by the producer.
+     * @returns {boolean} True if the consumer needs a wake message
+     */
+    requestWake() {
+        return Atomics.compareExchange(this.header, PENDING, 0, 1) === 0;
+    }
+
+    /**
+     * Clear the wake flag before draining. Only called by the consumer.
+     */
+    clearWake() {
+        Atomics.store(this.header, PENDING, 0);
+    }
+};
+
+
+/**
+ * Producer side of a ring. Records which do not fit are kept in an overflow
+ * queue and retried on the next tick.
+ */
+export class SPSCProducer {
+    /**
+     * @param {SPSCRing} ring The ring
+     * @param {{ postMessage: (message: any) => void }} port The port to wake
+     * the consumer up
+     */
+    constructor(ring, port) {
+        this.ring = ring;
+        this.port = port;
+
+        /**
+         * @type {Array<[number, bigint, Uint8Array | undefined]>}
+         */
+        this.overflow = [];
+        this.retryScheduled = false;
+        this.retry = () => this.flushOverflow();
+    }
+
+    /**
+     * Append a record and wake the consumer up if needed
+     * @param {number} tag The tag
+     * @param {bigint} id The ID
+     * @param {Uint8Array} [payload] The payload, it is copied
+     */
+    push(tag, id, payload) {
+        if (this.overflow.length > 0 || !this.ring.tryPush(tag, id, payload)) {
+            this.overflow.push([ tag, id, payload && payload.slice() ]);
+            this.scheduleRetry();
+        }
+        this.wake();
+    }
+
+    /**
+     * Wake the consumer up, at most one wake message is in flight
+     */
+    wake() {
+        if (this.ring.requestWake()) {
+            this.port.postMessage({ type: SPSC_WAKE });
+        }
+    }
+
+    /**
+     * Move the overflow queue to the ring
+     */
+    flushOverflow() {
+        this.retryScheduled = false;
+
+        let count = 0;
+        for (; count < this.overflow.length; count++) {
+            const [ tag, id, payload ] = this.overflow[count];
+            if (!this.ring.tryPush(tag, id, payload)) {
+                break;
+            }
+        }
+        this.overflow.splice(0, count);
+
+        if (count > 0) {
+            this.wake();
+        }
+        if (this.overflow.length > 0) {
+            this.scheduleRetry();
+        }
+    }
+
+    /**
+     * Schedule the retry of overflow queue
+     */
+    scheduleRetry() {
+        if (!this.retryScheduled) {
+            this.retryScheduled = true;
+            setImmediate(this.retry);
+        }
+    }
+};
+
+
+/**
+ * Consumer side of a ring, drained when the producer wakes it up
+ */
+export class SPSCConsumer {
+    /**
+     * @param {SPSCRing} ring The ring
+     * @param {(tag: number, id: bigint, payload: Uint8Array) => void} callback
+     * The record callback
+     */
+    constructor(ring, callback) {
+        this.ring = ring;
+        this.callback = callback;
+    }
+
+    /**
+     * Handle a wake message. The flag is cleared before draining, so that
+     * records published during the drain trigger another wake message.
+     */
+    wake() {
+        this.ring.clearWake();
+        this.ring.drain(this.callback);
+    }
+};
@@ -0,0 +1,348 @@
+import { Worker } from "node:worker_threads";
+import { SPSCRing, SPSCProducer, SPSCConsumer, SPSC_WAKE } from "./spsc.js";
+
+/**
+ * Sockets hosted on worker threads.
+ *
+ * Each socket thread is a worker with its own libuv loop, platform and native
+ * socket, so that crypto, packet parsing, fragmentation and resending run off
+ * the main thread. Events of the socket thread and sends of the main thread
+ * cross through two lock-free SPSC rings (see spsc.js), only a wake message
+ * is posted when a ring turns non-empty.
+ *
+ * The sharded socket (see shard.js) runs several socket threads of one
+ * threaded socket.
+ */
+
+export const THREAD_EVENT_CONNECTED = 0;
+export const THREAD_EVENT_DISCONNECTED = 1;
+export const THREAD_EVENT_RECEIVED = 2;
+
+const DEFAULT_RING_CAPACITY = 1024 * 1024;
+
+
+/**
+ * A session of a socket thread, living on the main thread
+ */
+export class ThreadedSession {
+    /**
+     * @param {SocketThread} thread The socket thread
+     * @param {bigint} id The session ID
+     */
+    constructor(thread, id) {
+        this.thread = thread;
+        this.id = id;
+        this.data = undefined;
+    }
+
+    /**
+     * @returns {number} Index of the socket thread which owns this session
+     */
+    get shardIndex() {
+        return this.thread.index;
+    }
+
+    /**
+     * Send a payload to this session. Messages belong to the thread which
+     * created them, so only raw bytes cross to the socket thread, and no
+     * result is reported back.
+     * @param {number} channelIndex The channel index
+     * @param {Uint8Array} data The payload, it is copied
+     */
+    send(channelIndex, data) {
+        this.thread.sends.push(channelIndex, this.id, data);
+    }
+
+    /**
+     * Disconnect this session
+     */
+    disconnect() {
+        this.thread.worker.postMessage({ type: "disconnect", id: this.id });
+    }
+};
+
+
+/**
+ * A socket thread, wrapper of a worker
+ */
+class SocketThread {
+    /**
+     * @param {ThreadedSocket} owner The threaded socket
+     * @param {number} index The thread index
+     * @param {Object} workerData The worker data
+     * @param {number} ringCapacity Capacity of each ring in bytes
+     */
+    constructor(owner, index, workerData, ringCapacity) {
+        const events = SPSCRing.create(ringCapacity);
+        const sends = SPSCRing.create(ringCapacity);
+
+        this.owner = owner;
+        this.index = index;
+        this.worker = new Worker(
+            new URL("./socket-worker.js", import.meta.url),
+            {
+                workerData: {
+                    ...workerData,
+                    events: events.buffer,
+                    sends: sends.buffer
+                }
+            }
+        );
+
+        /**
+         * @type {Map<bigint, ThreadedSession>}
+         */
+        this.sessions = new Map();
+        this.sends = new SPSCProducer(sends, this.worker);
+        this.events = new SPSCConsumer(
+            events, (tag, id, payload) => this.dispatch(tag, id, payload)
+        );
+
+        /**
+         * Pending requests by their IDs
+         * @type {Map<number, { resolve: Function, reject: Function }>}
+         */
+        this.requests = new Map();
+        this.nextRequestId = 1;
+
+        this.worker.on("message", (message) => {
+            switch (message.type) {
+                case SPSC_WAKE:
+                    this.events.wake();
+                    break;
+
+                case "result":
+                    this.settle(message.id, null, message.value);
+                    break;
+
+                case "error":
+                    this.settle(message.id, new Error(message.message));
+                    break;
+            }
+        });
+
+        this.worker.on("error", (error) => this.rejectAll(error));
+
+        /**
+         * Resolves when the worker has exited
+         * @type {Promise<void>}
+         */
+        this.exited = new Promise((resolve) => {
+            this.worker.once("exit", () => {
+                this.rejectAll(new Error("Socket thread has exited"));
+                resolve();
+            });
+        });
+    }
+
+    /**
+     * Send a command and wait for its result
+     * @param {Object} command The command
+     * @returns {Promise<any>} The result
+     */
+    request(command) {
+        return new Promise((resolve, reject) => {
+            const id = this.nextRequestId++;
+            this.requests.set(id, { resolve, reject });
+            this.worker.postMessage({ ...command, id });
+        });
+    }
+
+    /**
+     * Settle a pending request
+     * @param {number} id The request ID
+     * @param {Error | null} error The error, null on success
+     * @param {any} [value] The result
+     */
+    settle(id, error, value) {
+        const request = this.requests.get(id);
+        if (!request) {
+            return;
+        }
+
+        this.requests.delete(id);
+        if (error) {
+            request.reject(error);
+        } else {
+            request.resolve(value);
+        }
+    }
+
+    /**
+     * Reject all pending requests
+     * @param {Error} error The error
+     */
+    rejectAll(error) {
+        const requests = Array.from(this.requests.values());
+        this.requests.clear();
+        for (const request of requests) {
+            request.reject(error);
+        }
+    }
+
+    /**
+     * Dispatch an event of socket thread to the listener
+     * @param {number} tag The event kind
+     * @param {bigint} id The session ID
+     * @param {Uint8Array} payload The payload
+     */
+    dispatch(tag, id, payload) {
+        const listener = this.owner.listener;
+        switch (tag) {
+            case THREAD_EVENT_CONNECTED: {
+                const session = new ThreadedSession(this, id);
+                this.sessions.set(id, session);
+                listener && listener.onConnected(session);
+                break;
+            }
+
+            case THREAD_EVENT_DISCONNECTED: {
+                const session = this.sessions.get(id);
+                if (!session) break;
+                this.sessions.delete(id);
+                listener && listener.onDisconnected(session);
+                break;
+            }
+
+            case THREAD_EVENT_RECEIVED: {
+                const session = this.sessions.get(id);
+                if (!session || !listener) break;
+                listener.onReceived(session, payload);
+                break;
+            }
+        }
+    }
+
+    /**
+     * Stop the socket thread
+     * @returns {Promise<void>} Resolves when the worker has exited
+     */
+    stop() {
+        this.sends.flushOverflow();
+        this.worker.postMessage({ type: "stop" });
+        return this.exited;
+    }
+};
+
+
+/**
+ * Socket hosted on a worker thread
+ */
+export class ThreadedSocket {
+    /**
+     * @param {number[]} channelModes The channel modes
+     * @param {{ platform?: string, ringCapacity?: number }} [options] The
+     * platform of socket thread (default: the default platform) and the
+     * capacity of each ring in bytes
+     */
+    constructor(channelModes, options = {}) {
+        this.channelModes = Array.from(channelModes);
+        this.platform = options.platform;
+        this.ringCapacity = options.ringCapacity || DEFAULT_RING_CAPACITY;
+        this.listener = null;
+
+        /**
+         * @type {SocketThread[]}
+         */
+        this.threads = [];
+    }
+
+    /**
+     * Set the listener
+     * @param {{
+     *  onConnected: (session: ThreadedSession) => void,
+     *  onDisconnected: (session: ThreadedSession) => void,
+     *  onReceived: (session: ThreadedSession, data: Uint8Array) => void
+     * }} listener The listener
+     */
+    setListener(listener) {
+        this.listener = listener;
+    }
+
+    /**
+     * Start the socket threads
+     * @param {number} count Number of threads
+     * @param {boolean} reusePort Bind with SO_REUSEPORT
+     */
+    startThreads(count, reusePort) {
+        if (this.threads.length > 0) {
+            throw new Error("Socket is already running");
+        }
+
+        for (let i = 0; i < count; i++) {
+            this.threads.push(new SocketThread(this, i, {
+                platform: this.platform,
+                reusePort,
+                channelModes: this.channelModes
+            }, this.ringCapacity));
+        }
+    }
+
+    /**
+     * Start the socket as server
+     * @param {Uint8Array} privateKey The private key
+     * @param {number | bigint} protocolID The protocol ID
+     * @param {number} maxClients The maximum number of clients
+     * @param {string} address The bind address
+     * @returns {Promise<void>} Resolves when the socket is listening
+     */
+    listen(privateKey, protocolID, maxClients, address) {
+        return this.listenThreads(
+            1, false, privateKey, protocolID, maxClients, address
+        );
+    }
+
+    /**
+     * Start the socket threads as servers
+     * @returns {Promise<void>} Resolves when all threads are listening
+     */
+    listenThreads(
+        count, reusePort, privateKey, protocolID, maxClients, address
+    ) {
+        try {
+            this.startThreads(count, reusePort);
+        } catch (error) {
+            return Promise.reject(error);
+        }
+
+        const command = {
+            type: "listen",
+            privateKey,
+            protocolID,
+            maxClients,
+            address
+        };
+        return Promise.all(
+            this.threads.map((thread) => thread.request(command))
+        ).then(() => {}, (error) => this.stop().then(() => {
+            throw error;
+        }));
+    }
+
+    /**
+     * Start the socket as a client
+     * @param {Uint8Array | string} connectToken The connect token
+     * @returns {Promise<number>} Resolves the connect result
+     */
+    connect(connectToken) {
+        try {
+            this.startThreads(1, false);
+        } catch (error) {
+            return Promise.reject(error);
+        }
+
+        return this.threads[0].request({ type: "connect", connectToken });
+    }
+
+    /**
+     * Stop the socket threads
+     * @returns {Promise<void>} Resolves when all threads have exited
+     */
+    stop() {
+        const threads = this.threads;
+        this.threads = [];
+        return Promise.all(threads.map((thread) => thread.stop()))
+            .then(() => {});
+    }
+};
+
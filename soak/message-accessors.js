@@ -0,0 +1,70 @@
+// Micro-benchmark of per-call cost of Message accessors. Each accessor is
+// measured as is (type tag check) and behind an instanceof check, which is the
+// baseline of the validation that natives did before the type tags.
+// Usage: node soak/message-accessors.js [iterations]
+import { Message } from "../lib/pomelo.js";
+
+
+const ITERATIONS = parseInt(process.argv[2]) || 1000000;
+const VALUES_PER_MESSAGE = 32;
+const ROUNDS = 5;
+
+
+/**
+ * Measure the average cost of a call in nanoseconds
+ * @param {(message: Message) => void} fn Called VALUES_PER_MESSAGE times
+ * @param {(message: Message) => void} prepare Prepare the message
+ * @returns {number} The best average cost of a call
+ */
+function measure(fn, prepare) {
+    const message = new Message();
+    let best = Infinity;
+    const messages = Math.ceil(ITERATIONS / VALUES_PER_MESSAGE);
+
+    for (let round = 0; round < ROUNDS; round++) {
+        let elapsed = 0n;
+        for (let i = 0; i < messages; i++) {
+            message.reset();
+            prepare(message);
+            const start = process.hrtime.bigint();
+            for (let j = 0; j < VALUES_PER_MESSAGE; j++) {
+                fn(message);
+            }
+            elapsed += process.hrtime.bigint() - start;
+        }
+
+        const perCall = Number(elapsed) / (messages * VALUES_PER_MESSAGE);
+        if (perCall < best) best = perCall;
+    }
+
+    return best;
+}
+
+
+/**
+ * Compare the cost of a call with and without the instanceof baseline
+ * @param {string} name Name of the case
+ * @param {(message: Message) => void} fn Called VALUES_PER_MESSAGE times
+ * @param {(message: Message) => void} prepare Prepare the message
+ */
+function bench(name, fn, prepare) {
+    const baseline = measure((message) => {
+        if (!(message instanceof Message)) {
+            throw new TypeError("Invalid instance");
+        }
+        fn(message);
+    }, prepare);
+    const tagged = measure(fn, prepare);
+
+    console.log(
+        `${name.padEnd(16)} ` +
+        `instanceof ${baseline.toFixed(1).padStart(7)} ns/call  ` +
+        `type tag ${tagged.toFixed(1).padStart(7)} ns/call`
+    );
+}
+
+
+bench("writeFloat32", (message) => message.writeFloat32(1.5), () => {});
+bench("writeInt32", (message) => message.writeInt32(25), () => {});
+bench("writeUint8", (message) => message.writeUint8(1), () => {});
+bench("size", (message) => message.size(), () => {});
@@ -0,0 +1,65 @@
+// Micro-benchmark of the handle-based Message API against the object API
+// Usage: node soak/message-handles.js [messages]
+import { Message, statistic } from "../lib/pomelo.js";
+
+
+const MESSAGES = parseInt(process.argv[2]) || 200000;
+const VALUES_PER_MESSAGE = 16;
+const ROUNDS = 5;
+
+
+/**
+ * Measure the average cost of building and freeing a message
+ * @param {string} name Name of the case
+ * @param {() => void} fn Build and free a message
+ */
+function bench(name, fn) {
+    let best = Infinity;
+    for (let round = 0; round < ROUNDS; round++) {
+        const start = process.hrtime.bigint();
+        for (let i = 0; i < MESSAGES; i++) {
+            fn();
+        }
+        const elapsed = process.hrtime.bigint() - start;
+
+        const perMessage = Number(elapsed) / MESSAGES;
+        if (perMessage < best) best = perMessage;
+    }
+
+    const perValue = best / VALUES_PER_MESSAGE;
+    console.log(
+        `${name.padEnd(20)} ${best.toFixed(1)} ns/message`,
+        `${perValue.toFixed(1)} ns/value`
+    );
+}
+
+
+bench("object (GC)", () => {
+    const message = new Message();
+    for (let j = 0; j < VALUES_PER_MESSAGE; j++) {
+        message.writeFloat32(1.5);
+    }
+});
+
+bench("object (release)", () => {
+    const message = Message.acquire();
+    for (let j = 0; j < VALUES_PER_MESSAGE; j++) {
+        message.writeFloat32(1.5);
+    }
+    message.release();
+});
+
+bench("handle", () => {
+    const handle = Message.alloc();
+    for (let j = 0; j < VALUES_PER_MESSAGE; j++) {
+        Message.wf32(handle, 1.5);
+    }
+    Message.free(handle);
+});
+
+const { binding } = statistic();
+console.log(
+    `outstanding=${binding.messagesOutstanding}`,
+    `handles=${binding.messageHandles}`,
+    `collected=${binding.messagesCollected}`
+);
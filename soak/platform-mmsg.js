@@ -0,0 +1,229 @@
+// Loopback throughput benchmark: uv platform vs mmsg platform, with and
+// without GSO/GRO (Linux only)
+// Usage: node soak/platform-mmsg.js [packetsPerBurst] [durationSeconds]
+//
+// The platform is selected when lib/pomelo.js is imported, so each platform
+// runs in its own child process.
+import { spawn } from "node:child_process";
+import { fileURLToPath } from "node:url";
+
+
+const PROTOCOL_ID = 131;
+const MAX_CLIENTS = 1;
+const CLIENT_ID = 258;
+const TIMEOUT = 1; // seconds
+
+const BURST_INTERVAL = 1; // milliseconds
+const PACKETS_PER_BURST = parseInt(process.argv[2]) || 64;
+const DURATION = parseFloat(process.argv[3]) || 5; // seconds
+const ROUND_PLATFORM = process.env.POMELO_BENCH_ROUND;
+
+
+/**
+ * Run a benchmark round with the platform of this process
+ * @param {string} address The server address
+ * @returns {Promise<Object>} The result
+ */
+async function runRound(address) {
+    const { Token, Socket, Message, ChannelMode, statistic } =
+        await import("../lib/pomelo.js");
+    const channels = [ ChannelMode.UNRELIABLE ];
+    const { privateKey, token } = createConnectToken(Token, address);
+    const result = { received: 0, sent: 0, elapsed: 0 };
+
+    return new Promise((resolve) => {
+        let burstInterval = null;
+        let startTime = 0n;
+
+        const client = new Socket(channels);
+        client.setListener({
+            onConnected(session) {
+                startTime = process.hrtime.bigint();
+                burstInterval = setInterval(() => {
+                    for (let i = 0; i < PACKETS_PER_BURST; i++) {
+                        const message = new Message();
+                        message.writeInt32(i);
+                        session.sendFast(0, message);
+                        result.sent++;
+                    }
+                }, BURST_INTERVAL);
+
+                setTimeout(() => {
+                    clearInterval(burstInterval);
+                    result.elapsed =
+                        Number(process.hrtime.bigint() - startTime) / 1e9;
+                    result.platform = statistic().platform;
+                    client.stop();
+                    server.stop();
+                    resolve(result);
+                }, DURATION * 1000);
+            },
+            onDisconnected() {},
+            onReceived() {}
+        });
+
+        const server = new Socket(channels);
+        server.setListener({
+            onConnected() {},
+            onDisconnected() {},
+            onReceived() {
+                result.received++;
+            }
+        });
+
+        server.listen(privateKey, PROTOCOL_ID, MAX_CLIENTS, address)
+            .then(() => client.connect(token))
+            .catch((err) => {
+                console.error("Failed to start benchmark: ", err);
+                resolve(result);
+            });
+    });
+}
+
+
+/**
+ * Run a round in a child process
+ * @param {string} platform The platform name
+ * @param {string} address The server address
+ * @param {Object} [env] Extra environment variables
+ * @returns {Promise<Object | null>} The result
+ */
+function spawnRound(platform, address, env = {}) {
+    return new Promise((resolve) => {
+        const child = spawn(
+            process.execPath,
+            [
+                fileURLToPath(import.meta.url),
+                String(PACKETS_PER_BURST),
+                String(DURATION),
+                address
+            ],
+            {
+                env: {
+                    ...process.env,
+                    ...env,
+                    POMELO_PLATFORM: platform,
+                    POMELO_BENCH_ROUND: platform
+                },
+                stdio: [ "ignore", "pipe", "inherit" ]
+            }
+        );
+
+        let output = "";
+        child.stdout.on("data", (chunk) => output += chunk);
+        child.on("close", () => {
+            try {
+                resolve(JSON.parse(output));
+            } catch {
+                resolve(null);
+            }
+        });
+    });
+}
+
+
+/**
+ * Print the result of a round
+ * @param {string} name Name of round
+ * @param {Object | null} result The result
+ */
+function report(name, result) {
+    if (!result) {
+        console.log(`${name.padEnd(6)} failed`);
+        return;
+    }
+
+    const rate = Math.round(result.received / result.elapsed);
+    const loss = result.sent
+        ? (1 - result.received / result.sent) * 100
+        : 0;
+    let line = `${name.padEnd(6)} received=${result.received} ` +
+        `msg/s=${rate} loss=${loss.toFixed(2)}%`;
+
+    const platform = result.platform || {};
+    if (platform.recv_syscalls !== undefined) {
+        const recvPerCall =
+            Number(platform.recv_datagrams) / Number(platform.recv_syscalls);
+        const sendPerCall =
+            Number(platform.send_datagrams) / Number(platform.send_syscalls);
+        line += ` recv/syscall=${recvPerCall.toFixed(2)}` +
+            ` send/syscall=${sendPerCall.toFixed(2)}`;
+    }
+    if (Number(platform.gso_messages) > 0) {
+        const perMessage =
+            Number(platform.gso_segments) / Number(platform.gso_messages);
+        line += ` segments/gso=${perMessage.toFixed(2)}`;
+    }
+    if (Number(platform.gro_messages) > 0) {
+        const perMessage =
+            Number(platform.gro_segments) / Number(platform.gro_messages);
+        line += ` segments/gro=${perMessage.toFixed(2)}`;
+    }
+    console.log(line);
+}
+
+
+async function main() {
+    if (ROUND_PLATFORM) {
+        const result = await runRound(process.argv[4]);
+        process.stdout.write(JSON.stringify(result, (key, value) =>
+            typeof value === "bigint" ? value.toString() : value
+        ));
+        process.exit(0);
+    }
+
+    if (process.platform !== "linux") {
+        console.error("The mmsg platform is only available on Linux");
+        process.exit(1);
+    }
+
+    console.log(
+        `Burst: ${PACKETS_PER_BURST} packets every ${BURST_INTERVAL}ms,`,
+        `duration: ${DURATION}s`
+    );
+    report("uv", await spawnRound("uv", "127.0.0.1:8894"));
+    report("mmsg", await spawnRound("mmsg", "127.0.0.1:8895"));
+    report("gso", await spawnRound("mmsg", "127.0.0.1:8896", {
+        POMELO_MMSG_GSO: "1",
+        POMELO_MMSG_GRO: "1"
+    }));
+}
+
+
+function createConnectToken(Token, address) {
+    const privateKeyArray = new Array(Token.KEY_BYTES);
+    const serverToClientKeyArray = new Array(Token.KEY_BYTES);
+    const clientToServerKeyArray = new Array(Token.KEY_BYTES);
+    const connectTokenNonceArray = new Array(Token.CONNECT_TOKEN_NONCE_BYTES);
+    const userData = new Array(Token.USER_DATA_BYTES);
+    userData.fill(0);
+
+    for (let i = 0; i < 32; i++) {
+        privateKeyArray[i] = i;
+        clientToServerKeyArray[i] = (i * 2) % 128;
+        serverToClientKeyArray[i] = (i * 3) % 128;
+
+        if (i < 24) {
+            connectTokenNonceArray[i] = (i * 4) % 128;
+        }
+    }
+
+    const privateKey = Uint8Array.from(privateKeyArray);
+    const token = Token.encode(
+        privateKey,
+        PROTOCOL_ID,
+        Date.now(),
+        Date.now() + 3600 * 1000,
+        Uint8Array.from(connectTokenNonceArray),
+        TIMEOUT,
+        [ address ],
+        Uint8Array.from(clientToServerKeyArray),
+        Uint8Array.from(serverToClientKeyArray),
+        CLIENT_ID,
+        Uint8Array.from(userData)
+    );
+
+    return { privateKey, token };
+}
+
+main();
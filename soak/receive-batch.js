@@ -0,0 +1,153 @@
+// Receive throughput benchmark: per-message onReceived vs onReceivedBatch
+// Usage: node soak/receive-batch.js [messagesPerBurst] [durationSeconds]
+import { Token, Socket, Message, ChannelMode } from "../lib/pomelo.js";
+
+
+const CHANNELS = [ ChannelMode.UNRELIABLE ];
+const PROTOCOL_ID = 129;
+const MAX_CLIENTS = 1;
+const CLIENT_ID = 256;
+const TIMEOUT = 1; // seconds
+
+const BURST_INTERVAL = 1; // milliseconds
+const MESSAGES_PER_BURST = parseInt(process.argv[2]) || 64;
+const DURATION = parseFloat(process.argv[3]) || 5; // seconds
+
+
+/**
+ * Run a single benchmark round
+ * @param {string} address The server address
+ * @param {boolean} batched Use the batched receive callback
+ * @returns {Promise<{ received: number, calls: number, elapsed: number }>}
+ */
+function runRound(address, batched) {
+    const { privateKey, token } = createConnectToken(address);
+    const result = { received: 0, calls: 0, elapsed: 0 };
+
+    return new Promise((resolve) => {
+        let burstInterval = null;
+        let startTime = 0n;
+
+        const client = new Socket(CHANNELS);
+        client.setListener({
+            onConnected(session) {
+                startTime = process.hrtime.bigint();
+                burstInterval = setInterval(() => {
+                    for (let i = 0; i < MESSAGES_PER_BURST; i++) {
+                        const message = new Message();
+                        message.writeInt32(i);
+                        message.writeFloat64(1.2);
+                        session.send(0, message);
+                    }
+                }, BURST_INTERVAL);
+
+                setTimeout(() => {
+                    clearInterval(burstInterval);
+                    result.elapsed =
+                        Number(process.hrtime.bigint() - startTime) / 1e9;
+                    client.stop();
+                    server.stop();
+                    resolve(result);
+                }, DURATION * 1000);
+            },
+            onDisconnected() {},
+            onReceived() {}
+        });
+
+        const serverListener = {
+            onConnected() {},
+            onDisconnected() {}
+        };
+
+        if (batched) {
+            serverListener.onReceivedBatch = (sessions, messages, count) => {
+                result.calls++;
+                for (let i = 0; i < count; i++) {
+                    messages[i].readInt32();
+                    messages[i].readFloat64();
+                }
+                result.received += count;
+            };
+        } else {
+            serverListener.onReceived = (session, message) => {
+                result.calls++;
+                message.readInt32();
+                message.readFloat64();
+                result.received++;
+            };
+        }
+
+        const server = new Socket(CHANNELS);
+        server.setListener(serverListener);
+        server.listen(privateKey, PROTOCOL_ID, MAX_CLIENTS, address)
+            .then(() => client.connect(token))
+            .catch((err) => {
+                console.error("Failed to start benchmark: ", err);
+                resolve(result);
+            });
+    });
+}
+
+
+/**
+ * Print the result of a round
+ * @param {string} name Name of round
+ * @param {{ received: number, calls: number, elapsed: number }} result
+ */
+function report(name, result) {
+    const rate = Math.round(result.received / result.elapsed);
+    const perCall = result.calls ? (result.received / result.calls) : 0;
+    console.log(
+        `${name.padEnd(12)} received=${result.received} calls=${result.calls}`,
+        `msg/s=${rate} msg/call=${perCall.toFixed(2)}`
+    );
+}
+
+
+async function main() {
+    console.log(
+        `Burst: ${MESSAGES_PER_BURST} messages every ${BURST_INTERVAL}ms,`,
+        `duration: ${DURATION}s`
+    );
+    report("onReceived", await runRound("127.0.0.1:8890", false));
+    report("batched", await runRound("127.0.0.1:8891", true));
+}
+
+
+function createConnectToken(address) {
+    const privateKeyArray = new Array(Token.KEY_BYTES);
+    const serverToClientKeyArray = new Array(Token.KEY_BYTES);
+    const clientToServerKeyArray = new Array(Token.KEY_BYTES);
+    const connectTokenNonceArray = new Array(Token.CONNECT_TOKEN_NONCE_BYTES);
+    const userData = new Array(Token.USER_DATA_BYTES);
+    userData.fill(0);
+
+    for (let i = 0; i < 32; i++) {
+        privateKeyArray[i] = i;
+        clientToServerKeyArray[i] = (i * 2) % 128;
+        serverToClientKeyArray[i] = (i * 3) % 128;
+
+        if (i < 24) {
+            connectTokenNonceArray[i] = (i * 4) % 128;
+        }
+    }
+
+    const privateKey = Uint8Array.from(privateKeyArray);
+    const token = Token.encode(
+        privateKey,
+        PROTOCOL_ID,
+        Date.now(),
+        Date.now() + 3600 * 1000,
+        Uint8Array.from(connectTokenNonceArray),
+        TIMEOUT,
+        [ address ],
+        Uint8Array.from(clientToServerKeyArray),
+        Uint8Array.from(serverToClientKeyArray),
+        CLIENT_ID,
+        Uint8Array.from(userData)
+    );
+
+    return { privateKey, token };
+}
+
+main();
@@ -0,0 +1,142 @@
+// Receive ingestion benchmark of the N-API platform: one native call per
+// datagram vs one native call per setImmediate
+// Usage: node soak/recv-ingest.js [packetsPerBurst] [durationSeconds]
+process.env.POMELO_PLATFORM = "napi";
+
+const { setRecvBatching } = await import("../lib/platforms/platform-napi.js");
+const { Token, Socket, Message, ChannelMode } =
+    await import("../lib/pomelo.js");
+
+
+const CHANNELS = [ ChannelMode.UNRELIABLE ];
+const PROTOCOL_ID = 130;
+const MAX_CLIENTS = 1;
+const CLIENT_ID = 257;
+const TIMEOUT = 1; // seconds
+
+const BURST_INTERVAL = 1; // milliseconds
+const PACKETS_PER_BURST = parseInt(process.argv[2]) || 64;
+const DURATION = parseFloat(process.argv[3]) || 5; // seconds
+
+
+/**
+ * Run a single benchmark round
+ * @param {string} address The server address
+ * @param {boolean} batched Use the batched ingestion
+ * @returns {Promise<{ received: number, elapsed: number }>}
+ */
+function runRound(address, batched) {
+    // Only sockets created after this call are affected
+    setRecvBatching(batched);
+
+    const { privateKey, token } = createConnectToken(address);
+    const result = { received: 0, elapsed: 0 };
+
+    return new Promise((resolve) => {
+        let burstInterval = null;
+        let startTime = 0n;
+
+        const client = new Socket(CHANNELS);
+        client.setListener({
+            onConnected(session) {
+                startTime = process.hrtime.bigint();
+                burstInterval = setInterval(() => {
+                    for (let i = 0; i < PACKETS_PER_BURST; i++) {
+                        const message = new Message();
+                        message.writeInt32(i);
+                        session.sendFast(0, message);
+                    }
+                }, BURST_INTERVAL);
+
+                setTimeout(() => {
+                    clearInterval(burstInterval);
+                    result.elapsed =
+                        Number(process.hrtime.bigint() - startTime) / 1e9;
+                    client.stop();
+                    server.stop();
+                    resolve(result);
+                }, DURATION * 1000);
+            },
+            onDisconnected() {},
+            onReceived() {}
+        });
+
+        const server = new Socket(CHANNELS);
+        server.setListener({
+            onConnected() {},
+            onDisconnected() {},
+            onReceived() {
+                result.received++;
+            }
+        });
+
+        server.listen(privateKey, PROTOCOL_ID, MAX_CLIENTS, address)
+            .then(() => client.connect(token))
+            .catch((err) => {
+                console.error("Failed to start benchmark: ", err);
+                resolve(result);
+            });
+    });
+}
+
+
+/**
+ * Print the result of a round
+ * @param {string} name Name of round
+ * @param {{ received: number, elapsed: number }} result
+ */
+function report(name, result) {
+    const rate = Math.round(result.received / result.elapsed);
+    console.log(
+        `${name.padEnd(12)} received=${result.received} packets/s=${rate}`
+    );
+}
+
+
+async function main() {
+    console.log(
+        `Burst: ${PACKETS_PER_BURST} packets every ${BURST_INTERVAL}ms,`,
+        `duration: ${DURATION}s`
+    );
+    report("per-packet", await runRound("127.0.0.1:8892", false));
+    report("batched", await runRound("127.0.0.1:8893", true));
+}
+
+
+function createConnectToken(address) {
+    const privateKeyArray = new Array(Token.KEY_BYTES);
+    const serverToClientKeyArray = new Array(Token.KEY_BYTES);
+    const clientToServerKeyArray = new Array(Token.KEY_BYTES);
+    const connectTokenNonceArray = new Array(Token.CONNECT_TOKEN_NONCE_BYTES);
+    const userData = new Array(Token.USER_DATA_BYTES);
+    userData.fill(0);
+
+    for (let i = 0; i < 32; i++) {
+        privateKeyArray[i] = i;
+        clientToServerKeyArray[i] = (i * 2) % 128;
+        serverToClientKeyArray[i] = (i * 3) % 128;
+
+        if (i < 24) {
+            connectTokenNonceArray[i] = (i * 4) % 128;
+        }
+    }
+
+    const privateKey = Uint8Array.from(privateKeyArray);
+    const token = Token.encode(
+        privateKey,
+        PROTOCOL_ID,
+        Date.now(),
+        Date.now() + 3600 * 1000,
+        Uint8Array.from(connectTokenNonceArray),
+        TIMEOUT,
+        [ address ],
+        Uint8Array.from(clientToServerKeyArray),
+        Uint8Array.from(serverToClientKeyArray),
+        CLIENT_ID,
+        Uint8Array.from(userData)
+    );
+
+    return { privateKey, token };
+}
+
+main();
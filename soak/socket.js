@@ -1,5 +1,11 @@
 // Standalone soak test
-import { Token, Socket, Message, ChannelMode } from "../lib/pomelo-udp.js";
+import {
+    Token,
+    Socket,
+    Message,
+    ChannelMode,
+    statistic
+} from "../lib/pomelo.js";
 
 
 let client = null; // The client
@@ -30,13 +36,21 @@ const clientListener = {
             message.writeFloat64(0.5);
             message.writeInt8(1);
             session.send(0, message);
+
+            // The payload goes back to the pool now instead of at next GC
+            message.release();
         }, SEND_INTERVAL * 1000);
 
         this.statisticInterval = setInterval(() => {
-            const statistic = client.statistic();
-            if (statistic.allocatorAllocatedBytes !== this.allocatedBytes) {
-                this.allocatedBytes = statistic.allocatorAllocatedBytes;
-                console.log(new Date(), "Client: ", statistic);
+            const { allocator, binding } = statistic();
+            if (allocator.allocatedBytes !== this.allocatedBytes) {
+                this.allocatedBytes = allocator.allocatedBytes;
+                console.log(
+                    new Date(),
+                    "Client: ",
+                    allocator,
+                    `outstanding=${binding.messagesOutstanding}`
+                );
             }
         }, STATISTIC_INTERVAL * 1000);
     },
@@ -67,13 +81,21 @@ const serverListener = {
             message.writeFloat64(0.5);
             message.writeInt8(1);
             session.send(0, message);
+
+            // The payload goes back to the pool now instead of at next GC
+            message.release();
         }, SEND_INTERVAL * 1000);
 
         this.statisticInterval = setInterval(() => {
-            const statistic = client.statistic();
-            if (statistic.allocatorAllocatedBytes !== this.allocatedBytes) {
-                this.allocatedBytes = statistic.allocatorAllocatedBytes;
-                console.log(new Date(), "Server: ", statistic);
+            const { allocator, binding } = statistic();
+            if (allocator.allocatedBytes !== this.allocatedBytes) {
+                this.allocatedBytes = allocator.allocatedBytes;
+                console.log(
+                    new Date(),
+                    "Server: ",
+                    allocator,
+                    `outstanding=${binding.messagesOutstanding}`
+                );
             }
         }, STATISTIC_INTERVAL * 1000);
     },
@@ -0,0 +1,237 @@
+// Simulation tick jitter benchmark: server socket on the main thread vs a
+// threaded socket, while a client floods the server from a child process.
+// Usage: node soak/threaded-jitter.js [packetsPerBurst] [durationSeconds]
+//
+// The main thread runs a 16ms simulation tick with a fixed amount of CPU
+// work. The lateness of every tick is recorded, the p50/p99 lateness is the
+// jitter caused by the transport work on the main thread.
+import { spawn } from "node:child_process";
+import { fileURLToPath } from "node:url";
+import {
+    Token,
+    Socket,
+    Message,
+    ThreadedSocket,
+    ChannelMode
+} from "../lib/pomelo.js";
+
+
+const PROTOCOL_ID = 132;
+const MAX_CLIENTS = 1;
+const CLIENT_ID = 259;
+const TIMEOUT = 1; // seconds
+
+const TICK_INTERVAL = 16; // milliseconds
+const TICK_WORK = 4; // milliseconds
+const BURST_INTERVAL = 1; // milliseconds
+const PACKET_SIZE = 512;
+const PACKETS_PER_BURST = parseInt(process.argv[2]) || 32;
+const DURATION = parseFloat(process.argv[3]) || 5; // seconds
+const CHANNELS = [ ChannelMode.RELIABLE ];
+
+
+/**
+ * Flood the server, run in the child process
+ * @param {string} token The connect token (base64)
+ */
+function runClient(token) {
+    const payload = new Uint8Array(PACKET_SIZE);
+    let burstInterval = null;
+
+    const client = new Socket(CHANNELS);
+    client.setListener({
+        onConnected(session) {
+            burstInterval = setInterval(() => {
+                for (let i = 0; i < PACKETS_PER_BURST; i++) {
+                    const message = new Message();
+                    message.write(payload);
+                    session.sendFast(0, message);
+                }
+            }, BURST_INTERVAL);
+        },
+        onDisconnected() {
+            clearInterval(burstInterval);
+            client.stop();
+        },
+        onReceived() {}
+    });
+
+    client.connect(Buffer.from(token, "base64"));
+    setTimeout(() => {
+        clearInterval(burstInterval);
+        client.stop();
+        process.exit(0);
+    }, (DURATION + 2) * 1000);
+}
+
+
+/**
+ * Spawn the flooding client
+ * @param {Uint8Array} token The connect token
+ * @returns {import("node:child_process").ChildProcess} The child process
+ */
+function spawnClient(token) {
+    return spawn(
+        process.execPath,
+        [
+            fileURLToPath(import.meta.url),
+            String(PACKETS_PER_BURST),
+            String(DURATION),
+            Buffer.from(token).toString("base64")
+        ],
+        { stdio: [ "ignore", "inherit", "inherit" ] }
+    );
+}
+
+
+/**
+ * Busy loop
+ * @param {number} ms Duration in milliseconds
+ */
+function work(ms) {
+    const end = performance.now() + ms;
+    while (performance.now() < end);
+}
+
+
+/**
+ * Run the simulation tick until the duration elapses
+ * @returns {Promise<number[]>} Lateness of every tick in milliseconds
+ */
+function runSimulation() {
+    return new Promise((resolve) => {
+        const lateness = [];
+        const start = performance.now();
+        let expected = start + TICK_INTERVAL;
+
+        const tick = () => {
+            const now = performance.now();
+            lateness.push(now - expected);
+            work(TICK_WORK);
+
+            if (now - start >= DURATION * 1000) {
+                resolve(lateness);
+                return;
+            }
+
+            expected += TICK_INTERVAL;
+            setTimeout(tick, Math.max(0, expected - performance.now()));
+        };
+        setTimeout(tick, TICK_INTERVAL);
+    });
+}
+
+
+/**
+ * Run a round
+ * @param {Socket | ThreadedSocket} server The server socket
+ * @param {string} address The server address
+ * @returns {Promise<Object>} The result
+ */
+async function runRound(server, address) {
+    const { privateKey, token } = createConnectToken(address);
+    let received = 0;
+    server.setListener({
+        onConnected() {},
+        onDisconnected() {},
+        onReceived() {
+            received++;
+        }
+    });
+
+    await server.listen(privateKey, PROTOCOL_ID, MAX_CLIENTS, address);
+    const child = spawnClient(token);
+
+    // Let the client connect before measuring
+    await new Promise((resolve) => setTimeout(resolve, 500));
+    const lateness = await runSimulation();
+
+    child.kill();
+    server.stop();
+
+    lateness.sort((a, b) => a - b);
+    const percentile = (p) => lateness[
+        Math.min(lateness.length - 1, Math.floor(lateness.length * p))
+    ];
+    return {
+        received,
+        ticks: lateness.length,
+        p50: percentile(0.5),
+        p99: percentile(0.99),
+        max: lateness[lateness.length - 1]
+    };
+}
+
+
+/**
+ * Print the result of a round
+ * @param {string} name Name of round
+ * @param {Object} result The result
+ */
+function report(name, result) {
+    console.log(
+        `${name.padEnd(9)} ticks=${result.ticks}`,
+        `received=${result.received}`,
+        `p50=${result.p50.toFixed(2)}ms`,
+        `p99=${result.p99.toFixed(2)}ms`,
+        `max=${result.max.toFixed(2)}ms`
+    );
+}
+
+
+async function main() {
+    if (process.argv[4]) {
+        runClient(process.argv[4]);
+        return;
+    }
+
+    console.log(
+        `Tick: ${TICK_INTERVAL}ms with ${TICK_WORK}ms of work,`,
+        `load: ${PACKETS_PER_BURST}x${PACKET_SIZE}B every ${BURST_INTERVAL}ms,`,
+        `duration: ${DURATION}s`
+    );
+    report("main", await runRound(new Socket(CHANNELS), "127.0.0.1:8897"));
+    report(
+        "threaded",
+        await runRound(new ThreadedSocket(CHANNELS), "127.0.0.1:8898")
+    );
+}
+
+
+function createConnectToken(address) {
+    const privateKeyArray = new Array(Token.KEY_BYTES);
+    const serverToClientKeyArray = new Array(Token.KEY_BYTES);
+    const clientToServerKeyArray = new Array(Token.KEY_BYTES);
+    const connectTokenNonceArray = new Array(Token.CONNECT_TOKEN_NONCE_BYTES);
+    const userData = new Array(Token.USER_DATA_BYTES);
+    userData.fill(0);
+
+    for (let i = 0; i < 32; i++) {
+        privateKeyArray[i] = i;
+        clientToServerKeyArray[i] = (i * 2) % 128;
+        serverToClientKeyArray[i] = (i * 3) % 128;
+
+        if (i < 24) {
+            connectTokenNonceArray[i] = (i * 4) % 128;
+        }
+    }
+
+    const privateKey = Uint8Array.from(privateKeyArray);
+    const token = Token.encode(
+        privateKey,
+        PROTOCOL_ID,
+        Date.now(),
+        Date.now() + 3600 * 1000,
+        Uint8Array.from(connectTokenNonceArray),
+        TIMEOUT,
+        [ address ],
+        Uint8Array.from(clientToServerKeyArray),
+        Uint8Array.from(serverToClientKeyArray),
+        CLIENT_ID,
+        Uint8Array.from(userData)
+    );
+
+    return { privateKey, token };
+}
+
+main();
@@ -0,0 +1,562 @@
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include "bitstream.h"
+#include "message.h"
+#include "error.h"
+#include "utils.h"
+#include "context.h"
+
+
+/// @brief Range of the three smallest components of a unit quaternion
+#define QUATERNION_RANGE 0.70710678118654752
+
+
+/// @brief Get the number of levels of a quantized value
+static double bits_levels(uint32_t bits) {
+    return (double) ((bits == 32) ? UINT32_MAX : ((1U << bits) - 1));
+}
+
+
+/// @brief Quantize a value in range
+static uint32_t bits_quantize(
+    double value,
+    double min,
+    double max,
+    uint32_t bits
+) {
+    double normalized = (value - min) / (max - min);
+    if (!(normalized > 0.0)) normalized = 0.0; // Also NaN
+    if (normalized > 1.0) normalized = 1.0;
+    return (uint32_t) floor(normalized * bits_levels(bits) + 0.5);
+}
+
+
+/// @brief Restore a quantized value
+static double bits_dequantize(
+    uint32_t quantized,
+    double min,
+    double max,
+    uint32_t bits
+) {
+    return min + ((double) quantized / bits_levels(bits)) * (max - min);
+}
+
+
+/// @brief Check the number of bits of a field
+static bool bits_valid(uint32_t bits) {
+    return bits > 0 && bits <= POMELO_NODE_BITS_MAX;
+}
+
+
+/// @brief Get the message of a bit-packing call and its arguments
+static pomelo_node_message_t * bits_message(
+    napi_env env,
+    napi_callback_info info,
+    size_t * argc,
+    napi_value * argv,
+    size_t required
+) {
+    napi_value thiz = NULL;
+    pomelo_node_context_t * context = NULL;
+    pomelo_node_message_t * node_message = NULL;
+
+    napi_call(napi_get_cb_info(
+        env, info, argc, argv, &thiz, (void **) &context
+    ));
+    napi_call(pomelo_node_validate_native(
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
+    ));
+
+    if (!node_message->message) {
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
+        return NULL;
+    }
+
+    if (argc && *argc < required) {
+        napi_throw_msg(POMELO_NODE_ERROR_NOT_ENOUGH_ARGS);
+        return NULL;
+    }
+
+    return node_message;
+}
+
+
+/// @brief Parse the number of bits of a field
+static int bits_parse(napi_env env, napi_value value, uint32_t * bits) {
+    if (napi_get_value_uint32(env, value, bits) != napi_ok) return -1;
+    return bits_valid(*bits) ? 0 : -1;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*                                Public APIs                                 */
+/*----------------------------------------------------------------------------*/
+
+void pomelo_node_bits_reset(pomelo_node_message_t * node_message) {
+    assert(node_message != NULL);
+    node_message->bits_out = 0;
+    node_message->bits_out_count = 0;
+    node_message->bits_in = 0;
+    node_message->bits_in_count = 0;
+}
+
+
+int pomelo_node_bits_write(
+    pomelo_node_message_t * node_message,
+    uint32_t value,
+    uint32_t bits
+) {
+    assert(node_message != NULL);
+    if (!bits_valid(bits) || !node_message->message) return -1;
+
+    // The pending writable view comes before the new bits
+    if (pomelo_node_message_commit_view(node_message) < 0) return -1;
+
+    uint64_t mask = (bits == 32) ? UINT32_MAX : ((1ULL << bits) - 1);
+    uint64_t out = node_message->bits_out |
+        (((uint64_t) value & mask) << node_message->bits_out_count);
+    uint32_t count = node_message->bits_out_count + bits;
+
+    // Write the filled bytes at once
+    uint8_t bytes[8];
+    size_t nbytes = 0;
+    while (count >= 8) {
+        bytes[nbytes++] = (uint8_t) out;
+        out >>= 8;
+        count -= 8;
+    }
+
+    if (nbytes > 0) {
+        int ret = pomelo_message_write_buffer(
+            node_message->message, bytes, nbytes
+        );
+        if (ret < 0) return -1; // The cursor is left unchanged
+    }
+
+    node_message->bits_out = out;
+    node_message->bits_out_count = count;
+    return 0;
+}
+
+
+int pomelo_node_bits_read(
+    pomelo_node_message_t * node_message,
+    uint32_t bits,
+    uint32_t * value
+) {
+    assert(node_message != NULL);
+    assert(value != NULL);
+    if (!bits_valid(bits) || !node_message->message) return -1;
+
+    uint64_t in = node_message->bits_in;
+    uint32_t count = node_message->bits_in_count;
+    if (count < bits) {
+        // Read the missing bytes at once
+        uint8_t bytes[8];
+        size_t nbytes = (bits - count + 7) / 8;
+        int ret = pomelo_message_read_buffer(
+            node_message->message, bytes, nbytes
+        );
+        if (ret < 0) return -1;
+
+        for (size_t i = 0; i < nbytes; i++) {
+            in |= ((uint64_t) bytes[i]) << count;
+            count += 8;
+        }
+    }
+
+    uint64_t mask = (bits == 32) ? UINT32_MAX : ((1ULL << bits) - 1);
+    *value = (uint32_t) (in & mask);
+    node_message->bits_in = in >> bits;
+    node_message->bits_in_count = count - bits;
+    return 0;
+}
+
+
+int pomelo_node_bits_flush(pomelo_node_message_t * node_message) {
+    assert(node_message != NULL);
+    uint32_t count = node_message->bits_out_count;
+    if (count == 0) return 0;
+
+    // Pad with zero bits to the next byte
+    return pomelo_node_bits_write(node_message, 0, 8 - count);
+}
+
+
+void pomelo_node_bits_drop(pomelo_node_message_t * node_message) {
+    assert(node_message != NULL);
+    node_message->bits_in = 0;
+    node_message->bits_in_count = 0;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*                               Private APIs                                 */
+/*----------------------------------------------------------------------------*/
+
+napi_value pomelo_node_message_write_bits(
+    napi_env env,
+    napi_callback_info info
+) {
+    size_t argc = 2;
+    napi_value argv[2] = { NULL };
+    pomelo_node_message_t * node_message =
+        bits_message(env, info, &argc, argv, 2);
+    if (!node_message) return NULL;
+
+    uint32_t value = 0;
+    if (napi_get_value_uint32(env, argv[0], &value) != napi_ok) {
+        napi_throw_arg("value");
+        return NULL;
+    }
+
+    uint32_t bits = 0;
+    if (bits_parse(env, argv[1], &bits) < 0) {
+        napi_throw_arg("bits");
+        return NULL;
+    }
+
+    if (pomelo_node_bits_write(node_message, value, bits) < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_WRITE_MESSAGE);
+        return NULL;
+    }
+
+    napi_value undefined = NULL;
+    napi_call(napi_get_undefined(env, &undefined));
+    return undefined;
+}
+
+
+napi_value pomelo_node_message_read_bits(
+    napi_env env,
+    napi_callback_info info
+) {
+    size_t argc = 1;
+    napi_value argv[1] = { NULL };
+    pomelo_node_message_t * node_message =
+        bits_message(env, info, &argc, argv, 1);
+    if (!node_message) return NULL;
+
+    uint32_t bits = 0;
+    if (bits_parse(env, argv[0], &bits) < 0) {
+        napi_throw_arg("bits");
+        return NULL;
+    }
+
+    uint32_t value = 0;
+    if (pomelo_node_bits_read(node_message, bits, &value) < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_READ_MESSAGE);
+        return NULL;
+    }
+
+    napi_value result = NULL;
+    napi_call(napi_create_uint32(env, value, &result));
+    return result;
+}
+
+
+napi_value pomelo_node_message_write_varint(
+    napi_env env,
+    napi_callback_info info
+) {
+    size_t argc = 1;
+    napi_value argv[1] = { NULL };
+    pomelo_node_message_t * node_message =
+        bits_message(env, info, &argc, argv, 1);
+    if (!node_message) return NULL;
+
+    int64_t value = 0;
+    if (pomelo_node_parse_int64_value(env, argv[0], &value) < 0) {
+        napi_throw_arg("value");
+        return NULL;
+    }
+
+    // Zigzag encoding maps small magnitudes to small unsigned values
+    uint64_t zigzag = ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);
+
+    // 7-bit groups, the high bit tells that more groups follow. A failed
+    // write may leave the leading groups in message.
+    do {
+        uint32_t group = (uint32_t) (zigzag & 0x7F);
+        zigzag >>= 7;
+        if (zigzag) group |= 0x80;
+        if (pomelo_node_bits_write(node_message, group, 8) < 0) {
+            napi_throw_msg(POMELO_NODE_ERROR_WRITE_MESSAGE);
+            return NULL;
+        }
+    } while (zigzag);
+
+    napi_value undefined = NULL;
+    napi_call(napi_get_undefined(env, &undefined));
+    return undefined;
+}
+
+
+napi_value pomelo_node_message_read_varint(
+    napi_env env,
+    napi_callback_info info
+) {
+    pomelo_node_message_t * node_message =
+        bits_message(env, info, NULL, NULL, 0);
+    if (!node_message) return NULL;
+
+    uint64_t zigzag = 0;
+    uint32_t group = 0x80;
+    for (int i = 0; (group & 0x80) && i < POMELO_NODE_VARINT_GROUPS_MAX; i++) {
+        if (pomelo_node_bits_read(node_message, 8, &group) < 0) {
+            napi_throw_msg(POMELO_NODE_ERROR_READ_MESSAGE);
+            return NULL;
+        }
+        zigzag |= ((uint64_t) (group & 0x7F)) << (7 * i);
+    }
+
+    if (group & 0x80) {
+        napi_throw_msg(POMELO_NODE_ERROR_READ_MESSAGE);
+        return NULL; // Too many groups
+    }
+
+    int64_t value = (int64_t) (zigzag >> 1) ^ -((int64_t) (zigzag & 1));
+    napi_value result = NULL;
+    napi_call(napi_create_bigint_int64(env, value, &result));
+    return result;
+}
+
+
+napi_value pomelo_node_message_write_quantized(
+    napi_env env,
+    napi_callback_info info
+) {
+    size_t argc = 4;
+    napi_value argv[4] = { NULL };
+    pomelo_node_message_t * node_message =
+        bits_message(env, info, &argc, argv, 4);
+    if (!node_message) return NULL;
+
+    double value = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+    uint32_t bits = 0;
+    if (napi_get_value_double(env, argv[0], &value) != napi_ok) {
+        napi_throw_arg("value");
+        return NULL;
+    }
+    if (napi_get_value_double(env, argv[1], &min) != napi_ok) {
+        napi_throw_arg("min");
+        return NULL;
+    }
+    if (napi_get_value_double(env, argv[2], &max) != napi_ok || max <= min) {
+        napi_throw_arg("max");
+        return NULL;
+    }
+    if (bits_parse(env, argv[3], &bits) < 0) {
+        napi_throw_arg("bits");
+        return NULL;
+    }
+
+    uint32_t quantized = bits_quantize(value, min, max, bits);
+    if (pomelo_node_bits_write(node_message, quantized, bits) < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_WRITE_MESSAGE);
+        return NULL;
+    }
+
+    napi_value undefined = NULL;
+    napi_call(napi_get_undefined(env, &undefined));
+    return undefined;
+}
+
+
+napi_value pomelo_node_message_read_quantized(
+    napi_env env,
+    napi_callback_info info
+) {
+    size_t argc = 3;
+    napi_value argv[3] = { NULL };
+    pomelo_node_message_t * node_message =
+        bits_message(env, info, &argc, argv, 3);
+    if (!node_message) return NULL;
+
+    double min = 0.0;
+    double max = 0.0;
+    uint32_t bits = 0;
+    if (napi_get_value_double(env, argv[0], &min) != napi_ok) {
+        napi_throw_arg("min");
+        return NULL;
+    }
+    if (napi_get_value_double(env, argv[1], &max) != napi_ok || max <= min) {
+        napi_throw_arg("max");
+        return NULL;
+    }
+    if (bits_parse(env, argv[2], &bits) < 0) {
+        napi_throw_arg("bits");
+        return NULL;
+    }
+
+    uint32_t quantized = 0;
+    if (pomelo_node_bits_read(node_message, bits, &quantized) < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_READ_MESSAGE);
+        return NULL;
+    }
+
+    napi_value result = NULL;
+    napi_call(napi_create_double(
+        env, bits_dequantize(quantized, min, max, bits), &result
+    ));
+    return result;
+}
+
+
+napi_value pomelo_node_message_write_quaternion(
+    napi_env env,
+    napi_callback_info info
+) {
+    size_t argc = 5;
+    napi_value argv[5] = { NULL };
+    pomelo_node_message_t * node_message =
+        bits_message(env, info, &argc, argv, 5);
+    if (!node_message) return NULL;
+
+    static const char * names[] = { "x", "y", "z", "w" };
+    double components[4] = { 0.0 };
+    for (size_t i = 0; i < 4; i++) {
+        if (napi_get_value_double(env, argv[i], &components[i]) != napi_ok) {
+            napi_throw_arg(names[i]);
+            return NULL;
+        }
+    }
+
+    uint32_t bits = 0;
+    if (bits_parse(env, argv[4], &bits) < 0) {
+        napi_throw_arg("bits");
+        return NULL;
+    }
+
+    // Smallest three: the largest component is dropped and restored from the
+    // unit length, the others are within [-1/sqrt(2), 1/sqrt(2)]
+    uint32_t largest = 0;
+    for (uint32_t i = 1; i < 4; i++) {
+        if (fabs(components[i]) > fabs(components[largest])) {
+            largest = i;
+        }
+    }
+
+    // q and -q are the same rotation, the dropped component is kept positive
+    double sign = (components[largest] < 0.0) ? -1.0 : 1.0;
+    if (pomelo_node_bits_write(node_message, largest, 2) < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_WRITE_MESSAGE);
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < 4; i++) {
+        if (i == largest) continue;
+        uint32_t quantized = bits_quantize(
+            components[i] * sign, -QUATERNION_RANGE, QUATERNION_RANGE, bits
+        );
+        if (pomelo_node_bits_write(node_message, quantized, bits) < 0) {
+            napi_throw_msg(POMELO_NODE_ERROR_WRITE_MESSAGE);
+            return NULL;
+        }
+    }
+
+    napi_value undefined = NULL;
+    napi_call(napi_get_undefined(env, &undefined));
+    return undefined;
+}
+
+
+napi_value pomelo_node_message_read_quaternion(
+    napi_env env,
+    napi_callback_info info
+) {
+    size_t argc = 2;
+    napi_value argv[2] = { NULL };
+    pomelo_node_message_t * node_message =
+        bits_message(env, info, &argc, argv, 1);
+    if (!node_message) return NULL;
+
+    uint32_t bits = 0;
+    if (bits_parse(env, argv[0], &bits) < 0) {
+        napi_throw_arg("bits");
+        return NULL;
+    }
+
+    uint32_t largest = 0;
+    if (pomelo_node_bits_read(node_message, 2, &largest) < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_READ_MESSAGE);
+        return NULL;
+    }
+
+    double components[4] = { 0.0 };
+    double sum = 0.0;
+    for (uint32_t i = 0; i < 4; i++) {
+        if (i == largest) continue;
+        uint32_t quantized = 0;
+        if (pomelo_node_bits_read(node_message, bits, &quantized) < 0) {
+            napi_throw_msg(POMELO_NODE_ERROR_READ_MESSAGE);
+            return NULL;
+        }
+        components[i] = bits_dequantize(
+            quantized, -QUATERNION_RANGE, QUATERNION_RANGE, bits
+        );
+        sum += components[i] * components[i];
+    }
+    components[largest] = (sum < 1.0) ? sqrt(1.0 - sum) : 0.0;
+
+    // Write to the output Float64Array or to a new one
+    napi_value out = argv[1];
+    double * data = NULL;
+    napi_valuetype out_type = napi_undefined;
+    if (out) {
+        napi_call(napi_typeof(env, out, &out_type));
+    }
+
+    if (out_type != napi_undefined) {
+        bool is_typedarray = false;
+        napi_call(napi_is_typedarray(env, out, &is_typedarray));
+        napi_typedarray_type type = napi_int8_array;
+        size_t length = 0;
+        if (is_typedarray) {
+            napi_call(napi_get_typedarray_info(
+                env, out, &type, &length, (void **) &data, NULL, NULL
+            ));
+        }
+        if (!is_typedarray || type != napi_float64_array || length < 4) {
+            napi_throw_arg("out");
+            return NULL;
+        }
+    } else {
+        napi_value arrbuf = NULL;
+        napi_call(napi_create_arraybuffer(
+            env, sizeof(components), (void **) &data, &arrbuf
+        ));
+        napi_call(napi_create_typedarray(
+            env, napi_float64_array, 4, arrbuf, 0, &out
+        ));
+    }
+
+    memcpy(data, components, sizeof(components));
+    return out;
+}
+
+
+napi_value pomelo_node_message_align_bits(
+    napi_env env,
+    napi_callback_info info
+) {
+    pomelo_node_message_t * node_message =
+        bits_message(env, info, NULL, NULL, 0);
+    if (!node_message) return NULL;
+
+    // The remaining bits of the last read byte are dropped
+    pomelo_node_bits_drop(node_message);
+
+    if (pomelo_node_bits_flush(node_message) < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_WRITE_MESSAGE);
+        return NULL;
+    }
+
+    napi_value undefined = NULL;
+    napi_call(napi_get_undefined(env, &undefined));
+    return undefined;
+}
@@ -0,0 +1,130 @@
+#ifndef POMELO_NODE_BITSTREAM_SRC_H
+#define POMELO_NODE_BITSTREAM_SRC_H
+#include "module.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Bit-packing layer of messages. The bit cursors live in the node message:
+ * the writer keeps the bits which do not fill a byte yet, the reader keeps
+ * the bits of the last read byte which have not been consumed. Bits are
+ * packed LSB first. Every byte-aligned accessor aligns first, like
+ * alignBits(): writers pad the pending bits to the next byte, readers drop
+ * the remaining bits of the last read byte.
+ */
+
+/// @brief Maximum number of bits of a single bit field
+#define POMELO_NODE_BITS_MAX 32
+
+/// @brief Maximum number of 7-bit groups of a varint
+#define POMELO_NODE_VARINT_GROUPS_MAX 10
+
+
+/*----------------------------------------------------------------------------*/
+/*                                Public APIs                                 */
+/*----------------------------------------------------------------------------*/
+
+/// @brief Reset the bit cursors of message
+void pomelo_node_bits_reset(pomelo_node_message_t * node_message);
+
+
+/// @brief Write the low bits of value
+/// @returns 0 on success or -1 on failure
+int pomelo_node_bits_write(
+    pomelo_node_message_t * node_message,
+    uint32_t value,
+    uint32_t bits
+);
+
+
+/// @brief Read bits to the low bits of value
+/// @returns 0 on success or -1 on failure
+int pomelo_node_bits_read(
+    pomelo_node_message_t * node_message,
+    uint32_t bits,
+    uint32_t * value
+);
+
+
+/// @brief Pad the pending bits of writer with zeros and write them
+/// @returns 0 on success or -1 on failure
+int pomelo_node_bits_flush(pomelo_node_message_t * node_message);
+
+
+/// @brief Drop the unconsumed bits of the last byte read by the reader
+void pomelo_node_bits_drop(pomelo_node_message_t * node_message);
+
+
+/*----------------------------------------------------------------------------*/
+/*                               Private APIs                                 */
+/*----------------------------------------------------------------------------*/
+
+/// @brief Message.writeBits()
+napi_value pomelo_node_message_write_bits(
+    napi_env env,
+    napi_callback_info info
+);
+
+
+/// @brief Message.readBits()
+napi_value pomelo_node_message_read_bits(
+    napi_env env,
+    napi_callback_info info
+);
+
+
+/// @brief Message.writeVarint()
+napi_value pomelo_node_message_write_varint(
+    napi_env env,
+    napi_callback_info info
+);
+
+
+/// @brief Message.readVarint()
+napi_value pomelo_node_message_read_varint(
+    napi_env env,
+    napi_callback_info info
+);
+
+
+/// @brief Message.writeQuantized()
+napi_value pomelo_node_message_write_quantized(
+    napi_env env,
+    napi_callback_info info
+);
+
+
+/// @brief Message.readQuantized()
+napi_value pomelo_node_message_read_quantized(
+    napi_env env,
+    napi_callback_info info
+);
+
+
+/// @brief Message.writeQuaternion()
+napi_value pomelo_node_message_write_quaternion(
+    napi_env env,
+    napi_callback_info info
+);
+
+
+/// @brief Message.readQuaternion()
+napi_value pomelo_node_message_read_quaternion(
+    napi_env env,
+    napi_callback_info info
+);
+
+
+/// @brief Message.alignBits()
+napi_value pomelo_node_message_align_bits(
+    napi_env env,
+    napi_callback_info info
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // POMELO_NODE_BITSTREAM_SRC_H
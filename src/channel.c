@@ -24,7 +24,8 @@ napi_status pomelo_node_init_channel_module(napi_env env, napi_value ns) {
             pomelo_node_channel_set_mode,
             context
         ),
-        napi_method("send", pomelo_node_channel_send, context)
+        napi_method("send", pomelo_node_channel_send, context),
+        napi_method("sendFast", pomelo_node_channel_send_fast, context)
     };
 
     napi_value clazz = NULL;
@@ -145,6 +146,9 @@ napi_value pomelo_node_channel_constructor(
         return NULL;
     }
 
+    // Tag the object for fast validation
+    napi_call(napi_type_tag_object(env, thiz, &pomelo_node_type_tag_channel));
+
     return thiz;
 }
 
@@ -180,7 +184,7 @@ napi_value pomelo_node_channel_set_mode(napi_env env, napi_callback_info info) {
         env, info, &argc, argv, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_channel, (void **) &node_channel
+        env, thiz, &pomelo_node_type_tag_channel, (void **) &node_channel
     ));
 
     if (argc < POMELO_NODE_CHANNEL_SET_MODE_ARGC) {
@@ -227,7 +231,7 @@ napi_value pomelo_node_channel_get_mode(napi_env env, napi_callback_info info) {
         env, info, NULL, NULL, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_channel, (void **) &node_channel
+        env, thiz, &pomelo_node_type_tag_channel, (void **) &node_channel
     ));
 
     if (!node_channel->channel) {
@@ -245,7 +249,13 @@ napi_value pomelo_node_channel_get_mode(napi_env env, napi_callback_info info) {
 
 
 #define POMELO_NODE_CHANNEL_SEND_ARGC 1
-napi_value pomelo_node_channel_send(napi_env env, napi_callback_info info) {
+/// @brief Send a message. Without ack, no promise is created and the result
+/// is only counted in the statistic.
+static napi_value channel_send(
+    napi_env env,
+    napi_callback_info info,
+    bool ack
+) {
     size_t argc = POMELO_NODE_CHANNEL_SEND_ARGC;
     napi_value argv[POMELO_NODE_CHANNEL_SEND_ARGC] = { NULL };
     napi_value thiz = NULL;
@@ -256,7 +266,7 @@ napi_value pomelo_node_channel_send(napi_env env, napi_callback_info info) {
         env, info, &argc, argv, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_channel, (void **) &node_channel
+        env, thiz, &pomelo_node_type_tag_channel, (void **) &node_channel
     ));
 
     if (!node_channel->channel) {
@@ -272,29 +282,36 @@ napi_value pomelo_node_channel_send(napi_env env, napi_callback_info info) {
 
     // Parse message
     napi_value js_message = argv[0];
-    napi_value class_message = NULL;
-    napi_call(napi_get_reference_value(
-        env, context->class_message, &class_message
-    ));
-
-    bool instance_of = false;
-    napi_call(napi_instanceof(env, js_message, class_message, &instance_of));
-    if (!instance_of) {
+    pomelo_node_message_t * node_message = NULL;
+    napi_status status = pomelo_node_message_of(env, js_message, &node_message);
+    if (status != napi_ok) {
         napi_throw_arg("message");
         return NULL;
     }
-
-    pomelo_node_message_t * node_message = NULL;
-    napi_call(napi_unwrap(env, js_message, (void **) &node_message));
     if (!node_message) {
         napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
         return NULL;
     }
+    if (!node_message->message) {
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
+        return NULL;
+    }
+
+    // Write the pending writable view before sending
+    if (pomelo_node_message_commit_writable(node_message) < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_WRITE_MESSAGE);
+        return NULL;
+    }
 
-    // Create promise here
     napi_value result = NULL;
     napi_deferred deferred = NULL;
-    napi_call(napi_create_promise(env, &deferred, &result));
+    if (ack) {
+        // Create promise here
+        napi_call(napi_create_promise(env, &deferred, &result));
+    } else {
+        context->send_fast_requests++;
+        napi_call(napi_get_undefined(env, &result));
+    }
 
     // Delivery the message
     pomelo_channel_send(
@@ -303,7 +320,20 @@ napi_value pomelo_node_channel_send(napi_env env, napi_callback_info info) {
         deferred
     );
 
-    return result; // Promise<number>
+    return result; // Promise<number> | undefined
+}
+
+
+napi_value pomelo_node_channel_send(napi_env env, napi_callback_info info) {
+    return channel_send(env, info, true);
+}
+
+
+napi_value pomelo_node_channel_send_fast(
+    napi_env env,
+    napi_callback_info info
+) {
+    return channel_send(env, info, false);
 }
 
 
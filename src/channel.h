@@ -72,6 +72,12 @@ napi_value pomelo_node_channel_get_mode(napi_env env, napi_callback_info info);
 /// @brief Message.send()
 napi_value pomelo_node_channel_send(napi_env env, napi_callback_info info);
 
+/// @brief Channel.sendFast()
+napi_value pomelo_node_channel_send_fast(
+    napi_env env,
+    napi_callback_info info
+);
+
 
 #ifdef __cplusplus
 }
@@ -6,6 +6,7 @@
 #include "session.h"
 #include "message.h"
 #include "channel.h"
+#include "schema.h"
 #include "utils.h"
 #include "platform.h"
 
@@ -62,68 +63,64 @@ pomelo_node_context_t * pomelo_node_context_create(
     pomelo_platform_startup(context->platform);
 
     // Create pool of sockets
-    pomelo_pool_root_options_t pool_options;
-    memset(&pool_options, 0, sizeof(pomelo_pool_root_options_t));
+    pomelo_node_pool_options_t pool_options;
+    memset(&pool_options, 0, sizeof(pomelo_node_pool_options_t));
     pool_options.allocator = allocator;
     pool_options.element_size = sizeof(pomelo_node_socket_t);
     pool_options.available_max = options->pool_socket_max;
-    pool_options.alloc_data = context;
-    pool_options.on_init = (pomelo_pool_init_cb)
+    pool_options.on_init = (pomelo_node_pool_init_cb)
         pomelo_node_socket_init;
-    pool_options.on_cleanup = (pomelo_pool_cleanup_cb)
+    pool_options.on_cleanup = (pomelo_node_pool_cleanup_cb)
         pomelo_node_socket_cleanup;
-    pool_options.zero_init = true;
-    context->pool_socket = pomelo_pool_root_create(&pool_options);
+    context->pool_socket = pomelo_node_pool_create(&pool_options);
     if (!context->pool_socket) {
         pomelo_node_context_destroy(context);
         return NULL;
     }
 
-    memset(&pool_options, 0, sizeof(pomelo_pool_root_options_t));
+    // Create pool of messages
+    memset(&pool_options, 0, sizeof(pomelo_node_pool_options_t));
     pool_options.allocator = allocator;
     pool_options.element_size = sizeof(pomelo_node_message_t);
     pool_options.available_max = options->pool_message_max;
-    pool_options.alloc_data = context;
-    pool_options.on_init = (pomelo_pool_init_cb)
+    pool_options.prewarm = options->pool_message_prewarm;
+    pool_options.on_init = (pomelo_node_pool_init_cb)
         pomelo_node_message_init;
-    pool_options.on_cleanup = (pomelo_pool_cleanup_cb)
+    pool_options.on_cleanup = (pomelo_node_pool_cleanup_cb)
         pomelo_node_message_cleanup;
-    pool_options.zero_init = true;
-    context->pool_message = pomelo_pool_root_create(&pool_options);
+    context->pool_message = pomelo_node_pool_create(&pool_options);
     if (!context->pool_message) {
         pomelo_node_context_destroy(context);
         return NULL;
     }
 
     // Create pool of sessions
-    memset(&pool_options, 0, sizeof(pomelo_pool_root_options_t));
+    memset(&pool_options, 0, sizeof(pomelo_node_pool_options_t));
     pool_options.allocator = allocator;
     pool_options.element_size = sizeof(pomelo_node_session_t);
     pool_options.available_max = options->pool_session_max;
-    pool_options.alloc_data = context;
-    pool_options.on_init = (pomelo_pool_init_cb)
+    pool_options.prewarm = options->pool_session_prewarm;
+    pool_options.on_init = (pomelo_node_pool_init_cb)
         pomelo_node_session_init;
-    pool_options.on_cleanup = (pomelo_pool_cleanup_cb)
+    pool_options.on_cleanup = (pomelo_node_pool_cleanup_cb)
         pomelo_node_session_cleanup;
-    pool_options.zero_init = true;
-    context->pool_session = pomelo_pool_root_create(&pool_options);
+    context->pool_session = pomelo_node_pool_create(&pool_options);
     if (!context->pool_session) {
         pomelo_node_context_destroy(context);
         return NULL;
     }
 
     // Create pool of channels
-    memset(&pool_options, 0, sizeof(pomelo_pool_root_options_t));
+    memset(&pool_options, 0, sizeof(pomelo_node_pool_options_t));
     pool_options.allocator = allocator;
     pool_options.element_size = sizeof(pomelo_node_channel_t);
     pool_options.available_max = options->pool_channel_max;
-    pool_options.alloc_data = context;
-    pool_options.on_init = (pomelo_pool_init_cb)
+    pool_options.prewarm = options->pool_channel_prewarm;
+    pool_options.on_init = (pomelo_node_pool_init_cb)
         pomelo_node_channel_init;
-    pool_options.on_cleanup = (pomelo_pool_cleanup_cb)
+    pool_options.on_cleanup = (pomelo_node_pool_cleanup_cb)
         pomelo_node_channel_cleanup;
-    pool_options.zero_init = true;
-    context->pool_channel = pomelo_pool_root_create(&pool_options);
+    context->pool_channel = pomelo_node_pool_create(&pool_options);
     if (!context->pool_channel) {
         pomelo_node_context_destroy(context);
         return NULL;
@@ -151,6 +148,36 @@ pomelo_node_context_t * pomelo_node_context_create(
         return NULL; // Failed to create temporary session array
     }
 
+    array_options.element_size = sizeof(pomelo_node_field_value_t);
+    context->tmp_field_values = pomelo_array_create(&array_options);
+    if (!context->tmp_field_values) {
+        pomelo_node_context_destroy(context);
+        return NULL; // Failed to create temporary field value array
+    }
+
+    // Create arrays of received messages
+    context->message_auto_release = options->message_auto_release;
+    context->message_wrappers_prewarm = options->pool_message_prewarm;
+    array_options.element_size = sizeof(pomelo_node_message_t *);
+    context->message_wrappers = pomelo_array_create(&array_options);
+    if (!context->message_wrappers) {
+        pomelo_node_context_destroy(context);
+        return NULL;
+    }
+
+    context->lent_messages = pomelo_array_create(&array_options);
+    if (!context->lent_messages) {
+        pomelo_node_context_destroy(context);
+        return NULL;
+    }
+
+    // Create table of message handles
+    context->message_handles = pomelo_node_handle_table_create(allocator);
+    if (!context->message_handles) {
+        pomelo_node_context_destroy(context);
+        return NULL;
+    }
+
     return context;
 }
 
@@ -177,18 +204,23 @@ void pomelo_node_context_destroy(pomelo_node_context_t * context) {
         context->platform = NULL;
     }
 
+    if (context->pool_socket) {
+        pomelo_node_pool_destroy(context->pool_socket);
+        context->pool_socket = NULL;
+    }
+
     if (context->pool_message) {
-        pomelo_pool_destroy(context->pool_message);
+        pomelo_node_pool_destroy(context->pool_message);
         context->pool_message = NULL;
     }
 
     if (context->pool_session) {
-        pomelo_pool_destroy(context->pool_session);
+        pomelo_node_pool_destroy(context->pool_session);
         context->pool_session = NULL;
     }
 
     if (context->pool_channel) {
-        pomelo_pool_destroy(context->pool_channel);
+        pomelo_node_pool_destroy(context->pool_channel);
         context->pool_channel = NULL;
     }
 
@@ -202,6 +234,31 @@ void pomelo_node_context_destroy(pomelo_node_context_t * context) {
         context->tmp_send_sessions = NULL;
     }
 
+    if (context->tmp_field_values) {
+        pomelo_array_destroy(context->tmp_field_values);
+        context->tmp_field_values = NULL;
+    }
+
+    if (context->message_wrappers) {
+        pomelo_array_destroy(context->message_wrappers);
+        context->message_wrappers = NULL;
+    }
+
+    if (context->lent_messages) {
+        pomelo_array_destroy(context->lent_messages);
+        context->lent_messages = NULL;
+    }
+
+    if (context->message_handles) {
+        pomelo_node_handle_table_destroy(context->message_handles);
+        context->message_handles = NULL;
+    }
+
+    if (context->message_scratch) {
+        napi_delete_reference(context->env, context->message_scratch);
+        context->message_scratch = NULL;
+    }
+
     pomelo_allocator_free(context->allocator, context);
 }
 
@@ -222,7 +279,7 @@ pomelo_node_socket_t * pomelo_node_context_acquire_socket(
     pomelo_node_context_t * context
 ) {
     assert(context != NULL);
-    return pomelo_pool_acquire(context->pool_socket, context);
+    return pomelo_node_pool_acquire(context->pool_socket, context);
 }
 
 
@@ -231,7 +288,7 @@ void pomelo_node_context_release_socket(
     pomelo_node_socket_t * node_socket
 ) {
     assert(context != NULL);
-    pomelo_pool_release(context->pool_socket, node_socket);
+    pomelo_node_pool_release(context->pool_socket, node_socket);
 }
 
 
@@ -239,7 +296,7 @@ pomelo_node_session_t * pomelo_node_context_acquire_session(
     pomelo_node_context_t * context
 ) {
     assert(context != NULL);
-    return pomelo_pool_acquire(context->pool_session, context);
+    return pomelo_node_pool_acquire(context->pool_session, context);
 }
 
 
@@ -248,7 +305,7 @@ void pomelo_node_context_release_session(
     pomelo_node_session_t * node_session
 ) {
     assert(context != NULL);
-    pomelo_pool_release(context->pool_session, node_session);
+    pomelo_node_pool_release(context->pool_session, node_session);
 }
 
 
@@ -256,7 +313,7 @@ pomelo_node_message_t * pomelo_node_context_acquire_message(
     pomelo_node_context_t * context
 ) {
     assert(context != NULL);
-    return pomelo_pool_acquire(context->pool_message, context);
+    return pomelo_node_pool_acquire(context->pool_message, context);
 }
 
 
@@ -265,7 +322,7 @@ void pomelo_node_context_release_message(
     pomelo_node_message_t * node_message
 ) {
     assert(context != NULL);
-    pomelo_pool_release(context->pool_message, node_message);
+    pomelo_node_pool_release(context->pool_message, node_message);
 }
 
 
@@ -273,7 +330,7 @@ pomelo_node_channel_t * pomelo_node_context_acquire_channel(
     pomelo_node_context_t * context
 ) {
     assert(context != NULL);
-    return pomelo_pool_acquire(context->pool_channel, context);
+    return pomelo_node_pool_acquire(context->pool_channel, context);
 }
 
 
@@ -283,7 +340,7 @@ void pomelo_node_context_release_channel(
     pomelo_node_channel_t * node_channel
 ) {
     assert(context != NULL);
-    pomelo_pool_release(context->pool_channel, node_channel);
+    pomelo_node_pool_release(context->pool_channel, node_channel);
 }
 
 
@@ -334,6 +391,41 @@ void pomelo_node_context_handle_error_default(
 }
 
 
+/// @brief Create the statistic object of a binding pool
+static napi_value context_pool_statistic(
+    napi_env env,
+    pomelo_node_pool_t * pool
+) {
+    pomelo_node_pool_statistic_t * statistic = &pool->statistic;
+    struct {
+        const char * name;
+        uint64_t value;
+    } entries[] = {
+        { "acquired", statistic->acquired },
+        { "released", statistic->released },
+        { "inUse", statistic->in_use },
+        { "peakInUse", statistic->peak_in_use },
+        { "available", statistic->available },
+        { "misses", statistic->misses },
+        { "freed", statistic->freed }
+    };
+
+    napi_value result = NULL;
+    napi_call(napi_create_object(env, &result));
+    for (size_t i = 0; i < arrlen(entries); i++) {
+        napi_value entity = NULL;
+        napi_call(napi_create_int64(
+            env, (int64_t) entries[i].value, &entity
+        ));
+        napi_call(napi_set_named_property(
+            env, result, entries[i].name, entity
+        ));
+    }
+
+    return result;
+}
+
+
 napi_value pomelo_node_context_statistic(
     napi_env env,
     napi_callback_info info
@@ -540,6 +632,117 @@ napi_value pomelo_node_context_statistic(
     ));
     napi_call(napi_set_named_property(env, category, "heartbeats", entity));
 
+    /* Binding statistic */
+
+    // Create binding statistic object
+    napi_call(napi_create_object(env, &category));
+    napi_call(napi_set_named_property(env, result, "binding", category));
+
+    // Fire-and-forget sending requests
+    napi_call(napi_create_int64(
+        env, (int64_t) context->send_fast_requests, &entity
+    ));
+    napi_call(napi_set_named_property(
+        env, category, "sendFastRequests", entity
+    ));
+
+    // Fire-and-forget sending results
+    napi_call(napi_create_int64(
+        env, (int64_t) context->send_fast_results, &entity
+    ));
+    napi_call(napi_set_named_property(
+        env, category, "sendFastResults", entity
+    ));
+
+    // Fire-and-forget sent messages
+    napi_call(napi_create_int64(
+        env, (int64_t) context->send_fast_sent, &entity
+    ));
+    napi_call(napi_set_named_property(env, category, "sendFastSent", entity));
+
+    // Fire-and-forget failures
+    napi_call(napi_create_int64(
+        env, (int64_t) context->send_fast_failures, &entity
+    ));
+    napi_call(napi_set_named_property(
+        env, category, "sendFastFailures", entity
+    ));
+
+    // Native messages which are attached to JS messages
+    napi_call(napi_create_int64(
+        env, (int64_t) context->messages_outstanding, &entity
+    ));
+    napi_call(napi_set_named_property(
+        env, category, "messagesOutstanding", entity
+    ));
+
+    // Messages released by message.release()
+    napi_call(napi_create_int64(
+        env, (int64_t) context->messages_released, &entity
+    ));
+    napi_call(napi_set_named_property(
+        env, category, "messagesReleased", entity
+    ));
+
+    // Attached messages released by the garbage collector
+    napi_call(napi_create_int64(
+        env, (int64_t) context->messages_collected, &entity
+    ));
+    napi_call(napi_set_named_property(
+        env, category, "messagesCollected", entity
+    ));
+
+    // Received messages released when their callback returned
+    napi_call(napi_create_int64(
+        env, (int64_t) context->messages_auto_released, &entity
+    ));
+    napi_call(napi_set_named_property(
+        env, category, "messagesAutoReleased", entity
+    ));
+
+    // Received messages retained by message.retain()
+    napi_call(napi_create_int64(
+        env, (int64_t) context->messages_retained, &entity
+    ));
+    napi_call(napi_set_named_property(
+        env, category, "messagesRetained", entity
+    ));
+
+    // Received messages dropped before delivery
+    napi_call(napi_create_int64(
+        env, (int64_t) context->messages_dropped, &entity
+    ));
+    napi_call(napi_set_named_property(
+        env, category, "messagesDropped", entity
+    ));
+
+    // Live message handles
+    napi_call(napi_create_int64(
+        env, (int64_t) context->message_handles->handles, &entity
+    ));
+    napi_call(napi_set_named_property(env, category, "messageHandles", entity));
+
+    // Binding pools
+    napi_value pools = NULL;
+    napi_call(napi_create_object(env, &pools));
+    napi_call(napi_set_named_property(env, category, "pools", pools));
+
+    entity = context_pool_statistic(env, context->pool_socket);
+    if (!entity) return NULL;
+    napi_call(napi_set_named_property(env, pools, "socket", entity));
+
+    entity = context_pool_statistic(env, context->pool_message);
+    if (!entity) return NULL;
+    napi_call(napi_set_named_property(env, pools, "message", entity));
+
+    entity = context_pool_statistic(env, context->pool_session);
+    if (!entity) return NULL;
+    napi_call(napi_set_named_property(env, pools, "session", entity));
+
+    entity = context_pool_statistic(env, context->pool_channel);
+    if (!entity) return NULL;
+    napi_call(napi_set_named_property(env, pools, "channel", entity));
+
     // return: Statistic
     return result;
 }
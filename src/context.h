@@ -1,7 +1,8 @@
 #ifndef POMELO_NODE_CONTEXT_SRC_H
 #define POMELO_NODE_CONTEXT_SRC_H
 #include "module.h"
-#include "utils/pool.h"
+#include "pool.h"
+#include "handle.h"
 #include "utils/array.h"
 
 #ifdef __cplusplus
@@ -32,6 +33,18 @@ struct pomelo_node_context_options_s {
     /// @brief Maximum number of channels in pool
     size_t pool_channel_max;
 
+    /// @brief Number of JS messages which are preallocated at startup
+    size_t pool_message_prewarm;
+
+    /// @brief Number of sessions which are preallocated at startup
+    size_t pool_session_prewarm;
+
+    /// @brief Number of channels which are preallocated at startup
+    size_t pool_channel_prewarm;
+
+    /// @brief Release received messages when the receive callback returns
+    bool message_auto_release;
+
     /// @brief Error handler
     napi_value error_handler;
 
@@ -69,22 +82,91 @@ struct pomelo_node_context_s {
     napi_ref class_channel;
 
     /// @brief Pool of sockets
-    pomelo_pool_t * pool_socket;
+    pomelo_node_pool_t * pool_socket;
 
     /// @brief Pool of messages
-    pomelo_pool_t * pool_message;
+    pomelo_node_pool_t * pool_message;
 
     /// @brief Pool of sessions
-    pomelo_pool_t * pool_session;
+    pomelo_node_pool_t * pool_session;
 
     /// @brief Pool of channels
-    pomelo_pool_t * pool_channel;
+    pomelo_node_pool_t * pool_channel;
 
     /// @brief Error handler
     napi_ref error_handler;
 
     /// @brief Temporary sessions for sending
     pomelo_array_t * tmp_send_sessions;
+
+    /// @brief Temporary field values parsed by writeStruct()
+    pomelo_array_t * tmp_field_values;
+
+    /// @brief Scratch ArrayBuffer shared by message views
+    napi_ref message_scratch;
+
+    /// @brief Backing store of the message scratch
+    uint8_t * message_scratch_data;
+
+    /// @brief Capacity of the message scratch
+    size_t message_scratch_capacity;
+
+    /// @brief Message whose pending writable view lives in the scratch
+    pomelo_node_message_t * message_scratch_owner;
+
+    /// @brief Whether a view over the scratch has been returned to JS
+    bool message_scratch_lent;
+
+    /// @brief Release received messages when the receive callback returns
+    bool message_auto_release;
+
+    /// @brief Number of wrappers of received messages created at startup
+    size_t message_wrappers_prewarm;
+
+    /// @brief Recycled wrappers of received messages, they are held strongly
+    pomelo_array_t * message_wrappers;
+
+    /// @brief Received messages which are lent to the batch callbacks
+    pomelo_array_t * lent_messages;
+
+    /// @brief Table of message handles
+    pomelo_node_handle_table_t * message_handles;
+
+    /* Fire-and-forget sending counters */
+
+    /// @brief Number of sending requests without result promise
+    uint64_t send_fast_requests;
+
+    /// @brief Number of completed sending requests without result promise
+    uint64_t send_fast_results;
+
+    /// @brief Number of messages sent by requests without result promise
+    uint64_t send_fast_sent;
+
+    /// @brief Number of requests without result promise which sent nothing
+    uint64_t send_fast_failures;
+
+    /* Message lifecycle counters */
+
+    /// @brief Number of native messages which are attached to JS messages
+    uint64_t messages_outstanding;
+
+    /// @brief Number of messages released by message.release()
+    uint64_t messages_released;
+
+    /// @brief Number of attached messages released by the garbage collector
+    uint64_t messages_collected;
+
+    /// @brief Number of received messages released when their callback
+    /// returned
+    uint64_t messages_auto_released;
+
+    /// @brief Number of received messages retained by message.retain()
+    uint64_t messages_retained;
+
+    /// @brief Number of received messages which could not be queued for
+    /// batched delivery
+    uint64_t messages_dropped;
 };
 
 
@@ -9,6 +9,8 @@
 
 #define POMELO_NODE_ERROR_INIT_POMELO "Failed to initialize pomelo"
 #define POMELO_NODE_ERROR_INIT_PLATFORM_UV "Failed to initialize platform uv"
+#define POMELO_NODE_ERROR_INIT_PLATFORM_MMSG                                   \
+    "Failed to initialize platform mmsg"
 #define POMELO_NODE_EMPTY_MESSAGE_ERROR "<empty error message>"
 #define POMELO_NODE_ERROR_NOT_ENOUGH_ARGS "Not enough arguments"
 #define POMELO_NODE_ERROR_CREATE_SOCKET "Failed to create socket"
@@ -42,7 +44,12 @@
 #define POMELO_NODE_ERROR_GET_CHANNELS "Failed to get channels"
 
 #define POMELO_NODE_ERROR_MESSAGE_RELEASED "This message was released"
+#define POMELO_NODE_ERROR_MESSAGE_HANDLE "Invalid or stale message handle"
 #define POMELO_NODE_ERROR_CREATE_PLATFORM "Failed to create platform"
+#define POMELO_NODE_ERROR_CREATE_RING "Failed to create receive ring"
+#define POMELO_NODE_ERROR_CREATE_SCHEMA "Failed to create schema"
+#define POMELO_NODE_ERROR_CREATE_GROUP "Failed to create session group"
+#define POMELO_NODE_ERROR_MESSAGE_SCRATCH "Failed to create message view"
 
 #define POMELO_NODE_ERROR_MSG_CAPACITY 128
 
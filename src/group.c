@@ -0,0 +1,340 @@
+#include <assert.h>
+#include <stdio.h>
+#include "module.h"
+#include "group.h"
+#include "session.h"
+#include "error.h"
+#include "utils.h"
+#include "context.h"
+
+
+/// @brief Find the index of a pointer element in array.
+/// Returns -1 if the element is not found.
+static int64_t pointer_array_index_of(pomelo_array_t * array, void * element) {
+    void ** elements = array->elements;
+    for (size_t i = 0; i < array->size; i++) {
+        if (elements[i] == element) return (int64_t) i;
+    }
+    return -1;
+}
+
+
+/// @brief Remove a pointer element from array by swapping with the last one.
+/// Returns false if the element is not found.
+static bool pointer_array_remove(pomelo_array_t * array, void * element) {
+    int64_t index = pointer_array_index_of(array, element);
+    if (index < 0) return false;
+
+    void ** elements = array->elements;
+    elements[index] = elements[array->size - 1];
+    pomelo_array_resize(array, array->size - 1);
+    return true;
+}
+
+
+/// @brief Get the live node session from JS value.
+/// Returns NULL if the value is not a session or it has been disconnected.
+static pomelo_node_session_t * group_session_of(
+    napi_env env,
+    napi_value value
+) {
+    pomelo_node_session_t * node_session = NULL;
+    napi_status status = pomelo_node_validate_native(
+        env, value, &pomelo_node_type_tag_session, (void **) &node_session
+    );
+    if (status != napi_ok) return NULL;
+    if (!node_session || !node_session->session) return NULL;
+    return node_session;
+}
+
+
+/// @brief Remove all sessions from group
+static void group_clear(pomelo_node_group_t * group) {
+    pomelo_session_t ** sessions = group->sessions->elements;
+    for (size_t i = 0; i < group->sessions->size; i++) {
+        pomelo_node_session_t * node_session =
+            pomelo_session_get_extra(sessions[i]);
+        if (node_session && node_session->groups) {
+            pointer_array_remove(node_session->groups, group);
+        }
+    }
+    pomelo_array_clear(group->sessions);
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*                                Public APIs                                 */
+/*----------------------------------------------------------------------------*/
+
+napi_status pomelo_node_init_group_module(napi_env env, napi_value ns) {
+    pomelo_node_context_t * context = NULL;
+    napi_calls(napi_get_instance_data(env, (void **) &context));
+    assert(context != NULL);
+
+    napi_property_descriptor descriptors[] = {
+        napi_property("size", pomelo_node_group_get_size, NULL, context),
+        napi_method("add", pomelo_node_group_add, context),
+        napi_method("remove", pomelo_node_group_remove, context),
+        napi_method("has", pomelo_node_group_has, context),
+        napi_method("clear", pomelo_node_group_clear, context),
+    };
+
+    // Build the class
+    napi_value clazz = NULL;
+    napi_calls(napi_define_class(
+        env,
+        "SessionGroup",
+        NAPI_AUTO_LENGTH,
+        pomelo_node_group_constructor,
+        context,
+        arrlen(descriptors),
+        descriptors,
+        &clazz
+    ));
+
+    napi_calls(napi_set_named_property(env, ns, "SessionGroup", clazz));
+    return napi_ok;
+}
+
+
+void pomelo_node_group_remove_session_from_all(
+    pomelo_node_session_t * node_session
+) {
+    assert(node_session != NULL);
+    pomelo_array_t * groups = node_session->groups;
+    if (!groups) return;
+
+    pomelo_session_t * session = node_session->session;
+    pomelo_node_group_t ** elements = groups->elements;
+    for (size_t i = 0; i < groups->size; i++) {
+        pointer_array_remove(elements[i]->sessions, session);
+    }
+    pomelo_array_clear(groups);
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*                               Private APIs                                 */
+/*----------------------------------------------------------------------------*/
+
+napi_value pomelo_node_group_constructor(
+    napi_env env,
+    napi_callback_info info
+) {
+    napi_value thiz = NULL;
+    pomelo_node_context_t * context = NULL;
+    napi_call(napi_get_cb_info(
+        env, info, NULL, NULL, &thiz, (void **) &context
+    ));
+
+    // Check if this call is a constructor call
+    napi_valuetype type;
+    napi_call(napi_typeof(env, thiz, &type));
+    if (type != napi_object) {
+        napi_throw_msg(POMELO_NODE_ERROR_CONSTRUCTOR_CALL);
+        return NULL;
+    }
+
+    pomelo_node_group_t * group = pomelo_allocator_malloc_t(
+        context->allocator,
+        pomelo_node_group_t
+    );
+    if (!group) {
+        napi_throw_msg(POMELO_NODE_ERROR_CREATE_GROUP);
+        return NULL;
+    }
+    group->context = context;
+
+    pomelo_array_options_t array_options = {
+        .allocator = context->allocator,
+        .element_size = sizeof(pomelo_session_t *)
+    };
+    group->sessions = pomelo_array_create(&array_options);
+    if (!group->sessions) {
+        pomelo_allocator_free(context->allocator, group);
+        napi_throw_msg(POMELO_NODE_ERROR_CREATE_GROUP);
+        return NULL;
+    }
+
+    napi_status status = napi_wrap(
+        env,
+        thiz,
+        group,
+        (napi_finalize) pomelo_node_group_finalizer,
+        context,
+        NULL
+    );
+    if (status != napi_ok) {
+        pomelo_array_destroy(group->sessions);
+        pomelo_allocator_free(context->allocator, group);
+        assert(false);
+        return NULL;
+    }
+
+    // Tag the object for fast validation
+    napi_call(napi_type_tag_object(env, thiz, &pomelo_node_type_tag_group));
+
+    return thiz;
+}
+
+
+void pomelo_node_group_finalizer(
+    napi_env env,
+    pomelo_node_group_t * group,
+    pomelo_node_context_t * context
+) {
+    (void) env;
+    (void) context;
+    group_clear(group);
+    pomelo_array_destroy(group->sessions);
+    pomelo_allocator_free(group->context->allocator, group);
+}
+
+
+/// @brief Prepare a group method call with a session argument
+static pomelo_node_group_t * group_session_call(
+    napi_env env,
+    napi_callback_info info,
+    pomelo_node_session_t ** node_session
+) {
+    size_t argc = 1;
+    napi_value argv[1] = { NULL };
+    napi_value thiz = NULL;
+    pomelo_node_group_t * group = NULL;
+
+    napi_call(napi_get_cb_info(env, info, &argc, argv, &thiz, NULL));
+    napi_call(pomelo_node_validate_native(
+        env, thiz, &pomelo_node_type_tag_group, (void **) &group
+    ));
+    if (!group) {
+        napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
+        return NULL;
+    }
+
+    if (argc < 1) {
+        napi_throw_msg(POMELO_NODE_ERROR_NOT_ENOUGH_ARGS);
+        return NULL;
+    }
+
+    // A disconnected session is never a member
+    *node_session = group_session_of(env, argv[0]);
+    return group;
+}
+
+
+napi_value pomelo_node_group_add(napi_env env, napi_callback_info info) {
+    pomelo_node_session_t * node_session = NULL;
+    pomelo_node_group_t * group =
+        group_session_call(env, info, &node_session);
+    if (!group) return NULL;
+
+    napi_value result = NULL;
+    if (!node_session) {
+        napi_call(napi_get_boolean(env, false, &result));
+        return result;
+    }
+
+    // Check the membership from the session side, it has fewer groups
+    if (!node_session->groups) {
+        pomelo_array_options_t array_options = {
+            .allocator = group->context->allocator,
+            .element_size = sizeof(pomelo_node_group_t *)
+        };
+        node_session->groups = pomelo_array_create(&array_options);
+        if (!node_session->groups) {
+            napi_throw_msg(POMELO_NODE_ERROR_CREATE_GROUP);
+            return NULL;
+        }
+    } else if (pointer_array_index_of(node_session->groups, group) >= 0) {
+        napi_call(napi_get_boolean(env, false, &result));
+        return result;
+    }
+
+    if (!pomelo_array_append(group->sessions, node_session->session)) {
+        napi_throw_msg(POMELO_NODE_ERROR_CREATE_GROUP);
+        return NULL;
+    }
+    if (!pomelo_array_append(node_session->groups, group)) {
+        pomelo_array_resize(group->sessions, group->sessions->size - 1);
+        napi_throw_msg(POMELO_NODE_ERROR_CREATE_GROUP);
+        return NULL;
+    }
+
+    napi_call(napi_get_boolean(env, true, &result));
+    return result;
+}
+
+
+napi_value pomelo_node_group_remove(napi_env env, napi_callback_info info) {
+    pomelo_node_session_t * node_session = NULL;
+    pomelo_node_group_t * group =
+        group_session_call(env, info, &node_session);
+    if (!group) return NULL;
+
+    bool removed = false;
+    if (node_session && node_session->groups &&
+        pointer_array_remove(node_session->groups, group)
+    ) {
+        removed = pointer_array_remove(group->sessions, node_session->session);
+        assert(removed);
+    }
+
+    napi_value result = NULL;
+    napi_call(napi_get_boolean(env, removed, &result));
+    return result;
+}
+
+
+napi_value pomelo_node_group_has(napi_env env, napi_callback_info info) {
+    pomelo_node_session_t * node_session = NULL;
+    pomelo_node_group_t * group =
+        group_session_call(env, info, &node_session);
+    if (!group) return NULL;
+
+    bool found = node_session && node_session->groups &&
+        pointer_array_index_of(node_session->groups, group) >= 0;
+
+    napi_value result = NULL;
+    napi_call(napi_get_boolean(env, found, &result));
+    return result;
+}
+
+
+napi_value pomelo_node_group_clear(napi_env env, napi_callback_info info) {
+    napi_value thiz = NULL;
+    pomelo_node_group_t * group = NULL;
+    napi_call(napi_get_cb_info(env, info, NULL, NULL, &thiz, NULL));
+    napi_call(pomelo_node_validate_native(
+        env, thiz, &pomelo_node_type_tag_group, (void **) &group
+    ));
+    if (!group) {
+        napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
+        return NULL;
+    }
+
+    group_clear(group);
+
+    napi_value result = NULL;
+    napi_call(napi_get_undefined(env, &result));
+    return result;
+}
+
+
+napi_value pomelo_node_group_get_size(napi_env env, napi_callback_info info) {
+    napi_value thiz = NULL;
+    pomelo_node_group_t * group = NULL;
+    napi_call(napi_get_cb_info(env, info, NULL, NULL, &thiz, NULL));
+    napi_call(pomelo_node_validate_native(
+        env, thiz, &pomelo_node_type_tag_group, (void **) &group
+    ));
+    if (!group) {
+        napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
+        return NULL;
+    }
+
+    napi_value result = NULL;
+    napi_call(napi_create_uint32(
+        env, (uint32_t) group->sessions->size, &result
+    ));
+    return result;
+}
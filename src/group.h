@@ -0,0 +1,77 @@
+#ifndef POMELO_NODE_GROUP_SRC_H
+#define POMELO_NODE_GROUP_SRC_H
+#include "module.h"
+#include "utils/array.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+struct pomelo_node_group_s {
+    /// @brief The context
+    pomelo_node_context_t * context;
+
+    /// @brief The member sessions (pomelo_session_t *)
+    pomelo_array_t * sessions;
+};
+
+
+/*----------------------------------------------------------------------------*/
+/*                                Public APIs                                 */
+/*----------------------------------------------------------------------------*/
+
+/// @brief Initialize the session group module
+napi_status pomelo_node_init_group_module(napi_env env, napi_value ns);
+
+
+/// @brief Remove a session from all of its groups.
+/// This is called when the node session is cleaned up.
+void pomelo_node_group_remove_session_from_all(
+    pomelo_node_session_t * node_session
+);
+
+
+/*----------------------------------------------------------------------------*/
+/*                               Private APIs                                 */
+/*----------------------------------------------------------------------------*/
+
+/// @brief SessionGroup.constructor()
+napi_value pomelo_node_group_constructor(
+    napi_env env,
+    napi_callback_info info
+);
+
+
+/// @brief Finalizer of session group
+void pomelo_node_group_finalizer(
+    napi_env env,
+    pomelo_node_group_t * group,
+    pomelo_node_context_t * context
+);
+
+
+/// @brief SessionGroup.add(session: Session): boolean
+napi_value pomelo_node_group_add(napi_env env, napi_callback_info info);
+
+
+/// @brief SessionGroup.remove(session: Session): boolean
+napi_value pomelo_node_group_remove(napi_env env, napi_callback_info info);
+
+
+/// @brief SessionGroup.has(session: Session): boolean
+napi_value pomelo_node_group_has(napi_env env, napi_callback_info info);
+
+
+/// @brief SessionGroup.clear(): void
+napi_value pomelo_node_group_clear(napi_env env, napi_callback_info info);
+
+
+/// @brief readonly SessionGroup.size: number
+napi_value pomelo_node_group_get_size(napi_env env, napi_callback_info info);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // POMELO_NODE_GROUP_SRC_H
@@ -0,0 +1,515 @@
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+#include "handle.h"
+#include "message.h"
+#include "schema.h"
+#include "error.h"
+#include "utils.h"
+#include "context.h"
+#include "bitstream.h"
+
+
+/// @brief No free slot
+#define HANDLE_NO_SLOT UINT32_MAX
+
+/// @brief Initial number of slots
+#define HANDLE_INITIAL_CAPACITY 64
+
+
+/// @brief Field types of the typed accessors, used as their callback data
+static const pomelo_node_field_type handle_field_types[] = {
+    POMELO_NODE_FIELD_UINT8,
+    POMELO_NODE_FIELD_UINT16,
+    POMELO_NODE_FIELD_UINT32,
+    POMELO_NODE_FIELD_UINT64,
+    POMELO_NODE_FIELD_INT8,
+    POMELO_NODE_FIELD_INT16,
+    POMELO_NODE_FIELD_INT32,
+    POMELO_NODE_FIELD_INT64,
+    POMELO_NODE_FIELD_FLOAT32,
+    POMELO_NODE_FIELD_FLOAT64
+};
+
+/// @brief Names of the typed writers, indexed as handle_field_types
+static const char * handle_write_names[] = {
+    "wu8", "wu16", "wu32", "wu64",
+    "wi8", "wi16", "wi32", "wi64",
+    "wf32", "wf64"
+};
+
+/// @brief Names of the typed readers, indexed as handle_field_types
+static const char * handle_read_names[] = {
+    "ru8", "ru16", "ru32", "ru64",
+    "ri8", "ri16", "ri32", "ri64",
+    "rf32", "rf64"
+};
+
+
+/// @brief Make a handle from the index and generation of slot
+static inline uint64_t handle_make(uint32_t index, uint32_t generation) {
+    return ((uint64_t) generation << POMELO_NODE_HANDLE_INDEX_BITS) | index;
+}
+
+
+/// @brief Parse a handle from JS value
+static int handle_parse(napi_env env, napi_value value, uint64_t * handle) {
+    double number = 0.0;
+    if (napi_get_value_double(env, value, &number) != napi_ok) return -1;
+
+    // Handles are integers below the limit, which also rejects NaN
+    if (!(number >= 0.0 && number < (double) POMELO_NODE_HANDLE_LIMIT)) {
+        return -1;
+    }
+    *handle = (uint64_t) number;
+    if ((double) *handle != number) return -1; // Not an integer
+    return 0;
+}
+
+
+/// @brief Make sure that the table has a free slot
+static int handle_table_reserve(pomelo_node_handle_table_t * table) {
+    if (table->free_head != HANDLE_NO_SLOT) return 0;
+    if (table->used < table->capacity) return 0;
+    if (table->capacity >= POMELO_NODE_HANDLE_MAX) return -1; // Full
+
+    uint32_t capacity = table->capacity
+        ? table->capacity * 2
+        : HANDLE_INITIAL_CAPACITY;
+    if (capacity > POMELO_NODE_HANDLE_MAX) {
+        capacity = POMELO_NODE_HANDLE_MAX;
+    }
+
+    pomelo_node_handle_slot_t * slots = pomelo_allocator_malloc(
+        table->allocator, capacity * sizeof(pomelo_node_handle_slot_t)
+    );
+    if (!slots) return -1;
+
+    if (table->slots) {
+        memcpy(
+            slots,
+            table->slots,
+            table->capacity * sizeof(pomelo_node_handle_slot_t)
+        );
+        pomelo_allocator_free(table->allocator, table->slots);
+    }
+    table->slots = slots;
+    table->capacity = capacity;
+    return 0;
+}
+
+
+/// @brief Add a node message to the table
+/// @returns The handle or zero on failure
+static uint64_t handle_table_add(
+    pomelo_node_handle_table_t * table,
+    pomelo_node_message_t * node_message
+) {
+    if (handle_table_reserve(table) < 0) return 0;
+
+    uint32_t index = table->free_head;
+    pomelo_node_handle_slot_t * slot = NULL;
+    if (index != HANDLE_NO_SLOT) {
+        slot = &table->slots[index];
+        table->free_head = slot->next_free;
+        if (table->free_head == HANDLE_NO_SLOT) {
+            table->free_tail = HANDLE_NO_SLOT;
+        }
+    } else {
+        index = table->used++;
+        slot = &table->slots[index];
+        slot->generation = 1;
+    }
+
+    slot->node_message = node_message;
+    slot->next_free = HANDLE_NO_SLOT;
+    table->handles++;
+    return handle_make(index, slot->generation);
+}
+
+
+/// @brief Remove a handle from the table
+/// @returns The node message or NULL if the handle is stale
+static pomelo_node_message_t * handle_table_remove(
+    pomelo_node_handle_table_t * table,
+    uint64_t handle
+) {
+    pomelo_node_message_t * node_message =
+        pomelo_node_handle_table_get(table, handle);
+    if (!node_message) return NULL;
+
+    uint32_t index = handle & POMELO_NODE_HANDLE_INDEX_MASK;
+    pomelo_node_handle_slot_t * slot = &table->slots[index];
+    slot->node_message = NULL;
+
+    // Bump the generation, so that the freed handle is stale
+    slot->generation++;
+    if (slot->generation == 0) {
+        slot->generation = 1;
+    }
+
+    // Free to the tail, so that the slot is reused as late as possible
+    slot->next_free = HANDLE_NO_SLOT;
+    if (table->free_tail != HANDLE_NO_SLOT) {
+        table->slots[table->free_tail].next_free = index;
+    } else {
+        table->free_head = index;
+    }
+    table->free_tail = index;
+    table->handles--;
+    return node_message;
+}
+
+
+/// @brief Get the node message of the first argument
+static pomelo_node_message_t * handle_argument(
+    napi_env env,
+    pomelo_node_context_t * context,
+    napi_value value
+) {
+    uint64_t handle = 0;
+    if (handle_parse(env, value, &handle) < 0) {
+        napi_throw_arg("handle");
+        return NULL;
+    }
+
+    pomelo_node_message_t * node_message =
+        pomelo_node_handle_table_get(context->message_handles, handle);
+    if (!node_message) {
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_HANDLE);
+        return NULL;
+    }
+
+    return node_message;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*                                Public APIs                                 */
+/*----------------------------------------------------------------------------*/
+
+pomelo_node_handle_table_t * pomelo_node_handle_table_create(
+    pomelo_allocator_t * allocator
+) {
+    assert(allocator != NULL);
+    pomelo_node_handle_table_t * table =
+        pomelo_allocator_malloc_t(allocator, pomelo_node_handle_table_t);
+    if (!table) return NULL;
+
+    memset(table, 0, sizeof(pomelo_node_handle_table_t));
+    table->allocator = allocator;
+    table->free_head = HANDLE_NO_SLOT;
+    table->free_tail = HANDLE_NO_SLOT;
+    return table;
+}
+
+
+void pomelo_node_handle_table_destroy(pomelo_node_handle_table_t * table) {
+    assert(table != NULL);
+    if (table->slots) {
+        pomelo_allocator_free(table->allocator, table->slots);
+        table->slots = NULL;
+    }
+    pomelo_allocator_free(table->allocator, table);
+}
+
+
+pomelo_node_message_t * pomelo_node_handle_table_get(
+    pomelo_node_handle_table_t * table,
+    uint64_t handle
+) {
+    assert(table != NULL);
+    if (handle >= POMELO_NODE_HANDLE_LIMIT) return NULL;
+    uint32_t index = (uint32_t) (handle & POMELO_NODE_HANDLE_INDEX_MASK);
+    uint32_t generation =
+        (uint32_t) (handle >> POMELO_NODE_HANDLE_INDEX_BITS);
+    if (index >= table->used) return NULL;
+
+    pomelo_node_handle_slot_t * slot = &table->slots[index];
+    if (slot->generation != generation) return NULL;
+    return slot->node_message;
+}
+
+
+napi_status pomelo_node_init_message_handle_module(
+    napi_env env,
+    napi_value clazz
+) {
+    pomelo_node_context_t * context = NULL;
+    napi_calls(napi_get_instance_data(env, (void **) &context));
+    assert(context != NULL);
+
+    napi_property_descriptor descriptors[] = {
+        napi_static_method(
+            "alloc", pomelo_node_message_handle_alloc, context
+        ),
+        napi_static_method(
+            "free", pomelo_node_message_handle_free, context
+        ),
+        napi_static_method(
+            "hsize", pomelo_node_message_handle_size, context
+        ),
+        napi_static_method(
+            "hreset", pomelo_node_message_handle_reset, context
+        )
+    };
+    napi_calls(napi_define_properties(
+        env, clazz, arrlen(descriptors), descriptors
+    ));
+
+    // The typed accessors get their field type as callback data
+    napi_property_descriptor accessors[2 * arrlen(handle_field_types)];
+    memset(accessors, 0, sizeof(accessors));
+    for (size_t i = 0; i < arrlen(handle_field_types); i++) {
+        void * type = (void *) &handle_field_types[i];
+        napi_property_descriptor * writer = &accessors[2 * i];
+        writer->utf8name = handle_write_names[i];
+        writer->method = pomelo_node_message_handle_write;
+        writer->attributes = napi_static;
+        writer->data = type;
+
+        napi_property_descriptor * reader = &accessors[2 * i + 1];
+        reader->utf8name = handle_read_names[i];
+        reader->method = pomelo_node_message_handle_read;
+        reader->attributes = napi_static;
+        reader->data = type;
+    }
+    napi_calls(napi_define_properties(
+        env, clazz, arrlen(accessors), accessors
+    ));
+
+    return napi_ok;
+}
+
+
+napi_status pomelo_node_message_of(
+    napi_env env,
+    napi_value value,
+    pomelo_node_message_t ** node_message
+) {
+    assert(node_message != NULL);
+    napi_valuetype type;
+    napi_calls(napi_typeof(env, value, &type));
+    if (type != napi_number) {
+        return pomelo_node_validate_native(
+            env, value, &pomelo_node_type_tag_message, (void **) node_message
+        );
+    }
+
+    pomelo_node_context_t * context = NULL;
+    napi_calls(napi_get_instance_data(env, (void **) &context));
+
+    uint64_t handle = 0;
+    if (handle_parse(env, value, &handle) < 0) return napi_invalid_arg;
+
+    // A stale handle has no node message
+    *node_message =
+        pomelo_node_handle_table_get(context->message_handles, handle);
+    return napi_ok;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*                               Private APIs                                 */
+/*----------------------------------------------------------------------------*/
+
+napi_value pomelo_node_message_handle_alloc(
+    napi_env env,
+    napi_callback_info info
+) {
+    pomelo_node_context_t * context = NULL;
+    napi_call(napi_get_cb_info(
+        env, info, NULL, NULL, NULL, (void **) &context
+    ));
+
+    pomelo_message_t * message =
+        pomelo_context_acquire_message(context->context);
+    if (!message) {
+        napi_throw_msg(POMELO_NODE_ERROR_CREATE_MESSAGE);
+        return NULL;
+    }
+
+    pomelo_node_message_t * node_message =
+        pomelo_node_context_acquire_message(context);
+    if (!node_message) {
+        pomelo_message_unref(message);
+        napi_throw_msg(POMELO_NODE_ERROR_CREATE_MESSAGE);
+        return NULL;
+    }
+
+    // Attach the native message, there is no wrapper
+    node_message->message = message;
+    pomelo_message_set_extra(message, node_message);
+    context->messages_outstanding++;
+
+    uint64_t handle =
+        handle_table_add(context->message_handles, node_message);
+    if (handle == 0) {
+        pomelo_node_message_detach(node_message);
+        pomelo_node_context_release_message(context, node_message);
+        napi_throw_msg(POMELO_NODE_ERROR_CREATE_MESSAGE);
+        return NULL;
+    }
+
+    napi_value result = NULL;
+    napi_call(napi_create_double(env, (double) handle, &result));
+    return result;
+}
+
+
+napi_value pomelo_node_message_handle_free(
+    napi_env env,
+    napi_callback_info info
+) {
+    size_t argc = 1;
+    napi_value argv[1] = { NULL };
+    pomelo_node_context_t * context = NULL;
+    napi_call(napi_get_cb_info(
+        env, info, &argc, argv, NULL, (void **) &context
+    ));
+
+    uint64_t handle = 0;
+    if (argc < 1 || handle_parse(env, argv[0], &handle) < 0) {
+        napi_throw_arg("handle");
+        return NULL;
+    }
+
+    pomelo_node_message_t * node_message =
+        handle_table_remove(context->message_handles, handle);
+    if (!node_message) {
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_HANDLE);
+        return NULL;
+    }
+
+    // Messages which are being sent are kept until they are delivered
+    pomelo_node_message_detach(node_message);
+    context->messages_released++;
+    pomelo_node_context_release_message(context, node_message);
+
+    napi_value undefined = NULL;
+    napi_call(napi_get_undefined(env, &undefined));
+    return undefined;
+}
+
+
+napi_value pomelo_node_message_handle_size(
+    napi_env env,
+    napi_callback_info info
+) {
+    size_t argc = 1;
+    napi_value argv[1] = { NULL };
+    pomelo_node_context_t * context = NULL;
+    napi_call(napi_get_cb_info(
+        env, info, &argc, argv, NULL, (void **) &context
+    ));
+
+    pomelo_node_message_t * node_message =
+        handle_argument(env, context, argv[0]);
+    if (!node_message) return NULL;
+
+    size_t size = pomelo_message_size(node_message->message);
+    napi_value result = NULL;
+    napi_call(napi_create_uint32(env, (uint32_t) size, &result));
+    return result;
+}
+
+
+napi_value pomelo_node_message_handle_reset(
+    napi_env env,
+    napi_callback_info info
+) {
+    size_t argc = 1;
+    napi_value argv[1] = { NULL };
+    pomelo_node_context_t * context = NULL;
+    napi_call(napi_get_cb_info(
+        env, info, &argc, argv, NULL, (void **) &context
+    ));
+
+    pomelo_node_message_t * node_message =
+        handle_argument(env, context, argv[0]);
+    if (!node_message) return NULL;
+
+    pomelo_message_reset(node_message->message);
+    pomelo_node_bits_reset(node_message);
+
+    napi_value undefined = NULL;
+    napi_call(napi_get_undefined(env, &undefined));
+    return undefined;
+}
+
+
+napi_value pomelo_node_message_handle_write(
+    napi_env env,
+    napi_callback_info info
+) {
+    size_t argc = 2;
+    napi_value argv[2] = { NULL };
+    pomelo_node_field_type * type = NULL;
+    napi_call(napi_get_cb_info(
+        env, info, &argc, argv, NULL, (void **) &type
+    ));
+
+    if (argc < 2) {
+        napi_throw_msg(POMELO_NODE_ERROR_NOT_ENOUGH_ARGS);
+        return NULL;
+    }
+
+    pomelo_node_context_t * context = NULL;
+    napi_call(napi_get_instance_data(env, (void **) &context));
+
+    pomelo_node_message_t * node_message =
+        handle_argument(env, context, argv[0]);
+    if (!node_message) return NULL;
+
+    pomelo_node_field_value_t value;
+    if (pomelo_node_field_parse(env, *type, argv[1], &value) < 0) {
+        napi_throw_arg("value");
+        return NULL;
+    }
+
+    if (pomelo_node_message_commit_writable(node_message) < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_WRITE_MESSAGE);
+        return NULL;
+    }
+
+    if (pomelo_node_field_write(node_message->message, *type, &value) < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_WRITE_MESSAGE);
+        return NULL;
+    }
+
+    napi_value undefined = NULL;
+    napi_call(napi_get_undefined(env, &undefined));
+    return undefined;
+}
+
+
+napi_value pomelo_node_message_handle_read(
+    napi_env env,
+    napi_callback_info info
+) {
+    size_t argc = 1;
+    napi_value argv[1] = { NULL };
+    pomelo_node_field_type * type = NULL;
+    napi_call(napi_get_cb_info(
+        env, info, &argc, argv, NULL, (void **) &type
+    ));
+
+    pomelo_node_context_t * context = NULL;
+    napi_call(napi_get_instance_data(env, (void **) &context));
+
+    pomelo_node_message_t * node_message =
+        handle_argument(env, context, argv[0]);
+    if (!node_message) return NULL;
+
+    pomelo_node_bits_drop(node_message);
+
+    napi_value result = NULL;
+    if (pomelo_node_field_read(
+        env, node_message->message, *type, &result
+    ) < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_READ_MESSAGE);
+        return NULL;
+    }
+
+    return result;
+}
@@ -0,0 +1,167 @@
+#ifndef POMELO_NODE_HANDLE_SRC_H
+#define POMELO_NODE_HANDLE_SRC_H
+#include "module.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Message handles are plain integers which index a native table of node
+ * messages, so that hot serialization code does not pay for a JS wrapper,
+ * its reference and its finalizer. The low bits of a handle are the index of
+ * its slot and the high bits are the generation of slot, which is bumped when
+ * the handle is freed, so that a stale handle is rejected instead of reaching
+ * the message which reuses its slot. Freed slots are reused in FIFO order and
+ * the generation has 32 bits, so a stale handle would only come back after
+ * 2^32 reuses of its slot. Handles fit the 53-bit integers of JS numbers.
+ */
+
+/// @brief Number of bits of the slot index of handle
+#define POMELO_NODE_HANDLE_INDEX_BITS 20
+
+/// @brief Mask of the slot index of handle
+#define POMELO_NODE_HANDLE_INDEX_MASK \
+    ((1U << POMELO_NODE_HANDLE_INDEX_BITS) - 1)
+
+/// @brief Upper bound of handles, exclusive
+#define POMELO_NODE_HANDLE_LIMIT \
+    (1ULL << (POMELO_NODE_HANDLE_INDEX_BITS + 32))
+
+/// @brief Maximum number of live handles
+#define POMELO_NODE_HANDLE_MAX (POMELO_NODE_HANDLE_INDEX_MASK + 1)
+
+
+/// @brief The slot of handle table
+typedef struct pomelo_node_handle_slot_s pomelo_node_handle_slot_t;
+
+/// @brief The handle table
+typedef struct pomelo_node_handle_table_s pomelo_node_handle_table_t;
+
+
+struct pomelo_node_handle_slot_s {
+    /// @brief The node message, NULL if the slot is free
+    pomelo_node_message_t * node_message;
+
+    /// @brief The generation of slot, never zero
+    uint32_t generation;
+
+    /// @brief The next free slot
+    uint32_t next_free;
+};
+
+
+struct pomelo_node_handle_table_s {
+    /// @brief The allocator
+    pomelo_allocator_t * allocator;
+
+    /// @brief The slots
+    pomelo_node_handle_slot_t * slots;
+
+    /// @brief Number of allocated slots
+    uint32_t capacity;
+
+    /// @brief Number of slots which have been used at least once
+    uint32_t used;
+
+    /// @brief The first free slot, UINT32_MAX if there is none. Slots are
+    /// taken from the head of free list and freed to its tail.
+    uint32_t free_head;
+
+    /// @brief The last free slot, UINT32_MAX if there is none
+    uint32_t free_tail;
+
+    /// @brief Number of live handles
+    uint64_t handles;
+};
+
+
+/*----------------------------------------------------------------------------*/
+/*                                Public APIs                                 */
+/*----------------------------------------------------------------------------*/
+
+/// @brief Create the handle table
+pomelo_node_handle_table_t * pomelo_node_handle_table_create(
+    pomelo_allocator_t * allocator
+);
+
+
+/// @brief Destroy the handle table. The messages of live handles are not
+/// released.
+void pomelo_node_handle_table_destroy(pomelo_node_handle_table_t * table);
+
+
+/// @brief Get the node message of a handle, NULL if the handle is stale
+pomelo_node_message_t * pomelo_node_handle_table_get(
+    pomelo_node_handle_table_t * table,
+    uint64_t handle
+);
+
+
+/// @brief Define the static handle APIs on the Message class
+napi_status pomelo_node_init_message_handle_module(
+    napi_env env,
+    napi_value clazz
+);
+
+
+/// @brief Get the node message of a JS message or of a message handle
+napi_status pomelo_node_message_of(
+    napi_env env,
+    napi_value value,
+    pomelo_node_message_t ** node_message
+);
+
+
+/*----------------------------------------------------------------------------*/
+/*                               Private APIs                                 */
+/*----------------------------------------------------------------------------*/
+
+/// @brief Message.alloc()
+napi_value pomelo_node_message_handle_alloc(
+    napi_env env,
+    napi_callback_info info
+);
+
+
+/// @brief Message.free()
+napi_value pomelo_node_message_handle_free(
+    napi_env env,
+    napi_callback_info info
+);
+
+
+/// @brief Message.hsize()
+napi_value pomelo_node_message_handle_size(
+    napi_env env,
+    napi_callback_info info
+);
+
+
+/// @brief Message.hreset()
+napi_value pomelo_node_message_handle_reset(
+    napi_env env,
+    napi_callback_info info
+);
+
+
+/// @brief Message.wu8(), Message.wi32(), Message.wf32()... The field type is
+/// the callback data.
+napi_value pomelo_node_message_handle_write(
+    napi_env env,
+    napi_callback_info info
+);
+
+
+/// @brief Message.ru8(), Message.ri32(), Message.rf32()... The field type is
+/// the callback data.
+napi_value pomelo_node_message_handle_read(
+    napi_env env,
+    napi_callback_info info
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // POMELO_NODE_HANDLE_SRC_H
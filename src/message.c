@@ -7,6 +7,9 @@
 #include "error.h"
 #include "utils.h"
 #include "context.h"
+#include "schema.h"
+#include "handle.h"
+#include "bitstream.h"
 
 
 /*----------------------------------------------------------------------------*/
@@ -41,8 +44,48 @@ napi_status pomelo_node_init_message_module(napi_env env, napi_value ns) {
         napi_method("readInt64", pomelo_node_message_read_int64, context),
         napi_method("readFloat32", pomelo_node_message_read_float32, context),
         napi_method("readFloat64", pomelo_node_message_read_float64, context),
+        napi_method("readView", pomelo_node_message_read_view, context),
+        napi_method("writable", pomelo_node_message_writable, context),
+        napi_method("commit", pomelo_node_message_commit, context),
+        napi_method("writeStruct", pomelo_node_message_write_struct, context),
+        napi_method("readStruct", pomelo_node_message_read_struct, context),
+        napi_method(
+            "writeString", pomelo_node_message_write_string, context
+        ),
+        napi_method("readString", pomelo_node_message_read_string, context),
+        napi_method(
+            "writeStringLatin1",
+            pomelo_node_message_write_string_latin1,
+            context
+        ),
+        napi_method(
+            "readStringLatin1", pomelo_node_message_read_string_latin1, context
+        ),
         napi_method("reset", pomelo_node_message_reset, context),
-        napi_method("size", pomelo_node_message_size, context)
+        napi_method("size", pomelo_node_message_size, context),
+        napi_method("release", pomelo_node_message_release, context),
+        napi_method("retain", pomelo_node_message_retain, context),
+        napi_method("writeBits", pomelo_node_message_write_bits, context),
+        napi_method("readBits", pomelo_node_message_read_bits, context),
+        napi_method("writeVarint", pomelo_node_message_write_varint, context),
+        napi_method("readVarint", pomelo_node_message_read_varint, context),
+        napi_method(
+            "writeQuantized", pomelo_node_message_write_quantized, context
+        ),
+        napi_method(
+            "readQuantized", pomelo_node_message_read_quantized, context
+        ),
+        napi_method(
+            "writeQuaternion", pomelo_node_message_write_quaternion, context
+        ),
+        napi_method(
+            "readQuaternion", pomelo_node_message_read_quaternion, context
+        ),
+        napi_method("alignBits", pomelo_node_message_align_bits, context),
+        napi_static_method("acquire", pomelo_node_message_acquire, context),
+        napi_static_method(
+            "compileSchema", pomelo_node_schema_compile, context
+        )
     };
 
     // Build the class
@@ -58,9 +101,48 @@ napi_status pomelo_node_init_message_module(napi_env env, napi_value ns) {
         &clazz
     ));
 
+    // Static APIs of message handles
+    napi_calls(pomelo_node_init_message_handle_module(env, clazz));
+
     napi_calls(napi_create_reference(env, clazz, 1, &context->class_message));
     napi_calls(napi_set_named_property(env, ns, "Message", clazz));
 
+    return pomelo_node_message_prewarm_wrappers(env, context);
+}
+
+
+napi_status pomelo_node_message_prewarm_wrappers(
+    napi_env env,
+    pomelo_node_context_t * context
+) {
+    // The wrappers are only recycled when received messages are lent
+    if (!context->message_auto_release) return napi_ok;
+
+    size_t count = context->message_wrappers_prewarm;
+    if (count > POMELO_NODE_MESSAGE_WRAPPERS_MAX) {
+        count = POMELO_NODE_MESSAGE_WRAPPERS_MAX;
+    }
+
+    napi_value clazz = NULL;
+    napi_calls(napi_get_reference_value(env, context->class_message, &clazz));
+
+    pomelo_array_t * wrappers = context->message_wrappers;
+    for (size_t i = wrappers->size; i < count; i++) {
+        napi_value js_message = NULL;
+        napi_calls(napi_new_instance(env, clazz, 0, NULL, &js_message));
+
+        pomelo_node_message_t * node_message = NULL;
+        napi_calls(napi_unwrap(env, js_message, (void **) &node_message));
+
+        // Keep only the wrapper, the native message goes back to its pool
+        pomelo_node_message_detach(node_message);
+        napi_calls(napi_reference_ref(env, node_message->thiz, NULL));
+        if (!pomelo_array_append(wrappers, node_message)) {
+            napi_reference_unref(env, node_message->thiz, NULL);
+            return napi_generic_failure;
+        }
+    }
+
     return napi_ok;
 }
 
@@ -98,6 +180,74 @@ napi_value pomelo_node_message_new(napi_env env, pomelo_message_t * message) {
 }
 
 
+napi_value pomelo_node_message_lend(
+    napi_env env,
+    pomelo_message_t * message,
+    pomelo_node_message_t ** node_message
+) {
+    assert(message != NULL);
+    assert(node_message != NULL);
+    pomelo_node_context_t * context = NULL;
+    napi_call(napi_get_instance_data(env, (void **) &context));
+    assert(context != NULL);
+
+    napi_value js_message = NULL;
+    pomelo_array_t * wrappers = context->message_wrappers;
+    if (wrappers->size > 0) {
+        // Attach the native message to a recycled wrapper
+        pomelo_node_message_t * recycled = NULL;
+        pomelo_array_get(wrappers, wrappers->size - 1, recycled);
+        pomelo_array_resize(wrappers, wrappers->size - 1);
+        napi_call(napi_get_reference_value(env, recycled->thiz, &js_message));
+
+        pomelo_message_ref(message);
+        recycled->message = message;
+        pomelo_message_set_extra(message, recycled);
+        context->messages_outstanding++;
+        *node_message = recycled;
+    } else {
+        js_message = pomelo_node_message_new(env, message);
+        if (!js_message) return NULL;
+        napi_call(napi_unwrap(env, js_message, (void **) node_message));
+
+        // Hold the wrapper strongly, so that it can be recycled
+        napi_call(napi_reference_ref(env, (*node_message)->thiz, NULL));
+    }
+
+    (*node_message)->lent = true;
+    (*node_message)->retained = false;
+    return js_message;
+}
+
+
+void pomelo_node_message_reclaim(pomelo_node_message_t * node_message) {
+    assert(node_message != NULL);
+    assert(node_message->lent);
+    pomelo_node_context_t * context = node_message->context;
+    napi_env env = context->env;
+    node_message->lent = false;
+
+    if (node_message->retained) {
+        // The message escapes, it is released by the garbage collector
+        context->messages_retained++;
+        napi_reference_unref(env, node_message->thiz, NULL);
+        return;
+    }
+
+    if (node_message->message) {
+        pomelo_node_message_detach(node_message);
+        context->messages_auto_released++;
+    }
+
+    pomelo_array_t * wrappers = context->message_wrappers;
+    if (wrappers->size >= POMELO_NODE_MESSAGE_WRAPPERS_MAX) {
+        napi_reference_unref(env, node_message->thiz, NULL);
+        return;
+    }
+    pomelo_array_append(wrappers, node_message);
+}
+
+
 int pomelo_node_message_init(
     pomelo_node_message_t * node_message,
     pomelo_node_context_t * context
@@ -111,11 +261,11 @@ int pomelo_node_message_init(
 void pomelo_node_message_cleanup(pomelo_node_message_t * node_message) {
     assert(node_message != NULL);
 
-    // Release the native message
+    // The native message is still attached if it has not been released
+    // explicitly, it is released by the garbage collector.
     if (node_message->message) {
-        pomelo_message_set_extra(node_message->message, NULL);
-        pomelo_message_unref(node_message->message);
-        node_message->message = NULL;
+        node_message->context->messages_collected++;
+        pomelo_node_message_detach(node_message);
     }
 
     // Delete the reference
@@ -126,6 +276,57 @@ void pomelo_node_message_cleanup(pomelo_node_message_t * node_message) {
 }
 
 
+void pomelo_node_message_detach(pomelo_node_message_t * node_message) {
+    assert(node_message != NULL);
+    pomelo_node_message_discard_view(node_message);
+    pomelo_node_bits_reset(node_message);
+
+    pomelo_message_t * message = node_message->message;
+    if (!message) return; // Already detached
+
+    pomelo_message_set_extra(message, NULL);
+    pomelo_message_unref(message);
+    node_message->message = NULL;
+    node_message->context->messages_outstanding--;
+}
+
+
+int pomelo_node_message_commit_writable(pomelo_node_message_t * node_message) {
+    assert(node_message != NULL);
+
+    // Pending bits are padded to a whole byte before the message is sent
+    if (pomelo_node_bits_flush(node_message) < 0) return -1;
+    return pomelo_node_message_commit_view(node_message);
+}
+
+
+int pomelo_node_message_commit_view(pomelo_node_message_t * node_message) {
+    assert(node_message != NULL);
+    size_t length = node_message->writable_length;
+    pomelo_node_message_discard_view(node_message);
+    if (length == 0) return 0;
+
+    pomelo_node_context_t * context = node_message->context;
+    if (!node_message->message || !context->message_scratch_data) return -1;
+    if (length > context->message_scratch_capacity) return -1;
+
+    return pomelo_message_write_buffer(
+        node_message->message, context->message_scratch_data, length
+    );
+}
+
+
+void pomelo_node_message_discard_view(pomelo_node_message_t * node_message) {
+    assert(node_message != NULL);
+    node_message->writable_length = 0;
+
+    pomelo_node_context_t * context = node_message->context;
+    if (context && context->message_scratch_owner == node_message) {
+        context->message_scratch_owner = NULL;
+    }
+}
+
+
 /*----------------------------------------------------------------------------*/
 /*                                Private APIs                                */
 /*----------------------------------------------------------------------------*/
@@ -182,6 +383,7 @@ napi_value pomelo_node_message_constructor(
     // Attach the native message
     node_message->message = message;
     pomelo_message_set_extra(message, node_message);
+    context->messages_outstanding++;
     
     // Wrap the message
     napi_status status = napi_wrap(
@@ -194,10 +396,14 @@ napi_value pomelo_node_message_constructor(
     );
 
     if (status != napi_ok) {
+        pomelo_node_message_detach(node_message);
         pomelo_node_context_release_message(context, node_message);
         return NULL;
     }
 
+    // Tag the object for fast validation
+    napi_call(napi_type_tag_object(env, thiz, &pomelo_node_type_tag_message));
+
     // This will create weak ref of message
     return thiz;
 }
@@ -224,17 +430,19 @@ napi_value pomelo_node_message_reset(napi_env env, napi_callback_info info) {
         env, info, NULL, NULL, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_message, (void **) &node_message
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
     ));
 
     pomelo_message_t * message = node_message->message;
     if (!message) {
-        napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
         return NULL;
     }
 
     // Reset the message
     pomelo_message_reset(message);
+    pomelo_node_message_discard_view(node_message);
+    pomelo_node_bits_reset(node_message);
 
     napi_value undefined = NULL;
     napi_call(napi_get_undefined(env, &undefined));
@@ -251,12 +459,12 @@ napi_value pomelo_node_message_size(napi_env env, napi_callback_info info) {
         env, info, NULL, NULL, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_message, (void **) &node_message
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
     ));
 
     pomelo_message_t * message = node_message->message;
     if (!message) {
-        napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
         return NULL;
     }
 
@@ -267,6 +475,76 @@ napi_value pomelo_node_message_size(napi_env env, napi_callback_info info) {
 }
 
 
+napi_value pomelo_node_message_acquire(
+    napi_env env,
+    napi_callback_info info
+) {
+    pomelo_node_context_t * context = NULL;
+    napi_call(napi_get_cb_info(
+        env, info, NULL, NULL, NULL, (void **) &context
+    ));
+
+    napi_value clazz = NULL;
+    napi_call(napi_get_reference_value(env, context->class_message, &clazz));
+
+    // The constructor acquires new native message
+    napi_value js_message = NULL;
+    napi_call(napi_new_instance(env, clazz, 0, NULL, &js_message));
+    return js_message;
+}
+
+
+napi_value pomelo_node_message_release(napi_env env, napi_callback_info info) {
+    napi_value thiz = NULL;
+    pomelo_node_context_t * context = NULL;
+    pomelo_node_message_t * node_message = NULL;
+
+    napi_call(napi_get_cb_info(
+        env, info, NULL, NULL, &thiz, (void **) &context
+    ));
+    napi_call(pomelo_node_validate_native(
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
+    ));
+
+    if (!node_message->message) {
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
+        return NULL;
+    }
+
+    // Return the native message and its payloads to the pool now. The wrapper
+    // keeps the detached node message until it is finalized.
+    pomelo_node_message_detach(node_message);
+    context->messages_released++;
+
+    napi_value undefined = NULL;
+    napi_call(napi_get_undefined(env, &undefined));
+    return undefined;
+}
+
+
+napi_value pomelo_node_message_retain(napi_env env, napi_callback_info info) {
+    napi_value thiz = NULL;
+    pomelo_node_context_t * context = NULL;
+    pomelo_node_message_t * node_message = NULL;
+
+    napi_call(napi_get_cb_info(
+        env, info, NULL, NULL, &thiz, (void **) &context
+    ));
+    napi_call(pomelo_node_validate_native(
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
+    ));
+
+    if (!node_message->message) {
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
+        return NULL;
+    }
+
+    // Only lent messages are released automatically
+    node_message->retained = true;
+    return thiz;
+}
+
+
 #define POMELO_NODE_MESSAGE_READ_ARGC 1
 napi_value pomelo_node_message_read(napi_env env, napi_callback_info info) {
     size_t argc = POMELO_NODE_MESSAGE_READ_ARGC;
@@ -279,15 +557,18 @@ napi_value pomelo_node_message_read(napi_env env, napi_callback_info info) {
         env, info, &argc, argv, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_message, (void **) &node_message
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
     ));
 
     pomelo_message_t * message = node_message->message;
     if (!message) {
-        napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
         return NULL;
     }
 
+    // Byte-aligned reads drop the unconsumed bits of the bit reader
+    pomelo_node_bits_drop(node_message);
+
     if (argc < POMELO_NODE_MESSAGE_READ_ARGC) { 
         napi_throw_msg(POMELO_NODE_ERROR_NOT_ENOUGH_ARGS);
         return NULL;
@@ -333,15 +614,18 @@ napi_value pomelo_node_message_read_uint8(
         env, info, NULL, NULL, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_message, (void **) &node_message
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
     ));
 
     pomelo_message_t * message = node_message->message;
     if (!message) {
-        napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
         return NULL;
     }
 
+    // Byte-aligned reads drop the unconsumed bits of the bit reader
+    pomelo_node_bits_drop(node_message);
+
     uint8_t value = 0;
     if (pomelo_message_read_uint8(message, &value) < 0) {
         // Failed to read
@@ -367,16 +651,19 @@ napi_value pomelo_node_message_read_uint16(
         env, info, NULL, NULL, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_message, (void **) &node_message
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
     ));
 
 
     pomelo_message_t * message = node_message->message;
     if (!message) {
-        napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
         return NULL;
     }
 
+    // Byte-aligned reads drop the unconsumed bits of the bit reader
+    pomelo_node_bits_drop(node_message);
+
     uint16_t value = 0;
     if (pomelo_message_read_uint16(message, &value) < 0) {
         // Failed to read
@@ -402,15 +689,18 @@ napi_value pomelo_node_message_read_uint32(
         env, info, NULL, NULL, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_message, (void **) &node_message
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
     ));
 
     pomelo_message_t * message = node_message->message;
     if (!message) {
-        napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
         return NULL;
     }
 
+    // Byte-aligned reads drop the unconsumed bits of the bit reader
+    pomelo_node_bits_drop(node_message);
+
     uint32_t value = 0;
     if (pomelo_message_read_uint32(message, &value) < 0) {
         // Failed to read
@@ -436,16 +726,19 @@ napi_value pomelo_node_message_read_uint64(
         env, info, NULL, NULL, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_message, (void **) &node_message
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
     ));
 
 
     pomelo_message_t * message = node_message->message;
     if (!message) {
-        napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
         return NULL;
     }
 
+    // Byte-aligned reads drop the unconsumed bits of the bit reader
+    pomelo_node_bits_drop(node_message);
+
     uint64_t value = 0;
     if (pomelo_message_read_uint64(message, &value) < 0) {
         // Failed to read
@@ -471,16 +764,19 @@ napi_value pomelo_node_message_read_int8(
         env, info, NULL, NULL, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_message, (void **) &node_message
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
     ));
 
 
     pomelo_message_t * message = node_message->message;
     if (!message) {
-        napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
         return NULL;
     }
 
+    // Byte-aligned reads drop the unconsumed bits of the bit reader
+    pomelo_node_bits_drop(node_message);
+
     int8_t value = 0;
     if (pomelo_message_read_int8(message, &value) < 0) {
         // Failed to read
@@ -506,16 +802,19 @@ napi_value pomelo_node_message_read_int16(
         env, info, NULL, NULL, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_message, (void **) &node_message
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
     ));
 
 
     pomelo_message_t * message = node_message->message;
     if (!message) {
-        napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
         return NULL;
     }
 
+    // Byte-aligned reads drop the unconsumed bits of the bit reader
+    pomelo_node_bits_drop(node_message);
+
     int16_t value = 0;
     if (pomelo_message_read_int16(message, &value) < 0) {
         // Failed to read
@@ -541,16 +840,19 @@ napi_value pomelo_node_message_read_int32(
         env, info, NULL, NULL, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_message, (void **) &node_message
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
     ));
 
 
     pomelo_message_t * message = node_message->message;
     if (!message) {
-        napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
         return NULL;
     }
 
+    // Byte-aligned reads drop the unconsumed bits of the bit reader
+    pomelo_node_bits_drop(node_message);
+
     int32_t value = 0;
     if (pomelo_message_read_int32(message, &value) < 0) {
         // Failed to read
@@ -576,16 +878,19 @@ napi_value pomelo_node_message_read_int64(
         env, info, NULL, NULL, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_message, (void **) &node_message
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
     ));
 
 
     pomelo_message_t * message = node_message->message;
     if (!message) {
-        napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
         return NULL;
     }
 
+    // Byte-aligned reads drop the unconsumed bits of the bit reader
+    pomelo_node_bits_drop(node_message);
+
     int64_t value = 0;
     if (pomelo_message_read_int64(message, &value) < 0) {
         // Failed to read
@@ -611,16 +916,19 @@ napi_value pomelo_node_message_read_float32(
         env, info, NULL, NULL, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_message, (void **) &node_message
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
     ));
 
 
     pomelo_message_t * message = node_message->message;
     if (!message) {
-        napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
         return NULL;
     }
 
+    // Byte-aligned reads drop the unconsumed bits of the bit reader
+    pomelo_node_bits_drop(node_message);
+
     float value = 0;
     if (pomelo_message_read_float32(message, &value) < 0) {
         // Failed to read
@@ -646,15 +954,18 @@ napi_value pomelo_node_message_read_float64(
         env, info, NULL, NULL, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_message, (void **) &node_message
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
     ));
 
     pomelo_message_t * message = node_message->message;
     if (!message) {
-        napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
         return NULL;
     }
 
+    // Byte-aligned reads drop the unconsumed bits of the bit reader
+    pomelo_node_bits_drop(node_message);
+
     double value = 0;
     if (pomelo_message_read_float64(message, &value) < 0) {
         // Failed to read
@@ -680,7 +991,7 @@ napi_value pomelo_node_message_write(napi_env env, napi_callback_info info) {
         env, info, &argc, argv, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_message, (void **) &node_message
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
     ));
 
     if (argc < POMELO_NODE_MESSAGE_WRITE_ARGC) { 
@@ -690,7 +1001,13 @@ napi_value pomelo_node_message_write(napi_env env, napi_callback_info info) {
 
     pomelo_message_t * message = node_message->message;
     if (!message) {
-        napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
+        return NULL;
+    }
+
+    // The pending bits and writable view come before the new value
+    if (pomelo_node_message_commit_writable(node_message) < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_WRITE_MESSAGE);
         return NULL;
     }
 
@@ -738,7 +1055,7 @@ napi_value pomelo_node_message_write_uint8(
         env, info, &argc, argv, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_message, (void **) &node_message
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
     ));
 
 
@@ -749,7 +1066,13 @@ napi_value pomelo_node_message_write_uint8(
 
     pomelo_message_t * message = node_message->message;
     if (!message) {
-        napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
+        return NULL;
+    }
+
+    // The pending bits and writable view come before the new value
+    if (pomelo_node_message_commit_writable(node_message) < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_WRITE_MESSAGE);
         return NULL;
     }
 
@@ -784,7 +1107,7 @@ napi_value pomelo_node_message_write_uint16(
         env, info, &argc, argv, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_message, (void **) &node_message
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
     ));
 
 
@@ -795,7 +1118,13 @@ napi_value pomelo_node_message_write_uint16(
 
     pomelo_message_t * message = node_message->message;
     if (!message) {
-        napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
+        return NULL;
+    }
+
+    // The pending bits and writable view come before the new value
+    if (pomelo_node_message_commit_writable(node_message) < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_WRITE_MESSAGE);
         return NULL;
     }
 
@@ -830,7 +1159,7 @@ napi_value pomelo_node_message_write_uint32(
         env, info, &argc, argv, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_message, (void **) &node_message
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
     ));
 
 
@@ -841,7 +1170,13 @@ napi_value pomelo_node_message_write_uint32(
 
     pomelo_message_t * message = node_message->message;
     if (!message) {
-        napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
+        return NULL;
+    }
+
+    // The pending bits and writable view come before the new value
+    if (pomelo_node_message_commit_writable(node_message) < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_WRITE_MESSAGE);
         return NULL;
     }
 
@@ -876,7 +1211,7 @@ napi_value pomelo_node_message_write_uint64(
         env, info, &argc, argv, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_message, (void **) &node_message
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
     ));
 
 
@@ -887,7 +1222,13 @@ napi_value pomelo_node_message_write_uint64(
 
     pomelo_message_t * message = node_message->message;
     if (!message) {
-        napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
+        return NULL;
+    }
+
+    // The pending bits and writable view come before the new value
+    if (pomelo_node_message_commit_writable(node_message) < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_WRITE_MESSAGE);
         return NULL;
     }
 
@@ -922,7 +1263,7 @@ napi_value pomelo_node_message_write_int8(
         env, info, &argc, argv, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_message, (void **) &node_message
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
     ));
 
 
@@ -933,7 +1274,13 @@ napi_value pomelo_node_message_write_int8(
 
     pomelo_message_t * message = node_message->message;
     if (!message) {
-        napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
+        return NULL;
+    }
+
+    // The pending bits and writable view come before the new value
+    if (pomelo_node_message_commit_writable(node_message) < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_WRITE_MESSAGE);
         return NULL;
     }
 
@@ -968,7 +1315,7 @@ napi_value pomelo_node_message_write_int16(
         env, info, &argc, argv, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_message, (void **) &node_message
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
     ));
 
 
@@ -979,7 +1326,13 @@ napi_value pomelo_node_message_write_int16(
 
     pomelo_message_t * message = node_message->message;
     if (!message) {
-        napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
+        return NULL;
+    }
+
+    // The pending bits and writable view come before the new value
+    if (pomelo_node_message_commit_writable(node_message) < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_WRITE_MESSAGE);
         return NULL;
     }
 
@@ -1014,7 +1367,7 @@ napi_value pomelo_node_message_write_int32(
         env, info, &argc, argv, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_message, (void **) &node_message
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
     ));
 
 
@@ -1025,7 +1378,13 @@ napi_value pomelo_node_message_write_int32(
 
     pomelo_message_t * message = node_message->message;
     if (!message) {
-        napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
+        return NULL;
+    }
+
+    // The pending bits and writable view come before the new value
+    if (pomelo_node_message_commit_writable(node_message) < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_WRITE_MESSAGE);
         return NULL;
     }
 
@@ -1060,7 +1419,7 @@ napi_value pomelo_node_message_write_int64(
         env, info, &argc, argv, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_message, (void **) &node_message
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
     ));
 
 
@@ -1071,7 +1430,13 @@ napi_value pomelo_node_message_write_int64(
 
     pomelo_message_t * message = node_message->message;
     if (!message) {
-        napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
+        return NULL;
+    }
+
+    // The pending bits and writable view come before the new value
+    if (pomelo_node_message_commit_writable(node_message) < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_WRITE_MESSAGE);
         return NULL;
     }
 
@@ -1106,7 +1471,7 @@ napi_value pomelo_node_message_write_float32(
         env, info, &argc, argv, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_message, (void **) &node_message
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
     ));
 
 
@@ -1117,7 +1482,13 @@ napi_value pomelo_node_message_write_float32(
 
     pomelo_message_t * message = node_message->message;
     if (!message) {
-        napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
+        return NULL;
+    }
+
+    // The pending bits and writable view come before the new value
+    if (pomelo_node_message_commit_writable(node_message) < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_WRITE_MESSAGE);
         return NULL;
     }
 
@@ -1152,7 +1523,7 @@ napi_value pomelo_node_message_write_float64(
         env, info, &argc, argv, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_message, (void **) &node_message
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
     ));
 
 
@@ -1163,7 +1534,13 @@ napi_value pomelo_node_message_write_float64(
 
     pomelo_message_t * message = node_message->message;
     if (!message) {
-        napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
+        return NULL;
+    }
+
+    // The pending bits and writable view come before the new value
+    if (pomelo_node_message_commit_writable(node_message) < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_WRITE_MESSAGE);
         return NULL;
     }
 
@@ -1182,3 +1559,555 @@ napi_value pomelo_node_message_write_float64(
     napi_call(napi_get_undefined(env, &result));
     return result;
 }
+
+
+#define POMELO_NODE_MESSAGE_WRITE_STRUCT_ARGC 2
+napi_value pomelo_node_message_write_struct(
+    napi_env env,
+    napi_callback_info info
+) {
+    size_t argc = POMELO_NODE_MESSAGE_WRITE_STRUCT_ARGC;
+    napi_value argv[POMELO_NODE_MESSAGE_WRITE_STRUCT_ARGC] = { NULL };
+    napi_value thiz = NULL;
+    pomelo_node_context_t * context = NULL;
+    pomelo_node_message_t * node_message = NULL;
+
+    napi_call(napi_get_cb_info(
+        env, info, &argc, argv, &thiz, (void **) &context
+    ));
+    napi_call(pomelo_node_validate_native(
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
+    ));
+
+    if (argc < POMELO_NODE_MESSAGE_WRITE_STRUCT_ARGC) {
+        napi_throw_msg(POMELO_NODE_ERROR_NOT_ENOUGH_ARGS);
+        return NULL;
+    }
+
+    pomelo_message_t * message = node_message->message;
+    if (!message) {
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
+        return NULL;
+    }
+
+    // The pending bits and writable view come before the new value
+    if (pomelo_node_message_commit_writable(node_message) < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_WRITE_MESSAGE);
+        return NULL;
+    }
+
+    pomelo_node_schema_t * schema = pomelo_node_schema_of(env, argv[0]);
+    if (!schema) {
+        napi_throw_arg("schema");
+        return NULL;
+    }
+
+    int nrecords = pomelo_node_schema_pack(
+        env, context, schema, message, argv[1]
+    );
+    if (nrecords < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_WRITE_MESSAGE);
+        return NULL;
+    }
+
+    // return: number of written records
+    napi_value result = NULL;
+    napi_call(napi_create_uint32(env, (uint32_t) nrecords, &result));
+    return result;
+}
+
+
+#define POMELO_NODE_MESSAGE_READ_STRUCT_ARGC 3
+napi_value pomelo_node_message_read_struct(
+    napi_env env,
+    napi_callback_info info
+) {
+    size_t argc = POMELO_NODE_MESSAGE_READ_STRUCT_ARGC;
+    napi_value argv[POMELO_NODE_MESSAGE_READ_STRUCT_ARGC] = { NULL };
+    napi_value thiz = NULL;
+    pomelo_node_context_t * context = NULL;
+    pomelo_node_message_t * node_message = NULL;
+
+    napi_call(napi_get_cb_info(
+        env, info, &argc, argv, &thiz, (void **) &context
+    ));
+    napi_call(pomelo_node_validate_native(
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
+    ));
+
+    // readStruct(schema, out?, count?)
+    if (argc < 1) {
+        napi_throw_msg(POMELO_NODE_ERROR_NOT_ENOUGH_ARGS);
+        return NULL;
+    }
+
+    pomelo_message_t * message = node_message->message;
+    if (!message) {
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
+        return NULL;
+    }
+
+    // Byte-aligned reads drop the unconsumed bits of the bit reader
+    pomelo_node_bits_drop(node_message);
+
+    pomelo_node_schema_t * schema = pomelo_node_schema_of(env, argv[0]);
+    if (!schema) {
+        napi_throw_arg("schema");
+        return NULL;
+    }
+
+    uint32_t nrecords = 1;
+    if (argc > 2) {
+        if (pomelo_node_parse_uint32_value(env, argv[2], &nrecords) < 0) {
+            napi_throw_arg("count");
+            return NULL;
+        }
+    }
+
+    napi_value out = NULL;
+    napi_valuetype type = napi_undefined;
+    if (argc > 1) {
+        napi_call(napi_typeof(env, argv[1], &type));
+    }
+    if (type == napi_undefined || type == napi_null) {
+        napi_call(napi_create_array_with_length(
+            env, schema->nfields * nrecords, &out
+        ));
+    } else {
+        out = argv[1];
+    }
+
+    int ret = pomelo_node_schema_unpack(env, schema, message, out, nrecords);
+    if (ret < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_READ_MESSAGE);
+        return NULL;
+    }
+
+    return out; // Array | Float64Array
+}
+
+
+/// @brief Make sure the message scratch has enough capacity.
+/// Growing the scratch detaches the previous buffer, so the views which were
+/// created before become empty instead of pointing to the released memory.
+/// The buffer is also replaced whenever a view over it has been returned by
+/// readView() or writable(), so a stale view is never rewritten by the next
+/// user. A pending writable view of another message is written to that
+/// message first, so it does not lose its bytes.
+static napi_status message_scratch_reserve(
+    napi_env env,
+    pomelo_node_context_t * context,
+    size_t size,
+    napi_value * scratch
+) {
+    napi_status status;
+    size_t previous_capacity = context->message_scratch_capacity;
+    pomelo_node_message_t * owner = context->message_scratch_owner;
+    if (owner && pomelo_node_message_commit_view(owner) < 0) {
+        return napi_generic_failure;
+    }
+
+    if (
+        !context->message_scratch_lent &&
+        context->message_scratch &&
+        size <= context->message_scratch_capacity
+    ) {
+        return napi_get_reference_value(env, context->message_scratch, scratch);
+    }
+
+    if (context->message_scratch) {
+        napi_value previous = NULL;
+        status = napi_get_reference_value(
+            env, context->message_scratch, &previous
+        );
+        if (status != napi_ok) return status;
+
+        status = napi_detach_arraybuffer(env, previous);
+        if (status != napi_ok) return status;
+
+        status = napi_delete_reference(env, context->message_scratch);
+        if (status != napi_ok) return status;
+        context->message_scratch = NULL;
+        context->message_scratch_data = NULL;
+        context->message_scratch_capacity = 0;
+        context->message_scratch_lent = false;
+    }
+
+    // Grow by power of two to amortize the reallocation
+    size_t capacity = 256;
+    while (capacity < size || capacity < previous_capacity) capacity <<= 1;
+
+    void * data = NULL;
+    status = napi_create_arraybuffer(env, capacity, &data, scratch);
+    if (status != napi_ok) return status;
+
+    status = napi_create_reference(env, *scratch, 1, &context->message_scratch);
+    if (status != napi_ok) return status;
+
+    context->message_scratch_data = data;
+    context->message_scratch_capacity = capacity;
+    return napi_ok;
+}
+
+
+#define POMELO_NODE_MESSAGE_READ_VIEW_ARGC 1
+napi_value pomelo_node_message_read_view(
+    napi_env env,
+    napi_callback_info info
+) {
+    size_t argc = POMELO_NODE_MESSAGE_READ_VIEW_ARGC;
+    napi_value argv[POMELO_NODE_MESSAGE_READ_VIEW_ARGC] = { NULL };
+    napi_value thiz = NULL;
+    pomelo_node_context_t * context = NULL;
+    pomelo_node_message_t * node_message = NULL;
+
+    napi_call(napi_get_cb_info(
+        env, info, &argc, argv, &thiz, (void **) &context
+    ));
+    napi_call(pomelo_node_validate_native(
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
+    ));
+
+    pomelo_message_t * message = node_message->message;
+    if (!message) {
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
+        return NULL;
+    }
+
+    // Byte-aligned reads drop the unconsumed bits of the bit reader
+    pomelo_node_bits_drop(node_message);
+
+    if (argc < POMELO_NODE_MESSAGE_READ_VIEW_ARGC) {
+        napi_throw_msg(POMELO_NODE_ERROR_NOT_ENOUGH_ARGS);
+        return NULL;
+    }
+
+    size_t size = 0;
+    if (pomelo_node_parse_size_value(env, argv[0], &size) < 0) {
+        napi_throw_arg("length");
+        return NULL;
+    }
+
+    // Malformed lengths must not grow the scratch
+    if (size > pomelo_message_size(message)) {
+        napi_throw_msg(POMELO_NODE_ERROR_READ_MESSAGE);
+        return NULL;
+    }
+
+    napi_value scratch = NULL;
+    if (message_scratch_reserve(env, context, size, &scratch) != napi_ok) {
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_SCRATCH);
+        return NULL;
+    }
+
+    // Like read(), this consumes the bytes
+    if (size > 0) {
+        int ret = pomelo_message_read_buffer(
+            message, context->message_scratch_data, size
+        );
+        if (ret < 0) {
+            napi_throw_msg(POMELO_NODE_ERROR_READ_MESSAGE);
+            return NULL;
+        }
+    }
+
+    // return: Uint8Array over the shared scratch
+    napi_value result = NULL;
+    napi_call(napi_create_typedarray(
+        env, napi_uint8_array, size, scratch, /* offset = */ 0, &result
+    ));
+    context->message_scratch_lent = true;
+    return result;
+}
+
+
+#define POMELO_NODE_MESSAGE_WRITABLE_ARGC 1
+napi_value pomelo_node_message_writable(
+    napi_env env,
+    napi_callback_info info
+) {
+    size_t argc = POMELO_NODE_MESSAGE_WRITABLE_ARGC;
+    napi_value argv[POMELO_NODE_MESSAGE_WRITABLE_ARGC] = { NULL };
+    napi_value thiz = NULL;
+    pomelo_node_context_t * context = NULL;
+    pomelo_node_message_t * node_message = NULL;
+
+    napi_call(napi_get_cb_info(
+        env, info, &argc, argv, &thiz, (void **) &context
+    ));
+    napi_call(pomelo_node_validate_native(
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
+    ));
+
+    if (argc < POMELO_NODE_MESSAGE_WRITABLE_ARGC) {
+        napi_throw_msg(POMELO_NODE_ERROR_NOT_ENOUGH_ARGS);
+        return NULL;
+    }
+
+    if (!node_message->message) {
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
+        return NULL;
+    }
+
+    size_t length = 0;
+    if (pomelo_node_parse_size_value(env, argv[0], &length) < 0) {
+        napi_throw_arg("length");
+        return NULL;
+    }
+
+    // The previous writable view of this message is written first
+    if (pomelo_node_message_commit_writable(node_message) < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_WRITE_MESSAGE);
+        return NULL;
+    }
+
+    napi_value scratch = NULL;
+    if (message_scratch_reserve(env, context, length, &scratch) != napi_ok) {
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_SCRATCH);
+        return NULL;
+    }
+    node_message->writable_length = length;
+    context->message_scratch_owner = node_message;
+
+    // return: Uint8Array over the shared scratch
+    napi_value result = NULL;
+    napi_call(napi_create_typedarray(
+        env, napi_uint8_array, length, scratch, /* offset = */ 0, &result
+    ));
+    context->message_scratch_lent = true;
+    return result;
+}
+
+
+napi_value pomelo_node_message_commit(napi_env env, napi_callback_info info) {
+    napi_value thiz = NULL;
+    pomelo_node_context_t * context = NULL;
+    pomelo_node_message_t * node_message = NULL;
+
+    napi_call(napi_get_cb_info(
+        env, info, NULL, NULL, &thiz, (void **) &context
+    ));
+    napi_call(pomelo_node_validate_native(
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
+    ));
+
+    if (!node_message->message) {
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
+        return NULL;
+    }
+
+    if (pomelo_node_message_commit_writable(node_message) < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_WRITE_MESSAGE);
+        return NULL;
+    }
+
+    napi_value result = NULL;
+    napi_call(napi_get_undefined(env, &result));
+    return result; // undefined
+}
+
+
+/// @brief Write a length-prefixed string. The string is encoded straight into
+/// the message scratch behind its varint length, so that the prefix and the
+/// bytes take a single payload write.
+static napi_value message_write_string(
+    napi_env env,
+    napi_callback_info info,
+    bool latin1
+) {
+    size_t argc = 1;
+    napi_value argv[1] = { NULL };
+    napi_value thiz = NULL;
+    pomelo_node_context_t * context = NULL;
+    pomelo_node_message_t * node_message = NULL;
+
+    napi_call(napi_get_cb_info(
+        env, info, &argc, argv, &thiz, (void **) &context
+    ));
+    napi_call(pomelo_node_validate_native(
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
+    ));
+
+    if (argc < 1) {
+        napi_throw_msg(POMELO_NODE_ERROR_NOT_ENOUGH_ARGS);
+        return NULL;
+    }
+
+    if (!node_message->message) {
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
+        return NULL;
+    }
+
+    napi_valuetype type;
+    napi_call(napi_typeof(env, argv[0], &type));
+    if (type != napi_string) {
+        napi_throw_arg("value");
+        return NULL;
+    }
+
+    // The scratch is shared with the writable view, which is written first
+    if (pomelo_node_message_commit_writable(node_message) < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_WRITE_MESSAGE);
+        return NULL;
+    }
+
+    // Get the encoded length
+    size_t length = 0;
+    if (latin1) {
+        napi_call(napi_get_value_string_latin1(
+            env, argv[0], NULL, 0, &length
+        ));
+    } else {
+        napi_call(napi_get_value_string_utf8(env, argv[0], NULL, 0, &length));
+    }
+
+    if (length > UINT32_MAX) {
+        napi_throw_arg("value");
+        return NULL;
+    }
+
+    size_t prefix = 1;
+    for (size_t rest = length >> 7; rest; rest >>= 7) prefix++;
+
+    // One more byte for the null terminator
+    napi_value scratch = NULL;
+    size_t size = prefix + length + 1;
+    if (message_scratch_reserve(env, context, size, &scratch) != napi_ok) {
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_SCRATCH);
+        return NULL;
+    }
+
+    uint8_t * data = context->message_scratch_data;
+    size_t rest = length;
+    for (size_t i = 0; i < prefix; i++) {
+        data[i] = (uint8_t) ((rest & 0x7F) | ((i + 1 < prefix) ? 0x80 : 0));
+        rest >>= 7;
+    }
+
+    char * text = (char *) (data + prefix);
+    if (latin1) {
+        napi_call(napi_get_value_string_latin1(
+            env, argv[0], text, length + 1, NULL
+        ));
+    } else {
+        napi_call(napi_get_value_string_utf8(
+            env, argv[0], text, length + 1, NULL
+        ));
+    }
+
+    int ret = pomelo_message_write_buffer(
+        node_message->message, data, prefix + length
+    );
+    if (ret < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_WRITE_MESSAGE);
+        return NULL;
+    }
+
+    napi_value undefined = NULL;
+    napi_call(napi_get_undefined(env, &undefined));
+    return undefined;
+}
+
+
+/// @brief Read a length-prefixed string. The bytes are read to the message
+/// scratch and decoded from there.
+static napi_value message_read_string(
+    napi_env env,
+    napi_callback_info info,
+    bool latin1
+) {
+    napi_value thiz = NULL;
+    pomelo_node_context_t * context = NULL;
+    pomelo_node_message_t * node_message = NULL;
+
+    napi_call(napi_get_cb_info(
+        env, info, NULL, NULL, &thiz, (void **) &context
+    ));
+    napi_call(pomelo_node_validate_native(
+        env, thiz, &pomelo_node_type_tag_message, (void **) &node_message
+    ));
+
+    pomelo_message_t * message = node_message->message;
+    if (!message) {
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
+        return NULL;
+    }
+
+    // Byte-aligned reads drop the unconsumed bits of the bit reader
+    pomelo_node_bits_drop(node_message);
+
+    // Read the varint length
+    size_t length = 0;
+    uint8_t byte = 0x80;
+    for (size_t i = 0; (byte & 0x80); i++) {
+        if (i == POMELO_NODE_MESSAGE_STRING_PREFIX_MAX ||
+            pomelo_message_read_buffer(message, &byte, 1) < 0) {
+            napi_throw_msg(POMELO_NODE_ERROR_READ_MESSAGE);
+            return NULL;
+        }
+        length |= ((size_t) (byte & 0x7F)) << (7 * i);
+    }
+
+    // Malformed lengths must not grow the scratch
+    if (length > pomelo_message_size(message)) {
+        napi_throw_msg(POMELO_NODE_ERROR_READ_MESSAGE);
+        return NULL;
+    }
+
+    napi_value scratch = NULL;
+    if (message_scratch_reserve(env, context, length, &scratch) != napi_ok) {
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_SCRATCH);
+        return NULL;
+    }
+
+    char * text = (char *) context->message_scratch_data;
+    if (length > 0) {
+        int ret = pomelo_message_read_buffer(
+            message, (uint8_t *) text, length
+        );
+        if (ret < 0) {
+            napi_throw_msg(POMELO_NODE_ERROR_READ_MESSAGE);
+            return NULL;
+        }
+    }
+
+    napi_value result = NULL;
+    if (latin1) {
+        napi_call(napi_create_string_latin1(env, text, length, &result));
+    } else {
+        napi_call(napi_create_string_utf8(env, text, length, &result));
+    }
+    return result;
+}
+
+
+napi_value pomelo_node_message_write_string(
+    napi_env env,
+    napi_callback_info info
+) {
+    return message_write_string(env, info, /* latin1 = */ false);
+}
+
+
+napi_value pomelo_node_message_read_string(
+    napi_env env,
+    napi_callback_info info
+) {
+    return message_read_string(env, info, /* latin1 = */ false);
+}
+
+
+napi_value pomelo_node_message_write_string_latin1(
+    napi_env env,
+    napi_callback_info info
+) {
+    return message_write_string(env, info, /* latin1 = */ true);
+}
+
+
+napi_value pomelo_node_message_read_string_latin1(
+    napi_env env,
+    napi_callback_info info
+) {
+    return message_read_string(env, info, /* latin1 = */ true);
+}
@@ -9,6 +9,13 @@ extern "C" {
 #endif
 
 
+/// @brief Maximum number of recycled wrappers of received messages
+#define POMELO_NODE_MESSAGE_WRAPPERS_MAX 64
+
+/// @brief Maximum number of bytes of the varint length of a string
+#define POMELO_NODE_MESSAGE_STRING_PREFIX_MAX 5
+
+
 struct pomelo_node_message_s {
     /// @brief The context
     pomelo_node_context_t * context;
@@ -18,6 +25,27 @@ struct pomelo_node_message_s {
 
     /// @brief The reference of this object (message)
     napi_ref thiz;
+
+    /// @brief Length of pending writable view which has not been committed
+    size_t writable_length;
+
+    /// @brief Whether the message is lent to a receive callback
+    bool lent;
+
+    /// @brief Whether the message has been retained by message.retain()
+    bool retained;
+
+    /// @brief Pending bits of the bit writer which do not fill a byte yet
+    uint64_t bits_out;
+
+    /// @brief Number of pending bits of the bit writer
+    uint32_t bits_out_count;
+
+    /// @brief Unconsumed bits of the last byte read by the bit reader
+    uint64_t bits_in;
+
+    /// @brief Number of unconsumed bits of the bit reader
+    uint32_t bits_in_count;
 };
 
 
@@ -29,10 +57,33 @@ struct pomelo_node_message_s {
 napi_status pomelo_node_init_message_module(napi_env env, napi_value ns);
 
 
+/// @brief Create the recycled wrappers of received messages up to the message
+/// prewarm count, so that the first received messages do not construct them
+napi_status pomelo_node_message_prewarm_wrappers(
+    napi_env env,
+    pomelo_node_context_t * context
+);
+
+
 /// @brief Acquire new message from pool and attach the native message
 napi_value pomelo_node_message_new(napi_env env, pomelo_message_t * message);
 
 
+/// @brief Lend a JS message for a received native message. The JS message is
+/// recycled from the wrapper pool of context and must be given back by
+/// pomelo_node_message_reclaim() once the receive callback has returned.
+napi_value pomelo_node_message_lend(
+    napi_env env,
+    pomelo_message_t * message,
+    pomelo_node_message_t ** node_message
+);
+
+
+/// @brief Take back a lent message. The native message is released and the
+/// wrapper returns to the pool unless the message has been retained.
+void pomelo_node_message_reclaim(pomelo_node_message_t * node_message);
+
+
 /// @brief Initialize the message
 int pomelo_node_message_init(
     pomelo_node_message_t * node_message,
@@ -44,6 +95,26 @@ int pomelo_node_message_init(
 void pomelo_node_message_cleanup(pomelo_node_message_t * node_message);
 
 
+/// @brief Detach the native message and release it. Every access to the
+/// detached message throws.
+void pomelo_node_message_detach(pomelo_node_message_t * node_message);
+
+
+/// @brief Write everything which is pending to the native message, the
+/// pending bits are padded to a byte. This is called before byte-aligned
+/// writes and before the message is sent.
+int pomelo_node_message_commit_writable(pomelo_node_message_t * node_message);
+
+
+/// @brief Write the pending writable view to the native message. Pending bits
+/// of the bit writer are kept.
+int pomelo_node_message_commit_view(pomelo_node_message_t * node_message);
+
+
+/// @brief Drop the pending writable view without writing it
+void pomelo_node_message_discard_view(pomelo_node_message_t * node_message);
+
+
 /*----------------------------------------------------------------------------*/
 /*                               Private APIs                                 */
 /*----------------------------------------------------------------------------*/
@@ -67,6 +138,21 @@ void pomelo_node_message_finalizer(
 napi_value pomelo_node_message_reset(napi_env env, napi_callback_info info);
 
 
+/// @brief Message.acquire()
+napi_value pomelo_node_message_acquire(
+    napi_env env,
+    napi_callback_info info
+);
+
+
+/// @brief Message.release()
+napi_value pomelo_node_message_release(napi_env env, napi_callback_info info);
+
+
+/// @brief Message.retain()
+napi_value pomelo_node_message_retain(napi_env env, napi_callback_info info);
+
+
 /// @brief Message.size()
 napi_value pomelo_node_message_size(napi_env env, napi_callback_info info);
 
@@ -219,6 +305,66 @@ napi_value pomelo_node_message_write_float64(
 );
 
 
+/// @brief Message.readView()
+napi_value pomelo_node_message_read_view(
+    napi_env env,
+    napi_callback_info info
+);
+
+
+/// @brief Message.writable()
+napi_value pomelo_node_message_writable(
+    napi_env env,
+    napi_callback_info info
+);
+
+
+/// @brief Message.commit()
+napi_value pomelo_node_message_commit(napi_env env, napi_callback_info info);
+
+
+/// @brief Message.writeStruct()
+napi_value pomelo_node_message_write_struct(
+    napi_env env,
+    napi_callback_info info
+);
+
+
+/// @brief Message.readStruct()
+napi_value pomelo_node_message_read_struct(
+    napi_env env,
+    napi_callback_info info
+);
+
+
+/// @brief Message.writeString()
+napi_value pomelo_node_message_write_string(
+    napi_env env,
+    napi_callback_info info
+);
+
+
+/// @brief Message.readString()
+napi_value pomelo_node_message_read_string(
+    napi_env env,
+    napi_callback_info info
+);
+
+
+/// @brief Message.writeStringLatin1()
+napi_value pomelo_node_message_write_string_latin1(
+    napi_env env,
+    napi_callback_info info
+);
+
+
+/// @brief Message.readStringLatin1()
+napi_value pomelo_node_message_read_string_latin1(
+    napi_env env,
+    napi_callback_info info
+);
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -10,6 +10,7 @@
 #include "token.h"
 #include "channel.h"
 #include "plugin.h"
+#include "group.h"
 
 
 static void pomelo_node_parse_init_options(
@@ -127,6 +128,34 @@ static void pomelo_node_parse_init_options(
         options->pool_channel_max = (size_t) value;
     }
 
+    ret = pomelo_node_get_uint64_property(
+        env, js_options, "poolMessagePrewarm", &value
+    );
+    if (ret == 0) {
+        options->pool_message_prewarm = (size_t) value;
+    }
+
+    ret = pomelo_node_get_uint64_property(
+        env, js_options, "poolSessionPrewarm", &value
+    );
+    if (ret == 0) {
+        options->pool_session_prewarm = (size_t) value;
+    }
+
+    ret = pomelo_node_get_uint64_property(
+        env, js_options, "poolChannelPrewarm", &value
+    );
+    if (ret == 0) {
+        options->pool_channel_prewarm = (size_t) value;
+    }
+
+    ret = pomelo_node_get_uint64_property(
+        env, js_options, "messageAutoRelease", &value
+    );
+    if (ret == 0) {
+        options->message_auto_release = (value != 0);
+    }
+
     bool has_error_handler = false;
     napi_callv(napi_has_named_property(
         env, js_options, "errorHandler", &has_error_handler
@@ -179,6 +208,7 @@ napi_status pomelo_node_init_modules(napi_env env, napi_value ns) {
     // Initialize socket modules
     napi_calls(pomelo_node_init_socket_module(env, ns));
     napi_calls(pomelo_node_init_session_module(env, ns));
+    napi_calls(pomelo_node_init_group_module(env, ns));
     napi_calls(pomelo_node_init_message_module(env, ns));
     napi_calls(pomelo_node_init_token_module(env, ns));
     napi_calls(pomelo_node_init_channel_module(env, ns));
@@ -20,6 +20,12 @@ typedef struct pomelo_node_socket_s pomelo_node_socket_t;
 /// @brief The binding node channel
 typedef struct pomelo_node_channel_s pomelo_node_channel_t;
 
+/// @brief The compiled schema of message records
+typedef struct pomelo_node_schema_s pomelo_node_schema_t;
+
+/// @brief The binding node session group
+typedef struct pomelo_node_group_s pomelo_node_group_t;
+
 /// @brief The context of addon
 typedef struct pomelo_node_context_s pomelo_node_context_t;
 
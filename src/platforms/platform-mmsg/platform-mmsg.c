@@ -0,0 +1,506 @@
+#include <assert.h>
+#include <string.h>
+#include "platform-mmsg.h"
+#include "udp.h"
+#include "error.h"
+#include "utils.h"
+
+
+/**
+ * Linux platform with batched UDP syscalls. Everything but UDP is delegated
+ * to pomelo-platform-uv, running on the same loop.
+ */
+
+/// @brief Set the extra data
+static void platform_mmsg_set_extra(
+    pomelo_platform_t * platform,
+    void * extra
+) {
+    assert(platform != NULL);
+    pomelo_platform_mmsg_t * impl = (pomelo_platform_mmsg_t *) platform;
+    impl->extra = extra;
+}
+
+
+/// @brief Get the extra data
+static void * platform_mmsg_get_extra(pomelo_platform_t * platform) {
+    assert(platform != NULL);
+    pomelo_platform_mmsg_t * impl = (pomelo_platform_mmsg_t *) platform;
+    return impl->extra;
+}
+
+
+/// @brief Destroy the platform
+static void platform_mmsg_destroy(pomelo_platform_t * platform) {
+    assert(platform != NULL);
+    pomelo_platform_mmsg_t * impl = (pomelo_platform_mmsg_t *) platform;
+    
+    if (impl->platform_uv) {
+        pomelo_platform_uv_destroy((pomelo_platform_t *) impl->platform_uv);
+        impl->platform_uv = NULL;
+    }
+
+    // Free itself
+    pomelo_allocator_free(impl->allocator, impl);
+}
+
+
+/// @brief Startup the platform
+static void platform_mmsg_startup(pomelo_platform_t * platform) {
+    assert(platform != NULL);
+    pomelo_platform_mmsg_t * impl = (pomelo_platform_mmsg_t *) platform;
+    pomelo_platform_uv_startup(impl->platform_uv);
+}
+
+
+/// @brief Shutdown callback for the platform
+static void platform_mmsg_on_shutdown(pomelo_platform_uv_t * internal) {
+    // The argument here is the pointer to the UV platform
+    assert(internal != NULL);
+    pomelo_platform_mmsg_t * impl = pomelo_platform_uv_get_extra(internal);
+    assert(impl != NULL);
+
+    if (impl->shutdown_callback) {
+        impl->shutdown_callback((pomelo_platform_t *) impl);
+    }
+}
+
+
+/// @brief Shutdown the platform
+static void platform_mmsg_shutdown(
+    pomelo_platform_t * platform,
+    pomelo_platform_shutdown_callback callback
+) {
+    assert(platform != NULL);
+    pomelo_platform_mmsg_t * impl = (pomelo_platform_mmsg_t *) platform;
+
+    impl->shutdown_callback = callback;
+    pomelo_platform_uv_shutdown(
+        impl->platform_uv,
+        (pomelo_platform_shutdown_callback) platform_mmsg_on_shutdown
+    );
+}
+
+
+/// @brief Get the hrtime
+static uint64_t platform_mmsg_hrtime(pomelo_platform_t * platform) {
+    assert(platform != NULL);
+    pomelo_platform_mmsg_t * impl = (pomelo_platform_mmsg_t *) platform;
+    return pomelo_platform_uv_hrtime(impl->platform_uv);
+}
+
+
+/// @brief Get current time
+static uint64_t platform_mmsg_now(pomelo_platform_t * platform) {
+    assert(platform != NULL);
+    pomelo_platform_mmsg_t * impl = (pomelo_platform_mmsg_t *) platform;
+    return pomelo_platform_uv_now(impl->platform_uv);
+}
+
+
+/// @brief Acquire the threadsafe executor
+static pomelo_threadsafe_executor_t * platform_mmsg_acquire_threadsafe_executor(
+    pomelo_platform_t * platform
+) {
+    assert(platform != NULL);
+    pomelo_platform_mmsg_t * impl = (pomelo_platform_mmsg_t *) platform;
+    return pomelo_platform_uv_acquire_threadsafe_executor(impl->platform_uv);
+}
+
+
+/// @brief Release the threadsafe executor
+static void platform_mmsg_release_threadsafe_executor(
+    pomelo_platform_t * platform,
+    pomelo_threadsafe_executor_t * executor
+) {
+    assert(platform != NULL);
+    pomelo_platform_mmsg_t * impl = (pomelo_platform_mmsg_t *) platform;
+    pomelo_platform_uv_release_threadsafe_executor(impl->platform_uv, executor);
+}
+
+
+/// @brief Submit a task to the threadsafe executor
+static pomelo_platform_task_t * platform_mmsg_threadsafe_executor_submit(
+    pomelo_platform_t * platform,
+    pomelo_threadsafe_executor_t * executor,
+    pomelo_platform_task_entry entry,
+    void * data
+) {
+    assert(platform != NULL);
+    pomelo_platform_mmsg_t * impl = (pomelo_platform_mmsg_t *) platform;
+    return pomelo_threadsafe_executor_uv_submit(
+        impl->platform_uv, executor, entry, data
+    );
+}
+
+
+/// @brief Submit a task to the worker thread
+static pomelo_platform_task_t * platform_mmsg_submit_worker_task(
+    pomelo_platform_t * platform,
+    pomelo_platform_task_entry entry,
+    pomelo_platform_task_complete complete,
+    void * data
+) {
+    assert(platform != NULL);
+    pomelo_platform_mmsg_t * impl = (pomelo_platform_mmsg_t *) platform;
+    return pomelo_platform_uv_submit_worker_task(
+        impl->platform_uv, entry, complete, data
+    );
+}
+
+
+/// @brief Cancel a worker task
+static void platform_mmsg_cancel_worker_task(
+    pomelo_platform_t * platform,
+    pomelo_platform_task_t * task
+) {
+    assert(platform != NULL);
+    pomelo_platform_mmsg_t * impl = (pomelo_platform_mmsg_t *) platform;
+    pomelo_platform_uv_cancel_worker_task(impl->platform_uv, task);
+}
+
+
+/// @brief Bind the UDP socket
+static pomelo_platform_udp_t * platform_mmsg_udp_bind(
+    pomelo_platform_t * platform,
+    pomelo_address_t * address
+) {
+    assert(platform != NULL);
+    pomelo_platform_mmsg_t * impl = (pomelo_platform_mmsg_t *) platform;
+    return pomelo_platform_mmsg_udp_bind(impl, address);
+}
+
+
+/// @brief Connect the UDP socket
+static pomelo_platform_udp_t * platform_mmsg_udp_connect(
+    pomelo_platform_t * platform,
+    pomelo_address_t * address
+) {
+    assert(platform != NULL);
+    pomelo_platform_mmsg_t * impl = (pomelo_platform_mmsg_t *) platform;
+    return pomelo_platform_mmsg_udp_connect(impl, address);
+}
+
+
+/// @brief Stop the UDP socket
+static int platform_mmsg_udp_stop(
+    pomelo_platform_t * platform,
+    pomelo_platform_udp_t * socket
+) {
+    assert(platform != NULL);
+    pomelo_platform_mmsg_t * impl = (pomelo_platform_mmsg_t *) platform;
+    return pomelo_platform_mmsg_udp_stop(impl, socket);
+}
+
+
+/// @brief Send a packet to the UDP socket
+static int platform_mmsg_udp_send(
+    pomelo_platform_t * platform,
+    pomelo_platform_udp_t * socket,
+    pomelo_address_t * address,
+    int niovec,
+    pomelo_platform_iovec_t * iovec,
+    void * callback_data,
+    pomelo_platform_send_cb send_callback
+) {
+    assert(platform != NULL);
+    pomelo_platform_mmsg_t * impl = (pomelo_platform_mmsg_t *) platform;
+    return pomelo_platform_mmsg_udp_send(
+        impl,
+        socket,
+        address,
+        niovec,
+        iovec,
+        callback_data,
+        send_callback
+    );
+}
+
+
+/// @brief Start receiving packets from the UDP socket
+static void platform_mmsg_udp_recv_start(
+    pomelo_platform_t * platform,
+    pomelo_platform_udp_t * socket,
+    void * context,
+    pomelo_platform_alloc_cb alloc_callback,
+    pomelo_platform_recv_cb recv_callback
+) {
+    assert(platform != NULL);
+    pomelo_platform_mmsg_t * impl = (pomelo_platform_mmsg_t *) platform;
+    pomelo_platform_mmsg_udp_recv_start(
+        impl, socket, context, alloc_callback, recv_callback
+    );
+}
+
+
+/// @brief Start the timer
+static int platform_mmsg_timer_start(
+    pomelo_platform_t * platform,
+    pomelo_platform_timer_entry entry,
+    uint64_t timeout_ms,
+    uint64_t repeat_ms,
+    void * data,
+    pomelo_platform_timer_handle_t * handle
+) {
+    assert(platform != NULL);
+    pomelo_platform_mmsg_t * impl = (pomelo_platform_mmsg_t *) platform;
+    return pomelo_platform_uv_timer_start(
+        impl->platform_uv,
+        entry,
+        timeout_ms,
+        repeat_ms,
+        data,
+        handle
+    );
+}
+
+
+/// @brief Stop the timer
+static void platform_mmsg_timer_stop(
+    pomelo_platform_t * platform,
+    pomelo_platform_timer_handle_t * handle
+) {
+    assert(platform != NULL);
+    pomelo_platform_mmsg_t * impl = (pomelo_platform_mmsg_t *) platform;
+    pomelo_platform_uv_timer_stop(impl->platform_uv, handle);
+}
+
+
+/// @brief Get the platform statistic
+static napi_value platform_mmsg_statistic(
+    pomelo_platform_t * platform,
+    napi_env env
+) {
+    pomelo_platform_mmsg_t * impl = (pomelo_platform_mmsg_t *) platform;
+    pomelo_statistic_platform_uv_t statistic = { 0 };
+    pomelo_platform_uv_statistic(
+        (pomelo_platform_t *) impl->platform_uv,
+        &statistic
+    );
+
+    napi_value result = NULL;
+    napi_status status = napi_create_object(env, &result);
+    if (status != napi_ok) {
+        return NULL;
+    }
+
+    napi_value timers;
+    napi_call(napi_create_bigint_uint64(env, statistic.timers, &timers));
+    napi_call(napi_set_named_property(env, result, "timers", timers));
+
+    napi_value worker_tasks;
+    napi_call(napi_create_bigint_uint64(
+        env, statistic.worker_tasks, &worker_tasks
+    ));
+    napi_call(napi_set_named_property(
+        env, result, "worker_tasks", worker_tasks
+    ));
+
+    napi_value threadsafe_tasks;
+    napi_call(napi_create_bigint_uint64(
+        env, statistic.threadsafe_tasks, &threadsafe_tasks
+    ));
+    napi_call(napi_set_named_property(
+        env, result, "threadsafe_tasks", threadsafe_tasks
+    ));
+
+    // The UDP counters are kept by this platform
+    uint64_t counters[] = {
+        impl->send_commands,
+        impl->sent_bytes,
+        impl->recv_bytes,
+        impl->send_syscalls,
+        impl->send_datagrams,
+        impl->recv_syscalls,
+        impl->recv_datagrams,
+        impl->gso_messages,
+        impl->gso_segments,
+        impl->gro_messages,
+        impl->gro_segments
+    };
+    const char * names[] = {
+        "send_commands",
+        "sent_bytes",
+        "recv_bytes",
+        "send_syscalls",
+        "send_datagrams",
+        "recv_syscalls",
+        "recv_datagrams",
+        "gso_messages",
+        "gso_segments",
+        "gro_messages",
+        "gro_segments"
+    };
+    for (size_t i = 0; i < sizeof(counters) / sizeof(counters[0]); i++) {
+        napi_value value;
+        napi_call(napi_create_bigint_uint64(env, counters[i], &value));
+        napi_call(napi_set_named_property(env, result, names[i], value));
+    }
+
+    return result;
+}
+
+
+/// @brief Create the platform MMSG interface
+static pomelo_platform_t * platform_mmsg_create(
+    pomelo_allocator_t * allocator,
+    napi_env env
+) {
+    assert(allocator != NULL);
+    assert(env != NULL);
+
+    pomelo_platform_mmsg_t * platform = pomelo_allocator_malloc_t(
+        allocator,
+        pomelo_platform_mmsg_t
+    );
+    if (!platform) return NULL;
+    memset(platform, 0, sizeof(pomelo_platform_mmsg_t));
+    platform->allocator = allocator;
+
+    // Get UV loop, the sockets are polled by this loop
+    uv_loop_t * uv_loop = NULL;
+    napi_status status = napi_get_uv_event_loop(env, &uv_loop);
+    if (status != napi_ok || !uv_loop) {
+        platform_mmsg_destroy((pomelo_platform_t *) platform);
+        return NULL;
+    }
+    platform->uv_loop = uv_loop;
+
+    // Create platform UV
+    pomelo_platform_uv_options_t options = {
+        .allocator = allocator,
+        .uv_loop = uv_loop
+    };
+    pomelo_platform_uv_t * platform_uv =
+        (pomelo_platform_uv_t *) pomelo_platform_uv_create(&options);
+    if (!platform_uv) {
+        platform_mmsg_destroy((pomelo_platform_t *) platform);
+        return NULL;
+    }
+
+    // Set the extra data for platform
+    pomelo_platform_uv_set_extra(platform_uv, platform);
+
+    // Setup the interface
+    platform->platform_uv = platform_uv;
+
+    pomelo_platform_t * base = &platform->base;
+    base->set_extra = platform_mmsg_set_extra;
+    base->get_extra = platform_mmsg_get_extra;
+    base->destroy = platform_mmsg_destroy;
+    base->startup = platform_mmsg_startup;
+    base->shutdown = platform_mmsg_shutdown;
+    base->hrtime = platform_mmsg_hrtime;
+    base->now = platform_mmsg_now;
+    base->acquire_threadsafe_executor =
+        platform_mmsg_acquire_threadsafe_executor;
+    base->release_threadsafe_executor =
+        platform_mmsg_release_threadsafe_executor;
+    base->threadsafe_executor_submit = platform_mmsg_threadsafe_executor_submit;
+    base->submit_worker_task = platform_mmsg_submit_worker_task;
+    base->cancel_worker_task = platform_mmsg_cancel_worker_task;
+    base->udp_bind = platform_mmsg_udp_bind;
+    base->udp_connect = platform_mmsg_udp_connect;
+    base->udp_stop = platform_mmsg_udp_stop;
+    base->udp_send = platform_mmsg_udp_send;
+    base->udp_recv_start = platform_mmsg_udp_recv_start;
+    base->timer_start = platform_mmsg_timer_start;
+    base->timer_stop = platform_mmsg_timer_stop;
+    base->statistic = platform_mmsg_statistic;
+
+    return base;
+}
+
+
+/// @brief Get an optional boolean option
+static napi_status parse_bool_option(
+    napi_env env,
+    napi_value options,
+    const char * name,
+    bool * result
+) {
+    napi_value value = NULL;
+    napi_status status = napi_get_named_property(env, options, name, &value);
+    if (status != napi_ok) return status;
+
+    napi_valuetype type = napi_undefined;
+    status = napi_typeof(env, value, &type);
+    if (status != napi_ok) return status;
+    if (type != napi_boolean) return napi_ok; // Keep default value
+
+    return napi_get_value_bool(env, value, result);
+}
+
+
+#define PLATFORM_MMSG_INIT_ARGC 1
+/// @brief Platform-mmsg init function.
+/// Arguments: (options?: { gso?, gro?, reusePort?: boolean })
+static napi_value platform_mmsg_init(napi_env env, napi_callback_info info) {
+    size_t argc = PLATFORM_MMSG_INIT_ARGC;
+    napi_value argv[PLATFORM_MMSG_INIT_ARGC] = { NULL };
+    napi_call(napi_get_cb_info(env, info, &argc, argv, NULL, NULL));
+
+    bool gso = false;
+    bool gro = false;
+    bool reuse_port = false;
+    if (argc > 0) {
+        napi_valuetype type = napi_undefined;
+        napi_call(napi_typeof(env, argv[0], &type));
+        if (type == napi_object) {
+            napi_call(parse_bool_option(env, argv[0], "gso", &gso));
+            napi_call(parse_bool_option(env, argv[0], "gro", &gro));
+            napi_call(parse_bool_option(
+                env, argv[0], "reusePort", &reuse_port
+            ));
+        }
+    }
+
+    pomelo_allocator_t * allocator = pomelo_allocator_default();
+    pomelo_platform_t * platform = platform_mmsg_create(allocator, env);
+    if (!platform) {
+        napi_throw_msg(POMELO_NODE_ERROR_CREATE_PLATFORM);
+        return NULL;
+    }
+
+    pomelo_platform_mmsg_t * impl = (pomelo_platform_mmsg_t *) platform;
+    impl->gso = gso;
+    impl->gro = gro;
+    impl->reuse_port = reuse_port;
+
+    napi_value result = NULL;
+    napi_status status =
+        napi_create_external(env, platform, NULL, NULL, &result);
+    if (status != napi_ok) {
+        napi_throw_msg(POMELO_NODE_ERROR_CREATE_PLATFORM);
+        platform_mmsg_destroy((pomelo_platform_t *) platform);
+        return NULL;
+    }
+
+    return result;
+}
+
+
+/// @brief Entry function for platform-mmsg module
+static napi_value platform_mmsg_entry(napi_env env, napi_value exports) {
+    (void) exports;
+    // Create the init function
+    napi_value fn_init = NULL;
+    napi_status status = napi_create_function(
+        env,
+        "initPlatformMMSG",
+        NAPI_AUTO_LENGTH,
+        platform_mmsg_init,
+        NULL,
+        &fn_init
+    );
+
+    if (status != napi_ok) {
+        napi_throw_msg(POMELO_NODE_ERROR_INIT_PLATFORM_MMSG);
+        return NULL;
+    }
+
+    return fn_init;
+}
+
+/// @brief Platform-mmsg module
+NAPI_MODULE(pomelo_node_platform_mmsg, platform_mmsg_entry);
@@ -0,0 +1,83 @@
+#ifndef POMELO_NODE_PLATFORM_MMSG_H
+#define POMELO_NODE_PLATFORM_MMSG_H
+#include "platform.h"
+#include "platform/uv/platform-uv.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/// @brief Platform MMSG for node-api. Timers, workers and threadsafe
+/// executors are provided by pomelo-platform-uv, UDP sockets are
+/// nonblocking sockets driven by recvmmsg/sendmmsg (Linux only).
+typedef struct pomelo_platform_mmsg_s pomelo_platform_mmsg_t;
+
+
+struct pomelo_platform_mmsg_s {
+    /// @brief The base platform (interface)
+    pomelo_platform_t base;
+
+    /// @brief The allocator
+    pomelo_allocator_t * allocator;
+
+    /// @brief The UV loop which polls the sockets
+    uv_loop_t * uv_loop;
+
+    /// @brief The UV platform
+    pomelo_platform_uv_t * platform_uv;
+
+    /// @brief The shutdown callback
+    pomelo_platform_shutdown_callback shutdown_callback;
+
+    /// @brief Extra data
+    void * extra;
+
+    /// @brief Whether new sockets coalesce sends with UDP_SEGMENT
+    bool gso;
+
+    /// @brief Whether new sockets enable UDP_GRO
+    bool gro;
+
+    /// @brief Whether bound sockets set SO_REUSEPORT, so that multiple
+    /// sockets (one per shard) can share the same address
+    bool reuse_port;
+
+    /// @brief Number of recvmmsg calls which returned datagrams
+    uint64_t recv_syscalls;
+
+    /// @brief Number of received datagrams
+    uint64_t recv_datagrams;
+
+    /// @brief Number of received bytes
+    uint64_t recv_bytes;
+
+    /// @brief Number of queued send commands
+    uint64_t send_commands;
+
+    /// @brief Number of sendmmsg calls
+    uint64_t send_syscalls;
+
+    /// @brief Number of sent datagrams
+    uint64_t send_datagrams;
+
+    /// @brief Number of sent bytes
+    uint64_t sent_bytes;
+
+    /// @brief Number of sent GSO messages
+    uint64_t gso_messages;
+
+    /// @brief Number of datagrams sent in GSO messages
+    uint64_t gso_segments;
+
+    /// @brief Number of received GRO messages
+    uint64_t gro_messages;
+
+    /// @brief Number of datagrams received in GRO messages
+    uint64_t gro_segments;
+};
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // POMELO_NODE_PLATFORM_MMSG_H
@@ -0,0 +1,698 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // recvmmsg & sendmmsg
+#endif
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include "base/address.h"
+#include "udp.h"
+
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+/// @brief Capacity of the control buffer of a message
+#define MMSG_CONTROL_CAPACITY CMSG_SPACE(sizeof(int))
+
+
+/// @brief Get the length of a socket address
+static socklen_t sockaddr_length(struct sockaddr_storage * address) {
+    return (address->ss_family == AF_INET6)
+        ? sizeof(struct sockaddr_in6)
+        : sizeof(struct sockaddr_in);
+}
+
+
+/// @brief Create a nonblocking socket for the address
+static int mmsg_udp_open(struct sockaddr_storage * address) {
+    int fd = socket(
+        address->ss_family,
+        SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+        IPPROTO_UDP
+    );
+    return fd;
+}
+
+
+/// @brief Update the polled events of socket
+static void mmsg_udp_update_poll(pomelo_platform_mmsg_udp_t * udp);
+
+
+/// @brief Complete the first sent datagrams and remove them from the queue
+static void mmsg_udp_drop_sends(
+    pomelo_platform_mmsg_udp_t * udp,
+    uint32_t count
+) {
+    if (count == 0) return;
+
+    uint32_t remaining = udp->send_count - count;
+    if (remaining == 0) {
+        udp->send_count = 0;
+        udp->send_iovec_count = 0;
+        return;
+    }
+
+    uint32_t iovec_base = udp->sends[count].iovec_start;
+    memmove(
+        udp->sends,
+        udp->sends + count,
+        sizeof(pomelo_platform_mmsg_send_t) * remaining
+    );
+    for (uint32_t i = 0; i < remaining; i++) {
+        udp->sends[i].iovec_start -= iovec_base;
+    }
+
+    memmove(
+        udp->send_iovecs,
+        udp->send_iovecs + iovec_base,
+        sizeof(struct iovec) * (udp->send_iovec_count - iovec_base)
+    );
+    udp->send_iovec_count -= iovec_base;
+    udp->send_count = remaining;
+}
+
+
+/// @brief Check if two queued datagrams have the same target
+static bool mmsg_send_same_target(
+    pomelo_platform_mmsg_send_t * a,
+    pomelo_platform_mmsg_send_t * b
+) {
+    return a->address_length == b->address_length &&
+        memcmp(&a->address, &b->address, a->address_length) == 0;
+}
+
+
+/// @brief Coalesce the queued datagrams from index into a GSO message. All
+/// segments but the last must have the same size.
+/// @returns Number of coalesced datagrams
+static uint32_t mmsg_udp_coalesce(
+    pomelo_platform_mmsg_udp_t * udp,
+    uint32_t index,
+    struct msghdr * header
+) {
+    pomelo_platform_mmsg_send_t * first = &udp->sends[index];
+    size_t segment_size = first->length;
+    size_t total = segment_size;
+    uint32_t segments = 1;
+
+    while (
+        index + segments < udp->send_count &&
+        segments < POMELO_PLATFORM_MMSG_GSO_MAX_SEGMENTS
+    ) {
+        pomelo_platform_mmsg_send_t * next = &udp->sends[index + segments];
+        if (next->length == 0 || next->length > segment_size) break;
+        if (total + next->length > POMELO_PLATFORM_MMSG_GSO_MAX_BYTES) break;
+        if (!mmsg_send_same_target(first, next)) break;
+
+        // The iovecs of queued datagrams are contiguous
+        header->msg_iovlen += next->iovec_count;
+        total += next->length;
+        segments++;
+
+        // A shorter segment ends the message
+        if (next->length < segment_size) break;
+    }
+
+    if (segments > 1) {
+        struct cmsghdr * cmsg = CMSG_FIRSTHDR(header);
+        cmsg->cmsg_level = SOL_UDP;
+        cmsg->cmsg_type = UDP_SEGMENT;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+        *((uint16_t *) CMSG_DATA(cmsg)) = (uint16_t) segment_size;
+        header->msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+    } else {
+        header->msg_control = NULL;
+        header->msg_controllen = 0;
+    }
+
+    return segments;
+}
+
+
+/// @brief Flush the send queue with sendmmsg
+static void mmsg_udp_flush(pomelo_platform_mmsg_udp_t * udp) {
+    pomelo_platform_mmsg_t * platform = udp->platform;
+    struct mmsghdr messages[POMELO_PLATFORM_MMSG_BATCH_SIZE];
+    uint32_t segments[POMELO_PLATFORM_MMSG_BATCH_SIZE];
+    uint8_t controls
+        [POMELO_PLATFORM_MMSG_BATCH_SIZE]
+        [MMSG_CONTROL_CAPACITY];
+
+    // The send callbacks may queue more datagrams, so that the queue is always
+    // accessed by index here.
+    uint32_t flushed = 0;
+    while (flushed < udp->send_count && !udp->closing) {
+        uint32_t count = 0;
+        uint32_t index = flushed;
+        memset(messages, 0, sizeof(messages));
+        while (
+            index < udp->send_count &&
+            count < POMELO_PLATFORM_MMSG_BATCH_SIZE
+        ) {
+            pomelo_platform_mmsg_send_t * send = &udp->sends[index];
+            struct msghdr * header = &messages[count].msg_hdr;
+            if (send->address_length > 0) {
+                header->msg_name = &send->address;
+                header->msg_namelen = send->address_length;
+            }
+            header->msg_iov = udp->send_iovecs + send->iovec_start;
+            header->msg_iovlen = send->iovec_count;
+
+            if (udp->gso) {
+                memset(controls[count], 0, MMSG_CONTROL_CAPACITY);
+                header->msg_control = controls[count];
+                header->msg_controllen = MMSG_CONTROL_CAPACITY;
+                segments[count] = mmsg_udp_coalesce(udp, index, header);
+            } else {
+                segments[count] = 1;
+            }
+
+            index += segments[count];
+            count++;
+        }
+
+        int ret = sendmmsg(udp->fd, messages, count, 0);
+        uint32_t failed = 0;
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+
+            if (segments[0] > 1 && (errno == EIO || errno == EINVAL)) {
+                // The device or the kernel cannot segment, send the
+                // datagrams one by one from now on
+                udp->gso = false;
+                continue;
+            }
+
+            // The first message is failed, skip it
+            ret = 0;
+            failed = segments[0];
+        }
+
+        uint32_t sent = 0;
+        for (int i = 0; i < ret; i++) {
+            sent += segments[i];
+            if (segments[i] > 1) {
+                platform->gso_messages++;
+                platform->gso_segments += segments[i];
+            }
+        }
+        platform->send_syscalls++;
+        platform->send_datagrams += sent;
+
+        uint32_t first = flushed;
+        flushed += sent + failed;
+        for (uint32_t i = first; i < flushed; i++) {
+            pomelo_platform_mmsg_send_t * send = &udp->sends[i];
+            int status = (i < first + sent) ? 0 : -1;
+            if (status == 0) {
+                platform->sent_bytes += send->length;
+            }
+            if (send->send_callback) {
+                send->send_callback(send->callback_data, status);
+            }
+        }
+    }
+
+    mmsg_udp_drop_sends(udp, flushed);
+}
+
+
+/// @brief Get the GRO segment size of a received message, 0 if the message
+/// is not coalesced
+static size_t mmsg_gro_segment_size(struct msghdr * header) {
+    struct cmsghdr * cmsg = CMSG_FIRSTHDR(header);
+    for (; cmsg; cmsg = CMSG_NXTHDR(header, cmsg)) {
+        if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+            int segment_size = 0;
+            memcpy(&segment_size, CMSG_DATA(cmsg), sizeof(int));
+            return segment_size > 0 ? (size_t) segment_size : 0;
+        }
+    }
+    return 0;
+}
+
+
+/// @brief Deliver a received datagram
+static void mmsg_udp_deliver(
+    pomelo_platform_mmsg_udp_t * udp,
+    pomelo_address_t * address,
+    uint8_t * data,
+    size_t length,
+    int status
+) {
+    pomelo_platform_iovec_t iovec = { 0 };
+    udp->alloc_callback(udp->context, &iovec);
+    if (!iovec.data || iovec.length == 0) return;
+
+    if (length > iovec.length) {
+        length = iovec.length;
+        status = UV_UDP_PARTIAL;
+    }
+    memcpy(iovec.data, data, length);
+    iovec.length = length;
+    udp->platform->recv_bytes += length;
+
+    udp->recv_callback(udp->context, address, &iovec, status);
+}
+
+
+/// @brief Receive datagrams with recvmmsg
+static void mmsg_udp_recv(pomelo_platform_mmsg_udp_t * udp) {
+    pomelo_platform_mmsg_t * platform = udp->platform;
+    struct mmsghdr messages[POMELO_PLATFORM_MMSG_BATCH_SIZE];
+    struct iovec iovecs[POMELO_PLATFORM_MMSG_BATCH_SIZE];
+    struct sockaddr_storage addresses[POMELO_PLATFORM_MMSG_BATCH_SIZE];
+    uint8_t controls
+        [POMELO_PLATFORM_MMSG_BATCH_SIZE]
+        [MMSG_CONTROL_CAPACITY];
+    int batch_size = udp->recv_batch_size;
+
+    for (int round = 0; round < POMELO_PLATFORM_MMSG_RECV_ROUNDS; round++) {
+        memset(messages, 0, sizeof(struct mmsghdr) * batch_size);
+        for (int i = 0; i < batch_size; i++) {
+            iovecs[i].iov_base = udp->recv_buffers + udp->recv_buffer_size * i;
+            iovecs[i].iov_len = udp->recv_buffer_size;
+
+            struct msghdr * header = &messages[i].msg_hdr;
+            header->msg_name = &addresses[i];
+            header->msg_namelen = sizeof(struct sockaddr_storage);
+            header->msg_iov = &iovecs[i];
+            header->msg_iovlen = 1;
+            if (udp->gro) {
+                header->msg_control = controls[i];
+                header->msg_controllen = MMSG_CONTROL_CAPACITY;
+            }
+        }
+
+        int count = recvmmsg(udp->fd, messages, batch_size, 0, NULL);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            return; // EAGAIN or error
+        }
+        platform->recv_syscalls++;
+
+        for (int i = 0; i < count; i++) {
+            // The socket may be stopped by the receive callback
+            if (udp->closing || !udp->recv_callback) return;
+
+            pomelo_address_t address;
+            if (pomelo_address_from_sockaddr(&address, &addresses[i]) < 0) {
+                continue;
+            }
+
+            struct msghdr * header = &messages[i].msg_hdr;
+            uint8_t * data = iovecs[i].iov_base;
+            size_t length = messages[i].msg_len;
+            int status = (header->msg_flags & MSG_TRUNC) ? UV_UDP_PARTIAL : 0;
+
+            size_t segment_size = udp->gro ? mmsg_gro_segment_size(header) : 0;
+            if (segment_size == 0 || segment_size >= length) {
+                platform->recv_datagrams++;
+                mmsg_udp_deliver(udp, &address, data, length, status);
+                continue;
+            }
+
+            // Split the coalesced message
+            uint64_t nsegments = 0;
+            for (size_t offset = 0; offset < length; offset += segment_size) {
+                if (udp->closing || !udp->recv_callback) break;
+
+                size_t remain = length - offset;
+                size_t size = remain < segment_size ? remain : segment_size;
+                mmsg_udp_deliver(udp, &address, data + offset, size, status);
+                nsegments++;
+            }
+            platform->recv_datagrams += nsegments;
+            platform->gro_messages++;
+            platform->gro_segments += nsegments;
+        }
+
+        if (count < batch_size) return;
+    }
+}
+
+
+/// @brief Poll callback of socket
+static void mmsg_udp_on_poll(uv_poll_t * poll, int status, int events) {
+    pomelo_platform_mmsg_udp_t * udp = poll->data;
+    if (status < 0) {
+        // Let the syscalls report the error
+        events = udp->events;
+    }
+
+    if (events & UV_READABLE) {
+        mmsg_udp_recv(udp);
+    }
+
+    if (!udp->closing && (events & UV_WRITABLE)) {
+        mmsg_udp_flush(udp);
+    }
+
+    if (!udp->closing) {
+        mmsg_udp_update_poll(udp);
+    }
+}
+
+
+static void mmsg_udp_update_poll(pomelo_platform_mmsg_udp_t * udp) {
+    int events = 0;
+    if (udp->recv_callback) {
+        events |= UV_READABLE;
+    }
+    if (udp->send_count > 0) {
+        events |= UV_WRITABLE;
+    }
+
+    if (events == udp->events) return;
+    udp->events = events;
+
+    if (events) {
+        uv_poll_start(&udp->poll, events, mmsg_udp_on_poll);
+    } else {
+        uv_poll_stop(&udp->poll);
+    }
+}
+
+
+/// @brief Close callback of socket
+static void mmsg_udp_on_close(uv_handle_t * handle) {
+    pomelo_platform_mmsg_udp_t * udp = handle->data;
+    pomelo_allocator_t * allocator = udp->platform->allocator;
+
+    close(udp->fd);
+    udp->fd = -1;
+
+    // Cancel the queued datagrams
+    for (uint32_t i = 0; i < udp->send_count; i++) {
+        pomelo_platform_mmsg_send_t * send = &udp->sends[i];
+        if (send->send_callback) {
+            send->send_callback(send->callback_data, -1);
+        }
+    }
+
+    if (udp->sends) {
+        pomelo_allocator_free(allocator, udp->sends);
+    }
+    if (udp->send_iovecs) {
+        pomelo_allocator_free(allocator, udp->send_iovecs);
+    }
+    if (udp->recv_buffers) {
+        pomelo_allocator_free(allocator, udp->recv_buffers);
+    }
+    pomelo_allocator_free(allocator, udp);
+}
+
+
+/// @brief Create the socket from a bound or connected descriptor
+static pomelo_platform_mmsg_udp_t * mmsg_udp_create(
+    pomelo_platform_mmsg_t * platform,
+    int fd,
+    bool connected
+) {
+    pomelo_allocator_t * allocator = platform->allocator;
+    pomelo_platform_mmsg_udp_t * udp = pomelo_allocator_malloc_t(
+        allocator, pomelo_platform_mmsg_udp_t
+    );
+    if (!udp) return NULL;
+    memset(udp, 0, sizeof(pomelo_platform_mmsg_udp_t));
+
+    // GRO is only used if the kernel accepts it
+    udp->gso = platform->gso;
+    if (platform->gro) {
+        int value = 1;
+        int ret = setsockopt(fd, SOL_UDP, UDP_GRO, &value, sizeof(value));
+        udp->gro = (ret == 0);
+    }
+
+    if (udp->gro) {
+        udp->recv_batch_size = POMELO_PLATFORM_MMSG_GRO_BATCH_SIZE;
+        udp->recv_buffer_size = POMELO_PLATFORM_MMSG_GRO_BUFFER_SIZE;
+    } else {
+        udp->recv_batch_size = POMELO_PLATFORM_MMSG_BATCH_SIZE;
+        udp->recv_buffer_size = POMELO_PLATFORM_MMSG_RECV_BUFFER_SIZE;
+    }
+
+    udp->recv_buffers = pomelo_allocator_malloc(
+        allocator, udp->recv_buffer_size * udp->recv_batch_size
+    );
+    if (!udp->recv_buffers) {
+        pomelo_allocator_free(allocator, udp);
+        return NULL;
+    }
+
+    if (uv_poll_init(platform->uv_loop, &udp->poll, fd) < 0) {
+        pomelo_allocator_free(allocator, udp->recv_buffers);
+        pomelo_allocator_free(allocator, udp);
+        return NULL;
+    }
+
+    udp->platform = platform;
+    udp->poll.data = udp;
+    udp->fd = fd;
+    udp->connected = connected;
+    return udp;
+}
+
+
+pomelo_platform_udp_t * pomelo_platform_mmsg_udp_bind(
+    pomelo_platform_mmsg_t * platform,
+    pomelo_address_t * address
+) {
+    assert(platform != NULL);
+    assert(address != NULL);
+
+    struct sockaddr_storage sockaddr;
+    if (pomelo_address_to_sockaddr(address, &sockaddr) < 0) return NULL;
+
+    int fd = mmsg_udp_open(&sockaddr);
+    if (fd < 0) return NULL;
+
+    // Best effort, the kernel may cap the sizes
+    int sndbuf = POMELO_PLATFORM_MMSG_SERVER_SNDBUF_SIZE;
+    int rcvbuf = POMELO_PLATFORM_MMSG_SERVER_RCVBUF_SIZE;
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    // The kernel spreads the peers over the sockets by their 4-tuple hash
+    if (platform->reuse_port) {
+        int value = 1;
+        int ret = setsockopt(
+            fd, SOL_SOCKET, SO_REUSEPORT, &value, sizeof(value)
+        );
+        if (ret < 0) {
+            close(fd);
+            return NULL;
+        }
+    }
+
+    int ret = bind(
+        fd, (struct sockaddr *) &sockaddr, sockaddr_length(&sockaddr)
+    );
+    if (ret < 0) {
+        close(fd);
+        return NULL;
+    }
+
+    pomelo_platform_mmsg_udp_t * udp = mmsg_udp_create(platform, fd, false);
+    if (!udp) {
+        close(fd);
+        return NULL;
+    }
+
+    return (pomelo_platform_udp_t *) udp;
+}
+
+
+pomelo_platform_udp_t * pomelo_platform_mmsg_udp_connect(
+    pomelo_platform_mmsg_t * platform,
+    pomelo_address_t * address
+) {
+    assert(platform != NULL);
+    assert(address != NULL);
+
+    struct sockaddr_storage sockaddr;
+    if (pomelo_address_to_sockaddr(address, &sockaddr) < 0) return NULL;
+
+    int fd = mmsg_udp_open(&sockaddr);
+    if (fd < 0) return NULL;
+
+    int ret = connect(
+        fd, (struct sockaddr *) &sockaddr, sockaddr_length(&sockaddr)
+    );
+    if (ret < 0) {
+        close(fd);
+        return NULL;
+    }
+
+    pomelo_platform_mmsg_udp_t * udp = mmsg_udp_create(platform, fd, true);
+    if (!udp) {
+        close(fd);
+        return NULL;
+    }
+
+    return (pomelo_platform_udp_t *) udp;
+}
+
+
+int pomelo_platform_mmsg_udp_stop(
+    pomelo_platform_mmsg_t * platform,
+    pomelo_platform_udp_t * socket
+) {
+    assert(platform != NULL);
+    assert(socket != NULL);
+    (void) platform;
+
+    pomelo_platform_mmsg_udp_t * udp = (pomelo_platform_mmsg_udp_t *) socket;
+    if (udp->closing) return 0;
+
+    udp->closing = true;
+    udp->alloc_callback = NULL;
+    udp->recv_callback = NULL;
+
+    // The socket is freed in the close callback, so that it is still valid
+    // if this is called from its own callbacks.
+    uv_poll_stop(&udp->poll);
+    uv_close((uv_handle_t *) &udp->poll, mmsg_udp_on_close);
+    return 0;
+}
+
+
+/// @brief Grow the send queue of socket
+static int mmsg_udp_reserve_sends(
+    pomelo_platform_mmsg_udp_t * udp,
+    uint32_t niovec
+) {
+    pomelo_allocator_t * allocator = udp->platform->allocator;
+
+    if (udp->send_count == udp->send_capacity) {
+        uint32_t capacity = udp->send_capacity
+            ? udp->send_capacity * 2
+            : POMELO_PLATFORM_MMSG_SEND_QUEUE_INITIAL;
+        pomelo_platform_mmsg_send_t * sends = pomelo_allocator_malloc(
+            allocator, sizeof(pomelo_platform_mmsg_send_t) * capacity
+        );
+        if (!sends) return -1;
+
+        if (udp->sends) {
+            memcpy(
+                sends,
+                udp->sends,
+                sizeof(pomelo_platform_mmsg_send_t) * udp->send_count
+            );
+            pomelo_allocator_free(allocator, udp->sends);
+        }
+        udp->sends = sends;
+        udp->send_capacity = capacity;
+    }
+
+    uint32_t required = udp->send_iovec_count + niovec;
+    if (required > udp->send_iovec_capacity) {
+        uint32_t capacity = udp->send_iovec_capacity
+            ? udp->send_iovec_capacity
+            : POMELO_PLATFORM_MMSG_SEND_QUEUE_INITIAL;
+        while (capacity < required) {
+            capacity *= 2;
+        }
+
+        struct iovec * iovecs = pomelo_allocator_malloc(
+            allocator, sizeof(struct iovec) * capacity
+        );
+        if (!iovecs) return -1;
+
+        if (udp->send_iovecs) {
+            memcpy(
+                iovecs,
+                udp->send_iovecs,
+                sizeof(struct iovec) * udp->send_iovec_count
+            );
+            pomelo_allocator_free(allocator, udp->send_iovecs);
+        }
+        udp->send_iovecs = iovecs;
+        udp->send_iovec_capacity = capacity;
+    }
+
+    return 0;
+}
+
+
+int pomelo_platform_mmsg_udp_send(
+    pomelo_platform_mmsg_t * platform,
+    pomelo_platform_udp_t * socket,
+    pomelo_address_t * address,
+    int niovec,
+    pomelo_platform_iovec_t * iovec,
+    void * callback_data,
+    pomelo_platform_send_cb send_callback
+) {
+    assert(platform != NULL);
+    assert(socket != NULL);
+    assert(iovec != NULL);
+
+    pomelo_platform_mmsg_udp_t * udp = (pomelo_platform_mmsg_udp_t *) socket;
+    if (udp->closing || niovec <= 0) return -1;
+
+    if (mmsg_udp_reserve_sends(udp, (uint32_t) niovec) < 0) return -1;
+
+    // The target addresses are compared byte-wise when coalescing
+    pomelo_platform_mmsg_send_t * send = &udp->sends[udp->send_count];
+    memset(&send->address, 0, sizeof(struct sockaddr_storage));
+    send->address_length = 0;
+    if (address && !udp->connected) {
+        if (pomelo_address_to_sockaddr(address, &send->address) < 0) {
+            return -1;
+        }
+        send->address_length = sockaddr_length(&send->address);
+    }
+
+    send->iovec_start = udp->send_iovec_count;
+    send->iovec_count = (uint32_t) niovec;
+    send->length = 0;
+    for (int i = 0; i < niovec; i++) {
+        struct iovec * entry = &udp->send_iovecs[udp->send_iovec_count++];
+        entry->iov_base = iovec[i].data;
+        entry->iov_len = iovec[i].length;
+        send->length += iovec[i].length;
+    }
+    send->callback_data = callback_data;
+    send->send_callback = send_callback;
+    udp->send_count++;
+    platform->send_commands++;
+
+    // The queue is flushed once the socket is writable, which is on the next
+    // poll phase of the loop
+    mmsg_udp_update_poll(udp);
+    return 0;
+}
+
+
+void pomelo_platform_mmsg_udp_recv_start(
+    pomelo_platform_mmsg_t * platform,
+    pomelo_platform_udp_t * socket,
+    void * context,
+    pomelo_platform_alloc_cb alloc_callback,
+    pomelo_platform_recv_cb recv_callback
+) {
+    assert(platform != NULL);
+    assert(socket != NULL);
+    (void) platform;
+
+    pomelo_platform_mmsg_udp_t * udp = (pomelo_platform_mmsg_udp_t *) socket;
+    if (udp->closing) return;
+
+    udp->context = context;
+    udp->alloc_callback = alloc_callback;
+    udp->recv_callback = recv_callback;
+    mmsg_udp_update_poll(udp);
+}
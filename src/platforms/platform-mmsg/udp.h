@@ -0,0 +1,185 @@
+#ifndef POMELO_NODE_PLATFORM_MMSG_UDP_H
+#define POMELO_NODE_PLATFORM_MMSG_UDP_H
+#include <sys/socket.h>
+#include "platform-mmsg.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// @brief Maximum number of datagrams per recvmmsg/sendmmsg call
+#define POMELO_PLATFORM_MMSG_BATCH_SIZE 64
+
+/// @brief Maximum number of recvmmsg calls per readable event, so that a
+/// busy socket cannot starve the loop
+#define POMELO_PLATFORM_MMSG_RECV_ROUNDS 4
+
+/// @brief Capacity of a receive buffer. Longer datagrams are truncated.
+#define POMELO_PLATFORM_MMSG_RECV_BUFFER_SIZE 2048
+
+/// @brief Receive batch of sockets with GRO. A coalesced message holds up to
+/// 64KB, so that fewer but larger buffers are used.
+#define POMELO_PLATFORM_MMSG_GRO_BATCH_SIZE 16
+
+/// @brief Capacity of a receive buffer of sockets with GRO
+#define POMELO_PLATFORM_MMSG_GRO_BUFFER_SIZE 65536
+
+/// @brief Maximum number of datagrams coalesced into a GSO message
+#define POMELO_PLATFORM_MMSG_GSO_MAX_SEGMENTS 64
+
+/// @brief Maximum payload of a GSO message
+#define POMELO_PLATFORM_MMSG_GSO_MAX_BYTES 65000
+
+/// @brief Initial capacity of the send queue, in datagrams
+#define POMELO_PLATFORM_MMSG_SEND_QUEUE_INITIAL 64
+
+/// @brief Kernel buffer sizes of server sockets
+#define POMELO_PLATFORM_MMSG_SERVER_SNDBUF_SIZE (4 * 1024 * 1024)
+#define POMELO_PLATFORM_MMSG_SERVER_RCVBUF_SIZE (4 * 1024 * 1024)
+
+
+/// @brief The UDP socket of platform MMSG
+typedef struct pomelo_platform_mmsg_udp_s pomelo_platform_mmsg_udp_t;
+
+/// @brief A queued datagram
+typedef struct pomelo_platform_mmsg_send_s pomelo_platform_mmsg_send_t;
+
+
+struct pomelo_platform_mmsg_send_s {
+    /// @brief Index of the first iovec in the iovec queue
+    uint32_t iovec_start;
+
+    /// @brief Number of iovecs
+    uint32_t iovec_count;
+
+    /// @brief Total length of the datagram
+    size_t length;
+
+    /// @brief The target address
+    struct sockaddr_storage address;
+
+    /// @brief Length of the target address, 0 for connected sockets
+    socklen_t address_length;
+
+    /// @brief The callback data
+    void * callback_data;
+
+    /// @brief The send callback
+    pomelo_platform_send_cb send_callback;
+};
+
+
+struct pomelo_platform_mmsg_udp_s {
+    /// @brief The platform
+    pomelo_platform_mmsg_t * platform;
+
+    /// @brief The poll handle of socket
+    uv_poll_t poll;
+
+    /// @brief The socket descriptor
+    int fd;
+
+    /// @brief The polled events
+    int events;
+
+    /// @brief Whether the socket is connected
+    bool connected;
+
+    /// @brief Whether the socket is closing
+    bool closing;
+
+    /// @brief Whether same-sized datagrams to the same target are coalesced
+    /// with UDP_SEGMENT. It is turned off if the kernel rejects it.
+    bool gso;
+
+    /// @brief Whether UDP_GRO is enabled on socket
+    bool gro;
+
+    /// @brief The receive context
+    void * context;
+
+    /// @brief The allocation callback
+    pomelo_platform_alloc_cb alloc_callback;
+
+    /// @brief The receive callback
+    pomelo_platform_recv_cb recv_callback;
+
+    /// @brief The queued datagrams. The payloads are owned by the callers
+    /// until their send callbacks are called.
+    pomelo_platform_mmsg_send_t * sends;
+
+    /// @brief Number of queued datagrams
+    uint32_t send_count;
+
+    /// @brief Capacity of the datagram queue
+    uint32_t send_capacity;
+
+    /// @brief The iovecs of queued datagrams
+    struct iovec * send_iovecs;
+
+    /// @brief Number of queued iovecs
+    uint32_t send_iovec_count;
+
+    /// @brief Capacity of the iovec queue
+    uint32_t send_iovec_capacity;
+
+    /// @brief The receive buffers, recv_batch_size buffers of
+    /// recv_buffer_size bytes
+    uint8_t * recv_buffers;
+
+    /// @brief Capacity of a receive buffer
+    size_t recv_buffer_size;
+
+    /// @brief Number of datagrams per recvmmsg call
+    int recv_batch_size;
+};
+
+
+/// @brief Bind the socket with specific address
+pomelo_platform_udp_t * pomelo_platform_mmsg_udp_bind(
+    pomelo_platform_mmsg_t * platform,
+    pomelo_address_t * address
+);
+
+
+/// @brief Connect the socket to specific address
+pomelo_platform_udp_t * pomelo_platform_mmsg_udp_connect(
+    pomelo_platform_mmsg_t * platform,
+    pomelo_address_t * address
+);
+
+
+/// @brief Stop the socket. Queued datagrams are completed with -1 when the
+/// socket is closed.
+int pomelo_platform_mmsg_udp_stop(
+    pomelo_platform_mmsg_t * platform,
+    pomelo_platform_udp_t * socket
+);
+
+
+/// @brief Queue a packet to target. The queue is flushed with sendmmsg when
+/// the socket becomes writable.
+int pomelo_platform_mmsg_udp_send(
+    pomelo_platform_mmsg_t * platform,
+    pomelo_platform_udp_t * socket,
+    pomelo_address_t * address,
+    int niovec,
+    pomelo_platform_iovec_t * iovec,
+    void * callback_data,
+    pomelo_platform_send_cb send_callback
+);
+
+
+/// @brief Start receiving packets from socket
+void pomelo_platform_mmsg_udp_recv_start(
+    pomelo_platform_mmsg_t * platform,
+    pomelo_platform_udp_t * socket,
+    void * context,
+    pomelo_platform_alloc_cb alloc_callback,
+    pomelo_platform_recv_cb recv_callback
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // POMELO_NODE_PLATFORM_MMSG_UDP_H
@@ -0,0 +1,180 @@
+#include <assert.h>
+#include <string.h>
+#include "platform-napi.h"
+#include "address.h"
+
+
+/// @brief Hash the address bytes (FNV-1a).
+/// Equal addresses with different padding bytes only produce duplicated
+/// handles, they still resolve to the same address.
+static uint32_t address_hash(pomelo_address_t * address) {
+    const uint8_t * bytes = (const uint8_t *) address;
+    uint32_t hash = 2166136261U;
+    for (size_t i = 0; i < sizeof(pomelo_address_t); i++) {
+        hash ^= bytes[i];
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+
+/// @brief Insert a handle to the index
+static void address_index_insert(
+    pomelo_platform_address_cache_t * cache,
+    uint32_t handle
+) {
+    uint32_t mask = cache->capacity * 2 - 1;
+    uint32_t slot = address_hash(&cache->entries[handle].address) & mask;
+    while (cache->index[slot]) {
+        slot = (slot + 1) & mask;
+    }
+    cache->index[slot] = handle + 1;
+}
+
+
+/// @brief Allocate the storage with specific capacity and rebuild the index
+static int address_cache_reserve(
+    pomelo_platform_napi_t * platform,
+    uint32_t capacity
+) {
+    pomelo_platform_address_cache_t * cache = platform->address_cache;
+    pomelo_allocator_t * allocator = platform->allocator;
+
+    pomelo_platform_address_entry_t * entries = pomelo_allocator_malloc(
+        allocator, sizeof(pomelo_platform_address_entry_t) * capacity
+    );
+    if (!entries) return -1;
+
+    size_t index_bytes = sizeof(uint32_t) * capacity * 2;
+    uint32_t * index = pomelo_allocator_malloc(allocator, index_bytes);
+    if (!index) {
+        pomelo_allocator_free(allocator, entries);
+        return -1;
+    }
+    memset(index, 0, index_bytes);
+
+    if (cache->entries) {
+        memcpy(
+            entries,
+            cache->entries,
+            sizeof(pomelo_platform_address_entry_t) * cache->size
+        );
+        pomelo_allocator_free(allocator, cache->entries);
+    }
+    if (cache->index) {
+        pomelo_allocator_free(allocator, cache->index);
+    }
+
+    cache->entries = entries;
+    cache->index = index;
+    cache->capacity = capacity;
+    for (uint32_t i = 0; i < cache->size; i++) {
+        address_index_insert(cache, i);
+    }
+    return 0;
+}
+
+
+/// @brief Clear the cache and the JS mirror of it
+static void address_cache_reset(pomelo_platform_napi_t * platform) {
+    pomelo_platform_address_cache_t * cache = platform->address_cache;
+    cache->size = 0;
+    cache->generation++;
+    memset(cache->index, 0, sizeof(uint32_t) * cache->capacity * 2);
+
+    napi_env env = platform->env;
+    napi_value reset = NULL;
+    napi_status status =
+        napi_get_reference_value(env, platform->udp_address_reset, &reset);
+    if (status != napi_ok) return;
+
+    napi_value null_value = NULL;
+    status = napi_get_null(env, &null_value);
+    if (status != napi_ok) return;
+
+    napi_value result = NULL;
+    napi_call_function(env, null_value, reset, 0, NULL, &result);
+}
+
+
+int pomelo_platform_napi_address_cache_init(pomelo_platform_napi_t * platform) {
+    assert(platform != NULL);
+    pomelo_platform_address_cache_t * cache = pomelo_allocator_malloc(
+        platform->allocator, sizeof(pomelo_platform_address_cache_t)
+    );
+    if (!cache) return -1;
+    memset(cache, 0, sizeof(pomelo_platform_address_cache_t));
+    platform->address_cache = cache;
+
+    return address_cache_reserve(
+        platform, POMELO_PLATFORM_NAPI_ADDRESS_CACHE_INITIAL_CAPACITY
+    );
+}
+
+
+void pomelo_platform_napi_address_cache_finalize(
+    pomelo_platform_napi_t * platform
+) {
+    assert(platform != NULL);
+    pomelo_platform_address_cache_t * cache = platform->address_cache;
+    if (!cache) return;
+
+    if (cache->entries) {
+        pomelo_allocator_free(platform->allocator, cache->entries);
+    }
+    if (cache->index) {
+        pomelo_allocator_free(platform->allocator, cache->index);
+    }
+    pomelo_allocator_free(platform->allocator, cache);
+    platform->address_cache = NULL;
+}
+
+
+int64_t pomelo_platform_napi_address_intern(
+    pomelo_platform_napi_t * platform,
+    pomelo_address_t * address
+) {
+    assert(platform != NULL);
+    assert(address != NULL);
+    pomelo_platform_address_cache_t * cache = platform->address_cache;
+    if (!cache || !cache->index) return -1;
+
+    // Lookup
+    uint32_t mask = cache->capacity * 2 - 1;
+    uint32_t slot = address_hash(address) & mask;
+    while (cache->index[slot]) {
+        uint32_t handle = cache->index[slot] - 1;
+        if (pomelo_address_compare(&cache->entries[handle].address, address)) {
+            return handle;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    // Make room for the new entry
+    if (cache->size == cache->capacity) {
+        if (cache->capacity < POMELO_PLATFORM_NAPI_ADDRESS_CACHE_MAX_CAPACITY) {
+            int ret = address_cache_reserve(platform, cache->capacity * 2);
+            if (ret < 0) return -1;
+        } else {
+            address_cache_reset(platform);
+        }
+    }
+
+    uint32_t handle = cache->size++;
+    pomelo_platform_address_entry_t * entry = &cache->entries[handle];
+    memcpy(&entry->address, address, sizeof(pomelo_address_t));
+    entry->exposed = false;
+    address_index_insert(cache, handle);
+    return handle;
+}
+
+
+pomelo_platform_address_entry_t * pomelo_platform_napi_address_of(
+    pomelo_platform_napi_t * platform,
+    int64_t handle
+) {
+    assert(platform != NULL);
+    pomelo_platform_address_cache_t * cache = platform->address_cache;
+    if (!cache || handle < 0 || handle >= cache->size) return NULL;
+    return &cache->entries[handle];
+}
@@ -0,0 +1,85 @@
+#ifndef POMELO_NODE_PLATFORM_NAPI_ADDRESS_H
+#define POMELO_NODE_PLATFORM_NAPI_ADDRESS_H
+#include "node_api.h"
+#include "platform-napi.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The address cache interns peer addresses, so that the UDP hot path passes
+ * small integer handles across the JS boundary instead of address strings.
+ * The JS side keeps a mirror of handle -> host/port. When the cache is full,
+ * it is reset and the JS mirror is cleared through `udpAddressReset`.
+ */
+
+/// @brief Initial capacity of the address cache
+#define POMELO_PLATFORM_NAPI_ADDRESS_CACHE_INITIAL_CAPACITY 256
+
+/// @brief Maximum capacity of the address cache
+#define POMELO_PLATFORM_NAPI_ADDRESS_CACHE_MAX_CAPACITY 65536
+
+
+/// @brief The address cache entry
+typedef struct pomelo_platform_address_entry_s
+    pomelo_platform_address_entry_t;
+
+
+struct pomelo_platform_address_entry_s {
+    /// @brief The address
+    pomelo_address_t address;
+
+    /// @brief Whether the JS side knows the host and port of this handle
+    bool exposed;
+};
+
+
+struct pomelo_platform_address_cache_s {
+    /// @brief The entries, indexed by handle
+    pomelo_platform_address_entry_t * entries;
+
+    /// @brief The number of entries
+    uint32_t size;
+
+    /// @brief The capacity of entries
+    uint32_t capacity;
+
+    /// @brief Open addressing index of (handle + 1), 0 for empty slots.
+    /// Its capacity is twice the capacity of entries.
+    uint32_t * index;
+
+    /// @brief Number of resets, handles of older generations are invalid
+    uint32_t generation;
+};
+
+
+/// @brief Initialize the address cache
+int pomelo_platform_napi_address_cache_init(pomelo_platform_napi_t * platform);
+
+
+/// @brief Finalize the address cache
+void pomelo_platform_napi_address_cache_finalize(
+    pomelo_platform_napi_t * platform
+);
+
+
+/// @brief Get the handle of an address, interning it if needed.
+/// @returns The handle or -1 on failure
+int64_t pomelo_platform_napi_address_intern(
+    pomelo_platform_napi_t * platform,
+    pomelo_address_t * address
+);
+
+
+/// @brief Get the address of a handle.
+/// Returns NULL if the handle is invalid.
+pomelo_platform_address_entry_t * pomelo_platform_napi_address_of(
+    pomelo_platform_napi_t * platform,
+    int64_t handle
+);
+
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+#endif // POMELO_NODE_PLATFORM_NAPI_ADDRESS_H
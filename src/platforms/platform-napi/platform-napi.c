@@ -3,8 +3,10 @@
 #include "platform-napi.h"
 #include "udp.h"
 #include "time.h"
+#include "address.h"
 #include "timer.h"
 #include "worker.h"
+#include "worker-pool.h"
 #include "threadsafe.h"
 #include "error.h"
 #include "utils.h"
@@ -29,6 +31,26 @@ static bool parse_platform_options(
 }
 
 
+/// @brief Parse an optional unsigned integer option, missing or invalid
+/// values leave the output untouched
+static void parse_platform_uint32_option(
+    napi_env env,
+    napi_value options,
+    const char * name,
+    uint32_t * value
+) {
+    napi_value property;
+    napi_status status = napi_get_named_property(env, options, name, &property);
+    if (status != napi_ok) return;
+
+    napi_valuetype type = napi_undefined;
+    status = napi_typeof(env, property, &type);
+    if (status != napi_ok || type != napi_number) return;
+
+    napi_get_value_uint32(env, property, value);
+}
+
+
 /// @brief Create the platform NAPI interface
 static pomelo_platform_napi_t * platform_create(
     pomelo_allocator_t * allocator,
@@ -47,6 +69,9 @@ static pomelo_platform_napi_t * platform_create(
     platform->env = env;
     platform->allocator = allocator;
 
+    // The JS clock functions are kept as the fallback of the native clock
+    pomelo_platform_napi_clock_init(platform);
+
     if (!parse_platform_options(env, options, "hrtime", &platform->hrtime)) {
         pomelo_platform_napi_destroy(&platform->base);
         return NULL;
@@ -84,36 +109,35 @@ static pomelo_platform_napi_t * platform_create(
     }
 
     if (!parse_platform_options(
-        env, options, "udpSend", &platform->udp_send
+        env, options, "udpSendBatch", &platform->udp_send_batch
     )) {
         pomelo_platform_napi_destroy(&platform->base);
         return NULL;
     }
 
     if (!parse_platform_options(
-        env, options, "timerCreate", &platform->timer_create
+        env, options, "timerSchedule", &platform->timer_schedule
     )) {
         pomelo_platform_napi_destroy(&platform->base);
         return NULL;
     }
 
     if (!parse_platform_options(
-        env, options, "timerStart", &platform->timer_start
+        env, options, "statistic", &platform->statistic
     )) {
         pomelo_platform_napi_destroy(&platform->base);
         return NULL;
     }
 
     if (!parse_platform_options(
-        env, options, "timerStop", &platform->timer_stop
+        env, options, "udpAddressReset", &platform->udp_address_reset
     )) {
         pomelo_platform_napi_destroy(&platform->base);
         return NULL;
     }
 
-    if (!parse_platform_options(
-        env, options, "statistic", &platform->statistic
-    )) {
+    // Create the address cache
+    if (pomelo_platform_napi_address_cache_init(platform) < 0) {
         pomelo_platform_napi_destroy(&platform->base);
         return NULL;
     }
@@ -137,14 +161,18 @@ static pomelo_platform_napi_t * platform_create(
     pool_options.allocator = allocator;
     pool_options.element_size = sizeof(pomelo_platform_timer_info_t);
     pool_options.zero_init = true;
-    pool_options.on_cleanup = (pomelo_pool_cleanup_cb)
-        pomelo_platform_timer_info_finalize;
     platform->timer_info_pool = pomelo_pool_root_create(&pool_options);
     if (platform->timer_info_pool == NULL) {
         pomelo_platform_napi_destroy(&platform->base);
         return NULL;
     }
 
+    // Create the timer wheel
+    if (pomelo_platform_napi_timer_wheel_init(platform) < 0) {
+        pomelo_platform_napi_destroy(&platform->base);
+        return NULL;
+    }
+
     // Create the async work info pool
     memset(&pool_options, 0, sizeof(pomelo_pool_root_options_t));
     pool_options.allocator = allocator;
@@ -179,6 +207,22 @@ static pomelo_platform_napi_t * platform_create(
         return NULL;
     }
 
+    // Create the dedicated worker pool, without it worker tasks are queued as
+    // napi_async_work on the libuv threadpool
+    uint32_t worker_threads = 0;
+    parse_platform_uint32_option(
+        env, options, "workerThreads", &worker_threads
+    );
+    if (worker_threads > 0) {
+        platform->worker_pool = pomelo_platform_napi_worker_pool_create(
+            platform, worker_threads
+        );
+        if (platform->worker_pool == NULL) {
+            pomelo_platform_napi_destroy(&platform->base);
+            return NULL;
+        }
+    }
+
     // Create recv callbacks for sockets
     napi_value recv_callback = NULL;
     napi_status status = napi_create_function(
@@ -203,6 +247,30 @@ static pomelo_platform_napi_t * platform_create(
         return NULL;
     }
 
+    // Create batched recv callbacks for sockets
+    napi_value recv_batch_callback = NULL;
+    status = napi_create_function(
+        env,
+        "recvBatchCallback",
+        NAPI_AUTO_LENGTH,
+        pomelo_platform_udp_recv_batch_callback,
+        NULL,
+        &recv_batch_callback
+    );
+    if (status != napi_ok) {
+        pomelo_platform_napi_destroy(&platform->base);
+        return NULL;
+    }
+
+    // Create reference to the batched recv callback
+    status = napi_create_reference(
+        env, recv_batch_callback, 1, &platform->udp_recv_batch_callback
+    );
+    if (status != napi_ok) {
+        pomelo_platform_napi_destroy(&platform->base);
+        return NULL;
+    }
+
     // Create send callbacks for sockets
     napi_value send_callback = NULL;
     status = napi_create_function(
@@ -210,7 +278,7 @@ static pomelo_platform_napi_t * platform_create(
         "sendCallback",
         NAPI_AUTO_LENGTH,
         pomelo_platform_udp_send_callback,
-        NULL,
+        platform,
         &send_callback
     );
     if (status != napi_ok) {
@@ -227,6 +295,30 @@ static pomelo_platform_napi_t * platform_create(
         return NULL;
     }
 
+    // Create the send flush function
+    napi_value send_flush = NULL;
+    status = napi_create_function(
+        env,
+        "sendFlush",
+        NAPI_AUTO_LENGTH,
+        pomelo_platform_udp_send_flush,
+        platform,
+        &send_flush
+    );
+    if (status != napi_ok) {
+        pomelo_platform_napi_destroy(&platform->base);
+        return NULL;
+    }
+
+    // Create reference to the send flush function
+    status = napi_create_reference(
+        env, send_flush, 1, &platform->udp_send_flush
+    );
+    if (status != napi_ok) {
+        pomelo_platform_napi_destroy(&platform->base);
+        return NULL;
+    }
+
     // Create the timer callback
     napi_value timer_callback = NULL;
     status = napi_create_function(
@@ -234,7 +326,7 @@ static pomelo_platform_napi_t * platform_create(
         "timerCallback",
         NAPI_AUTO_LENGTH,
         pomelo_platform_timer_callback,
-        NULL,
+        platform,
         &timer_callback
     );
     if (status != napi_ok) {
@@ -311,13 +403,20 @@ pomelo_platform_t * pomelo_platform_napi_create(
 static void platform_destroy(pomelo_platform_napi_t * platform) {
     assert(platform != NULL);
 
+    // Stop the worker threads before their tasks are released
+    if (platform->worker_pool != NULL) {
+        pomelo_platform_napi_worker_pool_destroy(platform->worker_pool);
+        platform->worker_pool = NULL;
+    }
+
     // Destroy the UDP info pool
     if (platform->udp_info_pool != NULL) {
         pomelo_pool_destroy(platform->udp_info_pool);
         platform->udp_info_pool = NULL;
     }
 
-    // Destroy the timer info pool
+    // Destroy the timer wheel and its timer infos
+    pomelo_platform_napi_timer_wheel_finalize(platform);
     if (platform->timer_info_pool != NULL) {
         pomelo_pool_destroy(platform->timer_info_pool);
         platform->timer_info_pool = NULL;
@@ -360,9 +459,14 @@ static void platform_destroy(pomelo_platform_napi_t * platform) {
         platform->udp_stop = NULL;
     }
 
-    if (platform->udp_send != NULL) {
-        napi_delete_reference(platform->env, platform->udp_send);
-        platform->udp_send = NULL;
+    if (platform->udp_send_batch != NULL) {
+        napi_delete_reference(platform->env, platform->udp_send_batch);
+        platform->udp_send_batch = NULL;
+    }
+
+    if (platform->udp_send_flush != NULL) {
+        napi_delete_reference(platform->env, platform->udp_send_flush);
+        platform->udp_send_flush = NULL;
     }
 
     if (platform->udp_recv_callback != NULL) {
@@ -370,24 +474,19 @@ static void platform_destroy(pomelo_platform_napi_t * platform) {
         platform->udp_recv_callback = NULL;
     }
 
+    if (platform->udp_recv_batch_callback != NULL) {
+        napi_delete_reference(platform->env, platform->udp_recv_batch_callback);
+        platform->udp_recv_batch_callback = NULL;
+    }
+
     if (platform->udp_send_callback != NULL) {
         napi_delete_reference(platform->env, platform->udp_send_callback);
         platform->udp_send_callback = NULL;
     }
 
-    if (platform->timer_create != NULL) {
-        napi_delete_reference(platform->env, platform->timer_create);
-        platform->timer_create = NULL;
-    }
-
-    if (platform->timer_start != NULL) {
-        napi_delete_reference(platform->env, platform->timer_start);
-        platform->timer_start = NULL;
-    }
-
-    if (platform->timer_stop != NULL) {
-        napi_delete_reference(platform->env, platform->timer_stop);
-        platform->timer_stop = NULL;
+    if (platform->timer_schedule != NULL) {
+        napi_delete_reference(platform->env, platform->timer_schedule);
+        platform->timer_schedule = NULL;
     }
 
     if (platform->timer_callback != NULL) {
@@ -400,6 +499,13 @@ static void platform_destroy(pomelo_platform_napi_t * platform) {
         platform->statistic = NULL;
     }
 
+    if (platform->udp_address_reset != NULL) {
+        napi_delete_reference(platform->env, platform->udp_address_reset);
+        platform->udp_address_reset = NULL;
+    }
+
+    pomelo_platform_napi_address_cache_finalize(platform);
+
     pomelo_allocator_free(platform->allocator, platform);
 }
 
@@ -454,6 +560,81 @@ napi_value pomelo_platform_napi_statistic(
         env, thiz, fn_statistic, 0, NULL, &result
     ));
 
+    napi_valuetype type = napi_undefined;
+    napi_call(napi_typeof(env, result, &type));
+    if (type != napi_object) {
+        return result;
+    }
+
+    // The threadsafe executor counters are kept by the native side
+    uint64_t counters[] = {
+        pomelo_atomic_uint64_load(&impl->threadsafe_queue_depth),
+        pomelo_atomic_uint64_load(&impl->threadsafe_queue_peak),
+        impl->threadsafe_drains,
+        impl->threadsafe_drained_tasks,
+        impl->threadsafe_drain_max_batch
+    };
+    const char * names[] = {
+        "threadsafe_queue_depth",
+        "threadsafe_queue_peak",
+        "threadsafe_drains",
+        "threadsafe_drained_tasks",
+        "threadsafe_drain_max_batch"
+    };
+    for (size_t i = 0; i < sizeof(counters) / sizeof(counters[0]); i++) {
+        napi_value value;
+        napi_call(napi_create_bigint_uint64(env, counters[i], &value));
+        napi_call(napi_set_named_property(env, result, names[i], value));
+    }
+
+    pomelo_platform_timer_wheel_t * wheel = impl->timer_wheel;
+    uint64_t wheel_counters[] = {
+        wheel->timers,
+        wheel->ticks,
+        wheel->fired
+    };
+    const char * wheel_names[] = {
+        "timers",
+        "timer_ticks",
+        "timer_fired"
+    };
+    size_t wheel_count = sizeof(wheel_counters) / sizeof(wheel_counters[0]);
+    for (size_t i = 0; i < wheel_count; i++) {
+        napi_value value;
+        napi_call(napi_create_bigint_uint64(env, wheel_counters[i], &value));
+        napi_call(napi_set_named_property(
+            env, result, wheel_names[i], value
+        ));
+    }
+
+    pomelo_platform_napi_worker_pool_t * pool = impl->worker_pool;
+    if (pool == NULL) {
+        return result;
+    }
+
+    uint64_t pool_counters[] = {
+        pool->worker_count,
+        pool->outstanding,
+        pomelo_atomic_uint64_load(&pool->stolen_tasks),
+        pool->completion_drains,
+        pool->completed_tasks,
+        pool->completion_max_batch
+    };
+    const char * pool_names[] = {
+        "worker_threads",
+        "worker_outstanding",
+        "worker_stolen_tasks",
+        "worker_completion_drains",
+        "worker_completed_tasks",
+        "worker_completion_max_batch"
+    };
+    size_t pool_count = sizeof(pool_counters) / sizeof(pool_counters[0]);
+    for (size_t i = 0; i < pool_count; i++) {
+        napi_value value;
+        napi_call(napi_create_bigint_uint64(env, pool_counters[i], &value));
+        napi_call(napi_set_named_property(env, result, pool_names[i], value));
+    }
+
     return result;
 }
 
@@ -3,6 +3,7 @@
 #include "node_api.h"
 #include "platform.h"
 #include "base/extra.h"
+#include "utils/atomic.h"
 #include "utils/pool.h"
 #ifdef __cplusplus
 extern "C" {
@@ -16,6 +17,20 @@ extern "C" {
 /// @brief The platform NAPI structure
 typedef struct pomelo_platform_napi_s pomelo_platform_napi_t;
 
+/// @brief The UDP info structure
+typedef struct pomelo_platform_udp_info_s pomelo_platform_udp_info_t;
+
+/// @brief The timer wheel
+typedef struct pomelo_platform_timer_wheel_s pomelo_platform_timer_wheel_t;
+
+/// @brief The dedicated worker pool
+typedef struct pomelo_platform_napi_worker_pool_s
+    pomelo_platform_napi_worker_pool_t;
+
+/// @brief The cache of interned peer addresses
+typedef struct pomelo_platform_address_cache_s
+    pomelo_platform_address_cache_t;
+
 
 struct pomelo_platform_napi_s {
     /// @brief The platform interface
@@ -33,12 +48,31 @@ struct pomelo_platform_napi_s {
     /// @brief The async work info pool 
     pomelo_pool_t * task_worker_pool;
 
+    /// @brief The dedicated worker pool, NULL if worker tasks are queued as
+    /// napi_async_work on the libuv threadpool
+    pomelo_platform_napi_worker_pool_t * worker_pool;
+
     /// @brief The threadsafe info pool
     pomelo_pool_t * task_threadsafe_pool;
 
     /// @brief The threadsafe executor pool
     pomelo_pool_t * threadsafe_executor_pool;
 
+    /// @brief Number of submitted threadsafe tasks which have not run yet
+    pomelo_atomic_uint64_t threadsafe_queue_depth;
+
+    /// @brief Peak of threadsafe queue depth
+    pomelo_atomic_uint64_t threadsafe_queue_peak;
+
+    /// @brief Number of drains of threadsafe executors
+    uint64_t threadsafe_drains;
+
+    /// @brief Number of threadsafe tasks run by the drains
+    uint64_t threadsafe_drained_tasks;
+
+    /// @brief Largest number of threadsafe tasks run by a single drain
+    uint64_t threadsafe_drain_max_batch;
+
     /// @brief The environment
     napi_env env;
 
@@ -60,29 +94,61 @@ struct pomelo_platform_napi_s {
     /// @brief The udp stop reference
     napi_ref udp_stop;
 
-    /// @brief The udp send reference
-    napi_ref udp_send;
+    /// @brief The udp batched send reference
+    napi_ref udp_send_batch;
+
+    /// @brief The udp send flush function reference
+    napi_ref udp_send_flush;
+
+    /// @brief Sockets which have queued datagrams
+    pomelo_platform_udp_info_t * send_pending;
+
+    /// @brief Whether the send flush has been scheduled
+    bool send_scheduled;
 
     /// @brief The udp recv callback reference
     napi_ref udp_recv_callback;
 
+    /// @brief The batched udp recv callback reference
+    napi_ref udp_recv_batch_callback;
+
     /// @brief The udp send callback reference
     napi_ref udp_send_callback;
 
-    /// @brief The timer create reference
-    napi_ref timer_create;
+    /// @brief The udp address reset reference
+    napi_ref udp_address_reset;
 
-    /// @brief The timer start reference
-    napi_ref timer_start;
+    /// @brief The cache of peer addresses
+    pomelo_platform_address_cache_t * address_cache;
 
-    /// @brief The timer stop reference
-    napi_ref timer_stop;
+    /// @brief The timer schedule reference, which arms the JS timeout of
+    /// timer wheel
+    napi_ref timer_schedule;
 
-    /// @brief The timer callback reference
+    /// @brief The timer wheel tick callback reference
     napi_ref timer_callback;
 
+    /// @brief The timer wheel
+    pomelo_platform_timer_wheel_t * timer_wheel;
+
     /// @brief The statistic reference
     napi_ref statistic;
+
+    /* Clock */
+
+    /// @brief Whether the native clock is available. Otherwise, the hrtime
+    /// and now JS functions are called.
+    bool native_clock;
+
+    /// @brief Depth of running dispatches. Clock reads are cached while the
+    /// platform is dispatching a callback.
+    int clock_depth;
+
+    /// @brief Cached hrtime of current dispatch, 0 if it has not been read
+    uint64_t clock_hrtime;
+
+    /// @brief Cached now of current dispatch, 0 if it has not been read
+    uint64_t clock_now;
 };
 
 
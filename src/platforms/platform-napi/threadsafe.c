@@ -1,25 +1,69 @@
 #include <assert.h>
 #include "threadsafe.h"
+#include "time.h"
 
 
-/// @brief The threadsafe function max queue size
-#define THREADSAFE_FUNCTION_MAX_QUEUE_SIZE 0xFFFF
+/// @brief The threadsafe function max queue size. The threadsafe function is
+/// only called when the pending list of executor turns non-empty, so its queue
+/// holds at most a few wakeups and is left unlimited.
+#define THREADSAFE_FUNCTION_MAX_QUEUE_SIZE 0
 
 
-/// @brief The threadsafe function entry
+/// @brief Run all pending tasks of the executor
 static void threadsafe_function_entry(
     napi_env env,
-    pomelo_platform_napi_t * platform,
-    pomelo_platform_task_threadsafe_t * task_threadsafe
+    napi_value js_callback,
+    void * context,
+    pomelo_threadsafe_executor_t * executor
 ) {
+    (void) js_callback;
+    (void) context;
+    if (env == NULL) return; // The threadsafe function is being finalized
+    assert(executor != NULL);
+    pomelo_platform_napi_t * platform = executor->platform;
     assert(platform != NULL);
-    assert(task_threadsafe != NULL);
 
-    // Call the entry function
-    task_threadsafe->entry(task_threadsafe->data);
+    // Take the whole list, producers will start a new one
+    uint64_t head = pomelo_atomic_uint64_load(&executor->pending);
+    while (head != 0 && !pomelo_atomic_uint64_compare_exchange(
+        &executor->pending, head, 0
+    )) {
+        head = pomelo_atomic_uint64_load(&executor->pending);
+    }
+    if (head == 0) return; // Drained by a previous wakeup
+
+    pomelo_platform_task_threadsafe_t * task =
+        (pomelo_platform_task_threadsafe_t *) (uintptr_t) head;
+
+    // The list is newest first, reverse it to run the tasks in order
+    pomelo_platform_task_threadsafe_t * ordered = NULL;
+    uint64_t batch = 0;
+    while (task != NULL) {
+        pomelo_platform_task_threadsafe_t * next = task->next;
+        task->next = ordered;
+        ordered = task;
+        task = next;
+        batch++;
+    }
+
+    pomelo_atomic_uint64_fetch_sub(&platform->threadsafe_queue_depth, batch);
+    platform->threadsafe_drains++;
+    platform->threadsafe_drained_tasks += batch;
+    if (batch > platform->threadsafe_drain_max_batch) {
+        platform->threadsafe_drain_max_batch = batch;
+    }
+
+    // Call the entry functions
+    pomelo_platform_napi_clock_enter(platform);
+    while (ordered != NULL) {
+        task = ordered;
+        ordered = task->next;
+        task->entry(task->data);
 
-    // Release the task threadsafe
-    pomelo_pool_release(platform->task_threadsafe_pool, task_threadsafe);
+        // Release the task threadsafe
+        pomelo_pool_release(platform->task_threadsafe_pool, task);
+    }
+    pomelo_platform_napi_clock_leave(platform);
 }
 
 
@@ -57,6 +101,7 @@ pomelo_threadsafe_executor_t * pomelo_platform_napi_acquire_threadsafe_executor(
     // Set the threadsafe function
     executor->platform = impl;
     executor->threadsafe_function = threadsafe_function;
+    pomelo_atomic_uint64_store(&executor->pending, 0);
 
     return executor;
 }
@@ -91,6 +136,22 @@ void pomelo_platform_napi_release_threadsafe_executor(
 }
 
 
+/// @brief Raise the peak of threadsafe queue depth
+static void update_queue_peak(
+    pomelo_platform_napi_t * platform,
+    uint64_t depth
+) {
+    pomelo_atomic_uint64_t * queue_peak = &platform->threadsafe_queue_peak;
+    uint64_t peak = pomelo_atomic_uint64_load(queue_peak);
+    while (depth > peak) {
+        if (pomelo_atomic_uint64_compare_exchange(queue_peak, peak, depth)) {
+            break;
+        }
+        peak = pomelo_atomic_uint64_load(queue_peak);
+    }
+}
+
+
 pomelo_platform_task_t * pomelo_platform_napi_threadsafe_executor_submit(
     pomelo_platform_t * platform,
     pomelo_threadsafe_executor_t * executor,
@@ -110,15 +171,33 @@ pomelo_platform_task_t * pomelo_platform_napi_threadsafe_executor_submit(
     task_threadsafe->entry = entry;
     task_threadsafe->data = data;
 
-    napi_status status = napi_call_threadsafe_function(
-        (napi_threadsafe_function) executor,
-        task_threadsafe,
+    uint64_t depth =
+        pomelo_atomic_uint64_fetch_add(&impl->threadsafe_queue_depth, 1) + 1;
+    update_queue_peak(impl, depth);
+
+    // Push the task to the pending list
+    uint64_t head = 0;
+    do {
+        head = pomelo_atomic_uint64_load(&executor->pending);
+        task_threadsafe->next =
+            (pomelo_platform_task_threadsafe_t *) (uintptr_t) head;
+    } while (!pomelo_atomic_uint64_compare_exchange(
+        &executor->pending, head, (uint64_t) (uintptr_t) task_threadsafe
+    ));
+
+    // A wakeup is already on its way for a non-empty list
+    if (head != 0) {
+        return (pomelo_platform_task_t *) task_threadsafe;
+    }
+
+    // The task is already published, so it cannot be taken back if the call
+    // fails. The call only fails while the threadsafe function is closing,
+    // when no more tasks will run anyway.
+    napi_call_threadsafe_function(
+        executor->threadsafe_function,
+        executor,
         napi_tsfn_nonblocking
     );
-    if (status != napi_ok) {
-        pomelo_pool_release(impl->task_threadsafe_pool, task_threadsafe);
-        return NULL; // Failed to push the task to the threadsafe function
-    }
 
     return (pomelo_platform_task_t *) task_threadsafe;
 }
@@ -21,6 +21,9 @@ struct pomelo_platform_task_threadsafe_s {
 
     /// @brief The data
     void * data;
+
+    /// @brief The next task in the pending list of executor
+    pomelo_platform_task_threadsafe_t * next;
 };
 
 
@@ -30,6 +33,13 @@ struct pomelo_threadsafe_executor_s {
 
     /// @brief The threadsafe function
     napi_threadsafe_function threadsafe_function;
+
+    /// @brief Lock-free list of submitted tasks, newest first. Producers push
+    /// with CAS, the JS thread takes the whole list at once. The threadsafe
+    /// function is only called when the list turns non-empty, so a burst of
+    /// submissions costs a single wakeup of the loop. The head pointer is
+    /// stored as an atomic integer.
+    pomelo_atomic_uint64_t pending;
 };
 
 
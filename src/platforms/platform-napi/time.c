@@ -1,8 +1,51 @@
 #include <assert.h>
+#ifndef _WIN32
+#include <time.h>
+#endif
 #include "platform-napi.h"
 #include "time.h"
 
 
+/// @brief Read the native clock in nanoseconds.
+/// Returns 0 if the clock is not available.
+static uint64_t native_clock_ns(bool monotonic) {
+#ifdef _WIN32
+    (void) monotonic;
+    return 0;
+#else
+    struct timespec ts;
+    clockid_t clock = monotonic ? CLOCK_MONOTONIC : CLOCK_REALTIME;
+    if (clock_gettime(clock, &ts) != 0) return 0;
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+#endif
+}
+
+
+bool pomelo_platform_napi_clock_init(pomelo_platform_napi_t * platform) {
+    assert(platform != NULL);
+    platform->native_clock =
+        native_clock_ns(true) != 0 && native_clock_ns(false) != 0;
+    return platform->native_clock;
+}
+
+
+void pomelo_platform_napi_clock_enter(pomelo_platform_napi_t * platform) {
+    assert(platform != NULL);
+    platform->clock_depth++;
+}
+
+
+void pomelo_platform_napi_clock_leave(pomelo_platform_napi_t * platform) {
+    assert(platform != NULL);
+    assert(platform->clock_depth > 0);
+    if (--platform->clock_depth > 0) return;
+
+    // Next dispatch will read the clock again
+    platform->clock_hrtime = 0;
+    platform->clock_now = 0;
+}
+
+
 /// @brief Get the high resolution time
 static uint64_t platform_hrtime(pomelo_platform_napi_t * platform) {
     napi_value hrtime = NULL;
@@ -29,9 +72,8 @@ static uint64_t platform_hrtime(pomelo_platform_napi_t * platform) {
 }
 
 
-uint64_t pomelo_platform_napi_hrtime(pomelo_platform_t * platform) {
-    assert(platform != NULL);
-    pomelo_platform_napi_t * impl = (pomelo_platform_napi_t *) platform;
+/// @brief Get the high resolution time by calling the JS function
+static uint64_t platform_hrtime_scoped(pomelo_platform_napi_t * impl) {
     napi_env env = impl->env;
 
     napi_handle_scope scope = NULL;
@@ -47,6 +89,23 @@ uint64_t pomelo_platform_napi_hrtime(pomelo_platform_t * platform) {
 }
 
 
+uint64_t pomelo_platform_napi_hrtime(pomelo_platform_t * platform) {
+    assert(platform != NULL);
+    pomelo_platform_napi_t * impl = (pomelo_platform_napi_t *) platform;
+    if (impl->clock_hrtime) return impl->clock_hrtime;
+
+    uint64_t hrtime = impl->native_clock
+        ? native_clock_ns(true)
+        : platform_hrtime_scoped(impl);
+
+    // Cache the value until the current dispatch ends
+    if (impl->clock_depth > 0) {
+        impl->clock_hrtime = hrtime;
+    }
+    return hrtime;
+}
+
+
 /// @brief Get the current time
 static uint64_t platform_now(pomelo_platform_napi_t * platform) {
     napi_value now = NULL;
@@ -74,9 +133,8 @@ static uint64_t platform_now(pomelo_platform_napi_t * platform) {
 }
 
 
-uint64_t pomelo_platform_napi_now(pomelo_platform_t * platform) {
-    assert(platform != NULL);
-    pomelo_platform_napi_t * impl = (pomelo_platform_napi_t *) platform;
+/// @brief Get the current time by calling the JS function
+static uint64_t platform_now_scoped(pomelo_platform_napi_t * impl) {
     napi_env env = impl->env;
 
     napi_handle_scope scope = NULL;
@@ -90,3 +148,21 @@ uint64_t pomelo_platform_napi_now(pomelo_platform_t * platform) {
 
     return result;
 }
+
+
+uint64_t pomelo_platform_napi_now(pomelo_platform_t * platform) {
+    assert(platform != NULL);
+    pomelo_platform_napi_t * impl = (pomelo_platform_napi_t *) platform;
+    if (impl->clock_now) return impl->clock_now;
+
+    // The JS function returns milliseconds since epoch
+    uint64_t now = impl->native_clock
+        ? native_clock_ns(false) / 1000000ULL
+        : platform_now_scoped(impl);
+
+    // Cache the value until the current dispatch ends
+    if (impl->clock_depth > 0) {
+        impl->clock_now = now;
+    }
+    return now;
+}
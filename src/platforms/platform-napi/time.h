@@ -1,12 +1,25 @@
 #ifndef POMELO_NODE_PLATFORM_NAPI_TIME_H
 #define POMELO_NODE_PLATFORM_NAPI_TIME_H
 #include "node_api.h"
-#include "platform.h"
+#include "platform-napi.h"
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 
+/// @brief Check if the native clock is available
+bool pomelo_platform_napi_clock_init(pomelo_platform_napi_t * platform);
+
+
+/// @brief Begin a dispatch. The clock reads are cached until the outermost
+/// dispatch ends.
+void pomelo_platform_napi_clock_enter(pomelo_platform_napi_t * platform);
+
+
+/// @brief End a dispatch
+void pomelo_platform_napi_clock_leave(pomelo_platform_napi_t * platform);
+
+
 /// @brief Get the high resolution time
 uint64_t pomelo_platform_napi_hrtime(pomelo_platform_t * platform);
 
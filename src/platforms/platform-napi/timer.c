@@ -1,185 +1,383 @@
 #include <assert.h>
+#include <string.h>
 #include "platform-napi.h"
 #include "timer.h"
+#include "time.h"
 #include "utils.h"
 
 
-#define TIMER_CALLBACK_ARGC 1
-napi_value pomelo_platform_timer_callback(
-    napi_env env,
-    napi_callback_info info
+/// @brief Mask of the slot index
+#define WHEEL_SLOT_MASK (POMELO_TIMER_WHEEL_SLOTS - 1)
+
+/// @brief The range of all levels in ticks
+#define WHEEL_RANGE \
+    (1ULL << (POMELO_TIMER_WHEEL_SLOT_BITS * POMELO_TIMER_WHEEL_LEVELS))
+
+/// @brief The JS timeout is not armed
+#define WHEEL_NOT_SCHEDULED UINT64_MAX
+
+
+/// @brief Index of the lowest set bit, the value must not be zero
+static int wheel_lowest_bit(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index = 0;
+    _BitScanForward64(&index, value);
+    return (int) index;
+#else
+    return __builtin_ctzll(value);
+#endif
+}
+
+
+/// @brief Get the current tick of platform
+static uint64_t wheel_now(pomelo_platform_napi_t * platform) {
+    pomelo_platform_timer_wheel_t * wheel = platform->timer_wheel;
+    uint64_t hrtime = pomelo_platform_napi_hrtime(&platform->base);
+    if (hrtime <= wheel->origin) return 0;
+    return (hrtime - wheel->origin) / 1000000ULL;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/*                                   Lists                                    */
+/* -------------------------------------------------------------------------- */
+
+/// @brief Append a timer to the front of a list
+static void wheel_link(
+    pomelo_platform_timer_info_t ** list,
+    pomelo_platform_timer_info_t * info
 ) {
-    size_t argc = TIMER_CALLBACK_ARGC;
-    napi_value argv[TIMER_CALLBACK_ARGC] = { NULL };
-
-    // Get the callback info
-    napi_call(napi_get_cb_info(env, info, &argc, argv, NULL, NULL));
-    if (argc != TIMER_CALLBACK_ARGC) return NULL;
-
-    // Get the timer info
-    pomelo_platform_timer_info_t * timer_info = NULL;
-    napi_call(napi_unwrap(env, argv[0], (void *) &timer_info));
-    if (!timer_info) return NULL;
-    
-    // Call the timer callback
-    timer_info->entry(timer_info->data);
-    if (timer_info->repeat_ms == 0) {
-        napi_call(napi_reference_unref(env, timer_info->timer_ref, NULL));
-
-        // Clear the timer handle
-        if (timer_info->handle) {
-            timer_info->handle->timer = NULL;
-            timer_info->handle = NULL;
-        }
+    info->list = list;
+    info->prev = NULL;
+    info->next = *list;
+    if (*list) {
+        (*list)->prev = info;
     }
+    *list = info;
+}
 
-    napi_value undefined = NULL;
-    napi_call(napi_get_undefined(env, &undefined));
-    return undefined;
+
+/// @brief Remove a timer from its list
+static void wheel_unlink(
+    pomelo_platform_timer_wheel_t * wheel,
+    pomelo_platform_timer_info_t * info
+) {
+    pomelo_platform_timer_info_t ** list = info->list;
+    if (list == NULL) return;
+
+    if (info->prev) {
+        info->prev->next = info->next;
+    } else {
+        *list = info->next;
+    }
+    if (info->next) {
+        info->next->prev = info->prev;
+    }
+    info->list = NULL;
+    info->prev = NULL;
+    info->next = NULL;
+
+    // Clear the occupancy bit of emptied slot
+    if (*list == NULL && list != &wheel->expired) {
+        size_t index = (size_t) (list - &wheel->slots[0][0]);
+        size_t level = index / POMELO_TIMER_WHEEL_SLOTS;
+        size_t slot = index % POMELO_TIMER_WHEEL_SLOTS;
+        wheel->occupied[level] &= ~(1ULL << slot);
+    }
 }
 
 
-void pomelo_platform_timer_info_finalize(pomelo_platform_timer_info_t * info) {
-    assert(info != NULL);
+/// @brief Put a timer to the slot of its expiry
+static void wheel_insert(
+    pomelo_platform_timer_wheel_t * wheel,
+    pomelo_platform_timer_info_t * info
+) {
+    assert(info->expire > wheel->current);
+    uint64_t delta = info->expire - wheel->current;
+    uint64_t expire = info->expire;
+    if (delta >= WHEEL_RANGE) {
+        // Park it in the last level, it is reinserted when cascaded
+        expire = wheel->current + WHEEL_RANGE - 1;
+        delta = WHEEL_RANGE - 1;
+    }
 
-    // Delete the timer reference
-    if (info->timer_ref) {
-        napi_delete_reference(info->platform->env, info->timer_ref);
-        info->timer_ref = NULL;
+    size_t level = 0;
+    while (delta >= (1ULL << (POMELO_TIMER_WHEEL_SLOT_BITS * (level + 1)))) {
+        level++;
     }
+
+    size_t slot = (size_t)
+        (expire >> (POMELO_TIMER_WHEEL_SLOT_BITS * level)) & WHEEL_SLOT_MASK;
+    wheel_link(&wheel->slots[level][slot], info);
+    wheel->occupied[level] |= (1ULL << slot);
 }
 
 
-/// @brief Finalize the timer info
-static void platform_timer_info_finalize_and_release(
-    napi_env env,
-    pomelo_platform_timer_info_t * info,
-    pomelo_platform_napi_t * platform
+/// @brief Move the timers of a slot to lower levels
+static void wheel_cascade(
+    pomelo_platform_timer_wheel_t * wheel,
+    size_t level,
+    size_t slot
 ) {
-    (void) env;
-    assert(info != NULL);
-    assert(platform != NULL);
+    pomelo_platform_timer_info_t * info = wheel->slots[level][slot];
+    while (info) {
+        pomelo_platform_timer_info_t * next = info->next;
+        wheel_unlink(wheel, info);
+        if (info->expire <= wheel->current) {
+            wheel_link(&wheel->expired, info); // Due at this tick
+        } else {
+            wheel_insert(wheel, info);
+        }
+        info = next;
+    }
+}
 
-    // Release the timer info
-    pomelo_pool_release(platform->timer_info_pool, info);
+
+/* -------------------------------------------------------------------------- */
+/*                                 Scheduling                                 */
+/* -------------------------------------------------------------------------- */
+
+/// @brief Get the tick of the nearest event of wheel
+static uint64_t wheel_next_event(pomelo_platform_timer_wheel_t * wheel) {
+    if (wheel->timers == 0) return WHEEL_NOT_SCHEDULED;
+
+    uint64_t block = wheel->current & ~(uint64_t) WHEEL_SLOT_MASK;
+    uint64_t next = WHEEL_NOT_SCHEDULED;
+
+    uint64_t occupied = wheel->occupied[0];
+    if (occupied) {
+        size_t position = (size_t) (wheel->current & WHEEL_SLOT_MASK);
+        uint64_t after = (position < WHEEL_SLOT_MASK)
+            ? occupied & (~0ULL << (position + 1))
+            : 0;
+        next = after
+            ? block + wheel_lowest_bit(after)
+            : block + POMELO_TIMER_WHEEL_SLOTS + wheel_lowest_bit(occupied);
+    }
+
+    // Upper levels are cascaded at the next block boundary
+    for (size_t level = 1; level < POMELO_TIMER_WHEEL_LEVELS; level++) {
+        if (wheel->occupied[level]) {
+            uint64_t boundary = block + POMELO_TIMER_WHEEL_SLOTS;
+            if (boundary < next) next = boundary;
+            break;
+        }
+    }
+
+    return next;
+}
+
+
+/// @brief Arm the JS timeout for the nearest event if it is earlier than the
+/// armed one
+static void wheel_schedule(pomelo_platform_napi_t * platform) {
+    pomelo_platform_timer_wheel_t * wheel = platform->timer_wheel;
+    if (wheel->ticking) return; // Scheduled at the end of tick
+
+    uint64_t next = wheel_next_event(wheel);
+    if (next >= wheel->scheduled) return;
+    wheel->scheduled = next;
+
+    uint64_t now = wheel_now(platform);
+    double timeout_ms = (next > now) ? (double) (next - now) : 0;
+
+    napi_env env = platform->env;
+    napi_handle_scope scope = NULL;
+    napi_callv(napi_open_handle_scope(env, &scope));
+
+    napi_value timer_schedule = NULL;
+    napi_value timer_callback = NULL;
+    napi_value null_value = NULL;
+    napi_value timeout_value = NULL;
+    if (
+        napi_get_reference_value(
+            env, platform->timer_schedule, &timer_schedule
+        ) == napi_ok &&
+        napi_get_reference_value(
+            env, platform->timer_callback, &timer_callback
+        ) == napi_ok &&
+        napi_get_null(env, &null_value) == napi_ok &&
+        napi_create_double(env, timeout_ms, &timeout_value) == napi_ok
+    ) {
+        napi_value argv[] = { timer_callback, timeout_value };
+        napi_call_function(
+            env,
+            null_value,
+            timer_schedule,
+            sizeof(argv) / sizeof(argv[0]),
+            argv,
+            NULL
+        );
+    }
+
+    napi_close_handle_scope(env, scope);
 }
 
 
-/// @brief Start the timer
-static int timer_start(
+/* -------------------------------------------------------------------------- */
+/*                                   Ticks                                    */
+/* -------------------------------------------------------------------------- */
+
+/// @brief Release a timer which is not linked
+static void wheel_release(
     pomelo_platform_napi_t * platform,
-    pomelo_platform_timer_entry entry,
-    uint64_t timeout_ms,
-    uint64_t repeat_ms,
-    void * data,
-    pomelo_platform_timer_handle_t * handle
+    pomelo_platform_timer_info_t * info
 ) {
-    assert(platform != NULL);
-    assert(entry != NULL);
+    info->handle = NULL;
+    info->firing = false;
+    info->stopped = false;
+    pomelo_pool_release(platform->timer_info_pool, info);
+}
 
-    napi_env env = platform->env;
 
-    // Get the timer create function
-    napi_value timer_create = NULL;
-    napi_status status = napi_get_reference_value(
-        env, platform->timer_create, &timer_create
-    );
-    if (status != napi_ok || timer_create == NULL) return -1;
+/// @brief Fire the timers of the expired list
+static void wheel_fire(pomelo_platform_napi_t * platform) {
+    pomelo_platform_timer_wheel_t * wheel = platform->timer_wheel;
 
-    // Get the timer start function
-    napi_value timer_start = NULL;
-    status = napi_get_reference_value(
-        env, platform->timer_start, &timer_start
-    );
-    if (status != napi_ok || timer_start == NULL) return -1;
+    while (wheel->expired) {
+        pomelo_platform_timer_info_t * info = wheel->expired;
+        wheel_unlink(wheel, info);
 
-    // Get the timer callback function
-    napi_value timer_callback = NULL;
-    status = napi_get_reference_value(
-        env, platform->timer_callback, &timer_callback
-    );
-    if (status != napi_ok || timer_callback == NULL) return -1;
+        info->firing = true;
+        info->entry(info->data);
+        info->firing = false;
+        wheel->fired++;
 
-    // Convert timeout_ms to napi_value
-    napi_value timeout_ms_value = NULL;
-    status = napi_create_double(env, timeout_ms, &timeout_ms_value);
-    if (status != napi_ok || timeout_ms_value == NULL) return -1;
+        if (info->stopped) {
+            // Stopped by its entry
+            wheel_release(platform, info);
+            continue;
+        }
 
-    // Convert repeat_ms to napi_value
-    napi_value repeat_ms_value = NULL;
-    status = napi_create_double(env, repeat_ms, &repeat_ms_value);
-    if (status != napi_ok || repeat_ms_value == NULL) return -1;
+        if (info->repeat_ms > 0) {
+            info->expire = wheel->current + info->repeat_ms;
+            wheel_insert(wheel, info);
+            continue;
+        }
 
-    // Create null value
-    napi_value null_value = NULL;
-    status = napi_get_null(env, &null_value);
-    if (status != napi_ok || null_value == NULL) return -1;
-
-    // Create new timer
-    napi_value args[] = {
-        timer_callback,
-        timeout_ms_value,
-        repeat_ms_value
-    };
-    napi_value timer = NULL;
-    status = napi_call_function(
-        env,
-        null_value,
-        timer_create,
-        sizeof(args) / sizeof(args[0]),
-        args,
-        &timer
-    );
-    if (status != napi_ok || timer == NULL) return -1;
-
-    // Acquire the timer info   
-    pomelo_platform_timer_info_t * timer_info =
-        pomelo_pool_acquire(platform->timer_info_pool, NULL);
-    if (timer_info == NULL) return -1;
-
-    // Initialize the timer info
-    timer_info->entry = entry;
-    timer_info->timeout_ms = timeout_ms;
-    timer_info->repeat_ms = repeat_ms;
-    timer_info->data = data;
-    timer_info->handle = handle;
-    timer_info->platform = platform;
-
-    // Wrap the timer info
-    status = napi_wrap(
-        env,
-        timer,
-        timer_info,
-        (napi_finalize) platform_timer_info_finalize_and_release,
-        platform,
-        &timer_info->timer_ref
-    );
-    if (status != napi_ok) return -1;
+        // The handle may have been reused by the entry
+        pomelo_platform_timer_handle_t * handle = info->handle;
+        if (handle && handle->timer == (pomelo_platform_timer_t *) info) {
+            handle->timer = NULL;
+        }
+        wheel->timers--;
+        wheel_release(platform, info);
+    }
+}
 
-    if (handle) {
-        handle->timer = (pomelo_platform_timer_t *) timer_info->timer_ref;
+
+/// @brief Process all ticks until now
+static void wheel_advance(pomelo_platform_napi_t * platform, uint64_t now) {
+    pomelo_platform_timer_wheel_t * wheel = platform->timer_wheel;
+
+    while (wheel->current < now) {
+        if (wheel->timers == 0) {
+            wheel->current = now;
+            break;
+        }
+
+        if (wheel->occupied[0] == 0) {
+            // Skip to the next block boundary, nothing expires before it
+            uint64_t boundary = (wheel->current | WHEEL_SLOT_MASK) + 1;
+            if (boundary > now) {
+                wheel->current = now;
+                break;
+            }
+            wheel->current = boundary;
+        } else {
+            wheel->current++;
+        }
+
+        uint64_t tick = wheel->current;
+        if ((tick & WHEEL_SLOT_MASK) == 0) {
+            // Cascade from the highest level whose boundary is crossed
+            size_t top = 1;
+            while (
+                top + 1 < POMELO_TIMER_WHEEL_LEVELS &&
+                ((tick >> (POMELO_TIMER_WHEEL_SLOT_BITS * top)) &
+                    WHEEL_SLOT_MASK) == 0
+            ) {
+                top++;
+            }
+            for (size_t level = top; level >= 1; level--) {
+                size_t slot = (size_t) (tick >>
+                    (POMELO_TIMER_WHEEL_SLOT_BITS * level)) & WHEEL_SLOT_MASK;
+                wheel_cascade(wheel, level, slot);
+            }
+        }
+
+        // Move the expired slot to the expired list
+        size_t slot = (size_t) (tick & WHEEL_SLOT_MASK);
+        pomelo_platform_timer_info_t * info = wheel->slots[0][slot];
+        while (info) {
+            pomelo_platform_timer_info_t * next = info->next;
+            wheel_unlink(wheel, info);
+            wheel_link(&wheel->expired, info);
+            info = next;
+        }
+
+        wheel_fire(platform);
     }
+}
 
-    // Call the timer start function
-    napi_value argv[] = { timer };
-    status = napi_call_function(
-        env,
-        null_value,
-        timer_start,
-        sizeof(argv) / sizeof(argv[0]),
-        argv,
-        NULL
-    );
-    if (status != napi_ok) return -1;
 
-    // Increase the reference count
-    status = napi_reference_ref(env, timer_info->timer_ref, NULL);
-    if (status != napi_ok) return -1;
+napi_value pomelo_platform_timer_callback(
+    napi_env env,
+    napi_callback_info info
+) {
+    pomelo_platform_napi_t * platform = NULL;
+    napi_call(napi_get_cb_info(
+        env, info, NULL, NULL, NULL, (void **) &platform
+    ));
+    if (!platform || !platform->timer_wheel) return NULL;
+    pomelo_platform_timer_wheel_t * wheel = platform->timer_wheel;
+
+    pomelo_platform_napi_clock_enter(platform);
+    wheel->ticks++;
+    wheel->scheduled = WHEEL_NOT_SCHEDULED;
+    wheel->ticking = true;
+    wheel_advance(platform, wheel_now(platform));
+    wheel->ticking = false;
+    wheel_schedule(platform);
+    pomelo_platform_napi_clock_leave(platform);
+
+    napi_value undefined = NULL;
+    napi_call(napi_get_undefined(env, &undefined));
+    return undefined;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/*                                Public APIs                                 */
+/* -------------------------------------------------------------------------- */
+
+int pomelo_platform_napi_timer_wheel_init(pomelo_platform_napi_t * platform) {
+    assert(platform != NULL);
+    pomelo_platform_timer_wheel_t * wheel = pomelo_allocator_malloc(
+        platform->allocator, sizeof(pomelo_platform_timer_wheel_t)
+    );
+    if (wheel == NULL) return -1;
 
+    memset(wheel, 0, sizeof(pomelo_platform_timer_wheel_t));
+    wheel->scheduled = WHEEL_NOT_SCHEDULED;
+    platform->timer_wheel = wheel;
+    wheel->origin = pomelo_platform_napi_hrtime(&platform->base);
     return 0;
 }
 
 
+void pomelo_platform_napi_timer_wheel_finalize(
+    pomelo_platform_napi_t * platform
+) {
+    assert(platform != NULL);
+    if (platform->timer_wheel == NULL) return;
+
+    // The timer infos are freed with their pool
+    pomelo_allocator_free(platform->allocator, platform->timer_wheel);
+    platform->timer_wheel = NULL;
+}
+
+
 int pomelo_platform_napi_timer_start(
     pomelo_platform_t * platform,
     pomelo_platform_timer_entry entry,
@@ -189,84 +387,68 @@ int pomelo_platform_napi_timer_start(
     pomelo_platform_timer_handle_t * handle
 ) {
     assert(platform != NULL);
+    assert(entry != NULL);
 
     pomelo_platform_napi_t * impl = (pomelo_platform_napi_t *) platform;
-    napi_env env = impl->env;
+    pomelo_platform_timer_wheel_t * wheel = impl->timer_wheel;
+
+    pomelo_platform_timer_info_t * info =
+        pomelo_pool_acquire(impl->timer_info_pool, NULL);
+    if (info == NULL) return -1;
+
+    info->platform = impl;
+    info->entry = entry;
+    info->data = data;
+    info->timeout_ms = timeout_ms;
+    info->repeat_ms = repeat_ms;
+    info->handle = handle;
+    info->firing = false;
+    info->stopped = false;
+
+    // An idle wheel catches up with the clock before inserting
+    uint64_t now = wheel_now(impl);
+    if (wheel->timers == 0 && now > wheel->current && !wheel->ticking) {
+        wheel->current = now;
+    }
 
-    napi_handle_scope scope = NULL;
-    napi_status status = napi_open_handle_scope(env, &scope);
-    if (status != napi_ok) return -1;
+    uint64_t expire = now + timeout_ms;
+    if (expire <= wheel->current) {
+        expire = wheel->current + 1;
+    }
+    info->expire = expire;
+    wheel_insert(wheel, info);
+    wheel->timers++;
 
-    // Start the timer
-    int ret = timer_start(impl, entry, timeout_ms, repeat_ms, data, handle);
-    
-    status = napi_close_handle_scope(env, scope);
-    if (status != napi_ok) return -1;
+    if (handle) {
+        handle->timer = (pomelo_platform_timer_t *) info;
+    }
 
-    return ret;
+    wheel_schedule(impl);
+    return 0;
 }
 
 
-/// @brief Stop the timer
-static void timer_stop(
-    pomelo_platform_napi_t * platform,
+void pomelo_platform_napi_timer_stop(
+    pomelo_platform_t * platform,
     pomelo_platform_timer_handle_t * handle
 ) {
     assert(platform != NULL);
     assert(handle != NULL);
 
-    napi_ref timer = (napi_ref) handle->timer;
-    if (timer == NULL) return;
+    pomelo_platform_napi_t * impl = (pomelo_platform_napi_t *) platform;
+    pomelo_platform_timer_info_t * info =
+        (pomelo_platform_timer_info_t *) handle->timer;
+    if (info == NULL) return;
     handle->timer = NULL;
+    info->handle = NULL;
+    impl->timer_wheel->timers--;
 
-    napi_env env = platform->env;
-
-    // Get the timer stop function
-    napi_value timer_stop = NULL;
-    napi_callv(napi_get_reference_value(
-        env, platform->timer_stop, &timer_stop
-    ));
-    if (timer_stop == NULL) return;
-
-    // Get the timer object
-    napi_value timer_object = NULL;
-    napi_callv(napi_get_reference_value(env, timer, &timer_object));
-    if (timer_object == NULL) return;
-
-    // Create null value
-    napi_value null_value = NULL;
-    napi_callv(napi_get_null(env, &null_value));
-
-    // Call the timer stop function
-    napi_value argv[] = { timer_object };
-    napi_callv(napi_call_function(
-        env,
-        null_value,
-        timer_stop,
-        sizeof(argv) / sizeof(argv[0]),
-        argv,
-        NULL
-    ));
-
-    // Unref the reference to the timer
-    napi_callv(napi_reference_unref(env, (napi_ref) timer, NULL));
-}
-
-
-void pomelo_platform_napi_timer_stop(
-    pomelo_platform_t * i,
-    pomelo_platform_timer_handle_t * handle
-) {
-    assert(i != NULL);
-    pomelo_platform_napi_t * platform = (pomelo_platform_napi_t *) i;
-    napi_env env = platform->env;
-
-    napi_handle_scope scope = NULL;
-    napi_status status = napi_open_handle_scope(env, &scope);
-    if (status != napi_ok) return;
+    if (info->firing) {
+        // Released after its entry returns
+        info->stopped = true;
+        return;
+    }
 
-    timer_stop(platform, handle);
-    
-    status = napi_close_handle_scope(env, scope);
-    if (status != napi_ok) return;
+    wheel_unlink(impl->timer_wheel, info);
+    wheel_release(impl, info);
 }
@@ -6,9 +6,30 @@
 extern "C" {
 #endif
 
+/**
+ * Native timers of platform NAPI are kept in a hierarchical timer wheel. The
+ * wheel is driven by a single JS timeout, which is armed for the nearest
+ * expiry, so the platform only crosses into JS once per tick for all the
+ * expired timers. Starting and stopping a timer is O(1).
+ */
+
+/// @brief Number of bits of the slot index of each level
+#define POMELO_TIMER_WHEEL_SLOT_BITS 6
+
+/// @brief Number of slots of each level
+#define POMELO_TIMER_WHEEL_SLOTS (1 << POMELO_TIMER_WHEEL_SLOT_BITS)
+
+/// @brief Number of levels. The resolution of the wheel is 1ms, so that the
+/// levels cover 2^24ms (4.6 hours), longer timers are parked in the last level
+/// until they come into range.
+#define POMELO_TIMER_WHEEL_LEVELS 4
+
 /// @brief The timer info structure
 typedef struct pomelo_platform_timer_info_s pomelo_platform_timer_info_t;
 
+/// @brief The timer wheel structure
+typedef struct pomelo_platform_timer_wheel_s pomelo_platform_timer_wheel_t;
+
 
 struct pomelo_platform_timer_info_s {
     /// @brief The platform
@@ -26,25 +47,80 @@ struct pomelo_platform_timer_info_s {
     /// @brief The timeout ms
     uint64_t timeout_ms;
 
-    /// @brief The timer reference
-    napi_ref timer_ref;
+    /// @brief The expiry of timer, in wheel ticks
+    uint64_t expire;
 
     /// @brief The timer handle
     pomelo_platform_timer_handle_t * handle;
+
+    /// @brief The list which contains this timer, NULL if it is not linked
+    pomelo_platform_timer_info_t ** list;
+
+    /// @brief The previous timer in list
+    pomelo_platform_timer_info_t * prev;
+
+    /// @brief The next timer in list
+    pomelo_platform_timer_info_t * next;
+
+    /// @brief Whether the timer is running its entry
+    bool firing;
+
+    /// @brief Whether the timer has been stopped while firing
+    bool stopped;
 };
 
 
-/// @brief The timer callback
+struct pomelo_platform_timer_wheel_s {
+    /// @brief The slots of all levels
+    pomelo_platform_timer_info_t *
+        slots[POMELO_TIMER_WHEEL_LEVELS][POMELO_TIMER_WHEEL_SLOTS];
+
+    /// @brief Occupancy bitmap of slots of each level
+    uint64_t occupied[POMELO_TIMER_WHEEL_LEVELS];
+
+    /// @brief The timers which are being expired by current tick
+    pomelo_platform_timer_info_t * expired;
+
+    /// @brief The last processed tick in milliseconds
+    uint64_t current;
+
+    /// @brief The origin of ticks, in nanoseconds of hrtime
+    uint64_t origin;
+
+    /// @brief Number of active timers
+    uint64_t timers;
+
+    /// @brief Tick of the armed JS timeout, UINT64_MAX if it is not armed
+    uint64_t scheduled;
+
+    /// @brief Whether the wheel is processing a tick
+    bool ticking;
+
+    /// @brief Number of ticks which crossed into native code
+    uint64_t ticks;
+
+    /// @brief Number of fired timer entries
+    uint64_t fired;
+};
+
+
+/// @brief Initialize the timer wheel of platform
+int pomelo_platform_napi_timer_wheel_init(pomelo_platform_napi_t * platform);
+
+
+/// @brief Finalize the timer wheel of platform
+void pomelo_platform_napi_timer_wheel_finalize(
+    pomelo_platform_napi_t * platform
+);
+
+
+/// @brief The timer wheel tick callback, called by the JS timeout
 napi_value pomelo_platform_timer_callback(
     napi_env env,
     napi_callback_info info
 );
 
 
-/// @brief Finalize and release the timer info
-void pomelo_platform_timer_info_finalize(pomelo_platform_timer_info_t * info);
-
-
 /// @brief Start the timer
 int pomelo_platform_napi_timer_start(
     pomelo_platform_t * platform,
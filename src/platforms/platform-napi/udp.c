@@ -2,10 +2,40 @@
 #include <string.h>
 #include "platform-napi.h"
 #include "udp.h"
+#include "time.h"
+#include "address.h"
 #include "utils.h"
 
 
-#define POMELO_PLATFORM_UDP_RECV_CALLBACK_ARGC 4
+/// @brief Parse the host argument and intern the address
+static int64_t platform_udp_intern_address(
+    napi_env env,
+    pomelo_platform_napi_t * platform,
+    napi_value js_host,
+    uint32_t port
+) {
+    if (!port) return -1;
+
+    char host[POMELO_ADDRESS_STRING_BUFFER_CAPACITY];
+    napi_status status = napi_get_value_string_utf8(
+        env, js_host, host, sizeof(host), NULL
+    );
+    if (status != napi_ok) return -1;
+
+    pomelo_address_t address;
+    int ret = pomelo_address_from_string_ex(&address, host, (uint16_t) port);
+    if (ret < 0) return -1; // Failed to parse the address
+
+    int64_t handle = pomelo_platform_napi_address_intern(platform, &address);
+    if (handle < 0) return -1;
+
+    // The caller caches the host and port of this handle
+    pomelo_platform_napi_address_of(platform, handle)->exposed = true;
+    return handle;
+}
+
+
+#define POMELO_PLATFORM_UDP_RECV_CALLBACK_ARGC 5
 napi_value pomelo_platform_udp_recv_callback(
     napi_env env,
     napi_callback_info info
@@ -13,9 +43,10 @@ napi_value pomelo_platform_udp_recv_callback(
     size_t argc = POMELO_PLATFORM_UDP_RECV_CALLBACK_ARGC;
     napi_value argv[POMELO_PLATFORM_UDP_RECV_CALLBACK_ARGC] = { NULL };
 
-    // Get the callback info
+    // Get the callback info. The host and port are only passed when the JS
+    // side does not know the address handle yet.
     napi_call(napi_get_cb_info(env, info, &argc, argv, NULL, NULL));
-    if (argc != POMELO_PLATFORM_UDP_RECV_CALLBACK_ARGC) return NULL;
+    if (argc < POMELO_PLATFORM_UDP_RECV_CALLBACK_ARGC - 2) return NULL;
 
     // Get the socket object
     pomelo_platform_udp_info_t * socket_info = NULL;
@@ -32,22 +63,34 @@ napi_value pomelo_platform_udp_recv_callback(
     if (!data) return NULL;
 
     // Get the address
-    char host[POMELO_ADDRESS_STRING_BUFFER_CAPACITY];
-    napi_call(napi_get_value_string_utf8(
-        env, argv[2], host, sizeof(host), NULL
-    ));
+    int64_t handle = -1;
+    napi_call(napi_get_value_int64(env, argv[2], &handle));
+    if (handle < 0) {
+        if (argc < POMELO_PLATFORM_UDP_RECV_CALLBACK_ARGC) return NULL;
+        uint32_t port = 0;
+        napi_call(napi_get_value_uint32(env, argv[4], &port));
+        handle = platform_udp_intern_address(
+            env, socket_info->platform, argv[3], port
+        );
+    }
 
-    uint32_t port = 0;
-    napi_call(napi_get_value_uint32(env, argv[3], &port));
-    if (!port) return NULL;
+    pomelo_platform_address_entry_t * entry =
+        pomelo_platform_napi_address_of(socket_info->platform, handle);
+    if (!entry) return NULL;
+
+    // Copy the address, the cache might be reset by the callback
+    pomelo_address_t address = entry->address;
+    pomelo_platform_address_cache_t * cache =
+        socket_info->platform->address_cache;
+    uint32_t generation = cache->generation;
 
-    pomelo_address_t address;
-    int ret = pomelo_address_from_string_ex(&address, host, (uint16_t) port);
-    if (ret < 0) return NULL; // Failed to parse the address
-    
     pomelo_platform_iovec_t iovec = { 0 };
     socket_info->alloc_callback(socket_info->context, &iovec);
-    if (!iovec.data || iovec.length == 0) return NULL;
+    if (!iovec.data || iovec.length == 0) {
+        napi_value result = NULL;
+        napi_call(napi_create_int64(env, handle, &result));
+        return result;
+    }
 
     int status = 0;
     if (length > iovec.length) {
@@ -58,12 +101,140 @@ napi_value pomelo_platform_udp_recv_callback(
     memcpy(iovec.data, data, length);
     iovec.length = length;
 
+    pomelo_platform_napi_clock_enter(socket_info->platform);
     socket_info->recv_callback(
         socket_info->context,
         &address,
         &iovec,
         status
     );
+    pomelo_platform_napi_clock_leave(socket_info->platform);
+
+    // The handle is returned, so that the JS side can cache it. If the cache
+    // has been reset by the callback, the handle is not valid anymore.
+    if (cache->generation != generation) {
+        handle = -1;
+    }
+
+    napi_value result = NULL;
+    napi_call(napi_create_int64(env, handle, &result));
+    return result; // The address handle
+}
+
+
+/// @brief Get the int32 elements of a typed array argument
+static napi_status get_int32_elements(
+    napi_env env,
+    napi_value value,
+    int32_t ** elements,
+    size_t * length
+) {
+    napi_typedarray_type type;
+    napi_status status = napi_get_typedarray_info(
+        env, value, &type, length, (void **) elements, NULL, NULL
+    );
+    if (status != napi_ok) return status;
+    return (type == napi_int32_array) ? napi_ok : napi_invalid_arg;
+}
+
+
+#define POMELO_PLATFORM_UDP_RECV_BATCH_CALLBACK_ARGC 6
+napi_value pomelo_platform_udp_recv_batch_callback(
+    napi_env env,
+    napi_callback_info info
+) {
+    size_t argc = POMELO_PLATFORM_UDP_RECV_BATCH_CALLBACK_ARGC;
+    napi_value argv[POMELO_PLATFORM_UDP_RECV_BATCH_CALLBACK_ARGC] = { NULL };
+
+    // Arguments: (socket, buffers, handles, hosts, ports, count).
+    // Negative handles are interned from hosts and ports, and the new handles
+    // are written back to the handles array.
+    napi_call(napi_get_cb_info(env, info, &argc, argv, NULL, NULL));
+    if (argc != POMELO_PLATFORM_UDP_RECV_BATCH_CALLBACK_ARGC) return NULL;
+
+    // Get the socket object
+    pomelo_platform_udp_info_t * socket_info = NULL;
+    napi_call(napi_unwrap(env, argv[0], (void *) &socket_info));
+    if (!socket_info) return NULL;
+    if (!socket_info->alloc_callback || !socket_info->recv_callback) {
+        return NULL;
+    }
+
+    int32_t * handles = NULL;
+    int32_t * ports = NULL;
+    size_t nhandles = 0;
+    size_t nports = 0;
+    napi_call(get_int32_elements(env, argv[2], &handles, &nhandles));
+    napi_call(get_int32_elements(env, argv[4], &ports, &nports));
+
+    uint32_t count = 0;
+    napi_call(napi_get_value_uint32(env, argv[5], &count));
+    if (count > nhandles) count = (uint32_t) nhandles;
+    if (count > nports) count = (uint32_t) nports;
+
+    pomelo_platform_napi_t * platform = socket_info->platform;
+    pomelo_platform_address_cache_t * cache = platform->address_cache;
+    uint32_t generation = cache->generation;
+
+    // The whole batch is a single dispatch
+    pomelo_platform_napi_clock_enter(platform);
+    for (uint32_t i = 0; i < count; i++) {
+        // The socket might be stopped by the previous datagram
+        if (!socket_info->recv_callback) break;
+
+        napi_value buffer = NULL;
+        void * data = NULL;
+        size_t length = 0;
+        if (napi_get_element(env, argv[1], i, &buffer) != napi_ok) break;
+        if (napi_get_buffer_info(env, buffer, &data, &length) != napi_ok) {
+            break;
+        }
+        if (!data) continue;
+
+        // Handles from JS are invalid once the cache has been reset
+        int64_t handle = handles[i];
+        if (handle < 0 || cache->generation != generation) {
+            napi_value host = NULL;
+            if (napi_get_element(env, argv[3], i, &host) != napi_ok) break;
+            handle = platform_udp_intern_address(
+                env, platform, host, (uint32_t) ports[i]
+            );
+            handles[i] = (int32_t) handle;
+        }
+
+        pomelo_platform_address_entry_t * entry =
+            pomelo_platform_napi_address_of(platform, handle);
+        if (!entry) continue;
+        pomelo_address_t address = entry->address;
+
+        pomelo_platform_iovec_t iovec = { 0 };
+        socket_info->alloc_callback(socket_info->context, &iovec);
+        if (!iovec.data || iovec.length == 0) continue;
+
+        int status = 0;
+        if (length > iovec.length) {
+            length = iovec.length;
+            status = 2; // UV_UDP_PARTIAL
+        }
+
+        memcpy(iovec.data, data, length);
+        iovec.length = length;
+
+        socket_info->recv_callback(
+            socket_info->context,
+            &address,
+            &iovec,
+            status
+        );
+    }
+    pomelo_platform_napi_clock_leave(platform);
+
+    // Do not let the JS side cache handles of an older generation
+    if (cache->generation != generation) {
+        for (uint32_t i = 0; i < count; i++) {
+            handles[i] = -1;
+        }
+    }
 
     napi_value undefined = NULL;
     napi_call(napi_get_undefined(env, &undefined));
@@ -71,42 +242,68 @@ napi_value pomelo_platform_udp_recv_callback(
 }
 
 
-#define POMELO_PLATFORM_UDP_SEND_CALLBACK_ARGC 3
+/// @brief Deliver the send results of a batch.
+/// If statuses is NULL, all datagrams get the same status.
+static void platform_udp_send_batch_complete(
+    pomelo_platform_udp_send_batch_t * batch,
+    const int32_t * statuses,
+    int status
+) {
+    if (batch->completed) return;
+    batch->completed = true;
+
+    for (uint32_t i = 0; i < batch->count; i++) {
+        pomelo_platform_send_cb callback = batch->callbacks[i].callback;
+        if (!callback) continue;
+        callback(batch->callbacks[i].data, statuses ? statuses[i] : status);
+    }
+}
+
+
+/// @brief Finalize the batch external
+static void platform_udp_send_batch_finalize(
+    napi_env env,
+    pomelo_platform_udp_send_batch_t * batch,
+    pomelo_platform_napi_t * platform
+) {
+    (void) env;
+    pomelo_allocator_free(platform->allocator, batch);
+}
+
+
+#define POMELO_PLATFORM_UDP_SEND_CALLBACK_ARGC 2
 napi_value pomelo_platform_udp_send_callback(
     napi_env env,
     napi_callback_info info
 ) {
     size_t argc = POMELO_PLATFORM_UDP_SEND_CALLBACK_ARGC;
     napi_value argv[POMELO_PLATFORM_UDP_SEND_CALLBACK_ARGC] = { NULL };
+    pomelo_platform_napi_t * platform = NULL;
 
-    // Get the callback info
-    napi_call(napi_get_cb_info(env, info, &argc, argv, NULL, NULL));
+    // Arguments: (batch, statuses: Int32Array | null). The statuses are only
+    // passed when some datagrams have failed.
+    napi_call(napi_get_cb_info(
+        env, info, &argc, argv, NULL, (void **) &platform
+    ));
     if (argc != POMELO_PLATFORM_UDP_SEND_CALLBACK_ARGC) return NULL;
 
-    // Get function from external value
+    pomelo_platform_udp_send_batch_t * batch = NULL;
+    napi_call(napi_get_value_external(env, argv[0], (void **) &batch));
+    if (!batch) return NULL;
+
+    int32_t * statuses = NULL;
     napi_valuetype type = napi_undefined;
-    napi_call(napi_typeof(env, argv[0], &type));
-    if (type != napi_external) {
-        napi_value undefined = NULL;
-        napi_call(napi_get_undefined(env, &undefined));
-        return undefined;
+    napi_call(napi_typeof(env, argv[1], &type));
+    if (type == napi_object) {
+        size_t length = 0;
+        napi_call(get_int32_elements(env, argv[1], &statuses, &length));
+        if (length < batch->count) return NULL;
     }
 
-    pomelo_platform_send_cb send_callback = NULL;
-    napi_call(napi_get_value_external(env, argv[0], (void *) &send_callback));
-    if (!send_callback) return NULL;
-    
-    // Get the callback data
-    void * callback_data = NULL;
-    napi_call(napi_get_value_external(env, argv[1], &callback_data));
-
-    // Get the status number
-    int send_status = 0;
-    napi_call(napi_get_value_int32(env, argv[2], &send_status));
-    if (send_status < 0) return NULL;
-    
-    // Call the callback
-    send_callback(callback_data, send_status);
+    // Call the callbacks
+    pomelo_platform_napi_clock_enter(platform);
+    platform_udp_send_batch_complete(batch, statuses, 0);
+    pomelo_platform_napi_clock_leave(platform);
 
     napi_value undefined = NULL;
     napi_call(napi_get_undefined(env, &undefined));
@@ -123,6 +320,21 @@ void pomelo_platform_udp_info_finalize(pomelo_platform_udp_info_t * info) {
         napi_delete_reference(info->platform->env, info->socket_ref);
         info->socket_ref = NULL;
     }
+
+    // Free the send queue, the socket is never finalized while it is queued
+    assert(!info->send_queued);
+    if (info->send_data) {
+        pomelo_allocator_free(info->platform->allocator, info->send_data);
+        info->send_data = NULL;
+    }
+    info->send_data_size = 0;
+    info->send_data_capacity = 0;
+    if (info->send_entries) {
+        pomelo_allocator_free(info->platform->allocator, info->send_entries);
+        info->send_entries = NULL;
+    }
+    info->send_count = 0;
+    info->send_capacity = 0;
 }
 
 
@@ -174,6 +386,12 @@ static napi_ref platform_udp_create(
         env, platform->udp_recv_callback, &recv_callback
     ));
 
+    // Get the batched recv callback function
+    napi_value recv_batch_callback = NULL;
+    napi_call(napi_get_reference_value(
+        env, platform->udp_recv_batch_callback, &recv_batch_callback
+    ));
+
     // Get the send callback function
     napi_value send_callback = NULL;
     napi_call(napi_get_reference_value(
@@ -188,7 +406,9 @@ static napi_ref platform_udp_create(
         &udp_create
     ));
 
-    napi_value argv[] = { host, port, recv_callback, send_callback };
+    napi_value argv[] = {
+        host, port, recv_callback, send_callback, recv_batch_callback
+    };
     napi_value result = NULL;
 
     napi_value null_value = NULL;
@@ -368,6 +588,12 @@ pomelo_platform_udp_t * pomelo_platform_napi_udp_connect(
 }
 
 
+static void platform_udp_flush_send_queue(
+    pomelo_platform_napi_t * platform,
+    pomelo_platform_udp_info_t * info
+);
+
+
 /// @brief Stop the socket
 static int platform_udp_stop(
     pomelo_platform_napi_t * platform,
@@ -392,6 +618,23 @@ static int platform_udp_stop(
     );
     if (status != napi_ok) return -1;
 
+    // Send the queued datagrams (e.g. disconnect packets) while the JS socket
+    // is still open, the deferred flush would find it closed.
+    pomelo_platform_udp_info_t * info = NULL;
+    status = napi_unwrap(platform->env, socket_object, (void *) &info);
+    if (status == napi_ok && info && info->send_queued) {
+        pomelo_platform_udp_info_t ** link = &platform->send_pending;
+        while (*link && *link != info) {
+            link = &(*link)->send_next;
+        }
+        if (*link) *link = info->send_next;
+        info->send_next = NULL;
+        info->send_queued = false;
+
+        platform_udp_flush_send_queue(platform, info);
+        napi_reference_unref(platform->env, info->socket_ref, NULL);
+    }
+
     napi_value null_value = NULL;
     status = napi_get_null(platform->env, &null_value);
     if (status != napi_ok) return -1;
@@ -413,6 +656,12 @@ static int platform_udp_stop(
     if (status != napi_ok) return -1;
 
     if (result_value) {
+        // Stop delivering the pending datagrams of a batch
+        if (info) {
+            info->alloc_callback = NULL;
+            info->recv_callback = NULL;
+        }
+
         // Unref the reference to the socket
         napi_reference_unref(platform->env, (napi_ref) socket, NULL);
     }
@@ -444,43 +693,96 @@ int pomelo_platform_napi_udp_stop(
 }
 
 
-/// @brief Wrap the buffer
-static napi_status wrap_buffer(
-    napi_env env,
-    pomelo_platform_iovec_t * iovec,
-    napi_value * result
+/// @brief Grow the send queue of a socket to fit a datagram
+static int platform_udp_send_queue_reserve(
+    pomelo_platform_napi_t * platform,
+    pomelo_platform_udp_info_t * info,
+    size_t nbytes
 ) {
-    assert(env != NULL);
-    assert(iovec != NULL);
-    assert(result != NULL);
+    pomelo_allocator_t * allocator = platform->allocator;
+
+    if (info->send_count == info->send_capacity) {
+        uint32_t capacity = info->send_capacity
+            ? info->send_capacity * 2
+            : POMELO_PLATFORM_UDP_SEND_QUEUE_INITIAL_ENTRIES;
+        pomelo_platform_udp_send_entry_t * entries = pomelo_allocator_malloc(
+            allocator, sizeof(pomelo_platform_udp_send_entry_t) * capacity
+        );
+        if (!entries) return -1;
+
+        if (info->send_entries) {
+            memcpy(
+                entries,
+                info->send_entries,
+                sizeof(pomelo_platform_udp_send_entry_t) * info->send_count
+            );
+            pomelo_allocator_free(allocator, info->send_entries);
+        }
+        info->send_entries = entries;
+        info->send_capacity = capacity;
+    }
 
-    napi_status status = napi_create_external_buffer(
-        env,
-        iovec->length,
-        iovec->data,
-        NULL,
-        NULL,
-        result
+    size_t required = info->send_data_size + nbytes;
+    if (required > info->send_data_capacity) {
+        size_t capacity = info->send_data_capacity
+            ? info->send_data_capacity
+            : POMELO_PLATFORM_UDP_SEND_QUEUE_INITIAL_BYTES;
+        while (capacity < required) {
+            capacity *= 2;
+        }
+
+        uint8_t * data = pomelo_allocator_malloc(allocator, capacity);
+        if (!data) return -1;
+
+        if (info->send_data) {
+            memcpy(data, info->send_data, info->send_data_size);
+            pomelo_allocator_free(allocator, info->send_data);
+        }
+        info->send_data = data;
+        info->send_data_capacity = capacity;
+    }
+
+    return 0;
+}
+
+
+/// @brief Schedule the send flush on next setImmediate
+static int platform_udp_schedule_send_flush(pomelo_platform_napi_t * platform) {
+    napi_env env = platform->env;
+
+    napi_value global = NULL;
+    napi_status status = napi_get_global(env, &global);
+    if (status != napi_ok) return -1;
+
+    napi_value set_immediate = NULL;
+    status = napi_get_named_property(
+        env, global, "setImmediate", &set_immediate
     );
+    if (status != napi_ok) return -1;
 
-    if (status == napi_ok) {
-        return napi_ok;
-    }
+    napi_value send_flush = NULL;
+    status = napi_get_reference_value(
+        env, platform->udp_send_flush, &send_flush
+    );
+    if (status != napi_ok) return -1;
 
-    if (status == napi_no_external_buffers_allowed) {
-        // External buffer are not allowed in some runtime environments
-        // so we need to copy the buffer to a new buffer
-        void * data = NULL;
-        status = napi_create_buffer(env, iovec->length, &data, result);
-        if (status != napi_ok) return status;
-        memcpy(data, iovec->data, iovec->length);
-    }
+    napi_value argv[] = { send_flush };
+    napi_value result = NULL;
+    status = napi_call_function(
+        env,
+        global,
+        set_immediate,
+        sizeof(argv) / sizeof(argv[0]),
+        argv,
+        &result
+    );
+    if (status != napi_ok) return -1;
 
-    return status;
+    return 0;
 }
 
 
-/// @brief Send a packet to target  
+/// @brief Queue a packet to target
 static int platform_udp_send(
     pomelo_platform_napi_t * platform,
     pomelo_platform_udp_t * socket,
@@ -496,120 +798,66 @@ static int platform_udp_send(
 
     napi_env env = platform->env;
 
-    napi_value udp_send = NULL;
+    // Get the socket info
+    napi_value socket_object = NULL;
     napi_status status =
-        napi_get_reference_value(env, platform->udp_send, &udp_send);
+        napi_get_reference_value(env, (napi_ref) socket, &socket_object);
     if (status != napi_ok) return -1;
 
-    // Get the socket object
-    napi_value socket_object = NULL;
-    status = napi_get_reference_value(env, (napi_ref) socket, &socket_object);
-    if (status != napi_ok) return -1;
+    pomelo_platform_udp_info_t * info = NULL;
+    status = napi_unwrap(env, socket_object, (void *) &info);
+    if (status != napi_ok || !info) return -1;
 
-    // Create the messages array
-    napi_value messages = NULL;
-    status = napi_create_array(env, &messages);
-    if (status != napi_ok) return -1;
+    // Make sure the queue will be flushed
+    if (!platform->send_scheduled) {
+        if (platform_udp_schedule_send_flush(platform) < 0) return -1;
+        platform->send_scheduled = true;
+    }
 
+    size_t nbytes = 0;
     for (int i = 0; i < niovec; i++) {
-        napi_value buffer_object = NULL;
-        status = wrap_buffer(env, &iovec[i], &buffer_object);
-        if (status != napi_ok) return -1;
-        status = napi_set_element(env, messages, i, buffer_object);
-        if (status != napi_ok) return -1;
-    }
-
-    // Create the callback data
-    napi_value callback_data_object = NULL;
-    if (callback_data) {
-        status = napi_create_external(
-            env,
-            callback_data,
-            NULL,
-            NULL,
-            &callback_data_object
-        );
-        if (status != napi_ok) return -1;
-    } else {
-        status = napi_get_null(env, &callback_data_object);
-        if (status != napi_ok) return -1;
-    }
-
-    // Create callback function object
-    napi_value callback_func_object = NULL;
-    if (send_callback) {
-        status = napi_create_external(
-            env,
-            (void *) send_callback,
-            NULL,
-            NULL,
-            &callback_func_object
-        );
-        if (status != napi_ok) return -1;
-    } else {
-        status = napi_get_null(env, &callback_func_object);
-        if (status != napi_ok) return -1;
+        nbytes += iovec[i].length;
+    }
+
+    if (platform_udp_send_queue_reserve(platform, info, nbytes) < 0) {
+        return -1;
     }
-    
-    // Create the host and port
-    napi_value host = NULL;
-    napi_value port = NULL;
 
+    // Append the datagram
+    pomelo_platform_udp_send_entry_t * entry =
+        &info->send_entries[info->send_count++];
+    entry->offset = info->send_data_size;
+    entry->has_address = (address != NULL);
     if (address) {
-        char host_str[POMELO_ADDRESS_STRING_BUFFER_CAPACITY];
-        int ret = pomelo_address_to_ip_string(address, host_str, sizeof(host_str));
-        if (ret < 0) return -1;
-        
-        status = napi_create_string_utf8(
-            env,
-            host_str,
-            NAPI_AUTO_LENGTH,
-            &host
-        );
-        if (status != napi_ok) return -1;
+        entry->address = *address;
+    }
+    entry->callback_data = callback_data;
+    entry->send_callback = send_callback;
 
-        status = napi_create_uint32(
-            env,
-            pomelo_address_port(address),
-            &port
+    for (int i = 0; i < niovec; i++) {
+        memcpy(
+            info->send_data + info->send_data_size,
+            iovec[i].data,
+            iovec[i].length
         );
-        if (status != napi_ok) return -1;
-    } else {
-        status = napi_get_undefined(env, &host);
-        if (status != napi_ok) return -1;
-
-        status = napi_get_undefined(env, &port);
-        if (status != napi_ok) return -1;
+        info->send_data_size += iovec[i].length;
     }
 
-    napi_value null_value = NULL;
-    status = napi_get_null(env, &null_value);
-    if (status != napi_ok) return -1;
-
-    napi_value argv[] = {
-        socket_object,
-        messages,
-        host,
-        port,
-        callback_data_object,
-        callback_func_object
-    }; 
-    napi_value result = NULL;
-    status = napi_call_function(
-        env,
-        null_value,
-        udp_send,
-        sizeof(argv) / sizeof(argv[0]),
-        argv,
-        &result
-    );
-    if (status != napi_ok) return -1;
-
-    bool result_value = false;
-    status = napi_get_value_bool(env, result, &result_value);
-    if (status != napi_ok) return -1;
+    // Keep the socket alive until its queue is flushed
+    if (!info->send_queued) {
+        status = napi_reference_ref(env, info->socket_ref, NULL);
+        if (status != napi_ok) {
+            info->send_count--;
+            info->send_data_size = entry->offset;
+            return -1;
+        }
+
+        info->send_queued = true;
+        info->send_next = platform->send_pending;
+        platform->send_pending = info;
+    }
 
-    return result_value ? 0 : -1;
+    return 0;
 }
 
 
@@ -647,6 +895,289 @@ int pomelo_platform_napi_udp_send(
 }
 
 
+/// @brief Create an Int32Array with specific length
+static napi_status create_int32_array(
+    napi_env env,
+    size_t length,
+    int32_t ** elements,
+    napi_value * result
+) {
+    napi_value buffer = NULL;
+    napi_status status = napi_create_arraybuffer(
+        env, sizeof(int32_t) * length, (void **) elements, &buffer
+    );
+    if (status != napi_ok) return status;
+
+    return napi_create_typedarray(
+        env, napi_int32_array, length, buffer, 0, result
+    );
+}
+
+
+/// @brief Intern the target addresses of the queued datagrams
+static int platform_udp_intern_send_addresses(
+    pomelo_platform_napi_t * platform,
+    pomelo_platform_udp_info_t * info,
+    int32_t * handles
+) {
+    // Interning may reset the cache and invalidate the previous handles of
+    // this batch. The queue fits in a fresh cache, so retrying once is enough.
+    pomelo_platform_address_cache_t * cache = platform->address_cache;
+    for (int attempt = 0; attempt < 2; attempt++) {
+        uint32_t generation = cache->generation;
+        for (uint32_t i = 0; i < info->send_count; i++) {
+            pomelo_platform_udp_send_entry_t * entry = &info->send_entries[i];
+            if (!entry->has_address) {
+                handles[i] = -1;
+                continue;
+            }
+
+            int64_t handle = pomelo_platform_napi_address_intern(
+                platform, &entry->address
+            );
+            if (handle < 0) return -1;
+            handles[i] = (int32_t) handle;
+        }
+
+        if (cache->generation == generation) return 0;
+    }
+
+    return -1;
+}
+
+
+/// @brief Collect the [handle, host, port] triples of addresses which are
+/// unknown to the JS side. The result is undefined if there is none.
+static napi_status platform_udp_collect_new_addresses(
+    napi_env env,
+    pomelo_platform_napi_t * platform,
+    int32_t * handles,
+    uint32_t count,
+    napi_value * result
+) {
+    napi_status status = napi_get_undefined(env, result);
+    if (status != napi_ok) return status;
+
+    uint32_t nvalues = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (handles[i] < 0) continue;
+
+        pomelo_platform_address_entry_t * entry =
+            pomelo_platform_napi_address_of(platform, handles[i]);
+        if (!entry || entry->exposed) continue;
+
+        if (nvalues == 0) {
+            status = napi_create_array(env, result);
+            if (status != napi_ok) return status;
+        }
+
+        char host_str[POMELO_ADDRESS_STRING_BUFFER_CAPACITY];
+        int ret = pomelo_address_to_ip_string(
+            &entry->address, host_str, sizeof(host_str)
+        );
+        if (ret < 0) return napi_generic_failure;
+
+        napi_value handle = NULL;
+        napi_value host = NULL;
+        napi_value port = NULL;
+        status = napi_create_int32(env, handles[i], &handle);
+        if (status != napi_ok) return status;
+        status = napi_create_string_utf8(
+            env, host_str, NAPI_AUTO_LENGTH, &host
+        );
+        if (status != napi_ok) return status;
+        status = napi_create_uint32(
+            env, pomelo_address_port(&entry->address), &port
+        );
+        if (status != napi_ok) return status;
+
+        status = napi_set_element(env, *result, nvalues++, handle);
+        if (status != napi_ok) return status;
+        status = napi_set_element(env, *result, nvalues++, host);
+        if (status != napi_ok) return status;
+        status = napi_set_element(env, *result, nvalues++, port);
+        if (status != napi_ok) return status;
+
+        entry->exposed = true;
+    }
+
+    return napi_ok;
+}
+
+
+/// @brief Pass the queued datagrams of a socket to udpSendBatch
+static int platform_udp_call_send_batch(
+    pomelo_platform_napi_t * platform,
+    pomelo_platform_udp_info_t * info,
+    napi_value js_batch
+) {
+    napi_env env = platform->env;
+    uint32_t count = info->send_count;
+
+    napi_value udp_send_batch = NULL;
+    napi_status status = napi_get_reference_value(
+        env, platform->udp_send_batch, &udp_send_batch
+    );
+    if (status != napi_ok) return -1;
+
+    napi_value socket_object = NULL;
+    status = napi_get_reference_value(env, info->socket_ref, &socket_object);
+    if (status != napi_ok) return -1;
+
+    // All payloads are copied into a single buffer
+    napi_value data = NULL;
+    status = napi_create_buffer_copy(
+        env, info->send_data_size, info->send_data, NULL, &data
+    );
+    if (status != napi_ok) return -1;
+
+    // The payload of datagram i is [offsets[i], offsets[i + 1])
+    int32_t * offsets = NULL;
+    napi_value js_offsets = NULL;
+    status = create_int32_array(env, count + 1, &offsets, &js_offsets);
+    if (status != napi_ok) return -1;
+
+    for (uint32_t i = 0; i < count; i++) {
+        offsets[i] = (int32_t) info->send_entries[i].offset;
+    }
+    offsets[count] = (int32_t) info->send_data_size;
+
+    int32_t * handles = NULL;
+    napi_value js_handles = NULL;
+    status = create_int32_array(env, count, &handles, &js_handles);
+    if (status != napi_ok) return -1;
+
+    if (platform_udp_intern_send_addresses(platform, info, handles) < 0) {
+        return -1;
+    }
+
+    napi_value new_addresses = NULL;
+    status = platform_udp_collect_new_addresses(
+        env, platform, handles, count, &new_addresses
+    );
+    if (status != napi_ok) return -1;
+
+    napi_value null_value = NULL;
+    status = napi_get_null(env, &null_value);
+    if (status != napi_ok) return -1;
+
+    napi_value argv[] = {
+        socket_object,
+        data,
+        js_offsets,
+        js_handles,
+        new_addresses,
+        js_batch
+    };
+    napi_value result = NULL;
+    status = napi_call_function(
+        env,
+        null_value,
+        udp_send_batch,
+        sizeof(argv) / sizeof(argv[0]),
+        argv,
+        &result
+    );
+    if (status != napi_ok) return -1;
+
+    bool result_value = false;
+    status = napi_get_value_bool(env, result, &result_value);
+    if (status != napi_ok) return -1;
+
+    return result_value ? 0 : -1;
+}
+
+
+/// @brief Flush the send queue of a socket
+static void platform_udp_flush_send_queue(
+    pomelo_platform_napi_t * platform,
+    pomelo_platform_udp_info_t * info
+) {
+    uint32_t count = info->send_count;
+    if (count == 0) return;
+
+    // Move the callbacks to the batch
+    pomelo_platform_udp_send_batch_t * batch = pomelo_allocator_malloc(
+        platform->allocator,
+        sizeof(pomelo_platform_udp_send_batch_t) +
+            sizeof(batch->callbacks[0]) * count
+    );
+    if (!batch) {
+        for (uint32_t i = 0; i < count; i++) {
+            pomelo_platform_udp_send_entry_t * entry = &info->send_entries[i];
+            if (entry->send_callback) {
+                entry->send_callback(entry->callback_data, -1);
+            }
+        }
+        info->send_count = 0;
+        info->send_data_size = 0;
+        return;
+    }
+
+    batch->completed = false;
+    batch->count = count;
+    for (uint32_t i = 0; i < count; i++) {
+        batch->callbacks[i].data = info->send_entries[i].callback_data;
+        batch->callbacks[i].callback = info->send_entries[i].send_callback;
+    }
+
+    // The batch is freed when its external is collected
+    napi_value js_batch = NULL;
+    napi_status status = napi_create_external(
+        platform->env,
+        batch,
+        (napi_finalize) platform_udp_send_batch_finalize,
+        platform,
+        &js_batch
+    );
+    int ret = -1;
+    if (status == napi_ok) {
+        ret = platform_udp_call_send_batch(platform, info, js_batch);
+    }
+
+    // Reset the queue before calling the callbacks, they may queue again
+    info->send_count = 0;
+    info->send_data_size = 0;
+
+    if (ret < 0) {
+        platform_udp_send_batch_complete(batch, NULL, -1);
+    }
+
+    if (status != napi_ok) {
+        pomelo_allocator_free(platform->allocator, batch);
+    }
+}
+
+
+napi_value pomelo_platform_udp_send_flush(
+    napi_env env,
+    napi_callback_info info
+) {
+    pomelo_platform_napi_t * platform = NULL;
+    napi_call(napi_get_cb_info(
+        env, info, NULL, NULL, NULL, (void **) &platform
+    ));
+    if (!platform) return NULL;
+    platform->send_scheduled = false;
+
+    pomelo_platform_napi_clock_enter(platform);
+    while (platform->send_pending) {
+        pomelo_platform_udp_info_t * socket_info = platform->send_pending;
+        platform->send_pending = socket_info->send_next;
+        socket_info->send_next = NULL;
+        socket_info->send_queued = false;
+
+        platform_udp_flush_send_queue(platform, socket_info);
+        napi_reference_unref(env, socket_info->socket_ref, NULL);
+    }
+    pomelo_platform_napi_clock_leave(platform);
+
+    napi_value undefined = NULL;
+    napi_call(napi_get_undefined(env, &undefined));
+    return undefined;
+}
+
+
 static void platform_udp_recv_start(
     pomelo_platform_napi_t * platform,
     pomelo_platform_udp_t * socket,
@@ -7,8 +7,53 @@ extern "C" {
 #endif
 
 
-/// @brief The UDP info structure
-typedef struct pomelo_platform_udp_info_s pomelo_platform_udp_info_t;
+/// @brief A queued outgoing datagram
+typedef struct pomelo_platform_udp_send_entry_s
+    pomelo_platform_udp_send_entry_t;
+
+/// @brief A flushed batch of datagrams waiting for the send results
+typedef struct pomelo_platform_udp_send_batch_s
+    pomelo_platform_udp_send_batch_t;
+
+
+/// @brief Initial capacity of the send queue payloads in bytes
+#define POMELO_PLATFORM_UDP_SEND_QUEUE_INITIAL_BYTES 4096
+
+/// @brief Initial capacity of the send queue entries
+#define POMELO_PLATFORM_UDP_SEND_QUEUE_INITIAL_ENTRIES 16
+
+
+struct pomelo_platform_udp_send_entry_s {
+    /// @brief Offset of the payload in the packed data
+    size_t offset;
+
+    /// @brief Whether the datagram has a target address
+    bool has_address;
+
+    /// @brief The target address
+    pomelo_address_t address;
+
+    /// @brief The callback data
+    void * callback_data;
+
+    /// @brief The send callback
+    pomelo_platform_send_cb send_callback;
+};
+
+
+struct pomelo_platform_udp_send_batch_s {
+    /// @brief Whether the send results have been delivered
+    bool completed;
+
+    /// @brief The number of datagrams
+    uint32_t count;
+
+    /// @brief The send callbacks of datagrams
+    struct {
+        void * data;
+        pomelo_platform_send_cb callback;
+    } callbacks[];
+};
 
 
 struct pomelo_platform_udp_info_s {
@@ -26,6 +71,32 @@ struct pomelo_platform_udp_info_s {
 
     /// @brief The recv callback
     pomelo_platform_recv_cb recv_callback;
+
+    /* Send queue */
+
+    /// @brief Packed payloads of the queued datagrams
+    uint8_t * send_data;
+
+    /// @brief Size of the packed payloads
+    size_t send_data_size;
+
+    /// @brief Capacity of the packed payloads
+    size_t send_data_capacity;
+
+    /// @brief The queued datagrams
+    pomelo_platform_udp_send_entry_t * send_entries;
+
+    /// @brief Number of the queued datagrams
+    uint32_t send_count;
+
+    /// @brief Capacity of the queued datagrams
+    uint32_t send_capacity;
+
+    /// @brief Whether this socket is in the pending list of platform
+    bool send_queued;
+
+    /// @brief Next socket in the pending list of platform
+    pomelo_platform_udp_info_t * send_next;
 };
 
 
@@ -36,13 +107,27 @@ napi_value pomelo_platform_udp_recv_callback(
 );
 
 
-/// @brief The UDP send callback
+/// @brief The batched UDP recv callback
+napi_value pomelo_platform_udp_recv_batch_callback(
+    napi_env env,
+    napi_callback_info info
+);
+
+
+/// @brief The UDP send callback, called once per flushed batch
 napi_value pomelo_platform_udp_send_callback(
     napi_env env,
     napi_callback_info info
 );
 
 
+/// @brief Flush the send queues of all sockets, scheduled by setImmediate
+napi_value pomelo_platform_udp_send_flush(
+    napi_env env,
+    napi_callback_info info
+);
+
+
 /// @brief Finalize and release the UDP info
 void pomelo_platform_udp_info_finalize(pomelo_platform_udp_info_t * info);
 
@@ -68,7 +153,8 @@ int pomelo_platform_napi_udp_stop(
 );
 
 
-/// @brief Send a packet to the UDP socket
+/// @brief Queue a packet to the UDP socket. The queued packets are sent on
+/// next setImmediate in a single JS call.
 int pomelo_platform_napi_udp_send(
     pomelo_platform_t * platform,
     pomelo_platform_udp_t * socket,
@@ -0,0 +1,520 @@
+#include <assert.h>
+#include <string.h>
+#include "worker-pool.h"
+#include "worker.h"
+#include "time.h"
+
+
+/// @brief The task is waiting in a deque
+#define WORKER_TASK_QUEUED 0
+
+/// @brief The task has been claimed by a worker
+#define WORKER_TASK_RUNNING 1
+
+/// @brief The task has been canceled before running
+#define WORKER_TASK_CANCELED 2
+
+
+/* -------------------------------------------------------------------------- */
+/*                              Thread primitives                             */
+/* -------------------------------------------------------------------------- */
+
+#ifdef _WIN32
+
+static void worker_mutex_init(pomelo_worker_mutex_t * mutex) {
+    InitializeCriticalSection(mutex);
+}
+
+static void worker_mutex_destroy(pomelo_worker_mutex_t * mutex) {
+    DeleteCriticalSection(mutex);
+}
+
+static void worker_mutex_lock(pomelo_worker_mutex_t * mutex) {
+    EnterCriticalSection(mutex);
+}
+
+static void worker_mutex_unlock(pomelo_worker_mutex_t * mutex) {
+    LeaveCriticalSection(mutex);
+}
+
+static void worker_cond_init(pomelo_worker_cond_t * cond) {
+    InitializeConditionVariable(cond);
+}
+
+static void worker_cond_destroy(pomelo_worker_cond_t * cond) {
+    (void) cond;
+}
+
+static void worker_cond_wait(
+    pomelo_worker_cond_t * cond,
+    pomelo_worker_mutex_t * mutex
+) {
+    SleepConditionVariableCS(cond, mutex, INFINITE);
+}
+
+static void worker_cond_signal(pomelo_worker_cond_t * cond) {
+    WakeConditionVariable(cond);
+}
+
+static void worker_cond_broadcast(pomelo_worker_cond_t * cond) {
+    WakeAllConditionVariable(cond);
+}
+
+static DWORD WINAPI worker_thread_entry(LPVOID arg);
+
+static bool worker_thread_start(pomelo_platform_napi_worker_t * worker) {
+    worker->thread =
+        CreateThread(NULL, 0, worker_thread_entry, worker, 0, NULL);
+    return worker->thread != NULL;
+}
+
+static void worker_thread_join(pomelo_platform_napi_worker_t * worker) {
+    WaitForSingleObject(worker->thread, INFINITE);
+    CloseHandle(worker->thread);
+}
+
+#else
+
+static void worker_mutex_init(pomelo_worker_mutex_t * mutex) {
+    pthread_mutex_init(mutex, NULL);
+}
+
+static void worker_mutex_destroy(pomelo_worker_mutex_t * mutex) {
+    pthread_mutex_destroy(mutex);
+}
+
+static void worker_mutex_lock(pomelo_worker_mutex_t * mutex) {
+    pthread_mutex_lock(mutex);
+}
+
+static void worker_mutex_unlock(pomelo_worker_mutex_t * mutex) {
+    pthread_mutex_unlock(mutex);
+}
+
+static void worker_cond_init(pomelo_worker_cond_t * cond) {
+    pthread_cond_init(cond, NULL);
+}
+
+static void worker_cond_destroy(pomelo_worker_cond_t * cond) {
+    pthread_cond_destroy(cond);
+}
+
+static void worker_cond_wait(
+    pomelo_worker_cond_t * cond,
+    pomelo_worker_mutex_t * mutex
+) {
+    pthread_cond_wait(cond, mutex);
+}
+
+static void worker_cond_signal(pomelo_worker_cond_t * cond) {
+    pthread_cond_signal(cond);
+}
+
+static void worker_cond_broadcast(pomelo_worker_cond_t * cond) {
+    pthread_cond_broadcast(cond);
+}
+
+static void * worker_thread_entry(void * arg);
+
+static bool worker_thread_start(pomelo_platform_napi_worker_t * worker) {
+    return pthread_create(
+        &worker->thread, NULL, worker_thread_entry, worker
+    ) == 0;
+}
+
+static void worker_thread_join(pomelo_platform_napi_worker_t * worker) {
+    pthread_join(worker->thread, NULL);
+}
+
+#endif
+
+
+/* -------------------------------------------------------------------------- */
+/*                                   Deques                                   */
+/* -------------------------------------------------------------------------- */
+
+/// @brief Append a task to the back of deque
+static void worker_push_back(
+    pomelo_platform_napi_worker_t * worker,
+    pomelo_platform_task_worker_t * task
+) {
+    worker_mutex_lock(&worker->mutex);
+    task->next = NULL;
+    task->prev = worker->back;
+    if (worker->back) {
+        worker->back->next = task;
+    } else {
+        worker->front = task;
+    }
+    worker->back = task;
+    worker_mutex_unlock(&worker->mutex);
+}
+
+
+/// @brief Pop the front of deque, used by the owner
+static pomelo_platform_task_worker_t * worker_pop_front(
+    pomelo_platform_napi_worker_t * worker
+) {
+    worker_mutex_lock(&worker->mutex);
+    pomelo_platform_task_worker_t * task = worker->front;
+    if (task) {
+        worker->front = task->next;
+        if (worker->front) {
+            worker->front->prev = NULL;
+        } else {
+            worker->back = NULL;
+        }
+    }
+    worker_mutex_unlock(&worker->mutex);
+    return task;
+}
+
+
+/// @brief Pop the back of deque, used by thieves. Thieves take the other end
+/// so that they rarely contend with the owner.
+static pomelo_platform_task_worker_t * worker_pop_back(
+    pomelo_platform_napi_worker_t * worker
+) {
+    worker_mutex_lock(&worker->mutex);
+    pomelo_platform_task_worker_t * task = worker->back;
+    if (task) {
+        worker->back = task->prev;
+        if (worker->back) {
+            worker->back->next = NULL;
+        } else {
+            worker->front = NULL;
+        }
+    }
+    worker_mutex_unlock(&worker->mutex);
+    return task;
+}
+
+
+/// @brief Take a task from the own deque, or steal one from another worker
+static pomelo_platform_task_worker_t * worker_take(
+    pomelo_platform_napi_worker_t * worker
+) {
+    pomelo_platform_napi_worker_pool_t * pool = worker->pool;
+    pomelo_platform_task_worker_t * task = worker_pop_front(worker);
+    if (task) return task;
+
+    for (size_t i = 1; i < pool->worker_count; i++) {
+        size_t index = (worker->index + i) % pool->worker_count;
+        task = worker_pop_back(&pool->workers[index]);
+        if (task) {
+            pomelo_atomic_uint64_fetch_add(&pool->stolen_tasks, 1);
+            return task;
+        }
+    }
+
+    return NULL;
+}
+
+
+/* -------------------------------------------------------------------------- */
+/*                                 Completion                                 */
+/* -------------------------------------------------------------------------- */
+
+/// @brief Push a finished task to the completed list
+static void worker_complete(
+    pomelo_platform_napi_worker_pool_t * pool,
+    pomelo_platform_task_worker_t * task
+) {
+    uint64_t head = 0;
+    do {
+        head = pomelo_atomic_uint64_load(&pool->completed);
+        task->next = (pomelo_platform_task_worker_t *) (uintptr_t) head;
+    } while (!pomelo_atomic_uint64_compare_exchange(
+        &pool->completed, head, (uint64_t) (uintptr_t) task
+    ));
+
+    // Only the task which starts the list wakes the JS thread up
+    if (head == 0) {
+        napi_call_threadsafe_function(
+            pool->completion, pool, napi_tsfn_nonblocking
+        );
+    }
+}
+
+
+/// @brief Call the complete functions of all completed tasks
+static void worker_completion_entry(
+    napi_env env,
+    napi_value js_callback,
+    void * context,
+    pomelo_platform_napi_worker_pool_t * pool
+) {
+    (void) js_callback;
+    (void) context;
+    if (env == NULL) return; // The pool is being destroyed
+
+    // Take the whole list
+    uint64_t head = pomelo_atomic_uint64_load(&pool->completed);
+    while (head != 0 && !pomelo_atomic_uint64_compare_exchange(
+        &pool->completed, head, 0
+    )) {
+        head = pomelo_atomic_uint64_load(&pool->completed);
+    }
+    if (head == 0) return;
+
+    pomelo_platform_task_worker_t * task =
+        (pomelo_platform_task_worker_t *) (uintptr_t) head;
+
+    // The list is newest first, reverse it to complete in order
+    pomelo_platform_task_worker_t * ordered = NULL;
+    uint64_t batch = 0;
+    while (task) {
+        pomelo_platform_task_worker_t * next = task->next;
+        task->next = ordered;
+        ordered = task;
+        task = next;
+        batch++;
+    }
+
+    pool->completion_drains++;
+    pool->completed_tasks += batch;
+    if (batch > pool->completion_max_batch) {
+        pool->completion_max_batch = batch;
+    }
+
+    pomelo_platform_napi_t * platform = pool->platform;
+    pomelo_platform_napi_clock_enter(platform);
+    while (ordered) {
+        task = ordered;
+        ordered = task->next;
+        pool->outstanding--;
+
+        if (task->complete) {
+            task->complete(task->data, task->canceled);
+        }
+        pomelo_pool_release(platform->task_worker_pool, task);
+    }
+    pomelo_platform_napi_clock_leave(platform);
+
+    if (pool->outstanding == 0) {
+        napi_unref_threadsafe_function(env, pool->completion);
+    }
+}
+
+
+/// @brief Free the pool after the completion function has been finalized
+static void worker_completion_finalize(
+    napi_env env,
+    pomelo_platform_napi_worker_pool_t * pool,
+    void * hint
+) {
+    (void) env;
+    (void) hint;
+    pomelo_allocator_free(pool->allocator, pool);
+}
+
+
+/* -------------------------------------------------------------------------- */
+/*                                  Workers                                   */
+/* -------------------------------------------------------------------------- */
+
+/// @brief Run the tasks of a worker until the pool stops
+static void worker_run(pomelo_platform_napi_worker_t * worker) {
+    pomelo_platform_napi_worker_pool_t * pool = worker->pool;
+
+    while (true) {
+        // Claim one of the queued tasks
+        worker_mutex_lock(&pool->mutex);
+        while (pool->queued == 0 && !pool->stopping) {
+            worker_cond_wait(&pool->cond, &pool->mutex);
+        }
+        if (pool->stopping) {
+            worker_mutex_unlock(&pool->mutex);
+            return;
+        }
+        pool->queued--;
+        worker_mutex_unlock(&pool->mutex);
+
+        // The claimed task is in one of the deques
+        pomelo_platform_task_worker_t * task = NULL;
+        while ((task = worker_take(worker)) == NULL);
+
+        if (pomelo_atomic_int64_compare_exchange(
+            &task->state, WORKER_TASK_QUEUED, WORKER_TASK_RUNNING
+        )) {
+            task->entry(task->data);
+        }
+
+        worker_complete(pool, task);
+    }
+}
+
+
+#ifdef _WIN32
+static DWORD WINAPI worker_thread_entry(LPVOID arg) {
+    worker_run((pomelo_platform_napi_worker_t *) arg);
+    return 0;
+}
+#else
+static void * worker_thread_entry(void * arg) {
+    worker_run((pomelo_platform_napi_worker_t *) arg);
+    return NULL;
+}
+#endif
+
+
+/// @brief Stop and join the started threads
+static void worker_pool_stop(pomelo_platform_napi_worker_pool_t * pool) {
+    worker_mutex_lock(&pool->mutex);
+    pool->stopping = true;
+    worker_cond_broadcast(&pool->cond);
+    worker_mutex_unlock(&pool->mutex);
+
+    for (size_t i = 0; i < pool->worker_count; i++) {
+        pomelo_platform_napi_worker_t * worker = &pool->workers[i];
+        if (worker->started) {
+            worker_thread_join(worker);
+            worker->started = false;
+        }
+        worker_mutex_destroy(&worker->mutex);
+    }
+
+    worker_cond_destroy(&pool->cond);
+    worker_mutex_destroy(&pool->mutex);
+    pomelo_allocator_free(pool->allocator, pool->workers);
+    pool->workers = NULL;
+}
+
+
+pomelo_platform_napi_worker_pool_t * pomelo_platform_napi_worker_pool_create(
+    pomelo_platform_napi_t * platform,
+    size_t thread_count
+) {
+    assert(platform != NULL);
+    if (thread_count == 0) return NULL;
+    if (thread_count > POMELO_PLATFORM_NAPI_WORKER_POOL_MAX_THREADS) {
+        thread_count = POMELO_PLATFORM_NAPI_WORKER_POOL_MAX_THREADS;
+    }
+
+    pomelo_allocator_t * allocator = platform->allocator;
+    pomelo_platform_napi_worker_pool_t * pool = pomelo_allocator_malloc(
+        allocator, sizeof(pomelo_platform_napi_worker_pool_t)
+    );
+    if (pool == NULL) return NULL;
+    memset(pool, 0, sizeof(pomelo_platform_napi_worker_pool_t));
+    pool->platform = platform;
+    pool->allocator = allocator;
+    pomelo_atomic_uint64_store(&pool->completed, 0);
+    pomelo_atomic_uint64_store(&pool->stolen_tasks, 0);
+
+    pool->workers = pomelo_allocator_malloc(
+        allocator, sizeof(pomelo_platform_napi_worker_t) * thread_count
+    );
+    if (pool->workers == NULL) {
+        pomelo_allocator_free(allocator, pool);
+        return NULL;
+    }
+    memset(
+        pool->workers, 0, sizeof(pomelo_platform_napi_worker_t) * thread_count
+    );
+    pool->worker_count = thread_count;
+
+    // The completion function is only referenced while tasks are running
+    napi_value name = NULL;
+    napi_status status = napi_create_string_utf8(
+        platform->env, "pomelo-worker-pool", NAPI_AUTO_LENGTH, &name
+    );
+    if (status == napi_ok) {
+        status = napi_create_threadsafe_function(
+            platform->env,
+            NULL,
+            NULL,
+            name,
+            0,
+            1,
+            pool,
+            (napi_finalize) worker_completion_finalize,
+            NULL,
+            (napi_threadsafe_function_call_js) worker_completion_entry,
+            &pool->completion
+        );
+    }
+    if (status != napi_ok) {
+        pomelo_allocator_free(allocator, pool->workers);
+        pomelo_allocator_free(allocator, pool);
+        return NULL;
+    }
+    napi_unref_threadsafe_function(platform->env, pool->completion);
+
+    worker_mutex_init(&pool->mutex);
+    worker_cond_init(&pool->cond);
+    for (size_t i = 0; i < thread_count; i++) {
+        pomelo_platform_napi_worker_t * worker = &pool->workers[i];
+        worker->pool = pool;
+        worker->index = i;
+        worker_mutex_init(&worker->mutex);
+    }
+
+    for (size_t i = 0; i < thread_count; i++) {
+        pomelo_platform_napi_worker_t * worker = &pool->workers[i];
+        worker->started = worker_thread_start(worker);
+        if (!worker->started) {
+            pomelo_platform_napi_worker_pool_destroy(pool);
+            return NULL;
+        }
+    }
+
+    return pool;
+}
+
+
+void pomelo_platform_napi_worker_pool_destroy(
+    pomelo_platform_napi_worker_pool_t * pool
+) {
+    assert(pool != NULL);
+    worker_pool_stop(pool);
+
+    // The pool is freed by the finalizer of completion function
+    napi_release_threadsafe_function(pool->completion, napi_tsfn_abort);
+}
+
+
+int pomelo_platform_napi_worker_pool_submit(
+    pomelo_platform_napi_worker_pool_t * pool,
+    pomelo_platform_task_worker_t * task
+) {
+    assert(pool != NULL);
+    assert(task != NULL);
+
+    if (pool->outstanding == 0) {
+        napi_status status = napi_ref_threadsafe_function(
+            pool->platform->env, pool->completion
+        );
+        if (status != napi_ok) return -1;
+    }
+    pool->outstanding++;
+
+    pomelo_atomic_int64_store(&task->state, WORKER_TASK_QUEUED);
+    pomelo_platform_napi_worker_t * worker =
+        &pool->workers[pool->next_worker];
+    pool->next_worker = (pool->next_worker + 1) % pool->worker_count;
+    worker_push_back(worker, task);
+
+    worker_mutex_lock(&pool->mutex);
+    pool->queued++;
+    worker_cond_signal(&pool->cond);
+    worker_mutex_unlock(&pool->mutex);
+
+    return 0;
+}
+
+
+void pomelo_platform_napi_worker_pool_cancel(
+    pomelo_platform_napi_worker_pool_t * pool,
+    pomelo_platform_task_worker_t * task
+) {
+    assert(pool != NULL);
+    assert(task != NULL);
+    (void) pool;
+
+    // A running task finishes, but it is still reported as canceled
+    task->canceled = true;
+    pomelo_atomic_int64_compare_exchange(
+        &task->state, WORKER_TASK_QUEUED, WORKER_TASK_CANCELED
+    );
+}
@@ -0,0 +1,157 @@
+#ifndef POMELO_PLATFORM_NAPI_WORKER_POOL_H
+#define POMELO_PLATFORM_NAPI_WORKER_POOL_H
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+#include "node_api.h"
+#include "platform-napi.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Dedicated worker threads of platform NAPI. Worker tasks do not go through
+ * the shared libuv threadpool, so they do not queue behind fs/DNS requests.
+ *
+ * Every worker owns a deque. Tasks are spread over the deques round-robin,
+ * a worker pops the front of its own deque and steals the back of the other
+ * deques when it runs out of tasks. Completed tasks are pushed to a lock-free
+ * list, which is drained on the JS thread by a single threadsafe function
+ * call per batch.
+ */
+
+/// @brief Maximum number of worker threads
+#define POMELO_PLATFORM_NAPI_WORKER_POOL_MAX_THREADS 64
+
+
+#ifdef _WIN32
+typedef HANDLE pomelo_worker_thread_t;
+typedef CRITICAL_SECTION pomelo_worker_mutex_t;
+typedef CONDITION_VARIABLE pomelo_worker_cond_t;
+#else
+typedef pthread_t pomelo_worker_thread_t;
+typedef pthread_mutex_t pomelo_worker_mutex_t;
+typedef pthread_cond_t pomelo_worker_cond_t;
+#endif
+
+
+/// @brief A worker thread of the pool
+typedef struct pomelo_platform_napi_worker_s pomelo_platform_napi_worker_t;
+
+/// @brief The worker task (see worker.h)
+typedef struct pomelo_platform_task_worker_s pomelo_platform_task_worker_t;
+
+
+struct pomelo_platform_napi_worker_s {
+    /// @brief The pool
+    pomelo_platform_napi_worker_pool_t * pool;
+
+    /// @brief Index of this worker
+    size_t index;
+
+    /// @brief The thread
+    pomelo_worker_thread_t thread;
+
+    /// @brief Whether the thread has been started
+    bool started;
+
+    /// @brief The mutex of deque
+    pomelo_worker_mutex_t mutex;
+
+    /// @brief Front of deque
+    pomelo_platform_task_worker_t * front;
+
+    /// @brief Back of deque
+    pomelo_platform_task_worker_t * back;
+};
+
+
+struct pomelo_platform_napi_worker_pool_s {
+    /// @brief The platform
+    pomelo_platform_napi_t * platform;
+
+    /// @brief The allocator
+    pomelo_allocator_t * allocator;
+
+    /// @brief The workers
+    pomelo_platform_napi_worker_t * workers;
+
+    /// @brief Number of workers
+    size_t worker_count;
+
+    /// @brief Index of the worker which receives the next task
+    size_t next_worker;
+
+    /// @brief The mutex of sleeping workers
+    pomelo_worker_mutex_t mutex;
+
+    /// @brief The condition of sleeping workers
+    pomelo_worker_cond_t cond;
+
+    /// @brief Number of queued tasks which have not been claimed by a worker
+    size_t queued;
+
+    /// @brief Whether the workers are stopping
+    bool stopping;
+
+    /// @brief Threadsafe function which drains the completed tasks
+    napi_threadsafe_function completion;
+
+    /// @brief Lock-free list of completed tasks, newest first. The head
+    /// pointer is stored as an atomic integer.
+    pomelo_atomic_uint64_t completed;
+
+    /// @brief Number of submitted tasks whose completion has not been called.
+    /// The completion function keeps the loop alive while it is not zero.
+    size_t outstanding;
+
+    /// @brief Number of tasks stolen from the deque of another worker
+    pomelo_atomic_uint64_t stolen_tasks;
+
+    /// @brief Number of completion drains
+    uint64_t completion_drains;
+
+    /// @brief Number of completed tasks
+    uint64_t completed_tasks;
+
+    /// @brief Largest number of tasks completed by a single drain
+    uint64_t completion_max_batch;
+};
+
+
+/// @brief Create the worker pool and start its threads
+pomelo_platform_napi_worker_pool_t * pomelo_platform_napi_worker_pool_create(
+    pomelo_platform_napi_t * platform,
+    size_t thread_count
+);
+
+
+/// @brief Stop the threads and destroy the worker pool. Tasks which have not
+/// completed are dropped.
+void pomelo_platform_napi_worker_pool_destroy(
+    pomelo_platform_napi_worker_pool_t * pool
+);
+
+
+/// @brief Submit a task to the worker pool
+int pomelo_platform_napi_worker_pool_submit(
+    pomelo_platform_napi_worker_pool_t * pool,
+    pomelo_platform_task_worker_t * task
+);
+
+
+/// @brief Cancel a task of the worker pool. The task does not run if it has
+/// not been started, its complete function is still called with the canceled
+/// flag.
+void pomelo_platform_napi_worker_pool_cancel(
+    pomelo_platform_napi_worker_pool_t * pool,
+    pomelo_platform_task_worker_t * task
+);
+
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+#endif // POMELO_PLATFORM_NAPI_WORKER_POOL_H
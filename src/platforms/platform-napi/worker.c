@@ -1,6 +1,8 @@
 #include <assert.h>
 #include "platform-napi.h"
 #include "worker.h"
+#include "worker-pool.h"
+#include "time.h"
 
 
 /// @brief Async work callback
@@ -24,7 +26,9 @@ static void async_work_complete(
 
     if (task_worker->complete) {
         bool canceled = task_worker->canceled || (status == napi_cancelled);
+        pomelo_platform_napi_clock_enter(task_worker->platform);
         task_worker->complete(task_worker->data, canceled);
+        pomelo_platform_napi_clock_leave(task_worker->platform);
     }
     
     napi_delete_async_work(env, task_worker->async_work);
@@ -52,6 +56,19 @@ pomelo_platform_task_t * pomelo_platform_napi_submit_worker_task(
     task_worker->entry = entry;
     task_worker->complete = complete;
     task_worker->data = data;
+    task_worker->canceled = false;
+    task_worker->async_work = NULL;
+
+    // Run the task on the dedicated worker pool if there is one
+    if (impl->worker_pool) {
+        if (pomelo_platform_napi_worker_pool_submit(
+            impl->worker_pool, task_worker
+        ) < 0) {
+            pomelo_pool_release(impl->task_worker_pool, task_worker);
+            return NULL;
+        }
+        return (pomelo_platform_task_t *) task_worker;
+    }
 
     napi_env env = impl->env;
     // Create async work
@@ -104,6 +121,11 @@ void pomelo_platform_napi_cancel_worker_task(
     pomelo_platform_task_worker_t * task_worker =
         (pomelo_platform_task_worker_t *) task;
 
+    if (impl->worker_pool) {
+        pomelo_platform_napi_worker_pool_cancel(impl->worker_pool, task_worker);
+        return;
+    }
+
     task_worker->canceled = true;
     napi_cancel_async_work(impl->env, task_worker->async_work);
 }
@@ -24,11 +24,20 @@ struct pomelo_platform_task_worker_s {
     /// @brief The data
     void * data;
 
-    /// @brief The async work
+    /// @brief The async work, NULL if the task runs on the worker pool
     napi_async_work async_work;
 
     /// @brief The canceled flag
     bool canceled;
+
+    /// @brief State of the task on the worker pool
+    pomelo_atomic_int64_t state;
+
+    /// @brief The previous task in the deque of worker
+    pomelo_platform_task_worker_t * prev;
+
+    /// @brief The next task in the deque of worker, or in the completed list
+    pomelo_platform_task_worker_t * next;
 };
 
 
@@ -0,0 +1,206 @@
+#include <assert.h>
+#include <string.h>
+#include "pool.h"
+
+
+/// @brief The size of element header, elements are kept 16-byte aligned
+#define POOL_HEADER_SIZE \
+    ((sizeof(pomelo_node_pool_element_t) + 15) & ~((size_t) 15))
+
+/// @brief Get the element of header
+#define pool_element_of(header) ((void *) (((uint8_t *) (header)) + \
+    POOL_HEADER_SIZE))
+
+/// @brief Get the header of element
+#define pool_header_of(element) ((pomelo_node_pool_element_t *) \
+    (((uint8_t *) (element)) - POOL_HEADER_SIZE))
+
+
+/// @brief Allocate new element and link it to the list of all elements
+static pomelo_node_pool_element_t * pool_allocate(pomelo_node_pool_t * pool) {
+    pomelo_node_pool_element_t * header = pomelo_allocator_malloc(
+        pool->allocator, POOL_HEADER_SIZE + pool->element_size
+    );
+    if (!header) return NULL;
+
+    header->prev = NULL;
+    header->next = pool->elements;
+    header->next_available = NULL;
+    if (pool->elements) {
+        pool->elements->prev = header;
+    }
+    pool->elements = header;
+    return header;
+}
+
+
+/// @brief Unlink an element from the list of all elements and free it
+static void pool_free(
+    pomelo_node_pool_t * pool,
+    pomelo_node_pool_element_t * header
+) {
+    if (header->prev) {
+        header->prev->next = header->next;
+    } else {
+        pool->elements = header->next;
+    }
+    if (header->next) {
+        header->next->prev = header->prev;
+    }
+    pomelo_allocator_free(pool->allocator, header);
+}
+
+
+/// @brief Trim the available elements which were not needed to serve the peak
+/// usage of the last window
+static void pool_shrink(pomelo_node_pool_t * pool) {
+    pomelo_node_pool_statistic_t * statistic = &pool->statistic;
+    uint64_t needed = pool->window_peak;
+    if (needed < pool->floor) {
+        needed = pool->floor;
+    }
+
+    uint64_t total = statistic->in_use + statistic->available;
+    if (total > needed) {
+        uint64_t excess = total - needed;
+        if (excess > statistic->available) {
+            excess = statistic->available;
+        }
+
+        // Trim half of the excess, so that the pool shrinks gradually
+        uint64_t trim = (excess + 1) / 2;
+        while (trim > 0 && pool->available) {
+            pomelo_node_pool_element_t * header = pool->available;
+            pool->available = header->next_available;
+            pool_free(pool, header);
+            statistic->available--;
+            statistic->freed++;
+            trim--;
+        }
+    }
+
+    pool->window_peak = statistic->in_use;
+    pool->window_releases = 0;
+}
+
+
+pomelo_node_pool_t * pomelo_node_pool_create(
+    pomelo_node_pool_options_t * options
+) {
+    assert(options != NULL);
+    if (!options->allocator || options->element_size == 0) {
+        return NULL; // Invalid options
+    }
+
+    pomelo_node_pool_t * pool =
+        pomelo_allocator_malloc_t(options->allocator, pomelo_node_pool_t);
+    if (!pool) return NULL;
+
+    memset(pool, 0, sizeof(pomelo_node_pool_t));
+    pool->allocator = options->allocator;
+    pool->element_size = options->element_size;
+    pool->available_max = options->available_max;
+    pool->floor = options->prewarm;
+    pool->on_init = options->on_init;
+    pool->on_cleanup = options->on_cleanup;
+    if (pool->available_max < options->prewarm) {
+        pool->available_max = options->prewarm;
+    }
+
+    // Preallocate the available elements
+    for (size_t i = 0; i < options->prewarm; i++) {
+        pomelo_node_pool_element_t * header = pool_allocate(pool);
+        if (!header) {
+            pomelo_node_pool_destroy(pool);
+            return NULL;
+        }
+        header->next_available = pool->available;
+        pool->available = header;
+        pool->statistic.available++;
+    }
+
+    return pool;
+}
+
+
+void pomelo_node_pool_destroy(pomelo_node_pool_t * pool) {
+    assert(pool != NULL);
+
+    // Elements which are still in use are freed without cleanup
+    pomelo_node_pool_element_t * header = pool->elements;
+    while (header) {
+        pomelo_node_pool_element_t * next = header->next;
+        pomelo_allocator_free(pool->allocator, header);
+        header = next;
+    }
+
+    pomelo_allocator_free(pool->allocator, pool);
+}
+
+
+void * pomelo_node_pool_acquire(pomelo_node_pool_t * pool, void * data) {
+    assert(pool != NULL);
+    pomelo_node_pool_statistic_t * statistic = &pool->statistic;
+
+    pomelo_node_pool_element_t * header = pool->available;
+    if (header) {
+        pool->available = header->next_available;
+        header->next_available = NULL;
+        statistic->available--;
+    } else {
+        header = pool_allocate(pool);
+        if (!header) return NULL;
+        statistic->misses++;
+    }
+
+    void * element = pool_element_of(header);
+    memset(element, 0, pool->element_size);
+    if (pool->on_init && pool->on_init(element, data) < 0) {
+        // Failed to initialize, keep the element available
+        header->next_available = pool->available;
+        pool->available = header;
+        statistic->available++;
+        return NULL;
+    }
+
+    statistic->acquired++;
+    statistic->in_use++;
+    if (statistic->in_use > statistic->peak_in_use) {
+        statistic->peak_in_use = statistic->in_use;
+    }
+    if (statistic->in_use > pool->window_peak) {
+        pool->window_peak = statistic->in_use;
+    }
+
+    return element;
+}
+
+
+void pomelo_node_pool_release(pomelo_node_pool_t * pool, void * element) {
+    assert(pool != NULL);
+    if (!element) return;
+    pomelo_node_pool_statistic_t * statistic = &pool->statistic;
+
+    if (pool->on_cleanup) {
+        pool->on_cleanup(element);
+    }
+
+    assert(statistic->in_use > 0);
+    statistic->released++;
+    statistic->in_use--;
+
+    pomelo_node_pool_element_t * header = pool_header_of(element);
+    if (statistic->available < pool->available_max) {
+        header->next_available = pool->available;
+        pool->available = header;
+        statistic->available++;
+    } else {
+        pool_free(pool, header);
+        statistic->freed++;
+    }
+
+    pool->window_releases++;
+    if (pool->window_releases >= POMELO_NODE_POOL_SHRINK_INTERVAL) {
+        pool_shrink(pool);
+    }
+}
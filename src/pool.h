@@ -0,0 +1,161 @@
+#ifndef POMELO_NODE_POOL_SRC_H
+#define POMELO_NODE_POOL_SRC_H
+#include "module.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Pool of binding objects (sockets, sessions, messages and channels).
+ *
+ * Released elements are kept in a LIFO free list so that the most recently
+ * used, cache-hot element is handed out first. The pool can be prewarmed at
+ * startup, so that a burst of connections does not hit the allocator. The
+ * prewarm covers the native structs only, JS wrappers are created when the
+ * elements are acquired. The
+ * free list shrinks adaptively: every POMELO_NODE_POOL_SHRINK_INTERVAL
+ * releases, the elements which would not have been needed to serve the peak
+ * usage of the last window are trimmed by half, down to the prewarmed floor.
+ */
+
+/// @brief Number of releases between two shrink checks
+#define POMELO_NODE_POOL_SHRINK_INTERVAL 1024
+
+
+/// @brief The binding pool
+typedef struct pomelo_node_pool_s pomelo_node_pool_t;
+
+/// @brief The binding pool options
+typedef struct pomelo_node_pool_options_s pomelo_node_pool_options_t;
+
+/// @brief The header of pool elements
+typedef struct pomelo_node_pool_element_s pomelo_node_pool_element_t;
+
+/// @brief The statistic of binding pool
+typedef struct pomelo_node_pool_statistic_s pomelo_node_pool_statistic_t;
+
+/// @brief Initialize an acquired element
+typedef int (*pomelo_node_pool_init_cb)(void * element, void * data);
+
+/// @brief Cleanup a released element
+typedef void (*pomelo_node_pool_cleanup_cb)(void * element);
+
+
+struct pomelo_node_pool_options_s {
+    /// @brief The allocator
+    pomelo_allocator_t * allocator;
+
+    /// @brief The size of element
+    size_t element_size;
+
+    /// @brief Maximum number of available elements
+    size_t available_max;
+
+    /// @brief Number of elements which are preallocated at creation. They are
+    /// also the floor of the adaptive shrinking.
+    size_t prewarm;
+
+    /// @brief Init callback, called with zeroed element when it is acquired
+    pomelo_node_pool_init_cb on_init;
+
+    /// @brief Cleanup callback, called when element is released
+    pomelo_node_pool_cleanup_cb on_cleanup;
+};
+
+
+struct pomelo_node_pool_element_s {
+    /// @brief The previous element in the list of all elements
+    pomelo_node_pool_element_t * prev;
+
+    /// @brief The next element in the list of all elements
+    pomelo_node_pool_element_t * next;
+
+    /// @brief The next available element
+    pomelo_node_pool_element_t * next_available;
+};
+
+
+struct pomelo_node_pool_statistic_s {
+    /// @brief Number of acquired elements
+    uint64_t acquired;
+
+    /// @brief Number of released elements
+    uint64_t released;
+
+    /// @brief Number of elements in use
+    uint64_t in_use;
+
+    /// @brief Highest number of elements in use
+    uint64_t peak_in_use;
+
+    /// @brief Number of available elements
+    uint64_t available;
+
+    /// @brief Number of acquisitions which had to allocate a new element
+    uint64_t misses;
+
+    /// @brief Number of released elements which were freed instead of being
+    /// kept available, by the shrinking or by the available limit
+    uint64_t freed;
+};
+
+
+struct pomelo_node_pool_s {
+    /// @brief The allocator
+    pomelo_allocator_t * allocator;
+
+    /// @brief The size of element
+    size_t element_size;
+
+    /// @brief Maximum number of available elements
+    size_t available_max;
+
+    /// @brief Minimum number of elements which are kept by shrinking
+    size_t floor;
+
+    /// @brief Init callback
+    pomelo_node_pool_init_cb on_init;
+
+    /// @brief Cleanup callback
+    pomelo_node_pool_cleanup_cb on_cleanup;
+
+    /// @brief The list of all elements
+    pomelo_node_pool_element_t * elements;
+
+    /// @brief The available elements, most recently released first
+    pomelo_node_pool_element_t * available;
+
+    /// @brief Highest number of elements in use of the shrink window
+    uint64_t window_peak;
+
+    /// @brief Number of releases of the shrink window
+    uint64_t window_releases;
+
+    /// @brief The statistic
+    pomelo_node_pool_statistic_t statistic;
+};
+
+
+/// @brief Create new pool
+pomelo_node_pool_t * pomelo_node_pool_create(
+    pomelo_node_pool_options_t * options
+);
+
+
+/// @brief Destroy the pool and free all of its elements
+void pomelo_node_pool_destroy(pomelo_node_pool_t * pool);
+
+
+/// @brief Acquire an element, the init callback is called with data
+void * pomelo_node_pool_acquire(pomelo_node_pool_t * pool, void * data);
+
+
+/// @brief Release an element
+void pomelo_node_pool_release(pomelo_node_pool_t * pool, void * element);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // POMELO_NODE_POOL_SRC_H
@@ -0,0 +1,526 @@
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <float.h>
+#include "schema.h"
+#include "error.h"
+#include "utils.h"
+#include "context.h"
+
+
+/// @brief Maximum length of a field type name
+#define POMELO_NODE_FIELD_NAME_CAPACITY 16
+
+
+/// @brief Names of field types, indexed by pomelo_node_field_type
+static const char * field_names[POMELO_NODE_FIELD_COUNT] = {
+    "uint8", "uint16", "uint32", "uint64",
+    "int8", "int16", "int32", "int64",
+    "float32", "float64"
+};
+
+
+/// @brief Encoded sizes of field types, indexed by pomelo_node_field_type
+static const size_t field_sizes[POMELO_NODE_FIELD_COUNT] = {
+    1, 2, 4, 8,
+    1, 2, 4, 8,
+    4, 8
+};
+
+
+/// @brief Check that the message can take the encoded records, so that a full
+/// message does not get a partial struct
+static bool schema_message_fits(
+    pomelo_node_schema_t * schema,
+    pomelo_message_t * message,
+    size_t nrecords
+) {
+    size_t size = pomelo_message_size(message);
+    size_t capacity = pomelo_message_capacity(message);
+    if (size > capacity) return false;
+    return nrecords <= (capacity - size) / schema->record_size;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*                                Public APIs                                 */
+/*----------------------------------------------------------------------------*/
+
+pomelo_node_schema_t * pomelo_node_schema_of(napi_env env, napi_value value) {
+    bool matched = false;
+    napi_status status = napi_check_object_type_tag(
+        env, value, &pomelo_node_type_tag_schema, &matched
+    );
+    if (status != napi_ok || !matched) return NULL;
+
+    pomelo_node_schema_t * schema = NULL;
+    status = napi_get_value_external(env, value, (void **) &schema);
+    if (status != napi_ok) return NULL;
+    return schema;
+}
+
+
+/// @brief Check that a double fits the field. Integer fields take finite
+/// values in their range, the fraction is truncated toward zero. Float32
+/// fields take every value which does not overflow a float.
+static bool schema_number_valid(pomelo_node_field_type type, double value) {
+    if (type == POMELO_NODE_FIELD_FLOAT64) return true;
+    if (type == POMELO_NODE_FIELD_FLOAT32) {
+        return !isfinite(value) || fabs(value) <= FLT_MAX;
+    }
+    if (!isfinite(value)) return false;
+
+    double number = trunc(value);
+    switch (type) {
+        case POMELO_NODE_FIELD_UINT8:
+            return number >= 0.0 && number <= UINT8_MAX;
+        case POMELO_NODE_FIELD_UINT16:
+            return number >= 0.0 && number <= UINT16_MAX;
+        case POMELO_NODE_FIELD_UINT32:
+            return number >= 0.0 && number <= UINT32_MAX;
+        case POMELO_NODE_FIELD_UINT64:
+            return number >= 0.0 && number < 18446744073709551616.0;
+        case POMELO_NODE_FIELD_INT8:
+            return number >= INT8_MIN && number <= INT8_MAX;
+        case POMELO_NODE_FIELD_INT16:
+            return number >= INT16_MIN && number <= INT16_MAX;
+        case POMELO_NODE_FIELD_INT32:
+            return number >= INT32_MIN && number <= INT32_MAX;
+        case POMELO_NODE_FIELD_INT64:
+            return number >= -9223372036854775808.0 &&
+                number < 9223372036854775808.0;
+        default:
+            return false;
+    }
+}
+
+
+/// @brief Write a field from a double value which has been checked by
+/// schema_number_valid()
+static int schema_write_number(
+    pomelo_message_t * message,
+    pomelo_node_field_type type,
+    double value
+) {
+    switch (type) {
+        case POMELO_NODE_FIELD_UINT8:
+            return pomelo_message_write_uint8(message, (uint8_t) value);
+        case POMELO_NODE_FIELD_UINT16:
+            return pomelo_message_write_uint16(message, (uint16_t) value);
+        case POMELO_NODE_FIELD_UINT32:
+            return pomelo_message_write_uint32(message, (uint32_t) value);
+        case POMELO_NODE_FIELD_UINT64:
+            return pomelo_message_write_uint64(message, (uint64_t) value);
+        case POMELO_NODE_FIELD_INT8:
+            return pomelo_message_write_int8(message, (int8_t) value);
+        case POMELO_NODE_FIELD_INT16:
+            return pomelo_message_write_int16(message, (int16_t) value);
+        case POMELO_NODE_FIELD_INT32:
+            return pomelo_message_write_int32(message, (int32_t) value);
+        case POMELO_NODE_FIELD_INT64:
+            return pomelo_message_write_int64(message, (int64_t) value);
+        case POMELO_NODE_FIELD_FLOAT32:
+            return pomelo_message_write_float32(message, (float) value);
+        case POMELO_NODE_FIELD_FLOAT64:
+            return pomelo_message_write_float64(message, value);
+        default:
+            return -1;
+    }
+}
+
+
+int pomelo_node_field_parse(
+    napi_env env,
+    pomelo_node_field_type type,
+    napi_value value,
+    pomelo_node_field_value_t * result
+) {
+    assert(result != NULL);
+    napi_valuetype value_type;
+    napi_status status = napi_typeof(env, value, &value_type);
+    if (status != napi_ok) return -1;
+
+    if (value_type == napi_number) {
+        double number = 0.0;
+        status = napi_get_value_double(env, value, &number);
+        if (status != napi_ok) return -1;
+        if (!schema_number_valid(type, number)) return -1;
+
+        if (type == POMELO_NODE_FIELD_UINT64) {
+            result->u64 = (uint64_t) number;
+        } else if (type == POMELO_NODE_FIELD_INT64) {
+            result->i64 = (int64_t) number;
+        } else {
+            result->f64 = number;
+        }
+        return 0;
+    }
+
+    if (value_type != napi_bigint) return -1;
+
+    // BigInts must fit the field without losing bits
+    bool lossless = false;
+    if (type == POMELO_NODE_FIELD_UINT64) {
+        status = napi_get_value_bigint_uint64(
+            env, value, &result->u64, &lossless
+        );
+        return (status == napi_ok && lossless) ? 0 : -1;
+    }
+
+    int64_t number = 0;
+    status = napi_get_value_bigint_int64(env, value, &number, &lossless);
+    if (status != napi_ok || !lossless) return -1;
+
+    if (type == POMELO_NODE_FIELD_INT64) {
+        result->i64 = number;
+        return 0;
+    }
+
+    result->f64 = (double) number;
+    return schema_number_valid(type, result->f64) ? 0 : -1;
+}
+
+
+int pomelo_node_field_write(
+    pomelo_message_t * message,
+    pomelo_node_field_type type,
+    const pomelo_node_field_value_t * value
+) {
+    assert(value != NULL);
+    switch (type) {
+        case POMELO_NODE_FIELD_UINT64:
+            return pomelo_message_write_uint64(message, value->u64);
+        case POMELO_NODE_FIELD_INT64:
+            return pomelo_message_write_int64(message, value->i64);
+        default:
+            return schema_write_number(message, type, value->f64);
+    }
+}
+
+
+/// @brief Read a field as a double value
+static int schema_read_number(
+    pomelo_message_t * message,
+    pomelo_node_field_type type,
+    double * value
+) {
+    int ret = -1;
+    switch (type) {
+        case POMELO_NODE_FIELD_UINT8: {
+            uint8_t v = 0;
+            ret = pomelo_message_read_uint8(message, &v);
+            *value = (double) v;
+            break;
+        }
+        case POMELO_NODE_FIELD_UINT16: {
+            uint16_t v = 0;
+            ret = pomelo_message_read_uint16(message, &v);
+            *value = (double) v;
+            break;
+        }
+        case POMELO_NODE_FIELD_UINT32: {
+            uint32_t v = 0;
+            ret = pomelo_message_read_uint32(message, &v);
+            *value = (double) v;
+            break;
+        }
+        case POMELO_NODE_FIELD_UINT64: {
+            uint64_t v = 0;
+            ret = pomelo_message_read_uint64(message, &v);
+            *value = (double) v;
+            break;
+        }
+        case POMELO_NODE_FIELD_INT8: {
+            int8_t v = 0;
+            ret = pomelo_message_read_int8(message, &v);
+            *value = (double) v;
+            break;
+        }
+        case POMELO_NODE_FIELD_INT16: {
+            int16_t v = 0;
+            ret = pomelo_message_read_int16(message, &v);
+            *value = (double) v;
+            break;
+        }
+        case POMELO_NODE_FIELD_INT32: {
+            int32_t v = 0;
+            ret = pomelo_message_read_int32(message, &v);
+            *value = (double) v;
+            break;
+        }
+        case POMELO_NODE_FIELD_INT64: {
+            int64_t v = 0;
+            ret = pomelo_message_read_int64(message, &v);
+            *value = (double) v;
+            break;
+        }
+        case POMELO_NODE_FIELD_FLOAT32: {
+            float v = 0;
+            ret = pomelo_message_read_float32(message, &v);
+            *value = (double) v;
+            break;
+        }
+        case POMELO_NODE_FIELD_FLOAT64:
+            ret = pomelo_message_read_float64(message, value);
+            break;
+        default:
+            break;
+    }
+    return ret;
+}
+
+
+int pomelo_node_field_read(
+    napi_env env,
+    pomelo_message_t * message,
+    pomelo_node_field_type type,
+    napi_value * result
+) {
+    napi_status status;
+    if (type == POMELO_NODE_FIELD_UINT64) {
+        uint64_t value = 0;
+        if (pomelo_message_read_uint64(message, &value) < 0) return -1;
+        status = napi_create_bigint_uint64(env, value, result);
+    } else if (type == POMELO_NODE_FIELD_INT64) {
+        int64_t value = 0;
+        if (pomelo_message_read_int64(message, &value) < 0) return -1;
+        status = napi_create_bigint_int64(env, value, result);
+    } else {
+        double value = 0.0;
+        if (schema_read_number(message, type, &value) < 0) return -1;
+        status = napi_create_double(env, value, result);
+    }
+
+    return (status == napi_ok) ? 0 : -1;
+}
+
+
+int pomelo_node_schema_pack(
+    napi_env env,
+    pomelo_node_context_t * context,
+    pomelo_node_schema_t * schema,
+    pomelo_message_t * message,
+    napi_value values
+) {
+    assert(schema != NULL);
+    size_t nfields = schema->nfields;
+
+    // Fast path: Float64Array, values are read directly from its buffer
+    bool is_typedarray = false;
+    napi_status status = napi_is_typedarray(env, values, &is_typedarray);
+    if (status != napi_ok) return -1;
+
+    if (is_typedarray) {
+        napi_typedarray_type type;
+        size_t length = 0;
+        double * data = NULL;
+        status = napi_get_typedarray_info(
+            env, values, &type, &length, (void **) &data, NULL, NULL
+        );
+        if (status != napi_ok || type != napi_float64_array) return -1;
+        if (length % nfields != 0) return -1;
+
+        // Check all values first, so that a bad value writes nothing
+        for (size_t i = 0; i < length; i++) {
+            pomelo_node_field_type field = schema->fields[i % nfields];
+            if (!schema_number_valid(field, data[i])) return -1;
+        }
+        if (!schema_message_fits(schema, message, length / nfields)) return -1;
+
+        for (size_t i = 0; i < length; i++) {
+            pomelo_node_field_type field = schema->fields[i % nfields];
+            if (schema_write_number(message, field, data[i]) < 0) return -1;
+        }
+        return (int) (length / nfields);
+    }
+
+    bool is_array = false;
+    status = napi_is_array(env, values, &is_array);
+    if (status != napi_ok || !is_array) return -1;
+
+    uint32_t length = 0;
+    status = napi_get_array_length(env, values, &length);
+    if (status != napi_ok) return -1;
+    if (length % nfields != 0) return -1;
+
+    // Parse all values first, so that a bad value writes nothing
+    pomelo_array_t * parsed = context->tmp_field_values;
+    if (pomelo_array_resize(parsed, length) < 0) return -1;
+    pomelo_node_field_value_t * parsed_values = parsed->elements;
+
+    for (uint32_t i = 0; i < length; i++) {
+        napi_value element = NULL;
+        status = napi_get_element(env, values, i, &element);
+        if (status != napi_ok) return -1;
+
+        pomelo_node_field_type field = schema->fields[i % nfields];
+        if (pomelo_node_field_parse(
+            env, field, element, &parsed_values[i]
+        ) < 0) {
+            return -1;
+        }
+    }
+    if (!schema_message_fits(schema, message, length / nfields)) return -1;
+
+    for (uint32_t i = 0; i < length; i++) {
+        pomelo_node_field_type field = schema->fields[i % nfields];
+        if (pomelo_node_field_write(message, field, &parsed_values[i]) < 0) {
+            return -1;
+        }
+    }
+    return (int) (length / nfields);
+}
+
+
+int pomelo_node_schema_unpack(
+    napi_env env,
+    pomelo_node_schema_t * schema,
+    pomelo_message_t * message,
+    napi_value out,
+    uint32_t nrecords
+) {
+    assert(schema != NULL);
+    size_t nvalues = schema->nfields * nrecords;
+
+    // Fast path: Float64Array, values are written directly to its buffer
+    bool is_typedarray = false;
+    napi_status status = napi_is_typedarray(env, out, &is_typedarray);
+    if (status != napi_ok) return -1;
+
+    if (is_typedarray) {
+        napi_typedarray_type type;
+        size_t length = 0;
+        double * data = NULL;
+        status = napi_get_typedarray_info(
+            env, out, &type, &length, (void **) &data, NULL, NULL
+        );
+        if (status != napi_ok || type != napi_float64_array) return -1;
+        if (length < nvalues) return -1;
+
+        for (size_t i = 0; i < nvalues; i++) {
+            pomelo_node_field_type field = schema->fields[i % schema->nfields];
+            if (schema_read_number(message, field, data + i) < 0) return -1;
+        }
+        return 0;
+    }
+
+    bool is_array = false;
+    status = napi_is_array(env, out, &is_array);
+    if (status != napi_ok || !is_array) return -1;
+
+    for (size_t i = 0; i < nvalues; i++) {
+        pomelo_node_field_type field = schema->fields[i % schema->nfields];
+        napi_value value = NULL;
+        if (pomelo_node_field_read(env, message, field, &value) < 0) return -1;
+
+        status = napi_set_element(env, out, (uint32_t) i, value);
+        if (status != napi_ok) return -1;
+    }
+    return 0;
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*                               Private APIs                                 */
+/*----------------------------------------------------------------------------*/
+
+#define POMELO_NODE_SCHEMA_COMPILE_ARGC 1
+napi_value pomelo_node_schema_compile(napi_env env, napi_callback_info info) {
+    size_t argc = POMELO_NODE_SCHEMA_COMPILE_ARGC;
+    napi_value argv[POMELO_NODE_SCHEMA_COMPILE_ARGC] = { NULL };
+    pomelo_node_context_t * context = NULL;
+
+    napi_call(napi_get_cb_info(
+        env, info, &argc, argv, NULL, (void **) &context
+    ));
+
+    if (argc < POMELO_NODE_SCHEMA_COMPILE_ARGC) {
+        napi_throw_msg(POMELO_NODE_ERROR_NOT_ENOUGH_ARGS);
+        return NULL;
+    }
+
+    bool is_array = false;
+    napi_call(napi_is_array(env, argv[0], &is_array));
+    if (!is_array) {
+        napi_throw_arg("fields");
+        return NULL;
+    }
+
+    uint32_t nfields = 0;
+    napi_call(napi_get_array_length(env, argv[0], &nfields));
+    if (nfields == 0) {
+        napi_throw_arg("fields");
+        return NULL;
+    }
+
+    pomelo_node_schema_t * schema = pomelo_allocator_malloc(
+        context->allocator,
+        sizeof(pomelo_node_schema_t) +
+            nfields * sizeof(pomelo_node_field_type)
+    );
+    if (!schema) {
+        napi_throw_msg(POMELO_NODE_ERROR_CREATE_SCHEMA);
+        return NULL;
+    }
+    schema->allocator = context->allocator;
+    schema->nfields = nfields;
+    schema->record_size = 0;
+
+    // Parse the field types
+    for (uint32_t i = 0; i < nfields; i++) {
+        napi_value element = NULL;
+        char name[POMELO_NODE_FIELD_NAME_CAPACITY] = { 0 };
+        size_t name_length = 0;
+        napi_status status = napi_get_element(env, argv[0], i, &element);
+        if (status == napi_ok) {
+            status = napi_get_value_string_utf8(
+                env, element, name, sizeof(name), &name_length
+            );
+        }
+
+        int type = POMELO_NODE_FIELD_COUNT;
+        if (status == napi_ok) {
+            for (type = 0; type < POMELO_NODE_FIELD_COUNT; type++) {
+                if (strcmp(name, field_names[type]) == 0) break;
+            }
+        }
+
+        if (type == POMELO_NODE_FIELD_COUNT) {
+            pomelo_allocator_free(context->allocator, schema);
+            napi_throw_arg("fields");
+            return NULL;
+        }
+
+        schema->fields[i] = (pomelo_node_field_type) type;
+        schema->record_size += field_sizes[type];
+    }
+
+    napi_value result = NULL;
+    napi_status status = napi_create_external(
+        env,
+        schema,
+        (napi_finalize) pomelo_node_schema_finalizer,
+        NULL,
+        &result
+    );
+    if (status != napi_ok) {
+        pomelo_allocator_free(context->allocator, schema);
+        napi_throw_msg(POMELO_NODE_ERROR_CREATE_SCHEMA);
+        return NULL;
+    }
+    napi_call(napi_type_tag_object(env, result, &pomelo_node_type_tag_schema));
+
+    return result; // Schema
+}
+
+
+void pomelo_node_schema_finalizer(
+    napi_env env,
+    pomelo_node_schema_t * schema,
+    void * hint
+) {
+    (void) env;
+    (void) hint;
+    pomelo_allocator_free(schema->allocator, schema);
+}
@@ -0,0 +1,138 @@
+#ifndef POMELO_NODE_SCHEMA_SRC_H
+#define POMELO_NODE_SCHEMA_SRC_H
+#include "module.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/// @brief Field types of schema
+typedef enum pomelo_node_field_type {
+    POMELO_NODE_FIELD_UINT8,
+    POMELO_NODE_FIELD_UINT16,
+    POMELO_NODE_FIELD_UINT32,
+    POMELO_NODE_FIELD_UINT64,
+    POMELO_NODE_FIELD_INT8,
+    POMELO_NODE_FIELD_INT16,
+    POMELO_NODE_FIELD_INT32,
+    POMELO_NODE_FIELD_INT64,
+    POMELO_NODE_FIELD_FLOAT32,
+    POMELO_NODE_FIELD_FLOAT64,
+    POMELO_NODE_FIELD_COUNT
+} pomelo_node_field_type;
+
+
+struct pomelo_node_schema_s {
+    /// @brief The allocator of this schema
+    pomelo_allocator_t * allocator;
+
+    /// @brief Number of fields of a record
+    size_t nfields;
+
+    /// @brief Encoded size of a record in bytes
+    size_t record_size;
+
+    /// @brief The field types, in order
+    pomelo_node_field_type fields[];
+};
+
+
+/*----------------------------------------------------------------------------*/
+/*                                Public APIs                                 */
+/*----------------------------------------------------------------------------*/
+
+/// @brief Get the compiled schema from JS value.
+/// Returns NULL if the value is not a compiled schema.
+pomelo_node_schema_t * pomelo_node_schema_of(napi_env env, napi_value value);
+
+
+/// @brief Value of a field parsed from JS, by the type of field
+typedef union pomelo_node_field_value_u {
+    /// @brief Value of uint64 fields
+    uint64_t u64;
+
+    /// @brief Value of int64 fields
+    int64_t i64;
+
+    /// @brief Value of the other fields
+    double f64;
+} pomelo_node_field_value_t;
+
+
+/// @brief Parse a field from a JS value (number or bigint). Values which do
+/// not fit the field, including NaN and infinities for integer fields, are
+/// rejected.
+/// @returns 0 on success or -1 on failure
+int pomelo_node_field_parse(
+    napi_env env,
+    pomelo_node_field_type type,
+    napi_value value,
+    pomelo_node_field_value_t * result
+);
+
+
+/// @brief Write a field parsed by pomelo_node_field_parse()
+/// @returns 0 on success or -1 on failure
+int pomelo_node_field_write(
+    pomelo_message_t * message,
+    pomelo_node_field_type type,
+    const pomelo_node_field_value_t * value
+);
+
+
+/// @brief Read a field as a JS value, 64-bit integers are read as bigint
+/// @returns 0 on success or -1 on failure
+int pomelo_node_field_read(
+    napi_env env,
+    pomelo_message_t * message,
+    pomelo_node_field_type type,
+    napi_value * result
+);
+
+
+/// @brief Write records from a JS array or a Float64Array to message.
+/// The number of values must be a multiple of the number of fields. All
+/// values are parsed into the context scratch and the capacity of message is
+/// checked before the first one is written.
+/// @returns The number of written records or -1 on failure
+int pomelo_node_schema_pack(
+    napi_env env,
+    pomelo_node_context_t * context,
+    pomelo_node_schema_t * schema,
+    pomelo_message_t * message,
+    napi_value values
+);
+
+
+/// @brief Read records from message to a JS array or a Float64Array
+/// @returns 0 on success or -1 on failure
+int pomelo_node_schema_unpack(
+    napi_env env,
+    pomelo_node_schema_t * schema,
+    pomelo_message_t * message,
+    napi_value out,
+    uint32_t nrecords
+);
+
+
+/*----------------------------------------------------------------------------*/
+/*                               Private APIs                                 */
+/*----------------------------------------------------------------------------*/
+
+/// @brief Message.compileSchema(fields: string[])
+napi_value pomelo_node_schema_compile(napi_env env, napi_callback_info info);
+
+
+/// @brief Finalizer of compiled schema
+void pomelo_node_schema_finalizer(
+    napi_env env,
+    pomelo_node_schema_t * schema,
+    void * hint
+);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // POMELO_NODE_SCHEMA_SRC_H
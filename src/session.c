@@ -9,6 +9,7 @@
 #include "context.h"
 #include "socket.h"
 #include "channel.h"
+#include "group.h"
 
 
 /*----------------------------------------------------------------------------*/
@@ -27,6 +28,7 @@ napi_status pomelo_node_init_session_module(napi_env env, napi_value ns) {
             "channels", pomelo_node_session_get_channels, NULL, context
         ),
         napi_method("send", pomelo_node_session_send, context),
+        napi_method("sendFast", pomelo_node_session_send_fast, context),
         napi_method("disconnect", pomelo_node_session_disconnect, context),
         napi_method("rtt", pomelo_node_session_rtt, context),
         napi_method(
@@ -80,6 +82,17 @@ napi_value pomelo_node_session_new(napi_env env, pomelo_session_t * session) {
     node_session->session = session;
     pomelo_session_set_extra(session, node_session);
 
+    // Index the session by its ID for multicasting
+    pomelo_node_socket_t * node_socket =
+        pomelo_socket_get_extra(pomelo_session_get_socket(session));
+    if (node_socket && node_socket->sessions_by_id) {
+        int64_t id = pomelo_session_get_client_id(session);
+        if (!pomelo_map_set(node_socket->sessions_by_id, id, session)) {
+            napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
+            return NULL;
+        }
+    }
+
     // Ref the reference to keep the session alive
     napi_call(napi_reference_ref(env, node_session->thiz, NULL));
 
@@ -101,7 +114,21 @@ void pomelo_node_session_cleanup(pomelo_node_session_t * node_session) {
     pomelo_session_t * session = node_session->session;
     assert(session != NULL);
 
+    // Leave all groups before detaching the native session
+    if (node_session->groups) {
+        pomelo_node_group_remove_session_from_all(node_session);
+        pomelo_array_destroy(node_session->groups);
+        node_session->groups = NULL;
+    }
+
     if (session) {
+        pomelo_node_socket_t * node_socket =
+            pomelo_socket_get_extra(pomelo_session_get_socket(session));
+        if (node_socket && node_socket->sessions_by_id) {
+            int64_t id = pomelo_session_get_client_id(session);
+            pomelo_map_del(node_socket->sessions_by_id, id);
+        }
+
         pomelo_session_set_extra(session, NULL);
         node_session->session = NULL;
     }
@@ -192,6 +219,9 @@ napi_value pomelo_node_session_constructor(
         return NULL;
     }
 
+    // Tag the object for fast validation
+    napi_call(napi_type_tag_object(env, thiz, &pomelo_node_type_tag_session));
+
     return thiz;
 }
 
@@ -211,7 +241,13 @@ void pomelo_node_session_finalizer(
 
 
 #define POMELO_NODE_SESSION_SEND_ARGC 2
-napi_value pomelo_node_session_send(napi_env env, napi_callback_info info) {
+/// @brief Send a message. Without ack, no promise is created and the result
+/// is only counted in the statistic.
+static napi_value session_send(
+    napi_env env,
+    napi_callback_info info,
+    bool ack
+) {
     size_t argc = POMELO_NODE_SESSION_SEND_ARGC;
     napi_value argv[POMELO_NODE_SESSION_SEND_ARGC] = { NULL };
     napi_value thiz = NULL;
@@ -222,7 +258,7 @@ napi_value pomelo_node_session_send(napi_env env, napi_callback_info info) {
         env, info, &argc, argv, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_session, (void **) &node_session
+        env, thiz, &pomelo_node_type_tag_session, (void **) &node_session
     ));
 
     if (!node_session->session) {
@@ -245,29 +281,36 @@ napi_value pomelo_node_session_send(napi_env env, napi_callback_info info) {
 
     // Parse message
     napi_value js_message = argv[1];
-    napi_value class_message = NULL;
-    napi_call(napi_get_reference_value(
-        env, context->class_message, &class_message
-    ));
-
-    bool instance_of = false;
-    napi_call(napi_instanceof(env, js_message, class_message, &instance_of));
-    if (!instance_of) {
+    pomelo_node_message_t * node_message = NULL;
+    napi_status status = pomelo_node_message_of(env, js_message, &node_message);
+    if (status != napi_ok) {
         napi_throw_arg("message");
         return NULL;
     }
-
-    pomelo_node_message_t * node_message = NULL;
-    napi_call(napi_unwrap(env, js_message, (void **) &node_message));
     if (!node_message) {
         napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
         return NULL;
     }
+    if (!node_message->message) {
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
+        return NULL;
+    }
+
+    // Write the pending writable view before sending
+    if (pomelo_node_message_commit_writable(node_message) < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_WRITE_MESSAGE);
+        return NULL;
+    }
 
-    // Create promise here
     napi_value result = NULL;
     napi_deferred deferred = NULL;
-    napi_call(napi_create_promise(env, &deferred, &result));
+    if (ack) {
+        // Create promise here
+        napi_call(napi_create_promise(env, &deferred, &result));
+    } else {
+        context->send_fast_requests++;
+        napi_call(napi_get_undefined(env, &result));
+    }
 
     // Delivery the message
     pomelo_session_send(
@@ -277,7 +320,20 @@ napi_value pomelo_node_session_send(napi_env env, napi_callback_info info) {
         deferred
     );
 
-    return result; // Promise<number>
+    return result; // Promise<number> | undefined
+}
+
+
+napi_value pomelo_node_session_send(napi_env env, napi_callback_info info) {
+    return session_send(env, info, true);
+}
+
+
+napi_value pomelo_node_session_send_fast(
+    napi_env env,
+    napi_callback_info info
+) {
+    return session_send(env, info, false);
 }
 
 
@@ -293,7 +349,7 @@ napi_value pomelo_node_session_get_id(
         env, info, NULL, NULL, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_session, (void **) &node_session
+        env, thiz, &pomelo_node_type_tag_session, (void **) &node_session
     ));
 
     if (!node_session->session) {
@@ -325,7 +381,7 @@ napi_value pomelo_node_session_disconnect(
         env, info, NULL, NULL, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_session, (void **) &node_session
+        env, thiz, &pomelo_node_type_tag_session, (void **) &node_session
     ));
 
     if (!node_session->session) {
@@ -358,7 +414,7 @@ napi_value pomelo_node_session_set_channel_mode(
         env, info, &argc, argv, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_session, (void **) &node_session
+        env, thiz, &pomelo_node_type_tag_session, (void **) &node_session
     ));
 
     if (argc < POMELO_NODE_SESSION_SET_CHANNEL_MODE_ARGC) {
@@ -415,7 +471,7 @@ napi_value pomelo_node_session_get_channel_mode(
         env, info, &argc, argv, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_session, (void **) &node_session
+        env, thiz, &pomelo_node_type_tag_session, (void **) &node_session
     ));
 
     if (argc < POMELO_NODE_SESSION_GET_CHANNEL_MODE_ARGC) {
@@ -455,7 +511,7 @@ napi_value pomelo_node_session_rtt(napi_env env, napi_callback_info info) {
         env, info, NULL, NULL, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_session, (void **) &node_session
+        env, thiz, &pomelo_node_type_tag_session, (void **) &node_session
     ));
 
     if (!node_session->session) {
@@ -500,7 +556,7 @@ napi_value pomelo_node_session_get_channels(
         env, info, NULL, NULL, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_session, (void **) &node_session
+        env, thiz, &pomelo_node_type_tag_session, (void **) &node_session
     ));
 
     // Get the native session
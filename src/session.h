@@ -2,6 +2,7 @@
 #define POMELO_NODE_SESSION_SRC_H
 #include "module.h"
 #include "utils/list.h"
+#include "utils/array.h"
 
 
 #ifdef __cplusplus
@@ -21,6 +22,9 @@ struct pomelo_node_session_s {
 
     /// @brief Reference to array of channels (lazy getting)
     napi_ref channels;
+
+    /// @brief The groups containing this session (pomelo_node_group_t *)
+    pomelo_array_t * groups;
 };
 
 
@@ -73,6 +77,12 @@ void pomelo_node_session_finalizer(
 /// @brief send(channelIndex: number, message: Message): boolean
 napi_value pomelo_node_session_send(napi_env env, napi_callback_info info);
 
+/// @brief sendFast(channelIndex: number, message: Message): void
+napi_value pomelo_node_session_send_fast(
+    napi_env env,
+    napi_callback_info info
+);
+
 
 /// @brief readonly Session.id: number
 napi_value pomelo_node_session_get_id(napi_env env, napi_callback_info info);
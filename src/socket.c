@@ -1,5 +1,6 @@
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
 #include "pomelo/base64.h"
 #include "module.h"
 #include "socket.h"
@@ -8,11 +9,74 @@
 #include "error.h"
 #include "utils.h"
 #include "context.h"
+#include "group.h"
 
 
 #define POMELO_CONNECT_TOKEN_BASE64_BUFFER_LENGTH                              \
     pomelo_base64_calc_encoded_length(POMELO_CONNECT_TOKEN_BYTES)
 
+/// @brief Initial capacity of the reusable batch arrays
+#define POMELO_NODE_SOCKET_BATCH_INITIAL_CAPACITY 64
+
+/// @brief Bytes of the record header in receive ring:
+/// [session id: int64][length: uint32][reserved: uint32]
+#define POMELO_NODE_RING_HEADER_BYTES 16
+
+/// @brief Alignment of records in receive ring
+#define POMELO_NODE_RING_ALIGNMENT 8
+
+/// @brief Minimum capacity of receive ring
+#define POMELO_NODE_RING_MIN_CAPACITY 1024
+
+/// @brief The length value of a wrap marker record
+#define POMELO_NODE_RING_WRAP_MARKER 0xFFFFFFFFU
+
+/// @brief Align the record size
+#define POMELO_NODE_RING_ALIGN(size)                                           \
+    (((size) + POMELO_NODE_RING_ALIGNMENT - 1) &                               \
+    ~((size_t) POMELO_NODE_RING_ALIGNMENT - 1))
+
+
+static napi_value pomelo_node_socket_batch_flush_callback(
+    napi_env env,
+    napi_callback_info info
+);
+
+
+/// @brief Drop one owner of the ring storage
+static void pomelo_node_ring_store_unref(pomelo_node_ring_store_t * store) {
+    assert(store != NULL);
+    if (--store->refs > 0) return;
+    pomelo_allocator_free(store->allocator, store);
+}
+
+
+/// @brief Finalizer of the ring ArrayBuffer
+static void pomelo_node_ring_store_finalize(
+    napi_env env,
+    void * data,
+    pomelo_node_ring_store_t * store
+) {
+    (void) env;
+    (void) data;
+    pomelo_node_ring_store_unref(store);
+}
+
+
+/// @brief Drop the ring of socket and reset its cursors
+static void pomelo_node_socket_ring_reset(pomelo_node_socket_t * node_socket) {
+    if (node_socket->ring_store) {
+        pomelo_node_ring_store_unref(node_socket->ring_store);
+        node_socket->ring_store = NULL;
+    }
+    node_socket->ring_data = NULL;
+    node_socket->ring_capacity = 0;
+    node_socket->ring_read = 0;
+    node_socket->ring_write = 0;
+    node_socket->ring_pending = 0;
+    node_socket->ring_dropped = 0;
+}
+
 
 /*----------------------------------------------------------------------------*/
 /*                                Public APIs                                 */
@@ -31,7 +95,12 @@ napi_status pomelo_node_init_socket_module(napi_env env, napi_value ns) {
         napi_method("connect", pomelo_node_socket_connect, context),
         napi_method("stop", pomelo_node_socket_stop, context),
         napi_method("send", pomelo_node_socket_send, context),
+        napi_method("sendFast", pomelo_node_socket_send_fast, context),
         napi_method("time", pomelo_node_socket_time, context),
+        napi_method("multicast", pomelo_node_socket_multicast, context),
+        napi_method(
+            "setReceiveRing", pomelo_node_socket_set_receive_ring, context
+        ),
     };
 
     // Build the class
@@ -65,6 +134,15 @@ int pomelo_node_socket_init(
 ) {
     assert(node_socket != NULL);
     node_socket->context = context;
+
+    pomelo_map_options_t map_options = {
+        .allocator = context->allocator,
+        .key_size = sizeof(int64_t),
+        .value_size = sizeof(pomelo_session_t *)
+    };
+    node_socket->sessions_by_id = pomelo_map_create(&map_options);
+    if (!node_socket->sessions_by_id) return -1;
+
     return 0;
 }
 
@@ -89,6 +167,50 @@ void pomelo_node_socket_cleanup(pomelo_node_socket_t * node_socket) {
         node_socket->on_received = NULL;
     }
 
+    if (node_socket->on_received_batch) {
+        napi_delete_reference(env, node_socket->on_received_batch);
+        node_socket->on_received_batch = NULL;
+    }
+
+    // Drop all pending received messages
+    if (node_socket->batch_messages) {
+        pomelo_message_t ** messages = node_socket->batch_messages->elements;
+        size_t size = node_socket->batch_messages->size;
+        for (size_t i = 0; i < size; i++) {
+            pomelo_message_unref(messages[i]);
+        }
+        pomelo_array_destroy(node_socket->batch_messages);
+        node_socket->batch_messages = NULL;
+    }
+
+    if (node_socket->batch_sessions) {
+        pomelo_array_destroy(node_socket->batch_sessions);
+        node_socket->batch_sessions = NULL;
+    }
+
+    if (node_socket->batch_flush) {
+        napi_delete_reference(env, node_socket->batch_flush);
+        node_socket->batch_flush = NULL;
+    }
+
+    if (node_socket->batch_js_sessions) {
+        napi_delete_reference(env, node_socket->batch_js_sessions);
+        node_socket->batch_js_sessions = NULL;
+    }
+
+    if (node_socket->batch_js_messages) {
+        napi_delete_reference(env, node_socket->batch_js_messages);
+        node_socket->batch_js_messages = NULL;
+    }
+    node_socket->batch_scheduled = false;
+
+    if (node_socket->on_received_ring) {
+        napi_delete_reference(env, node_socket->on_received_ring);
+        node_socket->on_received_ring = NULL;
+    }
+
+    pomelo_node_socket_ring_reset(node_socket);
+
     if (node_socket->listener) {
         napi_delete_reference(env, node_socket->listener);
         node_socket->listener = NULL;
@@ -100,6 +222,12 @@ void pomelo_node_socket_cleanup(pomelo_node_socket_t * node_socket) {
         node_socket->socket = NULL;
     }
 
+    // Destroying the socket has removed all of its sessions from the map
+    if (node_socket->sessions_by_id) {
+        pomelo_map_destroy(node_socket->sessions_by_id);
+        node_socket->sessions_by_id = NULL;
+    }
+
     if (node_socket->thiz) {
         napi_delete_reference(env, node_socket->thiz);
         node_socket->thiz = NULL;
@@ -214,6 +342,9 @@ napi_value pomelo_node_socket_constructor(
         &node_socket->thiz 
     ));
 
+    // Tag the object for fast validation
+    napi_call(napi_type_tag_object(env, thiz, &pomelo_node_type_tag_socket));
+
     // The node_socket->thiz is now a weak reference
     return thiz;
 }
@@ -230,6 +361,91 @@ void pomelo_node_socket_finalizer(
 }
 
 
+/// @brief Create the function which flushes the received batch and ring
+static napi_status pomelo_node_socket_init_flush(
+    napi_env env,
+    pomelo_node_socket_t * node_socket
+) {
+    if (node_socket->batch_flush) return napi_ok;
+
+    napi_value batch_flush = NULL;
+    napi_status status = napi_create_function(
+        env,
+        "flushReceived",
+        NAPI_AUTO_LENGTH,
+        pomelo_node_socket_batch_flush_callback,
+        node_socket,
+        &batch_flush
+    );
+    if (status != napi_ok) return status;
+
+    return napi_create_reference(
+        env, batch_flush, 1, &node_socket->batch_flush
+    );
+}
+
+
+/// @brief Prepare the batched receiving of socket
+static napi_status pomelo_node_socket_init_batch(
+    napi_env env,
+    pomelo_node_socket_t * node_socket,
+    napi_value on_received_batch
+) {
+    pomelo_node_context_t * context = node_socket->context;
+    napi_status status = napi_create_reference(
+        env, on_received_batch, 1, &node_socket->on_received_batch
+    );
+    if (status != napi_ok) return status;
+
+    // The flush function and the arrays are reused for all batches
+    status = pomelo_node_socket_init_flush(env, node_socket);
+    if (status != napi_ok) return status;
+
+    if (!node_socket->batch_js_sessions) {
+        napi_value js_sessions = NULL;
+        status = napi_create_array_with_length(
+            env, POMELO_NODE_SOCKET_BATCH_INITIAL_CAPACITY, &js_sessions
+        );
+        if (status != napi_ok) return status;
+
+        status = napi_create_reference(
+            env, js_sessions, 1, &node_socket->batch_js_sessions
+        );
+        if (status != napi_ok) return status;
+    }
+
+    if (!node_socket->batch_js_messages) {
+        napi_value js_messages = NULL;
+        status = napi_create_array_with_length(
+            env, POMELO_NODE_SOCKET_BATCH_INITIAL_CAPACITY, &js_messages
+        );
+        if (status != napi_ok) return status;
+
+        status = napi_create_reference(
+            env, js_messages, 1, &node_socket->batch_js_messages
+        );
+        if (status != napi_ok) return status;
+    }
+
+    pomelo_array_options_t array_options = {
+        .allocator = context->allocator,
+        .element_size = sizeof(pomelo_session_t *)
+    };
+    if (!node_socket->batch_sessions) {
+        node_socket->batch_sessions = pomelo_array_create(&array_options);
+        if (!node_socket->batch_sessions) return napi_generic_failure;
+    }
+
+    array_options.element_size = sizeof(pomelo_message_t *);
+    if (!node_socket->batch_messages) {
+        node_socket->batch_messages = pomelo_array_create(&array_options);
+        if (!node_socket->batch_messages) return napi_generic_failure;
+    }
+
+    return napi_ok;
+}
+
+
 #define POMELO_NODE_SOCKET_SET_LISTENER_ARGC 1
 napi_value pomelo_node_socket_set_listener(
     napi_env env,
@@ -245,7 +461,7 @@ napi_value pomelo_node_socket_set_listener(
         env, info, &argc, argv, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_socket, (void **) &node_socket
+        env, thiz, &pomelo_node_type_tag_socket, (void **) &node_socket
     ));
 
     if (argc < POMELO_NODE_SOCKET_SET_LISTENER_ARGC) { 
@@ -283,15 +499,80 @@ napi_value pomelo_node_socket_set_listener(
         return NULL;
     }
 
-    // Get on received callback
+    // Get on received batch callback (optional)
+    napi_value on_received_batch = NULL;
+    napi_call(napi_get_named_property(
+        env, listener, "onReceivedBatch", &on_received_batch
+    ));
+    napi_call(napi_typeof(env, on_received_batch, &type));
+    if (type != napi_function) {
+        if (type != napi_undefined && type != napi_null) {
+            napi_throw_arg("listener.onReceivedBatch");
+            return NULL;
+        }
+        on_received_batch = NULL;
+    }
+
+    // Get on received ring callback (optional)
+    napi_value on_received_ring = NULL;
+    napi_call(napi_get_named_property(
+        env, listener, "onReceivedRing", &on_received_ring
+    ));
+    napi_call(napi_typeof(env, on_received_ring, &type));
+    if (type != napi_function) {
+        if (type != napi_undefined && type != napi_null) {
+            napi_throw_arg("listener.onReceivedRing");
+            return NULL;
+        }
+        on_received_ring = NULL;
+    }
+
+    // Get on received callback, it is optional in batched or ring mode
     napi_value on_received = NULL;
     napi_call(napi_get_named_property(
         env, listener, "onReceived", &on_received
     ));
     napi_call(napi_typeof(env, on_received, &type));
     if (type != napi_function) {
-        napi_throw_arg("listener.onReceived");
-        return NULL;
+        if (!on_received_batch && !on_received_ring) {
+            napi_throw_arg("listener.onReceived");
+            return NULL;
+        }
+        on_received = NULL;
+    }
+
+    // Deliver the pending messages of previous listener
+    if (node_socket->on_received_batch) {
+        pomelo_node_socket_flush_received_batch(node_socket);
+        napi_call(napi_delete_reference(env, node_socket->on_received_batch));
+        node_socket->on_received_batch = NULL;
+    }
+
+    if (node_socket->on_received_ring) {
+        pomelo_node_socket_flush_received_ring(node_socket);
+        napi_call(napi_delete_reference(env, node_socket->on_received_ring));
+        node_socket->on_received_ring = NULL;
+    }
+
+    // Drop the references of previous listener
+    if (node_socket->on_received) {
+        napi_call(napi_delete_reference(env, node_socket->on_received));
+        node_socket->on_received = NULL;
+    }
+
+    if (node_socket->on_connected) {
+        napi_call(napi_delete_reference(env, node_socket->on_connected));
+        node_socket->on_connected = NULL;
+    }
+
+    if (node_socket->on_disconnected) {
+        napi_call(napi_delete_reference(env, node_socket->on_disconnected));
+        node_socket->on_disconnected = NULL;
+    }
+
+    if (node_socket->listener) {
+        napi_call(napi_delete_reference(env, node_socket->listener));
+        node_socket->listener = NULL;
     }
 
     // Create references
@@ -302,9 +583,24 @@ napi_value pomelo_node_socket_set_listener(
     napi_call(napi_create_reference(
         env, on_disconnected, 1, &node_socket->on_disconnected
     ));
-    napi_call(napi_create_reference(
-        env, on_received, 1, &node_socket->on_received
-    ));
+    if (on_received) {
+        napi_call(napi_create_reference(
+            env, on_received, 1, &node_socket->on_received
+        ));
+    }
+
+    if (on_received_batch) {
+        napi_call(pomelo_node_socket_init_batch(
+            env, node_socket, on_received_batch
+        ));
+    }
+
+    if (on_received_ring) {
+        napi_call(napi_create_reference(
+            env, on_received_ring, 1, &node_socket->on_received_ring
+        ));
+        napi_call(pomelo_node_socket_init_flush(env, node_socket));
+    }
 
     // return: undefined
     napi_value result = NULL;
@@ -327,7 +623,7 @@ napi_value pomelo_node_socket_listen(napi_env env, napi_callback_info info) {
         env, info, &argc, argv, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_socket, (void **) &node_socket
+        env, thiz, &pomelo_node_type_tag_socket, (void **) &node_socket
     ));
 
     if (argc < POMELO_NODE_SOCKET_LISTEN_ARGC) { 
@@ -445,7 +741,7 @@ napi_value pomelo_node_socket_connect(napi_env env, napi_callback_info info) {
     ));
 
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_socket, (void **) &node_socket
+        env, thiz, &pomelo_node_type_tag_socket, (void **) &node_socket
     ));
 
     if (argc < POMELO_NODE_SOCKET_CONNECT_ARGC) { 
@@ -550,7 +846,7 @@ napi_value pomelo_node_socket_stop(napi_env env, napi_callback_info info) {
         env, info, NULL, NULL, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_socket, (void **) &node_socket
+        env, thiz, &pomelo_node_type_tag_socket, (void **) &node_socket
     ));
 
     // Check state of socket
@@ -594,21 +890,18 @@ napi_value pomelo_node_socket_stop(napi_env env, napi_callback_info info) {
 
 static pomelo_session_t * pomelo_node_get_session_element(
     napi_env env,
-    napi_value session_clazz,
     napi_value sessions_array,
     uint32_t index
 ) {
     napi_value js_session = NULL;
     napi_call(napi_get_element(env, sessions_array, index, &js_session));
 
-    // Check instance of class
-    bool instance_of = false;
-    napi_call(napi_instanceof(env, js_session, session_clazz, &instance_of));
-    if (!instance_of) return NULL;
-
-    // Unwrap the native
+    // Check the tag and unwrap the native
     pomelo_node_session_t * node_session = NULL;
-    napi_call(napi_unwrap(env, js_session, (void **) &node_session));
+    napi_status status = pomelo_node_validate_native(
+        env, js_session, &pomelo_node_type_tag_session, (void **) &node_session
+    );
+    if (status != napi_ok) return NULL;
     if (!node_session || !node_session->session) return NULL;
 
     return node_session->session;
@@ -616,7 +909,13 @@ static pomelo_session_t * pomelo_node_get_session_element(
 
 
 #define POMELO_NODE_SOCKET_SEND_ARGC 3
-napi_value pomelo_node_socket_send(napi_env env, napi_callback_info info) {
+/// @brief Send a message to multiple recipients. Without ack, no promise is
+/// created and the result is only counted in the statistic.
+static napi_value socket_send(
+    napi_env env,
+    napi_callback_info info,
+    bool ack
+) {
     size_t argc = POMELO_NODE_SOCKET_SEND_ARGC;
     napi_value argv[POMELO_NODE_SOCKET_SEND_ARGC];
     napi_value thiz = NULL;
@@ -627,7 +926,7 @@ napi_value pomelo_node_socket_send(napi_env env, napi_callback_info info) {
         env, info, &argc, argv, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_socket, (void **) &node_socket
+        env, thiz, &pomelo_node_type_tag_socket, (void **) &node_socket
     ));
 
     if (argc < POMELO_NODE_SOCKET_SEND_ARGC) { 
@@ -644,80 +943,237 @@ napi_value pomelo_node_socket_send(napi_env env, napi_callback_info info) {
 
     // Get the message
     napi_value js_message = argv[1];
-    napi_value message_clazz = NULL;
-    napi_call(napi_get_reference_value(
-        env,
-        context->class_message,
-        &message_clazz
-    ));
-    bool instance_of;
-    napi_call(napi_instanceof(env, js_message, message_clazz, &instance_of));
-    if (!instance_of) {
+    pomelo_node_message_t * node_message = NULL;
+    napi_status status = pomelo_node_message_of(env, js_message, &node_message);
+    if (status != napi_ok) {
         napi_throw_arg("message");
         return NULL;
     }
-
-    pomelo_node_message_t * node_message = NULL;
-    napi_call(napi_unwrap(env, js_message, (void**) &node_message));
     if (!node_message) {
         napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
         return NULL;
     }
+    if (!node_message->message) {
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
+        return NULL;
+    }
 
-    // Process the array of sessions
-    napi_value cls_session = NULL;
-    napi_call(napi_get_reference_value(
-        env,
-        context->class_session,
-        &cls_session
-    ));
-
-    // Get the array of sessions
-    bool is_array = false;
-    napi_call(napi_is_array(env, argv[2], &is_array));
-    if (!is_array) {
-        napi_throw_arg("sessions");
+    // Write the pending writable view before sending
+    if (pomelo_node_message_commit_writable(node_message) < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_WRITE_MESSAGE);
         return NULL;
     }
 
-    uint32_t length;
-    napi_call(napi_get_array_length(env, argv[2], &length));
+    // A session group already holds the native sessions, so that there is no
+    // need to scan the JS array.
+    pomelo_node_group_t * group = NULL;
+    pomelo_session_t ** sessions = NULL;
+    uint32_t length = 0;
+    status = pomelo_node_validate_native(
+        env, argv[2], &pomelo_node_type_tag_group, (void **) &group
+    );
+    if (status == napi_ok && group) {
+        sessions = group->sessions->elements;
+        length = (uint32_t) group->sessions->size;
+    } else {
+        // Get the array of sessions
+        bool is_array = false;
+        napi_call(napi_is_array(env, argv[2], &is_array));
+        if (!is_array) {
+            napi_throw_arg("sessions");
+            return NULL;
+        }
+        napi_call(napi_get_array_length(env, argv[2], &length));
+    }
+
     if (length == 0) {
         napi_value result;
-        napi_call(napi_create_int32(env, 0, &result));
+        if (ack) {
+            napi_call(napi_create_int32(env, 0, &result));
+        } else {
+            napi_call(napi_get_undefined(env, &result));
+        }
         return result;
     }
 
     napi_value result = NULL;
     napi_deferred deferred = NULL;
-    napi_call(napi_create_promise(env, &deferred, &result));
+    if (ack) {
+        napi_call(napi_create_promise(env, &deferred, &result));
+    } else {
+        context->send_fast_requests++;
+        napi_call(napi_get_undefined(env, &result));
+    }
 
     // The index in input array
     pomelo_message_t * message = node_message->message;
-    pomelo_array_t * send_sessions = context->tmp_send_sessions;
-    int ret = pomelo_array_resize(send_sessions, length);
-    if (ret < 0) {
-        napi_throw_msg(POMELO_NODE_ERROR_SOCKET_SEND);
-        return NULL;
-    }
+    if (!sessions) {
+        pomelo_array_t * send_sessions = context->tmp_send_sessions;
+        int ret = pomelo_array_resize(send_sessions, length);
+        if (ret < 0) {
+            napi_throw_msg(POMELO_NODE_ERROR_SOCKET_SEND);
+            return NULL;
+        }
 
-    for (uint32_t i = 0; i < length; i++) {
-        pomelo_session_t * session =
-            pomelo_node_get_session_element(env, cls_session, argv[2], i);
-        if (!session) continue;
-        pomelo_array_set(send_sessions, i, session);
+        for (uint32_t i = 0; i < length; i++) {
+            pomelo_session_t * session =
+                pomelo_node_get_session_element(env, argv[2], i);
+            if (!session) continue;
+            pomelo_array_set(send_sessions, i, session);
+        }
+        sessions = send_sessions->elements;
     }
 
     pomelo_socket_send(
         node_socket->socket,
         channel_index,
         message,
-        send_sessions->elements,
-        send_sessions->size,
+        sessions,
+        length,
         deferred
     );
 
-    return result; // Promise<number>
+    return result; // Promise<number> | undefined
+}
+
+
+napi_value pomelo_node_socket_send(napi_env env, napi_callback_info info) {
+    return socket_send(env, info, true);
+}
+
+
+napi_value pomelo_node_socket_send_fast(
+    napi_env env,
+    napi_callback_info info
+) {
+    return socket_send(env, info, false);
+}
+
+
+#define POMELO_NODE_SOCKET_MULTICAST_ARGC 4
+napi_value pomelo_node_socket_multicast(
+    napi_env env,
+    napi_callback_info info
+) {
+    size_t argc = POMELO_NODE_SOCKET_MULTICAST_ARGC;
+    napi_value argv[POMELO_NODE_SOCKET_MULTICAST_ARGC] = { NULL };
+    napi_value thiz = NULL;
+    pomelo_node_context_t * context = NULL;
+    pomelo_node_socket_t * node_socket = NULL;
+
+    napi_call(napi_get_cb_info(
+        env, info, &argc, argv, &thiz, (void **) &context
+    ));
+    napi_call(pomelo_node_validate_native(
+        env, thiz, &pomelo_node_type_tag_socket, (void **) &node_socket
+    ));
+
+    if (argc < POMELO_NODE_SOCKET_MULTICAST_ARGC - 1) {
+        napi_throw_msg(POMELO_NODE_ERROR_NOT_ENOUGH_ARGS);
+        return NULL;
+    }
+
+    if (!node_socket->socket) {
+        napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
+        return NULL;
+    }
+
+    // Get the channel_index
+    int32_t channel_index = -1;
+    if (pomelo_node_parse_int32_value(env, argv[0], &channel_index) < 0) {
+        napi_throw_arg("channelIndex");
+        return NULL;
+    }
+
+    // Get the message
+    pomelo_node_message_t * node_message = NULL;
+    napi_status status = pomelo_node_message_of(env, argv[1], &node_message);
+    if (status != napi_ok) {
+        napi_throw_arg("message");
+        return NULL;
+    }
+    if (!node_message) {
+        napi_throw_msg(POMELO_NODE_ERROR_NATIVE_NULL);
+        return NULL;
+    }
+    if (!node_message->message) {
+        napi_throw_msg(POMELO_NODE_ERROR_MESSAGE_RELEASED);
+        return NULL;
+    }
+
+    // Get the session IDs
+    bool is_typedarray = false;
+    napi_call(napi_is_typedarray(env, argv[2], &is_typedarray));
+    if (!is_typedarray) {
+        napi_throw_arg("sessionIds");
+        return NULL;
+    }
+
+    napi_typedarray_type type;
+    size_t length = 0;
+    int64_t * ids = NULL;
+    napi_call(napi_get_typedarray_info(
+        env, argv[2], &type, &length, (void **) &ids, NULL, NULL
+    ));
+    if (type != napi_bigint64_array) {
+        napi_throw_arg("sessionIds");
+        return NULL;
+    }
+
+    // The IDs array can be reused, only the first count elements are used
+    if (argc > 3) {
+        napi_valuetype count_type;
+        napi_call(napi_typeof(env, argv[3], &count_type));
+        if (count_type != napi_undefined) {
+            uint32_t count = 0;
+            if (pomelo_node_parse_uint32_value(env, argv[3], &count) < 0) {
+                napi_throw_arg("count");
+                return NULL;
+            }
+            if (count < length) length = count;
+        }
+    }
+
+    // Write the pending writable view before sending
+    if (pomelo_node_message_commit_writable(node_message) < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_WRITE_MESSAGE);
+        return NULL;
+    }
+
+    // Resolve the recipients, unknown IDs are skipped
+    pomelo_array_t * send_sessions = context->tmp_send_sessions;
+    if (pomelo_array_resize(send_sessions, length) < 0) {
+        napi_throw_msg(POMELO_NODE_ERROR_SOCKET_SEND);
+        return NULL;
+    }
+
+    pomelo_session_t ** sessions = send_sessions->elements;
+    size_t nsessions = 0;
+    for (size_t i = 0; i < length; i++) {
+        int64_t id = ids[i];
+        pomelo_session_t * session = NULL;
+        if (pomelo_map_get(node_socket->sessions_by_id, id, session) < 0) {
+            continue;
+        }
+        sessions[nsessions++] = session;
+    }
+
+    if (nsessions > 0) {
+        // The result is counted like sendFast()
+        context->send_fast_requests++;
+        pomelo_socket_send(
+            node_socket->socket,
+            channel_index,
+            node_message->message,
+            sessions,
+            nsessions,
+            NULL
+        );
+    }
+
+    napi_value result = NULL;
+    napi_call(napi_create_uint32(env, (uint32_t) nsessions, &result));
+    return result;
 }
 
 
@@ -729,7 +1185,7 @@ napi_value pomelo_node_socket_time(napi_env env, napi_callback_info info) {
         env, info, NULL, NULL, &thiz, (void **) &context
     ));
     napi_call(pomelo_node_validate_native(
-        env, thiz, context->class_socket, (void **) &node_socket
+        env, thiz, &pomelo_node_type_tag_socket, (void **) &node_socket
     )); 
 
     // Get socket time
@@ -742,6 +1198,85 @@ napi_value pomelo_node_socket_time(napi_env env, napi_callback_info info) {
 }
 
 
+#define POMELO_NODE_SOCKET_SET_RECEIVE_RING_ARGC 1
+napi_value pomelo_node_socket_set_receive_ring(
+    napi_env env,
+    napi_callback_info info
+) {
+    size_t argc = POMELO_NODE_SOCKET_SET_RECEIVE_RING_ARGC;
+    napi_value argv[POMELO_NODE_SOCKET_SET_RECEIVE_RING_ARGC] = { NULL };
+    napi_value thiz = NULL;
+    pomelo_node_context_t * context = NULL;
+    pomelo_node_socket_t * node_socket = NULL;
+
+    napi_call(napi_get_cb_info(
+        env, info, &argc, argv, &thiz, (void **) &context
+    ));
+    napi_call(pomelo_node_validate_native(
+        env, thiz, &pomelo_node_type_tag_socket, (void **) &node_socket
+    ));
+
+    if (argc < POMELO_NODE_SOCKET_SET_RECEIVE_RING_ARGC) {
+        napi_throw_msg(POMELO_NODE_ERROR_NOT_ENOUGH_ARGS);
+        return NULL;
+    }
+
+    uint32_t capacity = 0;
+    if (pomelo_node_parse_uint32_value(env, argv[0], &capacity) < 0) {
+        napi_throw_arg("capacity");
+        return NULL;
+    }
+
+    // Notify all the records of current ring before replacing it
+    pomelo_node_socket_flush_received_ring(node_socket);
+    pomelo_node_socket_ring_reset(node_socket);
+
+    napi_value result = NULL;
+    if (capacity == 0) {
+        // Disable the ring
+        napi_call(napi_get_null(env, &result));
+        return result; // null
+    }
+
+    if (capacity < POMELO_NODE_RING_MIN_CAPACITY) {
+        capacity = POMELO_NODE_RING_MIN_CAPACITY;
+    }
+    capacity = (uint32_t) POMELO_NODE_RING_ALIGN(capacity);
+
+    // The storage is native, JS only gets an external view of it
+    pomelo_node_ring_store_t * store = pomelo_allocator_malloc(
+        context->allocator, sizeof(pomelo_node_ring_store_t) + capacity
+    );
+    if (!store) {
+        napi_throw_msg(POMELO_NODE_ERROR_CREATE_RING);
+        return NULL;
+    }
+    store->allocator = context->allocator;
+    store->refs = 2; // The socket and the ArrayBuffer
+    uint8_t * data = (uint8_t *) (store + 1);
+    memset(data, 0, capacity);
+
+    napi_status status = napi_create_external_arraybuffer(
+        env,
+        data,
+        capacity,
+        (napi_finalize) pomelo_node_ring_store_finalize,
+        store,
+        &result
+    );
+    if (status != napi_ok) {
+        pomelo_allocator_free(context->allocator, store);
+        napi_throw_msg(POMELO_NODE_ERROR_CREATE_RING);
+        return NULL;
+    }
+    node_socket->ring_store = store;
+    node_socket->ring_data = data;
+    node_socket->ring_capacity = capacity;
+
+    return result; // ArrayBuffer
+}
+
+
 
 /*----------------------------------------------------------------------------*/
 /*                    Sockets native APIs implementations                     */
@@ -816,6 +1351,10 @@ void pomelo_socket_on_disconnected(
 
     // Open scope to call the callback
     napi_callv(napi_open_handle_scope(env, &scope));
+
+    // Deliver the pending messages before the session goes away
+    pomelo_node_socket_flush_received_batch(node_socket);
+    pomelo_node_socket_flush_received_ring(node_socket);
     process_disconnected(socket, session);
     napi_callv(napi_close_handle_scope(env, scope));
 }
@@ -839,15 +1378,111 @@ static void process_received(
         napi_get_reference_value(env, node_session->thiz, &js_session);
     if (status != napi_ok) return;
 
-    // Create new JS message object
-    napi_value js_message = pomelo_node_message_new(env, message);
+    if (!context->message_auto_release) {
+        // Create new JS message object
+        napi_value js_message = pomelo_node_message_new(env, message);
+        if (!js_message) return; // Failed to create new message
+
+        // Call the callback.
+        napi_value argv[] = { js_session, js_message };
+        pomelo_node_socket_call_listener(
+            node_socket, node_socket->on_received, argv, arrlen(argv)
+        );
+        return;
+    }
+
+    // The message is only valid during the callback unless it is retained
+    pomelo_node_message_t * node_message = NULL;
+    napi_value js_message =
+        pomelo_node_message_lend(env, message, &node_message);
     if (!js_message) return; // Failed to create new message
 
-    // Call the callback.
     napi_value argv[] = { js_session, js_message };
     pomelo_node_socket_call_listener(
         node_socket, node_socket->on_received, argv, arrlen(argv)
     );
+    pomelo_node_message_reclaim(node_message);
+}
+
+
+/// @brief Append a record to the receive ring
+static int pomelo_node_socket_ring_write(
+    pomelo_node_socket_t * node_socket,
+    pomelo_session_t * session,
+    pomelo_message_t * message
+) {
+    size_t length = pomelo_message_size(message);
+    size_t record = POMELO_NODE_RING_ALIGN(
+        POMELO_NODE_RING_HEADER_BYTES + length
+    );
+    size_t capacity = node_socket->ring_capacity;
+    size_t write = node_socket->ring_write;
+    size_t tail = capacity - write;
+
+    // Records never cross the end of ring
+    size_t needed = (tail < record) ? (record + tail) : record;
+    if (node_socket->ring_pending + needed >= capacity) {
+        return -1; // The ring is full
+    }
+
+    uint8_t * data = node_socket->ring_data;
+    if (tail < record) {
+        if (tail >= POMELO_NODE_RING_HEADER_BYTES) {
+            uint32_t marker = POMELO_NODE_RING_WRAP_MARKER;
+            memcpy(data + write + 8, &marker, sizeof(uint32_t));
+        }
+        write = 0;
+    }
+
+    int64_t session_id = pomelo_session_get_client_id(session);
+    uint32_t length32 = (uint32_t) length;
+    uint32_t reserved = 0;
+    memcpy(data + write, &session_id, sizeof(int64_t));
+    memcpy(data + write + 8, &length32, sizeof(uint32_t));
+    memcpy(data + write + 12, &reserved, sizeof(uint32_t));
+    if (length > 0) {
+        uint8_t * payload = data + write + POMELO_NODE_RING_HEADER_BYTES;
+        if (pomelo_message_read_buffer(message, payload, length) < 0) {
+            return -1; // Nothing has been committed
+        }
+    }
+
+    node_socket->ring_write = (write + record) % capacity;
+    node_socket->ring_pending += needed;
+    return 0;
+}
+
+
+/// @brief Schedule flushing the received batch on the next setImmediate
+static void process_schedule_batch_flush(pomelo_node_socket_t * node_socket) {
+    napi_env env = node_socket->context->env;
+
+    napi_value global = NULL;
+    napi_callv(napi_get_global(env, &global));
+
+    napi_value set_immediate = NULL;
+    napi_callv(napi_get_named_property(
+        env, global, "setImmediate", &set_immediate
+    ));
+
+    napi_value batch_flush = NULL;
+    napi_callv(napi_get_reference_value(
+        env, node_socket->batch_flush, &batch_flush
+    ));
+
+    napi_value argv[] = { batch_flush };
+    napi_status status = napi_call_function(
+        env, global, set_immediate, arrlen(argv), argv, NULL
+    );
+    if (status != napi_ok) {
+        // No way to defer, deliver right now
+        pomelo_node_socket_flush_received_batch(node_socket);
+        return;
+    }
+
+    // Keep the socket alive until the batch has been flushed
+    napi_callv(napi_reference_ref(env, node_socket->thiz, NULL));
+    node_socket->batch_scheduled = true;
 }
 
 
@@ -860,6 +1495,45 @@ void pomelo_socket_on_received(
     napi_env env = node_socket->context->env;
     napi_handle_scope scope = NULL;
 
+    if (node_socket->on_received_ring) {
+        // Ring mode, the payload is copied and the message is not retained.
+        // Without an attached ring, the message is dropped and reported.
+        if (!node_socket->ring_data ||
+            pomelo_node_socket_ring_write(node_socket, session, message) < 0
+        ) {
+            node_socket->ring_dropped++;
+        }
+        if (node_socket->batch_scheduled) return;
+
+        napi_callv(napi_open_handle_scope(env, &scope));
+        process_schedule_batch_flush(node_socket);
+        napi_callv(napi_close_handle_scope(env, scope));
+        return;
+    }
+
+    if (node_socket->on_received_batch) {
+        // Batched mode, the message is kept until the batch is flushed
+        if (!pomelo_array_append(node_socket->batch_sessions, session)) {
+            node_socket->context->messages_dropped++;
+            return;
+        }
+        if (!pomelo_array_append(node_socket->batch_messages, message)) {
+            pomelo_array_resize(
+                node_socket->batch_sessions,
+                node_socket->batch_sessions->size - 1
+            );
+            node_socket->context->messages_dropped++;
+            return;
+        }
+        pomelo_message_ref(message);
+        if (node_socket->batch_scheduled) return;
+
+        napi_callv(napi_open_handle_scope(env, &scope));
+        process_schedule_batch_flush(node_socket);
+        napi_callv(napi_close_handle_scope(env, scope));
+        return;
+    }
+
     // Open new scope to call the callback
     napi_callv(napi_open_handle_scope(env, &scope));
     process_received(socket, session, message);
@@ -867,6 +1541,29 @@ void pomelo_socket_on_received(
 }
 
 
+static napi_value pomelo_node_socket_batch_flush_callback(
+    napi_env env,
+    napi_callback_info info
+) {
+    pomelo_node_socket_t * node_socket = NULL;
+    napi_call(napi_get_cb_info(
+        env, info, NULL, NULL, NULL, (void **) &node_socket
+    ));
+    assert(node_socket != NULL);
+
+    if (node_socket->batch_scheduled) {
+        node_socket->batch_scheduled = false;
+        pomelo_node_socket_flush_received_batch(node_socket);
+        pomelo_node_socket_flush_received_ring(node_socket);
+        napi_call(napi_reference_unref(env, node_socket->thiz, NULL));
+    }
+
+    napi_value result = NULL;
+    napi_call(napi_get_undefined(env, &result));
+    return result; // undefined
+}
+
+
 static void process_connect_result(
     napi_env env,
     pomelo_node_socket_t * node_socket,
@@ -922,7 +1619,18 @@ void pomelo_socket_on_send_result(
 ) {
     (void) message;
     pomelo_node_socket_t * node_socket = pomelo_socket_get_extra(socket);
-    napi_env env = node_socket->context->env;
+    pomelo_node_context_t * context = node_socket->context;
+    napi_env env = context->env;
+
+    if (!data) {
+        // Fire-and-forget sending, only update the counters
+        context->send_fast_results++;
+        context->send_fast_sent += send_count;
+        if (send_count == 0) {
+            context->send_fast_failures++;
+        }
+        return;
+    }
 
     napi_handle_scope scope = NULL;
     napi_callv(napi_open_handle_scope(env, &scope));
@@ -931,6 +1639,123 @@ void pomelo_socket_on_send_result(
 }
 
 
+void pomelo_node_socket_flush_received_batch(
+    pomelo_node_socket_t * node_socket
+) {
+    if (!node_socket->batch_messages) return;
+    size_t count = node_socket->batch_messages->size;
+    if (count == 0) return;
+
+    napi_env env = node_socket->context->env;
+    pomelo_session_t ** sessions = node_socket->batch_sessions->elements;
+    pomelo_message_t ** messages = node_socket->batch_messages->elements;
+
+    napi_value js_sessions = NULL;
+    napi_value js_messages = NULL;
+    napi_get_reference_value(env, node_socket->batch_js_sessions, &js_sessions);
+    napi_get_reference_value(env, node_socket->batch_js_messages, &js_messages);
+
+    // Lent messages of nested flushes are stacked after this one
+    pomelo_node_context_t * context = node_socket->context;
+    bool auto_release = context->message_auto_release;
+    pomelo_array_t * lent_messages = context->lent_messages;
+    size_t lent_begin = lent_messages->size;
+
+    // Build all JS objects first, the listener might receive more messages
+    size_t index = 0;
+    for (size_t i = 0; i < count; i++) {
+        pomelo_node_session_t * node_session =
+            pomelo_session_get_extra(sessions[i]);
+        napi_value js_session = NULL;
+        napi_value js_message = NULL;
+        if (node_session && napi_get_reference_value(
+            env, node_session->thiz, &js_session
+        ) == napi_ok && js_session) {
+            if (auto_release) {
+                pomelo_node_message_t * node_message = NULL;
+                js_message = pomelo_node_message_lend(
+                    env, messages[i], &node_message
+                );
+                if (js_message) {
+                    pomelo_array_append(lent_messages, node_message);
+                }
+            } else {
+                js_message = pomelo_node_message_new(env, messages[i]);
+            }
+        }
+        pomelo_message_unref(messages[i]);
+        if (!js_message) continue;
+
+        napi_set_element(env, js_sessions, (uint32_t) index, js_session);
+        napi_set_element(env, js_messages, (uint32_t) index, js_message);
+        index++;
+    }
+
+    pomelo_array_resize(node_socket->batch_sessions, 0);
+    pomelo_array_resize(node_socket->batch_messages, 0);
+    if (index == 0) return;
+
+    napi_value js_count = NULL;
+    napi_callv(napi_create_uint32(env, (uint32_t) index, &js_count));
+
+    // Call the callback
+    napi_value argv[] = { js_sessions, js_messages, js_count };
+    pomelo_node_socket_call_listener(
+        node_socket, node_socket->on_received_batch, argv, arrlen(argv)
+    );
+
+    // The arrays are reused, clear the delivered entries so that they do not
+    // keep the sessions and the messages alive until the next batch. The
+    // length is kept to avoid shrinking the backing stores.
+    napi_value undefined = NULL;
+    napi_callv(napi_get_undefined(env, &undefined));
+    for (size_t i = 0; i < index; i++) {
+        napi_set_element(env, js_sessions, (uint32_t) i, undefined);
+        napi_set_element(env, js_messages, (uint32_t) i, undefined);
+    }
+
+    // Take back the lent messages of this flush
+    for (size_t i = lent_begin; i < lent_messages->size; i++) {
+        pomelo_node_message_t * node_message = NULL;
+        pomelo_array_get(lent_messages, i, node_message);
+        pomelo_node_message_reclaim(node_message);
+    }
+    pomelo_array_resize(lent_messages, lent_begin);
+}
+
+
+void pomelo_node_socket_flush_received_ring(
+    pomelo_node_socket_t * node_socket
+) {
+    if (!node_socket->on_received_ring) return;
+    if (node_socket->ring_pending == 0 && node_socket->ring_dropped == 0) {
+        return;
+    }
+
+    napi_env env = node_socket->context->env;
+    size_t begin = node_socket->ring_read;
+    size_t end = node_socket->ring_write;
+    uint32_t dropped = node_socket->ring_dropped;
+
+    // All records are considered consumed after the notification
+    node_socket->ring_read = end;
+    node_socket->ring_pending = 0;
+    node_socket->ring_dropped = 0;
+
+    napi_value js_begin = NULL;
+    napi_value js_end = NULL;
+    napi_value js_dropped = NULL;
+    napi_callv(napi_create_uint32(env, (uint32_t) begin, &js_begin));
+    napi_callv(napi_create_uint32(env, (uint32_t) end, &js_end));
+    napi_callv(napi_create_uint32(env, dropped, &js_dropped));
+
+    napi_value argv[] = { js_begin, js_end, js_dropped };
+    pomelo_node_socket_call_listener(
+        node_socket, node_socket->on_received_ring, argv, arrlen(argv)
+    );
+}
+
+
 void pomelo_node_socket_call_listener(
     pomelo_node_socket_t * node_socket,
     napi_ref callback,
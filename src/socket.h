@@ -1,12 +1,27 @@
 #ifndef POMELO_NODE_SOCKET_SRC_H
 #define POMELO_NODE_SOCKET_SRC_H
 #include "module.h"
+#include "utils/array.h"
+#include "utils/map.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 
+/// @brief Native storage of the receive ring. It is exposed as an external
+/// ArrayBuffer, so it is shared by the socket and the backing store of that
+/// buffer and is freed when both have dropped it. Detaching or transferring
+/// the buffer in JS therefore never frees the memory native writes into.
+typedef struct pomelo_node_ring_store_s {
+    /// @brief The allocator
+    pomelo_allocator_t * allocator;
+
+    /// @brief Number of owners: the socket and the ArrayBuffer
+    size_t refs;
+} pomelo_node_ring_store_t;
+
+
 struct pomelo_node_socket_s {
     /// @brief Context
     pomelo_node_context_t * context;
@@ -31,11 +46,63 @@ struct pomelo_node_socket_s {
     /// @brief The received callback
     napi_ref on_received;
 
+    /// @brief The batched received callback (optional)
+    napi_ref on_received_batch;
+
+    /* Batched receiving */
+
+    /// @brief Flush function which is scheduled by setImmediate
+    napi_ref batch_flush;
+
+    /// @brief Reusable JS array of sessions passed to onReceivedBatch
+    napi_ref batch_js_sessions;
+
+    /// @brief Reusable JS array of messages passed to onReceivedBatch
+    napi_ref batch_js_messages;
+
+    /// @brief Pending sessions of current batch (pomelo_session_t *)
+    pomelo_array_t * batch_sessions;
+
+    /// @brief Pending messages of current batch (pomelo_message_t *)
+    pomelo_array_t * batch_messages;
+
+    /// @brief Whether the batch flush has been scheduled
+    bool batch_scheduled;
+
+    /* Receive ring */
+
+    /// @brief The ring received callback (optional)
+    napi_ref on_received_ring;
+
+    /// @brief Native storage of the ring, shared with its ArrayBuffer
+    pomelo_node_ring_store_t * ring_store;
+
+    /// @brief Bytes of the ring storage
+    uint8_t * ring_data;
+
+    /// @brief Capacity of the ring in bytes
+    size_t ring_capacity;
+
+    /// @brief Offset of the first record which has not been notified
+    size_t ring_read;
+
+    /// @brief Offset of the next record
+    size_t ring_write;
+
+    /// @brief Number of bytes which have not been notified
+    size_t ring_pending;
+
+    /// @brief Number of dropped messages since the last notification
+    uint32_t ring_dropped;
+
     /// @brief Connect result promise deferred callback
     napi_deferred on_connect_result_deferred;
 
     /// @brief Number of channels
     size_t nchannels;
+
+    /// @brief Map of session ID to native session (pomelo_session_t *)
+    pomelo_map_t * sessions_by_id;
 };
 
 
@@ -93,9 +160,43 @@ napi_value pomelo_node_socket_stop(napi_env env, napi_callback_info info);
 /// @brief Socket.send()
 napi_value pomelo_node_socket_send(napi_env env, napi_callback_info info);
 
+/// @brief Socket.sendFast()
+napi_value pomelo_node_socket_send_fast(
+    napi_env env,
+    napi_callback_info info
+);
+
 /// @brief Socket.time()
 napi_value pomelo_node_socket_time(napi_env env, napi_callback_info info);
 
+
+/// @brief Socket.multicast(
+///     channelIndex: number,
+///     message: Message,
+///     sessionIds: BigInt64Array,
+///     count?: number
+/// ): number
+napi_value pomelo_node_socket_multicast(
+    napi_env env,
+    napi_callback_info info
+);
+
+/// @brief Socket.setReceiveRing()
+napi_value pomelo_node_socket_set_receive_ring(
+    napi_env env,
+    napi_callback_info info
+);
+
+/// @brief Flush all pending received messages to onReceivedBatch
+void pomelo_node_socket_flush_received_batch(
+    pomelo_node_socket_t * node_socket
+);
+
+/// @brief Notify the listener about the pending records of receive ring
+void pomelo_node_socket_flush_received_ring(
+    pomelo_node_socket_t * node_socket
+);
+
 /// @brief Call the listener
 void pomelo_node_socket_call_listener(
     pomelo_node_socket_t * node_socket,
@@ -81,20 +81,43 @@ napi_status pomelo_node_set_function_property(
 }
 
 
+const napi_type_tag pomelo_node_type_tag_socket = {
+    0x8f1c2a6be04d4b71ULL, 0x9a3e55c2d7f01b64ULL
+};
+
+const napi_type_tag pomelo_node_type_tag_session = {
+    0x2d6b9e0f41a7c358ULL, 0xb4c81f2e6a9d0375ULL
+};
+
+const napi_type_tag pomelo_node_type_tag_message = {
+    0x5e07a4d1c39b26f8ULL, 0x71f2c0b85d4e9a13ULL
+};
+
+const napi_type_tag pomelo_node_type_tag_channel = {
+    0xc3a91d7e52b0f846ULL, 0x0e6d48b3a2c7f159ULL
+};
+
+const napi_type_tag pomelo_node_type_tag_schema = {
+    0x64f0b2e9a17d3c85ULL, 0xd95a3c0e8b2f6417ULL
+};
+
+const napi_type_tag pomelo_node_type_tag_group = {
+    0x1b8e4f72c05a9d36ULL, 0xa72d3e914f6c0b58ULL
+};
+
+
 napi_status pomelo_node_validate_native(
     napi_env env,
     napi_value thiz,
-    napi_ref clazz_ref,
+    const napi_type_tag * tag,
     void ** native
 ) {
-    bool instance_of = false;
-    napi_value clazz = NULL;
-    napi_status status = napi_get_reference_value(env, clazz_ref, &clazz);
-    if (status != napi_ok) return status;
-
-    status = napi_instanceof(env, thiz, clazz, &instance_of);
+    // Checking the tag does not walk the prototype chain like instanceof
+    bool matched = false;
+    napi_status status =
+        napi_check_object_type_tag(env, thiz, tag, &matched);
     if (status != napi_ok) return status;
-    if (!instance_of) return napi_invalid_arg;
+    if (!matched) return napi_invalid_arg;
 
     return napi_unwrap(env, thiz, native);
 }
@@ -107,7 +130,7 @@ int pomelo_node_preprocess_function_callback(
     void * p_native,
     size_t * argc,
     napi_value * argv,
-    napi_ref clazz_ref,
+    const napi_type_tag * tag,
     void * p_data
 ) {
     assert(thiz != NULL);
@@ -117,15 +140,11 @@ int pomelo_node_preprocess_function_callback(
     napi_status ret = napi_get_cb_info(env, info, argc, argv, thiz, p_data);
     if (ret != napi_ok) return -1;
 
-    napi_value clazz;
-    ret = napi_get_reference_value(env, clazz_ref, &clazz);
-    if (ret != napi_ok) return -1;
-
-    bool instance_of;
-    ret = napi_instanceof(env, *thiz, clazz, &instance_of);
+    bool matched;
+    ret = napi_check_object_type_tag(env, *thiz, tag, &matched);
     if (ret != napi_ok) return -1;
 
-    if (!instance_of) {
+    if (!matched) {
         napi_throw_type_error(env, NULL, POMELO_NODE_ERROR_INVALID_INSTANCE);
         return -1;
     }
@@ -68,11 +68,31 @@ napi_status pomelo_node_set_function_property(
 );
 
 
-/// @brief Pre-process some stubs of function callbacks
+/// @brief Type tag of Socket instances
+extern const napi_type_tag pomelo_node_type_tag_socket;
+
+/// @brief Type tag of Session instances
+extern const napi_type_tag pomelo_node_type_tag_session;
+
+/// @brief Type tag of Message instances
+extern const napi_type_tag pomelo_node_type_tag_message;
+
+/// @brief Type tag of Channel instances
+extern const napi_type_tag pomelo_node_type_tag_channel;
+
+/// @brief Type tag of compiled message schemas
+extern const napi_type_tag pomelo_node_type_tag_schema;
+
+/// @brief Type tag of SessionGroup instances
+extern const napi_type_tag pomelo_node_type_tag_group;
+
+
+/// @brief Check the type tag of an object and unwrap its native.
+/// Returns napi_invalid_arg if the object does not carry the tag.
 napi_status pomelo_node_validate_native(
     napi_env env,
     napi_value thiz,
-    napi_ref clazz_ref,
+    const napi_type_tag * tag,
     void ** native
 );
 
@@ -0,0 +1,5 @@
+import { testAutoRelease } from "./socket-test.js";
+
+// Spawned by index.js with POMELO_MESSAGE_AUTO_RELEASE=1, which is read when
+// the module is loaded
+testAutoRelease();
@@ -2,6 +2,8 @@ import testToken from "./token-test.js";
 import testMessage from "./message-test.js";
 import testSocket from "./socket-test.js";
 import { statistic } from "../lib/pomelo.js";
+import { spawn } from "node:child_process";
+import { fileURLToPath } from "node:url";
 
 function test() {
     let ret = testToken();
@@ -15,6 +17,16 @@ function test() {
 
     // Check statistic
     console.log(statistic());
+
+    // Auto-release is set when the module is loaded, test it in a process
+    spawn(
+        process.execPath,
+        [ fileURLToPath(new URL("./auto-release.js", import.meta.url)) ],
+        {
+            stdio: "inherit",
+            env: { ...process.env, POMELO_MESSAGE_AUTO_RELEASE: "1" }
+        }
+    );
 }
 
 
@@ -33,5 +33,172 @@ export default function testMessage() {
     message.writeFloat32(0.12);
     message.writeFloat64(123.456);
 
-    return true;
+    // Test writing through a writable view
+    const writable = message.writable(4);
+    if (writable.length !== 4) {
+        return false;
+    }
+    writable.set([ 1, 2, 3, 4 ]);
+    message.commit();
+
+    // Test writing structs
+    const schema = Message.compileSchema([ "uint16", "float32", "int64" ]);
+    if (message.writeStruct(schema, [ 1, 0.5, 2n, 3, 1.5, 4n ]) !== 2) {
+        return false;
+    }
+
+    if (message.writeStruct(schema, new Float64Array([ 5, 2.5, 6 ])) !== 1) {
+        return false;
+    }
+
+    valid = false;
+    try {
+        // The number of values is not a multiple of the number of fields
+        message.writeStruct(schema, [ 1, 2 ]);
+    } catch (err) {
+        valid = true;
+    }
+
+    return valid &&
+        testWritableOrder() &&
+        testWriteStructRange() &&
+        testStaleHandles() &&
+        testAcquireRelease();
+}
+
+
+/**
+ * Check if calling fn throws
+ * @param {() => void} fn The function
+ * @returns {boolean}
+ */
+function throws(fn) {
+    try {
+        fn();
+    } catch (err) {
+        return true;
+    }
+    return false;
+}
+
+
+/**
+ * Test committing the pending writable view before other writes
+ * @returns {boolean}
+ */
+function testWritableOrder() {
+    const message = new Message();
+
+    // The next write commits the pending view first
+    message.writable(4).set([ 1, 2, 3, 4 ]);
+    message.writeUint8(5);
+    if (message.size() !== 5) {
+        return false;
+    }
+
+    // The view has been committed, so commit() does not write it again
+    message.commit();
+    if (message.size() !== 5) {
+        return false;
+    }
+
+    // Another writable view commits the pending view of this message
+    const other = new Message();
+    message.writable(2).set([ 6, 7 ]);
+    other.writable(3).set([ 8, 9, 10 ]);
+    if (message.size() !== 7) {
+        return false;
+    }
+    other.commit();
+    if (other.size() !== 3) {
+        return false;
+    }
+
+    // Reset drops the pending view
+    message.writable(8);
+    message.reset();
+    message.commit();
+    return message.size() === 0;
+}
+
+
+/**
+ * Test writing structs with values which do not fit their fields
+ * @returns {boolean}
+ */
+function testWriteStructRange() {
+    const message = new Message();
+    const invalid = [
+        [ "uint8", 256 ],
+        [ "int8", -129 ],
+        [ "uint16", -1 ],
+        [ "int32", NaN ],
+        [ "uint32", Infinity ],
+        [ "uint64", -1n ],
+        [ "float32", 1e40 ]
+    ];
+
+    for (const [ type, value ] of invalid) {
+        const schema = Message.compileSchema([ "uint8", type ]);
+
+        // The first record is valid, but nothing is written
+        if (!throws(() => message.writeStruct(schema, [ 1, 1, 2, value ]))) {
+            return false;
+        }
+        if (message.size() !== 0) {
+            return false;
+        }
+    }
+
+    // Fractions of integer fields are truncated
+    const schema = Message.compileSchema([ "uint8" ]);
+    return message.writeStruct(schema, [ 255.5 ]) === 1 &&
+        message.size() === 1;
+}
+
+
+/**
+ * Test using message handles after they have been freed
+ * @returns {boolean}
+ */
+function testStaleHandles() {
+    const handle = Message.alloc();
+    Message.wu8(handle, 1);
+    if (Message.hsize(handle) !== 1) {
+        return false;
+    }
+    Message.free(handle);
+
+    // The slot may be reused, but never with the same handle
+    const next = Message.alloc();
+    const valid = next !== handle &&
+        throws(() => Message.wu8(handle, 1)) &&
+        throws(() => Message.hsize(handle)) &&
+        throws(() => Message.free(handle)) &&
+        throws(() => Message.wu8(handle + 0.5, 1)) &&
+        Message.hsize(next) === 0;
+    Message.free(next);
+    return valid;
+}
+
+
+/**
+ * Test using a message after it has been released
+ * @returns {boolean}
+ */
+function testAcquireRelease() {
+    const message = Message.acquire();
+    message.writable(4).set([ 1, 2, 3, 4 ]);
+    message.release();
+
+    // The pending view is dropped and the message cannot be used anymore
+    const valid = throws(() => message.writeUint8(1)) &&
+        throws(() => message.commit()) &&
+        throws(() => message.release());
+
+    // The pooled message comes back empty
+    const next = Message.acquire();
+    const empty = next.size() === 0;
+    next.release();
+    return valid && empty;
 }
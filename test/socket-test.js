@@ -1,4 +1,6 @@
-import { Token, Socket, Message, ChannelMode } from "../lib/pomelo.js";
+import {
+    Token, Socket, Message, ChannelMode, SessionGroup, statistic
+} from "../lib/pomelo.js";
 
 
 let client = null; // The client
@@ -18,6 +20,65 @@ const MAX_CLIENTS = 20;
 const CLIENT_ID = 123;
 const TIMEOUT = 1; // seconds
 
+/// Receive ring test: 100-byte payloads take 120-byte records, so that the
+/// 1024-byte ring wraps every 8 records
+const RING_ADDRESS = "127.0.0.1:8889";
+const RING_CAPACITY = 1024;
+const RING_MESSAGES = 32;
+const RING_PAYLOAD_BYTES = 100;
+const RING_HEADER_BYTES = 16;
+const RING_WRAP_MARKER = 0xFFFFFFFF;
+const RING_SEND_INTERVAL = 10; // ms
+
+/// Varints which take 1, 2, 3, 9 and 10 bytes
+const VARINTS = [ 0n, -65n, 8192n, -(2n ** 62n), 2n ** 63n - 1n, -(2n ** 63n) ];
+
+/// Addresses of the round-trip tests, one socket pair each
+const STRINGS_ADDRESS = "127.0.0.1:8890";
+const MIXED_BITS_ADDRESS = "127.0.0.1:8891";
+const GROUP_ADDRESS = "127.0.0.1:8892";
+const BATCH_ADDRESS = "127.0.0.1:8893";
+
+/// Batched receive test: each client sends its ID in every message
+const BATCH_CLIENT_IDS = [ 201, 202 ];
+const BATCH_MESSAGES = 16;
+
+/// Multicast test: two clients, the last one disconnects before the second
+/// multicast
+const MULTICAST_ADDRESS = "127.0.0.1:8894";
+const MULTICAST_CLIENT_IDS = [ 301, 302 ];
+const MULTICAST_UNKNOWN_ID = 399;
+
+/// Addresses of the bit-packing round-trip tests
+const VARINTS_ADDRESS = "127.0.0.1:8895";
+const BITS_1_ADDRESS = "127.0.0.1:8896";
+const BITS_32_ADDRESS = "127.0.0.1:8897";
+const QUANTIZED_ADDRESS = "127.0.0.1:8898";
+const QUATERNION_ADDRESS = "127.0.0.1:8899";
+const ALIGN_BITS_ADDRESS = "127.0.0.1:8900";
+
+/// Auto-release test, run with POMELO_MESSAGE_AUTO_RELEASE=1
+const AUTO_RELEASE_ADDRESS = "127.0.0.1:8901";
+const AUTO_RELEASE_MESSAGES = 3;
+
+/// Bits of quantized values and quaternion components
+const QUANTIZED_BITS = 16;
+const QUATERNION_BITS = 12;
+const QUATERNIONS = [
+    [ 0.5, 0.5, 0.5, 0.5 ],
+    [ 0, 0, 0.6, -0.8 ],
+    [ -0.1, 0.7, -0.1, 0.7 ]
+];
+
+/// Strings around the boundary of 1-byte and 2-byte length prefixes
+const STRINGS = [
+    "",
+    "a".repeat(127),
+    "a".repeat(128),
+    "\u00e9".repeat(63) + "a", // 127 bytes of UTF-8
+    "\u00e9".repeat(64) // 128 bytes of UTF-8
+];
+
 const clientListener = {
     onConnected: function(session) {
         try {
@@ -57,6 +118,13 @@ let stopped = false;
 const serverListener = {
     onConnected: function(session) {
         console.log(`Server session has connected ${session.id}`);
+
+        // Session group membership
+        const group = new SessionGroup();
+        const added = group.add(session) && !group.add(session);
+        const ok = added && group.has(session) && group.size === 1;
+        console.log(`Session group: ${ok ? "OK" : "Failed"}`);
+        group.remove(session);
     },
 
     onDisconnected: function(session) {
@@ -96,7 +164,7 @@ const serverListener = {
 
 export default function testSocket() {
     // Create connect token first
-    createConnectToken();
+    token = createConnectToken(ADDRESS);
 
     // Create sockets
     client = new Socket(CHANNELS);
@@ -122,11 +190,614 @@ export default function testSocket() {
         console.error("Failed to connect: ", err);
     });
 
+    testReceiveRing();
+    testStrings();
+    testMixedBits();
+    testSessionGroup();
+    testReceivedBatch();
+    testMulticast();
+    testVarints();
+    testBits1();
+    testBits32();
+    testQuantized();
+    testQuaternion();
+    testAlignBits();
     return true;
 }
 
 
-function createConnectToken() {
+/**
+ * Send a message from a client to a server on their own address and check it
+ * on the server
+ * @param {string} name The name of test
+ * @param {string} address The server address
+ * @param {(message: Message) => void} write Writes the message
+ * @param {(message: Message) => boolean} check Checks the received message
+ */
+function testRoundTrip(name, address, write, check) {
+    const pairClient = new Socket(CHANNELS);
+    const pairServer = new Socket(CHANNELS);
+    let done = false;
+
+    pairServer.setListener({
+        onConnected: function(session) {},
+        onDisconnected: function(session) {},
+        onReceived: function(session, message) {
+            if (done) {
+                return;
+            }
+
+            done = true;
+            let ok = false;
+            try {
+                ok = check(message);
+            } catch (err) {
+                console.error(err);
+            }
+            console.log(`${name}: ${ok ? "OK" : "Failed"}`);
+            pairClient.stop();
+            pairServer.stop();
+        }
+    });
+
+    pairClient.setListener({
+        onConnected: function(session) {
+            const message = new Message();
+            write(message);
+            session.send(0, message);
+        },
+        onDisconnected: function(session) {},
+        onReceived: function(session, message) {}
+    });
+
+    pairServer.listen(privateKey, PROTOCOL_ID, MAX_CLIENTS, address)
+        .catch((err) => console.error("Failed to listen: ", err));
+    pairClient.connect(createConnectToken(address))
+        .catch((err) => console.error("Failed to connect: ", err));
+}
+
+
+/**
+ * Check the round-trip of strings
+ */
+function testStrings() {
+    testRoundTrip("Strings", STRINGS_ADDRESS, (message) => {
+        for (const value of STRINGS) {
+            message.writeString(value);
+        }
+    }, (message) => {
+        return STRINGS.every((value) => message.readString() === value);
+    });
+}
+
+
+/**
+ * Check the round-trip of varints
+ */
+function testVarints() {
+    testRoundTrip("Varints", VARINTS_ADDRESS, (message) => {
+        for (const value of VARINTS) {
+            message.writeVarint(value);
+        }
+    }, (message) => {
+        return VARINTS.every((value) => message.readVarint() === value);
+    });
+}
+
+
+/**
+ * Check the round-trip of single bits
+ */
+function testBits1() {
+    const bits = [ 1, 0, 1, 1, 0, 0, 0, 1, 1 ]; // Crosses a byte boundary
+    testRoundTrip("Bits 1", BITS_1_ADDRESS, (message) => {
+        bits.forEach((bit) => message.writeBits(bit, 1));
+    }, (message) => {
+        return message.size() === 2 &&
+            bits.every((bit) => message.readBits(1) === bit);
+    });
+}
+
+
+/**
+ * Check the round-trip of 32-bit fields, aligned and unaligned
+ */
+function testBits32() {
+    const values = [ 0xFFFFFFFF, 0x12345678, 0 ];
+    testRoundTrip("Bits 32", BITS_32_ADDRESS, (message) => {
+        message.writeBits(values[0], 32);
+        message.writeBits(5, 3);
+        message.writeBits(values[1], 32);
+        message.writeBits(values[2], 32);
+    }, (message) => {
+        return message.readBits(32) === values[0] &&
+            message.readBits(3) === 5 &&
+            message.readBits(32) === values[1] &&
+            message.readBits(32) === values[2];
+    });
+}
+
+
+/**
+ * Check the round-trip of quantized values, out of range values are clamped
+ */
+function testQuantized() {
+    const values = [ -1, -0.3, 0, 0.25, 1 ];
+    const step = 2 / (2 ** QUANTIZED_BITS - 1);
+    testRoundTrip("Quantized", QUANTIZED_ADDRESS, (message) => {
+        for (const value of values) {
+            message.writeQuantized(value, -1, 1, QUANTIZED_BITS);
+        }
+        message.writeQuantized(5, 0, 1, 8);
+        message.writeQuantized(-5, 0, 1, 8);
+    }, (message) => {
+        const valid = values.every((value) => Math.abs(
+            message.readQuantized(-1, 1, QUANTIZED_BITS) - value
+        ) <= step / 2);
+        return valid &&
+            message.readQuantized(0, 1, 8) === 1 &&
+            message.readQuantized(0, 1, 8) === 0;
+    });
+}
+
+
+/**
+ * Check the round-trip of quaternions with the smallest-three compression
+ */
+function testQuaternion() {
+    const tolerance = 1e-3; // The dropped component adds the errors up
+    testRoundTrip("Quaternion", QUATERNION_ADDRESS, (message) => {
+        for (const [ x, y, z, w ] of QUATERNIONS) {
+            message.writeQuaternion(x, y, z, w, QUATERNION_BITS);
+        }
+    }, (message) => {
+        const out = new Float64Array(4);
+        return QUATERNIONS.every((expected) => {
+            const q = message.readQuaternion(QUATERNION_BITS, out);
+            const sign = Math.sign(
+                q.reduce((dot, value, i) => dot + value * expected[i], 0)
+            );
+            return q === out && expected.every((value, i) => {
+                return Math.abs(q[i] * sign - value) <= tolerance;
+            });
+        });
+    });
+}
+
+
+/**
+ * Check that alignBits() pads the writer and drops the rest of reader
+ */
+function testAlignBits() {
+    testRoundTrip("Align bits", ALIGN_BITS_ADDRESS, (message) => {
+        message.writeBits(1, 1);
+        message.alignBits();
+        message.writeBits(0x1FF, 9);
+        message.alignBits();
+        message.alignBits(); // Nothing is pending
+        message.writeBits(3, 2);
+    }, (message) => {
+        const size = message.size();
+        const first = message.readBits(1);
+        message.alignBits();
+        const second = message.readBits(9);
+        message.alignBits();
+        return size === 4 &&
+            first === 1 &&
+            second === 0x1FF &&
+            message.readBits(2) === 3;
+    });
+}
+
+
+/**
+ * Check that byte-aligned accessors align the bit cursors like alignBits()
+ */
+function testMixedBits() {
+    testRoundTrip("Mixed bits and bytes", MIXED_BITS_ADDRESS, (message) => {
+        message.writeBits(5, 3);
+        message.writeUint8(0xAB); // Pads the 3 bits to a byte
+        message.writeBits(1, 1);
+        message.writeUint16(0x1234);
+        message.writeBits(3, 2);
+        message.writeString("bits");
+        message.writeBits(0x7F, 7);
+        message.write(Uint8Array.of(9, 8));
+        message.writeBits(1, 1); // Padded when the message is sent
+    }, (message) => {
+        const bytes = message.size();
+        const valid = message.readBits(3) === 5 &&
+            message.readUint8() === 0xAB && // Drops the 5 remaining bits
+            message.readBits(1) === 1 &&
+            message.readUint16() === 0x1234 &&
+            message.readBits(2) === 3 &&
+            message.readString() === "bits" &&
+            message.readBits(7) === 0x7F;
+
+        const tail = message.read(2);
+        return valid && tail[0] === 9 && tail[1] === 8 &&
+            message.readBits(1) === 1 &&
+            bytes === 1 + 1 + 1 + 2 + 1 + 5 + 1 + 2 + 1;
+    });
+}
+
+
+/**
+ * Send payloads to a server with a small receive ring, so that the records
+ * wrap around the end of ring several times
+ */
+function testReceiveRing() {
+    const ringClient = new Socket(CHANNELS);
+    const ringServer = new Socket(CHANNELS);
+    let ring = null;
+    let received = 0;
+    let wrapped = false;
+    let valid = true;
+
+    const finish = () => {
+        const ok = valid && wrapped && received === RING_MESSAGES;
+        console.log(`Receive ring: ${ok ? "OK" : "Failed"}`);
+        ringClient.stop();
+        ringServer.stop();
+    };
+
+    ringServer.setListener({
+        onConnected: function(session) {},
+        onDisconnected: function(session) {},
+        onReceivedRing: function(begin, end, dropped) {
+            const view = new DataView(ring);
+            let offset = begin;
+            while (offset !== end) {
+                if (
+                    ring.byteLength - offset < RING_HEADER_BYTES ||
+                    view.getUint32(offset + 8, true) === RING_WRAP_MARKER
+                ) {
+                    offset = 0;
+                    wrapped = true;
+                    continue;
+                }
+
+                const id = view.getBigInt64(offset, true);
+                const length = view.getUint32(offset + 8, true);
+                const payload = new Uint8Array(
+                    ring, offset + RING_HEADER_BYTES, length
+                );
+                valid = valid &&
+                    id === BigInt(CLIENT_ID) &&
+                    length === RING_PAYLOAD_BYTES &&
+                    payload.every((value) => value === payload[0]);
+                received++;
+
+                const record = (RING_HEADER_BYTES + length + 7) & ~7;
+                offset = (offset + record) % ring.byteLength;
+                if (offset === 0) {
+                    wrapped = true;
+                }
+            }
+
+            valid = valid && dropped === 0;
+            if (received === RING_MESSAGES) {
+                finish();
+            }
+        }
+    });
+    ring = ringServer.setReceiveRing(RING_CAPACITY);
+
+    ringClient.setListener({
+        onConnected: function(session) {
+            let sent = 0;
+            const timer = setInterval(() => {
+                const message = new Message();
+                message.write(new Uint8Array(RING_PAYLOAD_BYTES).fill(sent));
+                session.sendFast(0, message);
+                if (++sent === RING_MESSAGES) {
+                    clearInterval(timer);
+                }
+            }, RING_SEND_INTERVAL);
+        },
+        onDisconnected: function(session) {},
+        onReceived: function(session, message) {}
+    });
+
+    ringServer.listen(privateKey, PROTOCOL_ID, MAX_CLIENTS, RING_ADDRESS)
+        .catch((err) => console.error("Failed to listen: ", err));
+    ringClient.connect(createConnectToken(RING_ADDRESS))
+        .catch((err) => console.error("Failed to connect: ", err));
+}
+
+
+/**
+ * Send a message to a SessionGroup through Socket.send, then check that the
+ * session leaves the group once it has disconnected
+ */
+function testSessionGroup() {
+    const groupClient = new Socket(CHANNELS);
+    const groupServer = new Socket(CHANNELS);
+    const group = new SessionGroup();
+    let sent = false;
+
+    groupServer.setListener({
+        onConnected: function(session) {
+            group.add(session);
+            const message = new Message();
+            message.writeUint8(1);
+            groupServer.send(0, message, group).then((count) => {
+                sent = count === 1;
+            }).catch((err) => console.error(err));
+        },
+        onDisconnected: function(session) {
+            // The session leaves its groups once it has been released
+            setImmediate(() => {
+                const ok = sent && group.size === 0 && !group.has(session);
+                console.log(`Session group send: ${ok ? "OK" : "Failed"}`);
+                groupServer.stop();
+            });
+        },
+        onReceived: function(session, message) {}
+    });
+
+    groupClient.setListener({
+        onConnected: function(session) {},
+        onDisconnected: function(session) {},
+        onReceived: function(session, message) {
+            // Disconnect from the server once the group message has arrived
+            setImmediate(() => groupClient.stop());
+        }
+    });
+
+    groupServer.listen(privateKey, PROTOCOL_ID, MAX_CLIENTS, GROUP_ADDRESS)
+        .catch((err) => console.error("Failed to listen: ", err));
+    groupClient.connect(createConnectToken(GROUP_ADDRESS))
+        .catch((err) => console.error("Failed to connect: ", err));
+}
+
+
+/**
+ * Receive through onReceivedBatch from two clients. Every message carries the
+ * ID of its sender, so that it can be matched with the session at the same
+ * index. The reused arrays must be cleared once the callback returns.
+ */
+function testReceivedBatch() {
+    const batchServer = new Socket(CHANNELS);
+    const batchClients = BATCH_CLIENT_IDS.map(() => new Socket(CHANNELS));
+    const total = BATCH_CLIENT_IDS.length * BATCH_MESSAGES;
+    let received = 0;
+    let valid = true;
+
+    batchServer.setListener({
+        onConnected: function(session) {},
+        onDisconnected: function(session) {},
+        onReceivedBatch: function(sessions, messages, count) {
+            valid = valid && count > 0 &&
+                count <= sessions.length && count <= messages.length;
+            for (let i = 0; i < count; i++) {
+                valid = valid && messages[i].readInt64() === sessions[i].id;
+            }
+            received += count;
+
+            setImmediate(() => {
+                for (let i = 0; i < count; i++) {
+                    valid = valid &&
+                        sessions[i] === undefined &&
+                        messages[i] === undefined;
+                }
+
+                if (received !== total) {
+                    return;
+                }
+
+                console.log(`Received batch: ${valid ? "OK" : "Failed"}`);
+                batchClients.forEach((batchClient) => batchClient.stop());
+                batchServer.stop();
+            });
+        }
+    });
+
+    batchServer.listen(privateKey, PROTOCOL_ID, MAX_CLIENTS, BATCH_ADDRESS)
+        .catch((err) => console.error("Failed to listen: ", err));
+
+    batchClients.forEach((batchClient, index) => {
+        const clientID = BATCH_CLIENT_IDS[index];
+        batchClient.setListener({
+            onConnected: function(session) {
+                for (let i = 0; i < BATCH_MESSAGES; i++) {
+                    const message = new Message();
+                    message.writeInt64(BigInt(clientID));
+                    session.send(0, message);
+                }
+            },
+            onDisconnected: function(session) {},
+            onReceived: function(session, message) {}
+        });
+
+        batchClient.connect(createConnectToken(BATCH_ADDRESS, clientID))
+            .catch((err) => console.error("Failed to connect: ", err));
+    });
+}
+
+
+/**
+ * Multicast to session IDs: the resolved count skips unknown IDs and the IDs
+ * of sessions which have disconnected
+ */
+function testMulticast() {
+    const multicastServer = new Socket(CHANNELS);
+    const multicastClients =
+        MULTICAST_CLIENT_IDS.map(() => new Socket(CHANNELS));
+    const ids = BigInt64Array.from(
+        [ ...MULTICAST_CLIENT_IDS, MULTICAST_UNKNOWN_ID ].map(BigInt)
+    );
+    const leaving = multicastClients[multicastClients.length - 1];
+    let connected = 0;
+    let valid = true;
+    let done = false;
+
+    const multicast = (count) => {
+        const message = new Message();
+        message.writeUint8(1);
+        return multicastServer.multicast(0, message, ids, count);
+    };
+
+    multicastServer.setListener({
+        onConnected: function(session) {
+            if (++connected < MULTICAST_CLIENT_IDS.length) {
+                return;
+            }
+
+            valid = valid &&
+                multicast() === MULTICAST_CLIENT_IDS.length &&
+                multicast(1) === 1;
+            leaving.stop();
+        },
+        onDisconnected: function(session) {
+            if (done) {
+                return;
+            }
+
+            // The ID is removed from the socket once the session is released
+            done = true;
+            setImmediate(() => {
+                const ok = valid &&
+                    multicast() === MULTICAST_CLIENT_IDS.length - 1;
+                console.log(`Multicast: ${ok ? "OK" : "Failed"}`);
+                multicastClients.forEach((multicastClient) => {
+                    if (multicastClient !== leaving) {
+                        multicastClient.stop();
+                    }
+                });
+                multicastServer.stop();
+            });
+        },
+        onReceived: function(session, message) {}
+    });
+
+    multicastServer.listen(
+        privateKey, PROTOCOL_ID, MAX_CLIENTS, MULTICAST_ADDRESS
+    ).catch((err) => console.error("Failed to listen: ", err));
+
+    multicastClients.forEach((multicastClient, index) => {
+        multicastClient.setListener({
+            onConnected: function(session) {},
+            onDisconnected: function(session) {},
+            onReceived: function(session, message) {}
+        });
+
+        const clientID = MULTICAST_CLIENT_IDS[index];
+        multicastClient.connect(
+            createConnectToken(MULTICAST_ADDRESS, clientID)
+        ).catch((err) => console.error("Failed to connect: ", err));
+    });
+}
+
+
+/**
+ * Check the received messages with POMELO_MESSAGE_AUTO_RELEASE=1. The client
+ * sends the next message once the server has replied, so that the checks of
+ * a message run before the next one arrives:
+ * - The first message is released once onReceived has returned.
+ * - The second message reuses its object and is retained.
+ * - The third message takes another object, the retained one stays valid.
+ */
+export function testAutoRelease() {
+    const autoClient = new Socket(CHANNELS);
+    const autoServer = new Socket(CHANNELS);
+    const before = statistic().binding;
+    const messages = [];
+    let valid = true;
+
+    const isReleased = (message) => {
+        try {
+            message.readUint8();
+        } catch (err) {
+            return true;
+        }
+        return false;
+    };
+
+    const finish = () => {
+        const after = statistic().binding;
+        const autoReleased =
+            after.messagesAutoReleased - before.messagesAutoReleased;
+        const retained = after.messagesRetained - before.messagesRetained;
+        // Every message but the retained one, and the replies of server
+        const ok = valid &&
+            autoReleased === 2 * (AUTO_RELEASE_MESSAGES - 1) &&
+            retained === 1;
+        console.log(`Auto release: ${ok ? "OK" : "Failed"}`);
+        autoClient.stop();
+        autoServer.stop();
+    };
+
+    autoServer.setListener({
+        onConnected: function(session) {},
+        onDisconnected: function(session) {},
+        onReceived: function(session, message) {
+            const index = messages.length;
+            messages.push(message);
+            if (index === 1) {
+                // The wrapper of the released first message is recycled
+                valid = valid && message === messages[0];
+                valid = valid && message.retain() === message;
+            } else if (index === 2) {
+                valid = valid && message !== messages[1];
+            } else {
+                valid = valid && message.readUint8() === index;
+            }
+
+            setImmediate(() => {
+                if (index === 0) {
+                    valid = valid && isReleased(messages[0]);
+                } else if (index === 1) {
+                    valid = valid && messages[1].readUint8() === index;
+                } else {
+                    valid = valid && isReleased(messages[2]);
+                    messages[1].release();
+                    finish();
+                    return;
+                }
+
+                const reply = new Message();
+                reply.writeUint8(index);
+                session.send(0, reply);
+            });
+        }
+    });
+
+    let sent = 0;
+    const sendNext = (session) => {
+        const message = new Message();
+        message.writeUint8(sent++);
+        session.send(0, message);
+    };
+
+    autoClient.setListener({
+        onConnected: function(session) {
+            sendNext(session);
+        },
+        onDisconnected: function(session) {},
+        onReceived: function(session, message) {
+            if (sent < AUTO_RELEASE_MESSAGES) {
+                sendNext(session);
+            }
+        }
+    });
+
+    const token = createConnectToken(AUTO_RELEASE_ADDRESS);
+    autoServer.listen(
+        privateKey, PROTOCOL_ID, MAX_CLIENTS, AUTO_RELEASE_ADDRESS
+    ).catch((err) => console.error("Failed to listen: ", err));
+    autoClient.connect(token)
+        .catch((err) => console.error("Failed to connect: ", err));
+}
+
+
+/**
+ * Create a connect token for an address
+ * @param {string} address The server address
+ * @param {number} [clientID] The client ID
+ * @returns {Uint8Array} The connect token
+ */
+function createConnectToken(address, clientID = CLIENT_ID) {
     const privateKeyArray = new Array(Token.KEY_BYTES);
     const serverToClientKeyArray = new Array(Token.KEY_BYTES);
     const clientToServerKeyArray = new Array(Token.KEY_BYTES);
@@ -145,17 +816,17 @@ function createConnectToken() {
     }
 
     privateKey = Uint8Array.from(privateKeyArray);
-    token = Token.encode(
+    return Token.encode(
         privateKey,
         PROTOCOL_ID,
         Date.now(),
         Date.now() + 3600 * 1000000000,
         Uint8Array.from(connectTokenNonceArray),
         TIMEOUT,
-        [ ADDRESS ],
+        [ address ],
         Uint8Array.from(clientToServerKeyArray),
         Uint8Array.from(serverToClientKeyArray),
-        CLIENT_ID,
+        clientID,
         Uint8Array.from(userData)
     );
 }